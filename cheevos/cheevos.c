@@ -42,6 +42,7 @@
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
+#include <array/rbuf.h>
 #endif
 
 #ifdef HAVE_CHEATS
@@ -77,6 +78,13 @@
 #include "../deps/rcheevos/include/rc_runtime_types.h"
 #include "../deps/rcheevos/include/rc_hash.h"
 #include "../deps/rcheevos/src/rc_libretro.h"
+#ifdef RCHEEVOS_THREADED_EVAL
+/* Private to rcheevos: rc_client has no public accessor for the
+ * memrefs of the loaded game, or for the mutex that guards them
+ * while a subset loads, both of which rcheevos_eval_frame() uses.
+ * Check those uses whenever deps/rcheevos is updated. */
+#include "../deps/rcheevos/src/rc_client_internal.h"
+#endif
 
 /* Define this macro to prevent cheevos from being deactivated when they trigger. */
 #undef CHEEVOS_DONT_DEACTIVATE
@@ -85,9 +93,13 @@ static rcheevos_locals_t rcheevos_locals =
 {
    NULL, /* client */
    {{0}},/* memory */
+   {0},  /* memory_pages */
 #ifdef HAVE_THREADS
    CMD_EVENT_NONE, /* queued_command */
    false, /* game_placard_requested */
+#endif
+#ifdef RCHEEVOS_THREADED_EVAL
+   {0},   /* eval */
 #endif
    "",   /* user_agent_prefix */
    "",   /* user_agent_core */
@@ -122,6 +134,416 @@ void rcheevos_log(const char* fmt, ...)
 }
 #endif
 
+#ifdef RCHEEVOS_THREADED_EVAL
+
+/*****************************************************************************
+Threaded evaluation. At the end of each frame, the memory read by the active
+achievements is copied to a snapshot, and rc_client_do_frame runs against it
+on a worker thread while the core runs the next frame. Events raised and
+server calls made on that thread are held until the main thread next waits
+for it, so they are seen one frame later.
+*****************************************************************************/
+
+/* Pointer chains can read anywhere, so sets using them get a
+ * snapshot of all of memory, as long as it is no larger than this */
+#define RCHEEVOS_EVAL_MAX_SNAPSHOT CHEEVOS_MB(4)
+
+static void rcheevos_client_event_handler(const rc_client_event_t* event,
+      rc_client_t* client);
+
+static bool rcheevos_eval_on_thread(void)
+{
+   return rcheevos_locals.eval.thread
+      && sthread_isself(rcheevos_locals.eval.thread);
+}
+
+static uint32_t rcheevos_eval_read_memory(uint32_t address,
+      uint8_t* buffer, uint32_t num_bytes)
+{
+   const rcheevos_eval_t* eval = &rcheevos_locals.eval;
+   size_t lo                   = 0;
+   size_t hi                   = RBUF_LEN(eval->ranges);
+
+   /* Find the first range that ends past the address */
+   while (lo < hi)
+   {
+      const size_t mid = (lo + hi) / 2;
+      if ((uint64_t)eval->ranges[mid].address
+            + eval->ranges[mid].size <= address)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   if (lo < RBUF_LEN(eval->ranges))
+   {
+      const rcheevos_eval_range_t* range = &eval->ranges[lo];
+      const uint32_t offset = address - range->address;
+
+      if (     address >= range->address
+            && num_bytes <= range->size - offset)
+      {
+         memcpy(buffer, eval->snapshot[eval->front]
+               + range->offset + offset, num_bytes);
+         return num_bytes;
+      }
+   }
+
+   /* Not in the snapshot, so not mapped either */
+   return 0;
+}
+
+static void rcheevos_eval_add_range(rcheevos_eval_t* eval,
+      uint32_t address, uint32_t size)
+{
+   /* Only keep the bytes a read from the core would find, so
+    * that reads from the snapshot fail exactly when those do */
+   while (size)
+   {
+      uint32_t avail;
+      rcheevos_eval_range_t range;
+
+      if (!rc_libretro_memory_find_avail(&rcheevos_locals.memory,
+               address, &avail) || !avail)
+         break;
+
+      range.address = address;
+      range.size    = MIN(size, avail);
+      range.offset  = 0;
+      RBUF_PUSH(eval->ranges, range);
+
+      address      += range.size;
+      size         -= range.size;
+   }
+}
+
+static int rcheevos_eval_range_cmp(const void* a, const void* b)
+{
+   const uint32_t address_a = ((const rcheevos_eval_range_t*)a)->address;
+   const uint32_t address_b = ((const rcheevos_eval_range_t*)b)->address;
+   return (address_a > address_b) - (address_a < address_b);
+}
+
+/* Checks whether the ranges were built for these memrefs.
+ * Every address is compared, as the memrefs of a subset that
+ * was loaded or disabled can't be told apart any other way. */
+static bool rcheevos_eval_layout_matches(const rcheevos_eval_t* eval,
+      const rc_memref_t* memref, bool* indirect)
+{
+   size_t i     = 0;
+   bool matches = eval->layout_valid;
+
+   *indirect    = false;
+
+   for (; memref; memref = memref->next)
+   {
+      if (memref->value.is_indirect)
+         *indirect = true;
+      else
+      {
+         if (     i >= RBUF_LEN(eval->addresses)
+               || eval->addresses[i] != memref->address)
+            matches = false;
+         i++;
+      }
+   }
+
+   return matches
+      && i == RBUF_LEN(eval->addresses)
+      && *indirect == eval->indirect;
+}
+
+static void rcheevos_eval_set_layout(rcheevos_eval_t* eval,
+      const rc_memref_t* memref, bool indirect)
+{
+   RBUF_CLEAR(eval->addresses);
+
+   for (; memref; memref = memref->next)
+      if (!memref->value.is_indirect)
+         RBUF_PUSH(eval->addresses, memref->address);
+
+   eval->indirect     = indirect;
+   eval->layout_valid = true;
+}
+
+static void rcheevos_eval_build_ranges(rcheevos_eval_t* eval,
+      const rc_memref_t* memref, bool indirect)
+{
+   size_t i, j;
+   size_t size = 0;
+
+   RBUF_CLEAR(eval->ranges);
+
+   if (indirect)
+   {
+      const rc_libretro_memory_regions_t* memory = &rcheevos_locals.memory;
+      uint64_t address = 0;
+
+      for (i = 0; i < memory->count && address < ((uint64_t)1 << 32); i++)
+      {
+         if (memory->data[i])
+            rcheevos_eval_add_range(eval, (uint32_t)address,
+                  (uint32_t)MIN(memory->size[i],
+                     ((uint64_t)1 << 32) - address));
+         address += memory->size[i];
+      }
+   }
+   else
+   {
+      /* No value is wider than 32 bits */
+      for (; memref; memref = memref->next)
+         rcheevos_eval_add_range(eval, memref->address, 4);
+   }
+
+   qsort(eval->ranges, RBUF_LEN(eval->ranges), sizeof(*eval->ranges),
+         rcheevos_eval_range_cmp);
+
+   /* Merge overlapping and adjacent ranges */
+   for (i = 0, j = 0; i < RBUF_LEN(eval->ranges); i++)
+   {
+      rcheevos_eval_range_t* last = j ? &eval->ranges[j - 1] : NULL;
+      const uint64_t end = (uint64_t)eval->ranges[i].address
+         + eval->ranges[i].size;
+
+      if (last && eval->ranges[i].address <= (uint64_t)last->address + last->size)
+      {
+         if (end > (uint64_t)last->address + last->size)
+            last->size = (uint32_t)(end - last->address);
+      }
+      else
+         eval->ranges[j++] = eval->ranges[i];
+   }
+   RBUF_RESIZE(eval->ranges, j);
+
+   for (i = 0; i < j; i++)
+   {
+      eval->ranges[i].offset = size;
+      size                  += eval->ranges[i].size;
+   }
+
+   if (size > RCHEEVOS_EVAL_MAX_SNAPSHOT)
+   {
+      CHEEVOS_LOG(RCHEEVOS_TAG "%u bytes of memory to snapshot, evaluating on the main thread\n",
+            (unsigned)size);
+      RBUF_CLEAR(eval->ranges);
+      return;
+   }
+
+   if (size > eval->snapshot_size)
+   {
+      uint8_t* front = (uint8_t*)realloc(eval->snapshot[0], size);
+      uint8_t* back  = front ? (uint8_t*)realloc(eval->snapshot[1], size) : NULL;
+
+      if (front)
+         eval->snapshot[0] = front;
+      if (back)
+         eval->snapshot[1] = back;
+
+      if (!front || !back)
+      {
+         RBUF_CLEAR(eval->ranges);
+         return;
+      }
+
+      eval->snapshot_size = size;
+   }
+}
+
+static void rcheevos_eval_copy(const rcheevos_eval_t* eval, uint8_t* snapshot)
+{
+   size_t i;
+   for (i = 0; i < RBUF_LEN(eval->ranges); i++)
+      rcheevos_memory_pages_read(&rcheevos_locals.memory_pages,
+            &rcheevos_locals.memory, eval->ranges[i].address,
+            snapshot + eval->ranges[i].offset, eval->ranges[i].size);
+}
+
+/* Must only be called while the thread is idle */
+static void rcheevos_eval_flush(rcheevos_eval_t* eval, bool raise_events)
+{
+   size_t i;
+   /* Handlers can end up back here (i.e. a reset), take the lists first */
+   rcheevos_eval_call_t* calls = eval->calls;
+   rc_client_event_t* events   = eval->events;
+
+   eval->calls                 = NULL;
+   eval->events                = NULL;
+
+   for (i = 0; i < RBUF_LEN(calls); i++)
+   {
+      rc_api_request_t request;
+      memset(&request, 0, sizeof(request));
+      request.url          = calls[i].url;
+      request.post_data    = calls[i].post_data;
+      request.content_type = calls[i].content_type;
+
+      rcheevos_client_server_call(&request, calls[i].callback,
+            calls[i].callback_data, rcheevos_locals.client);
+
+      free(calls[i].url);
+      free(calls[i].post_data);
+      free(calls[i].content_type);
+   }
+
+   /* The events point into the game, which is still loaded */
+   if (raise_events)
+      for (i = 0; i < RBUF_LEN(events); i++)
+         rcheevos_client_event_handler(&events[i], rcheevos_locals.client);
+
+   /* Keep the storage unless new items were queued meanwhile */
+   RBUF_CLEAR(calls);
+   RBUF_CLEAR(events);
+   if (!eval->calls)
+      eval->calls  = calls;
+   else
+      RBUF_FREE(calls);
+   if (!eval->events)
+      eval->events = events;
+   else
+      RBUF_FREE(events);
+}
+
+static void rcheevos_eval_wait(rcheevos_eval_t* eval)
+{
+   slock_lock(eval->lock);
+   while (eval->busy)
+      scond_wait(eval->cond, eval->lock);
+   slock_unlock(eval->lock);
+}
+
+static void rcheevos_eval_thread(void* userdata)
+{
+   rcheevos_eval_t* eval = (rcheevos_eval_t*)userdata;
+
+   slock_lock(eval->lock);
+   for (;;)
+   {
+      while (!eval->busy && !eval->quit)
+         scond_wait(eval->cond, eval->lock);
+
+      if (eval->quit)
+         break;
+
+      slock_unlock(eval->lock);
+      rc_client_do_frame(rcheevos_locals.client);
+      slock_lock(eval->lock);
+
+      eval->busy = false;
+      scond_signal(eval->cond);
+   }
+   slock_unlock(eval->lock);
+}
+
+static bool rcheevos_eval_start(rcheevos_eval_t* eval)
+{
+   if (     !(eval->lock = slock_new())
+         || !(eval->cond = scond_new())
+         || !(eval->thread = sthread_create(rcheevos_eval_thread, eval)))
+   {
+      CHEEVOS_ERR(RCHEEVOS_TAG "Failed to create evaluation thread\n");
+      if (eval->cond)
+         scond_free(eval->cond);
+      if (eval->lock)
+         slock_free(eval->lock);
+      eval->cond = NULL;
+      eval->lock = NULL;
+      return false;
+   }
+
+   CHEEVOS_LOG(RCHEEVOS_TAG "Evaluating achievements on a separate thread\n");
+   return true;
+}
+
+static void rcheevos_eval_stop(rcheevos_eval_t* eval)
+{
+   if (!eval->thread)
+      return;
+
+   rcheevos_eval_wait(eval);
+
+   slock_lock(eval->lock);
+   eval->quit = true;
+   scond_signal(eval->cond);
+   slock_unlock(eval->lock);
+
+   sthread_join(eval->thread);
+   eval->thread = NULL;
+
+   /* Still send the unlocks and submissions of the last frame */
+   rcheevos_eval_flush(eval, false);
+
+   scond_free(eval->cond);
+   slock_free(eval->lock);
+   RBUF_FREE(eval->ranges);
+   RBUF_FREE(eval->addresses);
+   RBUF_FREE(eval->events);
+   RBUF_FREE(eval->calls);
+   free(eval->snapshot[0]);
+   free(eval->snapshot[1]);
+   memset(eval, 0, sizeof(*eval));
+}
+
+/* Returns false if this frame must be evaluated on the main thread */
+static bool rcheevos_eval_frame(rcheevos_eval_t* eval)
+{
+   rc_client_t* client = rcheevos_locals.client;
+   bool indirect;
+
+   if (!eval->thread && !rcheevos_eval_start(eval))
+      return false;
+
+   /* Copy this frame while the last one is still being evaluated */
+   rcheevos_eval_copy(eval, eval->snapshot[eval->front ^ 1]);
+
+   rcheevos_eval_wait(eval);
+   rcheevos_eval_flush(eval, true);
+
+   /* Handling the events may have unloaded the game */
+   if (!eval->thread || !client->game)
+      return false;
+
+   /* Achievements, leaderboards or whole subsets may have been
+    * added or disabled, or memory remapped. The thread is idle,
+    * but the memrefs may still be changed by a loading subset. */
+   rc_mutex_lock(&client->state.mutex);
+   if (!rcheevos_eval_layout_matches(eval,
+            client->game->runtime.memrefs, &indirect))
+   {
+      rcheevos_eval_build_ranges(eval, client->game->runtime.memrefs,
+            indirect);
+      rcheevos_eval_copy(eval, eval->snapshot[eval->front ^ 1]);
+      rcheevos_eval_set_layout(eval, client->game->runtime.memrefs,
+            indirect);
+   }
+   rc_mutex_unlock(&client->state.mutex);
+
+   if (!RBUF_LEN(eval->ranges))
+      return false;
+
+   slock_lock(eval->lock);
+   eval->front ^= 1;
+   eval->busy   = true;
+   scond_signal(eval->cond);
+   slock_unlock(eval->lock);
+
+   return true;
+}
+
+#endif
+
+/* Waits for the frame being evaluated on the thread, if any,
+ * and handles what it raised */
+static void rcheevos_eval_sync(void)
+{
+#ifdef RCHEEVOS_THREADED_EVAL
+   if (rcheevos_locals.eval.thread)
+   {
+      rcheevos_eval_wait(&rcheevos_locals.eval);
+      rcheevos_eval_flush(&rcheevos_locals.eval, true);
+   }
+#endif
+}
+
 static void rcheevos_handle_log_message(const char* message)
 {
    CHEEVOS_LOG(RCHEEVOS_TAG "%s\n", message);
@@ -179,6 +601,14 @@ static int rcheevos_init_memory(rcheevos_locals_t* locals)
    result = rc_libretro_memory_init(&locals->memory, &mmap,
          rcheevos_get_core_memory_info, console_id);
 
+   if (!rcheevos_memory_pages_init(&locals->memory_pages, &locals->memory))
+      CHEEVOS_ERR(RCHEEVOS_TAG "Failed to allocate memory page table\n");
+
+#ifdef RCHEEVOS_THREADED_EVAL
+   /* Snapshot ranges must be rebuilt for the new mapping */
+   locals->eval.layout_valid = false;
+#endif
+
    free(descriptors);
    return result;
 }
@@ -209,6 +639,8 @@ static bool rcheevos_is_player_active(void)
 
 void rcheevos_spectating_changed(void)
 {
+   rcheevos_eval_sync();
+
    /* don't update spectator mode while a game is loading - it prevents being able to change it later */
    if (rcheevos_is_game_loaded())
    {
@@ -526,6 +958,17 @@ static void rcheevos_server_reconnected(void)
 
 static void rcheevos_client_event_handler(const rc_client_event_t* event, rc_client_t* client)
 {
+#ifdef RCHEEVOS_THREADED_EVAL
+   /* Raised while evaluating a snapshot, handled on the next sync.
+    * Server errors and scoreboards, which point to temporary data,
+    * only come from server responses and never from there. */
+   if (rcheevos_eval_on_thread())
+   {
+      RBUF_PUSH(rcheevos_locals.eval.events, *event);
+      return;
+   }
+#endif
+
    switch (event->type)
    {
 #ifdef HAVE_GFX_WIDGETS
@@ -637,6 +1080,7 @@ void rcheevos_reset_game(bool widgets_ready)
    rcheevos_hide_widgets(widgets_ready);
 #endif
 
+   rcheevos_eval_sync();
    rc_client_reset(rcheevos_locals.client);
 
    /* Some cores reallocate memory on reset,
@@ -647,6 +1091,7 @@ void rcheevos_reset_game(bool widgets_ready)
 
 void rcheevos_refresh_memory(void)
 {
+   rcheevos_eval_sync();
    if (rcheevos_locals.memory.total_size > 0)
       rcheevos_init_memory(&rcheevos_locals);
 }
@@ -680,6 +1125,9 @@ bool rcheevos_unload(void)
    gfx_widget_set_cheevos_set_loading(false);
 #endif
 
+#ifdef RCHEEVOS_THREADED_EVAL
+   rcheevos_eval_stop(&rcheevos_locals.eval);
+#endif
    rc_client_unload_game(rcheevos_locals.client);
 
 #ifdef HAVE_THREADS
@@ -689,6 +1137,7 @@ bool rcheevos_unload(void)
 
    if (rcheevos_locals.memory.count > 0)
       rc_libretro_memory_destroy(&rcheevos_locals.memory);
+   rcheevos_memory_pages_free(&rcheevos_locals.memory_pages);
 
    if (was_loaded)
    {
@@ -751,6 +1200,8 @@ static void rcheevos_toggle_hardcore_active(rcheevos_locals_t* locals)
    bool rewind_enable   = settings->bools.rewind_enable;
    const bool was_enabled = rcheevos_hardcore_active();
 
+   rcheevos_eval_sync();
+
    if (!was_enabled)
    {
       locals->hardcore_being_enabled = true;
@@ -1000,28 +1451,46 @@ void rcheevos_test(void)
 #endif
 
    if (rcheevos_locals.memory.count != 0)
+   {
+#ifdef RCHEEVOS_THREADED_EVAL
+      if (config_get_ptr()->bools.cheevos_threaded_evaluation)
+      {
+         if (rcheevos_eval_frame(&rcheevos_locals.eval))
+            return;
+      }
+      else if (rcheevos_locals.eval.thread)
+      {
+         rcheevos_eval_sync();
+         rcheevos_eval_stop(&rcheevos_locals.eval);
+      }
+#endif
       rc_client_do_frame(rcheevos_locals.client);
+   }
    else
       rc_client_idle(rcheevos_locals.client);
 }
 
 void rcheevos_idle(void)
 {
+   rcheevos_eval_sync();
    rc_client_idle(rcheevos_locals.client);
 }
 
 size_t rcheevos_get_serialize_size(void)
 {
+   rcheevos_eval_sync();
    return rc_client_progress_size(rcheevos_locals.client);
 }
 
 bool rcheevos_get_serialized_data(void* buffer)
 {
+   rcheevos_eval_sync();
    return (rc_client_serialize_progress(rcheevos_locals.client, (uint8_t*)buffer) == RC_OK);
 }
 
 bool rcheevos_set_serialized_data(void* buffer)
 {
+   rcheevos_eval_sync();
    if (rcheevos_is_game_loaded() && buffer)
    {
       const int result = rc_client_deserialize_progress(
@@ -1282,7 +1751,34 @@ static void rcheevos_show_game_placard(void)
 static uint32_t rcheevos_client_read_memory(uint32_t address,
    uint8_t* buffer, uint32_t num_bytes, rc_client_t* client)
 {
-   return rc_libretro_memory_read(&rcheevos_locals.memory, address, buffer, num_bytes);
+#ifdef RCHEEVOS_THREADED_EVAL
+   if (rcheevos_eval_on_thread())
+      return rcheevos_eval_read_memory(address, buffer, num_bytes);
+#endif
+   return rcheevos_memory_pages_read(&rcheevos_locals.memory_pages,
+         &rcheevos_locals.memory, address, buffer, num_bytes);
+}
+
+static void rcheevos_server_call(const rc_api_request_t* request,
+   rc_client_server_callback_t callback, void* callback_data, rc_client_t* client)
+{
+#ifdef RCHEEVOS_THREADED_EVAL
+   /* Unlocks and submissions made while evaluating a snapshot
+    * are sent from the main thread on the next sync */
+   if (rcheevos_eval_on_thread())
+   {
+      rcheevos_eval_call_t call;
+      call.url           = request->url ? strdup(request->url) : NULL;
+      call.post_data     = request->post_data ? strdup(request->post_data) : NULL;
+      call.content_type  = request->content_type ? strdup(request->content_type) : NULL;
+      call.callback      = callback;
+      call.callback_data = callback_data;
+      RBUF_PUSH(rcheevos_locals.eval.calls, call);
+      return;
+   }
+#endif
+
+   rcheevos_client_server_call(request, callback, callback_data, client);
 }
 
 static uint32_t rcheevos_client_read_memory_dummy(uint32_t address,
@@ -1535,11 +2031,14 @@ bool rcheevos_load(const void *data)
 
    if (rcheevos_locals.client)
    {
+#ifdef RCHEEVOS_THREADED_EVAL
+      rcheevos_eval_stop(&rcheevos_locals.eval);
+#endif
       rc_client_unload_game(rcheevos_locals.client);
    }
    else
    {
-      rcheevos_locals.client = rc_client_create(rcheevos_client_read_memory, rcheevos_client_server_call);
+      rcheevos_locals.client = rc_client_create(rcheevos_client_read_memory, rcheevos_server_call);
       rc_client_enable_logging(rcheevos_locals.client, RC_CLIENT_LOG_LEVEL_VERBOSE, rcheevos_client_log_message);
       rc_client_set_event_handler(rcheevos_locals.client, rcheevos_client_event_handler);
       rc_client_set_get_time_millisecs_function(rcheevos_locals.client, rcheevos_client_get_time_millisecs);
@@ -33,6 +33,8 @@
 #include "../command.h"
 #include "../verbosity.h"
 
+#include "cheevos_memory.h"
+
 RETRO_BEGIN_DECLS
 
 /************************************************************************
@@ -79,15 +81,60 @@ typedef struct rcheevos_menuitem_t
 
 #endif
 
+/* Evaluating on a worker thread relies on the rc_client mutexes,
+ * which RC_NO_THREADS compiles out of rcheevos */
+#if defined(HAVE_THREADS) && !defined(RC_NO_THREADS)
+#define RCHEEVOS_THREADED_EVAL
+
+typedef struct rcheevos_eval_range_t
+{
+   uint32_t address;                  /* first achievement address of the range */
+   uint32_t size;                     /* number of bytes in the range */
+   size_t offset;                     /* position of the range in the snapshots */
+} rcheevos_eval_range_t;
+
+typedef struct rcheevos_eval_call_t
+{
+   char* url;
+   char* post_data;
+   char* content_type;
+   rc_client_server_callback_t callback;
+   void* callback_data;
+} rcheevos_eval_call_t;
+
+typedef struct rcheevos_eval_t
+{
+   sthread_t* thread;                 /* evaluates the front snapshot */
+   slock_t* lock;
+   scond_t* cond;
+   rcheevos_eval_range_t* ranges;     /* RBUF, sorted by address */
+   rc_client_event_t* events;         /* RBUF, raised while evaluating, handled on the main thread */
+   rcheevos_eval_call_t* calls;       /* RBUF, made while evaluating, sent from the main thread */
+   uint8_t* snapshot[2];              /* memory covered by ranges, front and back */
+   size_t snapshot_size;              /* size of each snapshot */
+   uint32_t* addresses;               /* RBUF, addresses of the direct memrefs ranges were built for */
+   bool indirect;                     /* ranges were built for memrefs including indirect ones */
+   bool layout_valid;                 /* ranges match addresses and indirect, false to rebuild */
+   unsigned front;                    /* index of the snapshot being evaluated */
+   bool busy;                         /* thread is evaluating the front snapshot */
+   bool quit;                         /* thread should exit */
+} rcheevos_eval_t;
+
+#endif
+
 typedef struct rcheevos_locals_t
 {
    rc_client_t* client;               /* rcheevos client state */
    rc_libretro_memory_regions_t memory;/* achievement addresses to core memory mappings */
+   rcheevos_memory_pages_t memory_pages;/* page table built from memory, used for reads */
 
 #ifdef HAVE_THREADS
    enum event_command queued_command; /* action queued by background thread to be run on main thread */
    bool game_placard_requested;       /* request to display game placard */
 #endif
+#ifdef RCHEEVOS_THREADED_EVAL
+   rcheevos_eval_t eval;              /* threaded evaluation state */
+#endif
 
    char user_agent_prefix[128];       /* RetroArch/OS version information */
    char user_agent_core[256];         /* RetroArch/OS/Core version information */
@@ -0,0 +1,115 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2023 The RetroArch team
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "cheevos_memory.h"
+
+bool rcheevos_memory_pages_init(rcheevos_memory_pages_t* pages,
+      const rc_libretro_memory_regions_t* regions)
+{
+   uint32_t i;
+   uint32_t count;
+   uint32_t shift  = RCHEEVOS_MEMORY_PAGE_SHIFT;
+   uint64_t total  = regions->total_size;
+   uint64_t start;
+
+   /* Achievement addresses are 32-bit */
+   if (total > ((uint64_t)1 << 32))
+      total = (uint64_t)1 << 32;
+
+   /* Pages only grow if the table would be too large. Pages
+    * that straddle a region boundary are left NULL below, and
+    * just take the slow path */
+   while ((total >> shift) > RCHEEVOS_MEMORY_MAX_PAGES)
+      shift++;
+
+   count = (uint32_t)((total + ((1 << shift) - 1)) >> shift);
+
+   if (count != pages->count || !pages->page)
+   {
+      free(pages->page);
+      pages->page  = NULL;
+      pages->count = 0;
+
+      if (count && !(pages->page = (uint8_t**)malloc(
+                  count * sizeof(*pages->page))))
+         return false;
+   }
+
+   pages->count = count;
+   pages->shift = shift;
+   pages->mask  = (1 << shift) - 1;
+
+   if (count)
+      memset(pages->page, 0, count * sizeof(*pages->page));
+
+   for (i = 0, start = 0; i < regions->count && start < total; i++)
+   {
+      uint64_t end  = start + regions->size[i];
+      uint64_t page = (start + pages->mask) >> shift;
+
+      if (regions->data[i])
+         for (; page < count && ((page + 1) << shift) <= end; page++)
+            pages->page[page] = regions->data[i]
+               + (size_t)((page << shift) - start);
+
+      start = end;
+   }
+
+   return true;
+}
+
+void rcheevos_memory_pages_free(rcheevos_memory_pages_t* pages)
+{
+   free(pages->page);
+   memset(pages, 0, sizeof(*pages));
+}
+
+uint32_t rcheevos_memory_pages_read(const rcheevos_memory_pages_t* pages,
+      const rc_libretro_memory_regions_t* regions, uint32_t address,
+      uint8_t* buffer, uint32_t num_bytes)
+{
+   const uint32_t page   = address >> pages->shift;
+   const uint32_t offset = address &  pages->mask;
+
+   if (     page < pages->count
+         && pages->page[page]
+         && num_bytes <= pages->mask + 1 - offset)
+   {
+      const uint8_t *src = pages->page[page] + offset;
+
+      /* Conditions only ever read 1 to 4 bytes */
+      switch (num_bytes)
+      {
+         case 1:
+            buffer[0] = src[0];
+            break;
+         case 2:
+            memcpy(buffer, src, 2);
+            break;
+         case 4:
+            memcpy(buffer, src, 4);
+            break;
+         default:
+            memcpy(buffer, src, num_bytes);
+            break;
+      }
+
+      return num_bytes;
+   }
+
+   return rc_libretro_memory_read(regions, address, buffer, num_bytes);
+}
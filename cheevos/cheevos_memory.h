@@ -0,0 +1,63 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2023 The RetroArch team
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_CHEEVOS_MEMORY_H
+#define __RARCH_CHEEVOS_MEMORY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <boolean.h>
+
+#include <retro_common_api.h>
+
+#include "../deps/rcheevos/src/rc_libretro.h"
+
+RETRO_BEGIN_DECLS
+
+/* Page size used to translate achievement addresses (4 KiB) */
+#define RCHEEVOS_MEMORY_PAGE_SHIFT 12
+/* Page size is raised past RCHEEVOS_MEMORY_PAGE_SHIFT if the
+ * address space would need more pages than this */
+#define RCHEEVOS_MEMORY_MAX_PAGES  (1 << 16)
+
+/* Flattened view of a rc_libretro_memory_regions_t: the host
+ * address of every page of the achievement address space, so
+ * a read is a shift and a lookup instead of a walk over the
+ * regions. Pages that are unmapped, or that are split across
+ * two regions, are NULL and go through rc_libretro_memory_read. */
+typedef struct rcheevos_memory_pages_t
+{
+   uint8_t** page;  /* host address of each page, or NULL */
+   uint32_t count;  /* number of entries in page */
+   uint32_t shift;  /* log2 of the page size */
+   uint32_t mask;   /* page size - 1 */
+} rcheevos_memory_pages_t;
+
+/* (Re)builds the table from the regions; must be called again
+ * whenever the regions change. Returns false if the table could
+ * not be allocated, in which case every read takes the slow path. */
+bool rcheevos_memory_pages_init(rcheevos_memory_pages_t* pages,
+      const rc_libretro_memory_regions_t* regions);
+void rcheevos_memory_pages_free(rcheevos_memory_pages_t* pages);
+
+/* Same contract as rc_libretro_memory_read */
+uint32_t rcheevos_memory_pages_read(const rcheevos_memory_pages_t* pages,
+      const rc_libretro_memory_regions_t* regions, uint32_t address,
+      uint8_t* buffer, uint32_t num_bytes);
+
+RETRO_END_DECLS
+
+#endif /* __RARCH_CHEEVOS_MEMORY_H */
@@ -758,6 +758,23 @@ bool command_play_replay_slot(command_t *cmd, const char *arg)
 #endif
 }
 
+bool command_seek_replay(command_t *cmd, const char *arg)
+{
+#ifdef HAVE_BSV_MOVIE
+   char reply[128]     = "";
+   uint64_t frame      = (uint64_t)strtoull(arg, NULL, 10);
+   bool ret            = bsv_movie_seek(input_state_get_ptr(), frame);
+   if (ret)
+      snprintf(reply, sizeof(reply) - 1, "SEEK_REPLAY %llu", (unsigned long long)frame);
+   else
+      snprintf(reply, sizeof(reply) - 1, "SEEK_REPLAY -1");
+   cmd->replier(cmd, reply, strlen(reply));
+   return ret;
+#else
+   return false;
+#endif
+}
+
 
 #if defined(HAVE_CHEEVOS)
 bool command_read_ram(command_t *cmd, const char *arg)
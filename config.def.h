@@ -212,6 +212,10 @@
 #define DEFAULT_CHEEVOS_VISIBILITY_LBOARD_CANCEL true
 #define DEFAULT_CHEEVOS_VISIBILITY_LBOARD_TRACKERS true
 #define DEFAULT_CHEEVOS_VISIBILITY_PROGRESS_TRACKER true
+/* Evaluate achievements on a worker thread, against a
+ * snapshot of the memory they read taken at the end of
+ * each frame. Unlocks are then reported a frame later. */
+#define DEFAULT_CHEEVOS_THREADED_EVALUATION false
 #endif
 
 /* VIDEO */
@@ -778,6 +782,11 @@
  * the screensaver */
 #define DEFAULT_MENU_SCREENSAVER_TIMEOUT 0
 
+/* Only draw and present the menu when something
+ * on it changes, rather than every frame, so an
+ * idle menu uses next to no CPU and GPU time */
+#define DEFAULT_MENU_SKIP_IDLE_FRAMES false
+
 #if defined(HAVE_MATERIALUI) || defined(HAVE_XMB) || defined(HAVE_OZONE)
 /* When menu screensaver is enabled, specifies
  * animation effect and animation speed */
@@ -1332,6 +1341,17 @@
 
 #define DEFAULT_NETPLAY_NAT_TRAVERSAL false
 
+/* Also send input over UDP, so that a lost TCP
+ * segment doesn't hold back later input frames */
+#define DEFAULT_NETPLAY_UDP_INPUT false
+
+/* How many datagrams carry each input frame */
+#define DEFAULT_NETPLAY_UDP_REDUNDANCY 3
+
+/* Serialize only every this many frames for rollback,
+ * replaying input from there. 0 picks it automatically. */
+#define DEFAULT_NETPLAY_SNAPSHOT_INTERVAL 1
+
 #define DEFAULT_NETPLAY_DELAY_FRAMES 16
 
 #define DEFAULT_NETPLAY_CHECK_FRAMES 600
@@ -1624,6 +1644,27 @@
 
 #define DEFAULT_GFX_THUMBNAIL_UPSCALE_THRESHOLD 0
 
+/* Size in MB of the cache of decoded thumbnail
+ * images shared by the menu drivers, so that
+ * scrolling back to an entry doesn't load its
+ * thumbnails again. 0 disables the cache */
+#if defined(_3DS) || defined(GEKKO) || defined(HW_RVL) || defined(PSP) || defined(VITA) || defined(SN_TARGET_PSP2) || defined(PS2) || defined(_XBOX) || defined(DINGUX)
+#define DEFAULT_GFX_THUMBNAIL_CACHE_SIZE 0
+#else
+#define DEFAULT_GFX_THUMBNAIL_CACHE_SIZE 64
+#endif
+
+/* Number of playlist entries ahead of the current
+ * one (in the direction of scrolling) whose thumbnails
+ * are loaded into the cache in advance */
+#define DEFAULT_GFX_THUMBNAIL_PREFETCH 3
+
+/* Keep copies of thumbnail images shrunk to fit
+ * the display under the cache directory, which are
+ * much quicker to load than full size images on
+ * low-end devices */
+#define DEFAULT_GFX_THUMBNAIL_PRESCALE false
+
 #ifdef HAVE_MENU
 #if defined(RS90) || defined(MIYOO)
 /* The RS-90 has a hardware clock that is neither
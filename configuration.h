@@ -218,6 +218,8 @@ typedef struct settings
       unsigned netplay_chat_color_msg;
       unsigned netplay_input_latency_frames_min;
       unsigned netplay_input_latency_frames_range;
+      unsigned netplay_udp_redundancy;
+      unsigned netplay_snapshot_interval;
       unsigned netplay_share_digital;
       unsigned netplay_share_analog;
       unsigned bundle_assets_extract_version_current;
@@ -284,6 +286,8 @@ typedef struct settings
       unsigned menu_left_thumbnails;
       unsigned menu_icon_thumbnails;
       unsigned gfx_thumbnail_upscale_threshold;
+      unsigned gfx_thumbnail_cache_size;
+      unsigned gfx_thumbnail_prefetch;
       unsigned menu_rgui_thumbnail_downscaler;
       unsigned menu_rgui_thumbnail_delay;
       unsigned menu_rgui_color_theme;
@@ -730,6 +734,7 @@ typedef struct settings
       bool filter_by_current_core;
       bool menu_enable_widgets;
       bool menu_show_load_content_animation;
+      bool gfx_thumbnail_prescale;
       bool notification_show_autoconfig;
       bool notification_show_cheats_applied;
       bool notification_show_patch_applied;
@@ -898,6 +903,7 @@ typedef struct settings
       bool netplay_allow_slaves;
       bool netplay_require_slaves;
       bool netplay_nat_traversal;
+      bool netplay_udp_input;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
       bool netplay_ping_show;
@@ -936,6 +942,7 @@ typedef struct settings
       bool cheevos_visibility_lboard_cancel;
       bool cheevos_visibility_lboard_trackers;
       bool cheevos_visibility_progress_tracker;
+      bool cheevos_threaded_evaluation;
 
       /* Camera */
       bool camera_allow;
@@ -985,6 +992,7 @@ typedef struct settings
       bool fastforward_frameskip;
       bool vrr_runloop_enable;
       bool menu_throttle_framerate;
+      bool menu_skip_idle_frames;
       bool apply_cheats_after_toggle;
       bool apply_cheats_after_load;
       bool run_ahead_enabled;
@@ -111,6 +111,7 @@ RETRO_BEGIN_DECLS
 #endif
 #define FILE_PATH_CORE_INFO_CACHE "core_info.cache"
 #define FILE_PATH_CORE_INFO_CACHE_REFRESH "core_info.refresh"
+#define FILE_PATH_EXPLORE_CACHE "explore.cache"
 
 #ifdef HAVE_LAKKA
  #ifdef HAVE_LAKKA_SERVER
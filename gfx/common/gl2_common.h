@@ -201,6 +201,8 @@ struct gl2
    void *readback_buffer_screenshot;
    const float *vertex_ptr;
    const float *white_color_ptr;
+   /* GLsync per PBO, signalled once its readback has landed. */
+   void *pbo_readback_fence[4];
    float *overlay_vertex_coord;
    float *overlay_tex_coord;
    float *overlay_color_coord;
@@ -235,6 +237,9 @@ struct gl2
    unsigned base_size; /* 2 or 4 */
    unsigned overlays;
    unsigned pbo_readback_index;
+   unsigned pbo_readback_frames;
+   unsigned pbo_readback_stalls;
+   retro_time_t pbo_readback_stall_time;
    unsigned last_width[GFX_MAX_TEXTURES];
    unsigned last_height[GFX_MAX_TEXTURES];
 
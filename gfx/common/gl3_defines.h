@@ -78,6 +78,8 @@ typedef struct gl3
    float *overlay_tex_coord;
    float *overlay_color_coord;
    GLsync fences[GL_CORE_NUM_FENCES];
+   /* Signalled once the readback into each PBO has landed. */
+   GLsync pbo_readback_fence[GL_CORE_NUM_PBOS];
    void *readback_buffer_screenshot;
    struct scaler_ctx pbo_readback_scaler;
 
@@ -121,6 +123,9 @@ typedef struct gl3
    unsigned scratch_vbo_index;
    unsigned fence_count;
    unsigned pbo_readback_index;
+   unsigned pbo_readback_frames;
+   unsigned pbo_readback_stalls;
+   retro_time_t pbo_readback_stall_time;
    unsigned hw_render_max_width;
    unsigned hw_render_max_height;
    GLuint scratch_vbos[GL_CORE_NUM_VBOS];
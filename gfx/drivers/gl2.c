@@ -48,6 +48,7 @@
 #include <retro_miscellaneous.h>
 #include <retro_math.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
 #include <libretro.h>
 
 #include <gfx/gl_capabilities.h>
@@ -131,6 +132,9 @@ typedef struct __GLsync *GLsync;
 #if (!defined(HAVE_OPENGLES) || defined(HAVE_OPENGLES3))
 #ifdef GL_PIXEL_PACK_BUFFER
 #define HAVE_GL_ASYNC_READBACK
+#ifdef HAVE_GL_SYNC
+#define HAVE_GL_ASYNC_READBACK_FENCES
+#endif
 #endif
 #endif
 
@@ -657,7 +661,8 @@ gfx_display_ctx_driver_t gfx_display_ctx_gl = {
    "gl",
    false,
    gfx_display_gl2_scissor_begin,
-   gfx_display_gl2_scissor_end
+   gfx_display_gl2_scissor_end,
+   true /* batch_quads */
 };
 
 /**
@@ -2120,6 +2125,31 @@ static void gl2_renderchain_bind_prev_texture(
    }
 }
 
+#ifdef HAVE_GL_ASYNC_READBACK_FENCES
+/* Makes sure the readback into a PBO has landed before
+ * it gets mapped, so that mapping never blocks inside
+ * the driver. The ring is deep enough that this should
+ * not have to wait; when it does, the time is counted. */
+static void gl2_pbo_readback_wait(gl2_t *gl, unsigned index)
+{
+   GLsync fence = (GLsync)gl->pbo_readback_fence[index];
+
+   if (!fence)
+      return;
+
+   if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      gl->pbo_readback_stall_time += cpu_features_get_time_usec() - start;
+      gl->pbo_readback_stalls++;
+   }
+
+   glDeleteSync(fence);
+   gl->pbo_readback_fence[index] = NULL;
+}
+#endif
+
 static bool gl2_renderchain_read_viewport(
       gl2_t *gl,
       uint8_t *buffer, bool is_idle)
@@ -2142,6 +2172,10 @@ static bool gl2_renderchain_read_viewport(
          goto error;
 
       gl->pbo_readback_valid[gl->pbo_readback_index] = false;
+#ifdef HAVE_GL_ASYNC_READBACK_FENCES
+      gl2_pbo_readback_wait(gl, gl->pbo_readback_index);
+#endif
+      gl->pbo_readback_frames++;
       glBindBuffer(GL_PIXEL_PACK_BUFFER,
             gl->pbo_readback[gl->pbo_readback_index]);
 
@@ -2151,16 +2185,10 @@ static bool gl2_renderchain_read_viewport(
             0, num_pixels * sizeof(uint32_t), GL_MAP_READ_BIT);
 
       if (ptr)
-      {
-         int y;
-         for (y = 0; y < gl->vp.height; y++)
-         {
-            video_frame_convert_rgba_to_bgr(
-                  (const void*)ptr,
-                  buffer,
-                  gl->vp.width);
-         }
-      }
+         video_frame_convert_rgba_to_bgr(
+               (const void*)ptr,
+               buffer,
+               num_pixels);
 #else
       ptr = (const uint8_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
       if (ptr)
@@ -3355,17 +3383,29 @@ static void gl2_pbo_async_readback(gl2_t *gl)
    GLenum type = GL_UNSIGNED_INT_8_8_8_8_REV;
 #endif
 
-   gl2_renderchain_bind_pbo(
-         gl->pbo_readback[gl->pbo_readback_index++]);
-   gl->pbo_readback_index &= 3;
-
-   /* 4 frames back, we can readback. */
-   gl->pbo_readback_valid[gl->pbo_readback_index] = true;
+   unsigned index = gl->pbo_readback_index;
 
+   gl2_renderchain_bind_pbo(gl->pbo_readback[index]);
    gl2_renderchain_readback(gl, gl->renderchain_data,
          gl2_get_alignment(gl->vp.width * sizeof(uint32_t)),
          fmt, type, NULL);
    gl2_renderchain_unbind_pbo();
+
+#ifdef HAVE_GL_ASYNC_READBACK_FENCES
+   if (gl->flags & GL2_FLAG_HAVE_SYNC)
+   {
+      /* Overwriting a frame that was never read back. */
+      if (gl->pbo_readback_fence[index])
+         glDeleteSync((GLsync)gl->pbo_readback_fence[index]);
+      gl->pbo_readback_fence[index] = glFenceSync(
+            GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   }
+#endif
+
+   /* read_viewport() picks this frame up once the ring
+    * comes back around to it, 3 frames from now. */
+   gl->pbo_readback_valid[index] = true;
+   gl->pbo_readback_index        = (index + 1) & 3;
 }
 
 static bool gl2_frame(void *data, const void *frame,
@@ -3793,6 +3833,17 @@ static void gl2_free(void *data)
 
    if (gl->flags & GL2_FLAG_PBO_READBACK_ENABLE)
    {
+#ifdef HAVE_GL_ASYNC_READBACK_FENCES
+      int i;
+      for (i = 0; i < 4; i++)
+         if (gl->pbo_readback_fence[i])
+            glDeleteSync((GLsync)gl->pbo_readback_fence[i]);
+#endif
+      if (gl->pbo_readback_frames)
+         RARCH_LOG("[GL]: Async PBO readback: %u frames, %u stalled "
+               "for %.2f ms in total.\n",
+               gl->pbo_readback_frames, gl->pbo_readback_stalls,
+               gl->pbo_readback_stall_time / 1000.0);
       glDeleteBuffers(4, gl->pbo_readback);
       scaler_ctx_gen_reset(&gl->pbo_readback_scaler);
    }
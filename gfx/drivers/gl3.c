@@ -34,6 +34,7 @@
 #include <gfx/video_frame.h>
 #include <glsym/glsym.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
 #include <retro_math.h>
 
 #include "../../configuration.h"
@@ -574,7 +575,8 @@ gfx_display_ctx_driver_t gfx_display_ctx_gl3 = {
    "glcore",
    false,
    gfx_display_gl3_scissor_begin,
-   gfx_display_gl3_scissor_end
+   gfx_display_gl3_scissor_end,
+   true /* batch_quads */
 };
 
 /**
@@ -1113,30 +1115,76 @@ static bool gl3_init_pbo_readback(gl3_t *gl)
 static void gl3_deinit_pbo_readback(gl3_t *gl)
 {
    int i;
+
+   if (gl->pbo_readback_frames)
+      RARCH_LOG("[GLCore]: Async PBO readback: %u frames, %u stalled "
+            "for %.2f ms in total.\n",
+            gl->pbo_readback_frames, gl->pbo_readback_stalls,
+            gl->pbo_readback_stall_time / 1000.0);
+
    for (i = 0; i < GL_CORE_NUM_PBOS; i++)
+   {
       if (gl->pbo_readback[i] != 0)
          glDeleteBuffers(1, &gl->pbo_readback[i]);
+      if (gl->pbo_readback_fence[i])
+         glDeleteSync(gl->pbo_readback_fence[i]);
+   }
    memset(gl->pbo_readback, 0, sizeof(gl->pbo_readback));
+   memset(gl->pbo_readback_fence, 0, sizeof(gl->pbo_readback_fence));
    scaler_ctx_gen_reset(&gl->pbo_readback_scaler);
 }
 
 static void gl3_pbo_async_readback(gl3_t *gl)
 {
-   glBindBuffer(GL_PIXEL_PACK_BUFFER,
-         gl->pbo_readback[gl->pbo_readback_index++]);
+   unsigned index = gl->pbo_readback_index;
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[index]);
    glPixelStorei(GL_PACK_ALIGNMENT, 4);
    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
 #ifndef HAVE_OPENGLES
    glReadBuffer(GL_BACK);
 #endif
-   if (gl->pbo_readback_index >= GL_CORE_NUM_PBOS)
-      gl->pbo_readback_index = 0;
-   gl->pbo_readback_valid[gl->pbo_readback_index] = true;
 
    glReadPixels(gl->vp.x, gl->vp.y,
                 gl->vp.width, gl->vp.height,
                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   /* Overwriting a frame that was never read back. */
+   if (gl->pbo_readback_fence[index])
+      glDeleteSync(gl->pbo_readback_fence[index]);
+   gl->pbo_readback_fence[index] = glFenceSync(
+         GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+   /* gl3_read_viewport() picks this frame up once the ring
+    * comes back around to it, GL_CORE_NUM_PBOS - 1 frames
+    * from now. */
+   gl->pbo_readback_valid[index] = true;
+   if (++gl->pbo_readback_index >= GL_CORE_NUM_PBOS)
+      gl->pbo_readback_index = 0;
+}
+
+/* Makes sure the readback into a PBO has landed before
+ * it gets mapped, so that mapping never blocks inside
+ * the driver. The ring is deep enough that this should
+ * not have to wait; when it does, the time is counted. */
+static void gl3_pbo_readback_wait(gl3_t *gl, unsigned index)
+{
+   GLsync fence = gl->pbo_readback_fence[index];
+
+   if (!fence)
+      return;
+
+   if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      gl->pbo_readback_stall_time += cpu_features_get_time_usec() - start;
+      gl->pbo_readback_stalls++;
+   }
+
+   glDeleteSync(fence);
+   gl->pbo_readback_fence[index] = NULL;
 }
 
 static void gl3_fence_iterate(gl3_t *gl, unsigned hard_sync_frames)
@@ -2503,12 +2551,20 @@ static bool gl3_read_viewport(void *data, uint8_t *buffer, bool is_idle)
          goto error;
 
       gl->pbo_readback_valid[gl->pbo_readback_index] = false;
+      gl3_pbo_readback_wait(gl, gl->pbo_readback_index);
+      gl->pbo_readback_frames++;
       glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[gl->pbo_readback_index]);
 
       ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, num_pixels * sizeof(uint32_t), GL_MAP_READ_BIT);
-      scaler_ctx_scale_direct(ctx, buffer, ptr);
-      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      if (ptr)
+      {
+         scaler_ctx_scale_direct(ctx, buffer, ptr);
+         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      }
       glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+      if (!ptr)
+         goto error;
    }
    else
    {
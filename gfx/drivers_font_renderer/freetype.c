@@ -45,33 +45,20 @@
 #include FT_FREETYPE_H
 #include "../font_driver.h"
 
-#define FT_ATLAS_ROWS 16
-#define FT_ATLAS_COLS 16
-#define FT_ATLAS_SIZE (FT_ATLAS_ROWS * FT_ATLAS_COLS)
 /* Padding is required between each glyph in
  * the atlas to prevent texture bleed when
  * drawing with linear filtering enabled */
 #define FT_ATLAS_PADDING 1
 
-typedef struct freetype_atlas_slot
-{
-   struct freetype_atlas_slot* next;   /* ptr alignment */
-   struct font_glyph glyph;            /* unsigned alignment */
-   unsigned charcode;
-   unsigned last_used;
-}freetype_atlas_slot_t;
-
 typedef struct freetype_renderer
 {
    FT_Library lib;                                   /* ptr alignment   */
    FT_Face face;                                     /* ptr alignment   */
    struct font_atlas atlas;                          /* ptr alignment   */
-   freetype_atlas_slot_t atlas_slots[FT_ATLAS_SIZE]; /* ptr alignment   */
-   freetype_atlas_slot_t* uc_map[0x100];             /* ptr alignment   */
+   font_glyph_cache_t cache;                         /* ptr alignment   */
    void *file_data;                                  /* ptr alignment   */
    unsigned max_glyph_width;
    unsigned max_glyph_height;
-   unsigned usage_counter;
    struct font_line_metrics line_metrics;            /* float alignment */
 } ft_font_renderer_t;
 
@@ -89,6 +76,7 @@ static void font_renderer_ft_free(void *data)
    if (!handle)
       return;
 
+   font_glyph_cache_free(&handle->cache, "freetype");
    free(handle->atlas.buffer);
 
    if (handle->face)
@@ -101,55 +89,19 @@ static void font_renderer_ft_free(void *data)
    free(handle);
 }
 
-static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
-{
-   int i, map_id;
-   unsigned oldest = 0;
-
-   for (i = 1; i < FT_ATLAS_SIZE; i++)
-      if ((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
-
-   /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if (handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
-   else if (handle->uc_map[map_id])
-   {
-      freetype_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while (ptr->next && ptr->next != &handle->atlas_slots[oldest])
-         ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
-   }
-
-   return &handle->atlas_slots[oldest];
-}
-
 static const struct font_glyph *font_renderer_ft_get_glyph(
       void *data, uint32_t charcode)
 {
-   unsigned map_id;
    uint8_t *dst;
    FT_GlyphSlot slot;
-   freetype_atlas_slot_t* atlas_slot;
+   struct font_glyph *glyph;
    ft_font_renderer_t *handle = (ft_font_renderer_t*)data;
 
    if (!handle)
       return NULL;
 
-   map_id     = charcode & 0xFF;
-   atlas_slot = handle->uc_map[map_id];
-
-   while (atlas_slot)
-   {
-      if (atlas_slot->charcode == charcode)
-      {
-         atlas_slot->last_used = handle->usage_counter++;
-         return &atlas_slot->glyph;
-      }
-      atlas_slot = atlas_slot->next;
-   }
+   if ((glyph = font_glyph_cache_find(&handle->cache, charcode)))
+      return glyph;
 
    if (FT_Load_Char(handle->face, charcode, FT_LOAD_RENDER))
       return NULL;
@@ -157,28 +109,26 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
    FT_Render_Glyph(handle->face->glyph, FT_RENDER_MODE_NORMAL);
    slot = handle->face->glyph;
 
-   atlas_slot                      = font_renderer_get_slot(handle);
-   atlas_slot->charcode            = charcode;
-   atlas_slot->next                = handle->uc_map[map_id];
-   handle->uc_map[map_id]          = atlas_slot;
+   glyph                           = font_glyph_cache_insert(
+         &handle->cache, charcode);
 
    /* Some glyphs can be blank. */
-   atlas_slot->glyph.width         = slot->bitmap.width;
-   atlas_slot->glyph.height        = slot->bitmap.rows;
-   atlas_slot->glyph.advance_x     = slot->advance.x >> 6;
-   atlas_slot->glyph.advance_y     = slot->advance.y >> 6;
-   atlas_slot->glyph.draw_offset_x = slot->bitmap_left;
-   atlas_slot->glyph.draw_offset_y = -slot->bitmap_top;
+   glyph->width                    = slot->bitmap.width;
+   glyph->height                   = slot->bitmap.rows;
+   glyph->advance_x                = slot->advance.x >> 6;
+   glyph->advance_y                = slot->advance.y >> 6;
+   glyph->draw_offset_x            = slot->bitmap_left;
+   glyph->draw_offset_y            = -slot->bitmap_top;
 
-   dst = (uint8_t*)handle->atlas.buffer + atlas_slot->glyph.atlas_offset_x
-         + atlas_slot->glyph.atlas_offset_y * handle->atlas.width;
+   dst = (uint8_t*)handle->atlas.buffer + glyph->atlas_offset_x
+         + glyph->atlas_offset_y * handle->atlas.width;
 
    if (slot->bitmap.buffer)
    {
       unsigned y;
       const uint8_t *src    = (const uint8_t*)slot->bitmap.buffer;
-      unsigned delta_width  = (handle->max_glyph_width > atlas_slot->glyph.width) ?
-            (handle->max_glyph_width - atlas_slot->glyph.width) : 0;
+      unsigned delta_width  = (handle->max_glyph_width > glyph->width) ?
+            (handle->max_glyph_width - glyph->width) : 0;
 
       /* When copying the glyph bitmap, it is
        * necessary to clear any unused regions of
@@ -187,19 +137,19 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
        * the edges of the glyph when rendering with
        * filtering enabled */
 
-      for (y = 0; y < atlas_slot->glyph.height; y++)
+      for (y = 0; y < glyph->height; y++)
       {
          /* Copy bitmap row */
-         memcpy(dst, src, atlas_slot->glyph.width * sizeof(uint8_t));
+         memcpy(dst, src, glyph->width * sizeof(uint8_t));
          /* Zero out remaining atlas row */
-         memset(dst + atlas_slot->glyph.width, 0, delta_width * sizeof(uint8_t));
+         memset(dst + glyph->width, 0, delta_width * sizeof(uint8_t));
 
          dst += handle->atlas.width;
          src += slot->bitmap.pitch;
       }
 
       /* Zero out unused atlas rows */
-      for (y = atlas_slot->glyph.height; y < handle->max_glyph_height; y++)
+      for (y = glyph->height; y < handle->max_glyph_height; y++)
       {
          memset(dst, 0, handle->max_glyph_width * sizeof(uint8_t));
          dst += handle->atlas.width;
@@ -207,44 +157,29 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
    }
 
    handle->atlas.dirty = true;
-   atlas_slot->last_used = handle->usage_counter++;
-   return &atlas_slot->glyph;
+   return glyph;
 }
 
 static bool font_renderer_create_atlas(ft_font_renderer_t *handle, float font_size)
 {
-   unsigned i, x, y;
-   freetype_atlas_slot_t* slot = NULL;
-
+   unsigned i;
+   uint8_t *atlas_buffer       = NULL;
    unsigned max_width          = round((handle->face->bbox.xMax - handle->face->bbox.xMin)
          * font_size / handle->face->units_per_EM);
    unsigned max_height         = round((handle->face->bbox.yMax - handle->face->bbox.yMin)
          * font_size / handle->face->units_per_EM);
 
-   unsigned atlas_width        = (max_width  + FT_ATLAS_PADDING) * FT_ATLAS_COLS;
-   unsigned atlas_height       = (max_height + FT_ATLAS_PADDING) * FT_ATLAS_ROWS;
-
-   uint8_t *atlas_buffer       = (uint8_t*)calloc(atlas_width * atlas_height, 1);
+   if (!font_glyph_cache_init(&handle->cache, &handle->atlas,
+            max_width, max_height, FT_ATLAS_PADDING))
+      return false;
 
-   if (!atlas_buffer)
+   if (!(atlas_buffer = (uint8_t*)calloc(
+               handle->atlas.width * handle->atlas.height, 1)))
       return false;
 
    handle->max_glyph_width     = max_width;
    handle->max_glyph_height    = max_height;
    handle->atlas.buffer        = atlas_buffer;
-   handle->atlas.width         = atlas_width;
-   handle->atlas.height        = atlas_height;
-   slot                        = handle->atlas_slots;
-
-   for (y = 0; y < FT_ATLAS_ROWS; y++)
-   {
-      for (x = 0; x < FT_ATLAS_COLS; x++)
-      {
-         slot->glyph.atlas_offset_x = x * (max_width  + FT_ATLAS_PADDING);
-         slot->glyph.atlas_offset_y = y * (max_height + FT_ATLAS_PADDING);
-         slot++;
-      }
-   }
 
    for (i = 0; i < 256; i++)
       font_renderer_ft_get_glyph(handle, i);
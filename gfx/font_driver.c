@@ -16,13 +16,18 @@
 
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
 #endif
 
 #include "font_driver.h"
+#include "gfx_display.h"
 #include "video_thread_wrapper.h"
+#include "../verbosity.h"
 
 /* TODO/FIXME - global */
 static void *video_font_driver = NULL;
@@ -73,6 +78,134 @@ int font_renderer_create_default(
    return 0;
 }
 
+static INLINE unsigned font_glyph_cache_hash(uint32_t charcode)
+{
+   /* Fibonacci hashing, keeping the top 10 bits
+    * (FONT_GLYPH_CACHE_BUCKETS); neighbouring code
+    * points (as in CJK text) land in different buckets */
+   return (uint32_t)(charcode * 2654435761u) >> 22;
+}
+
+bool font_glyph_cache_init(font_glyph_cache_t *cache,
+      struct font_atlas *atlas, unsigned slot_width,
+      unsigned slot_height, unsigned padding)
+{
+   unsigned i, x, y;
+   unsigned slot_size = MAX(slot_width, slot_height) + padding;
+   unsigned grid      = slot_size
+      ? FONT_GLYPH_CACHE_MAX_ATLAS_SIZE / slot_size : 32;
+
+   memset(cache, 0, sizeof(*cache));
+
+   cache->cols        = MIN(MAX(grid, 16), 32);
+   cache->rows        = cache->cols;
+
+   if (!(cache->slots = (font_glyph_cache_slot_t*)calloc(
+               cache->cols * cache->rows, sizeof(*cache->slots))))
+      return false;
+
+   for (y = 0, i = 0; y < cache->rows; y++)
+   {
+      for (x = 0; x < cache->cols; x++, i++)
+      {
+         font_glyph_cache_slot_t *slot = &cache->slots[i];
+         slot->glyph.atlas_offset_x    = x * (slot_width  + padding);
+         slot->glyph.atlas_offset_y    = y * (slot_height + padding);
+
+         /* All slots start out on the LRU list, unused */
+         slot->lru_prev                = cache->lru_tail;
+         if (cache->lru_tail)
+            cache->lru_tail->lru_next  = slot;
+         else
+            cache->lru_head            = slot;
+         cache->lru_tail               = slot;
+      }
+   }
+
+   atlas->width  = (slot_width  + padding) * cache->cols;
+   atlas->height = (slot_height + padding) * cache->rows;
+
+   return true;
+}
+
+void font_glyph_cache_free(font_glyph_cache_t *cache, const char *ident)
+{
+   if (cache->hits || cache->misses)
+      RARCH_DBG("[Font]: %s glyph cache (%ux%u): %u hits, %u misses, %u evictions.\n",
+            ident, cache->cols, cache->rows,
+            cache->hits, cache->misses, cache->evictions);
+
+   free(cache->slots);
+   cache->slots = NULL;
+}
+
+static void font_glyph_cache_touch(font_glyph_cache_t *cache,
+      font_glyph_cache_slot_t *slot)
+{
+   if (cache->lru_head == slot)
+      return;
+
+   /* Unlink */
+   slot->lru_prev->lru_next   = slot->lru_next;
+   if (slot->lru_next)
+      slot->lru_next->lru_prev = slot->lru_prev;
+   else
+      cache->lru_tail          = slot->lru_prev;
+
+   /* Move to the front */
+   slot->lru_prev             = NULL;
+   slot->lru_next             = cache->lru_head;
+   cache->lru_head->lru_prev  = slot;
+   cache->lru_head            = slot;
+}
+
+struct font_glyph *font_glyph_cache_find(font_glyph_cache_t *cache,
+      uint32_t charcode)
+{
+   font_glyph_cache_slot_t *slot =
+      cache->buckets[font_glyph_cache_hash(charcode)];
+
+   for (; slot; slot = slot->hash_next)
+   {
+      if (slot->charcode == charcode)
+      {
+         font_glyph_cache_touch(cache, slot);
+         cache->hits++;
+         return &slot->glyph;
+      }
+   }
+
+   cache->misses++;
+   return NULL;
+}
+
+struct font_glyph *font_glyph_cache_insert(font_glyph_cache_t *cache,
+      uint32_t charcode)
+{
+   font_glyph_cache_slot_t **bucket;
+   font_glyph_cache_slot_t *slot = cache->lru_tail;
+
+   if (slot->used)
+   {
+      /* Evict the least recently used glyph */
+      font_glyph_cache_slot_t **ptr =
+         &cache->buckets[font_glyph_cache_hash(slot->charcode)];
+      while (*ptr != slot)
+         ptr = &(*ptr)->hash_next;
+      *ptr = slot->hash_next;
+      cache->evictions++;
+   }
+
+   bucket          = &cache->buckets[font_glyph_cache_hash(charcode)];
+   slot->charcode  = charcode;
+   slot->used      = true;
+   slot->hash_next = *bucket;
+   *bucket         = slot;
+
+   font_glyph_cache_touch(cache, slot);
+   return &slot->glyph;
+}
+
 static bool font_init_first(
       const void **font_driver, void **font_handle,
       void *video_data, const char *font_path, float font_size,
@@ -790,7 +923,10 @@ void font_driver_bind_block(void *font_data, void *block)
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
 
    if (font && font->renderer && font->renderer->bind_block)
+   {
       font->renderer->bind_block(font->renderer_data, block);
+      font->block_bound = (block != NULL);
+   }
 }
 
 /* Flushing is slow - only do it if font has actually been used */
@@ -801,6 +937,7 @@ void font_flush(
 {
    if (font_data->raster_block.carr.coords.vertices == 0)
       return;
+   gfx_display_flush(disp_get_ptr());
    if (font_data->font && font_data->font->renderer && font_data->font->renderer->flush)
       font_data->font->renderer->flush(video_width, video_height, font_data->font->renderer_data);
    font_data->raster_block.carr.coords.vertices = 0;
@@ -920,6 +1057,7 @@ font_data_t *font_driver_init_first(
          font->renderer      = (const font_renderer_t*)font_driver;
          font->renderer_data = font_handle;
          font->size          = font_size;
+         font->block_bound   = false;
          return font;
       }
    }
@@ -67,11 +67,63 @@ typedef struct font_renderer_driver
    void (*get_line_metrics)(void* data, struct font_line_metrics **metrics);
 } font_renderer_driver_t;
 
+/* Glyph cache shared by the font renderers that rasterize
+ * glyphs on demand into a grid of equally sized atlas slots.
+ * Lookups go through a hash table, and the least recently
+ * used slot is reused when the atlas is full. */
+#define FONT_GLYPH_CACHE_BUCKETS 1024
+/* The atlas grid is made as large as this allows (at least
+ * 16x16 and at most 32x32 slots). */
+#define FONT_GLYPH_CACHE_MAX_ATLAS_SIZE 1024
+
+typedef struct font_glyph_cache_slot
+{
+   struct font_glyph_cache_slot *hash_next;
+   struct font_glyph_cache_slot *lru_prev;  /* More recently used */
+   struct font_glyph_cache_slot *lru_next;  /* Less recently used */
+   struct font_glyph glyph;                 /* unsigned alignment */
+   uint32_t charcode;
+   bool used;
+} font_glyph_cache_slot_t;
+
+typedef struct font_glyph_cache
+{
+   font_glyph_cache_slot_t *slots;
+   font_glyph_cache_slot_t *lru_head;
+   font_glyph_cache_slot_t *lru_tail;
+   font_glyph_cache_slot_t *buckets[FONT_GLYPH_CACHE_BUCKETS];
+   unsigned cols;
+   unsigned rows;
+   unsigned hits;
+   unsigned misses;
+   unsigned evictions;
+} font_glyph_cache_t;
+
+/* Lays out the atlas grid for glyphs of up to slot_width x slot_height
+ * pixels and sets atlas->width/height; the caller allocates the buffer. */
+bool font_glyph_cache_init(font_glyph_cache_t *cache,
+      struct font_atlas *atlas, unsigned slot_width,
+      unsigned slot_height, unsigned padding);
+
+void font_glyph_cache_free(font_glyph_cache_t *cache, const char *ident);
+
+/* Returns NULL if the glyph isn't cached. */
+struct font_glyph *font_glyph_cache_find(font_glyph_cache_t *cache,
+      uint32_t charcode);
+
+/* Returns the slot for a new glyph, its atlas offsets filled in;
+ * the caller rasterizes it there and fills in the rest. */
+struct font_glyph *font_glyph_cache_insert(font_glyph_cache_t *cache,
+      uint32_t charcode);
+
 typedef struct
 {
    const font_renderer_t *renderer;
    void *renderer_data;
    float size;
+   /* Set while a raster block is bound, i.e. messages
+    * are queued until the block is flushed */
+   bool block_bound;
 } font_data_t;
 
 /* This structure holds all objects + metadata
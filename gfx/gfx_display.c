@@ -334,6 +334,162 @@ float gfx_display_get_dpi_scale(
    return adjusted_scale;
 }
 
+void gfx_display_flush(gfx_display_t *p_disp)
+{
+   gfx_display_ctx_draw_t draw;
+   struct video_coords coords;
+   gfx_display_batch_t       *batch = &p_disp->batch;
+   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx_impl;
+
+   if (!batch->quads)
+      return;
+
+   coords.vertices      = batch->quads * 6;
+   coords.vertex        = batch->vertex;
+   coords.tex_coord     = batch->tex_coord;
+   coords.lut_tex_coord = NULL;
+   coords.color         = batch->color;
+
+   draw.x               = 0;
+   draw.y               = 0;
+   draw.width           = batch->width;
+   draw.height          = batch->height;
+   draw.coords          = &coords;
+   draw.matrix_data     = batch->has_matrix ? &batch->matrix : NULL;
+   draw.texture         = batch->texture;
+   draw.prim_type       = GFX_DISPLAY_PRIM_TRIANGLES;
+   draw.pipeline_id     = 0;
+   draw.scale_factor    = 1.0f;
+   draw.rotation        = 0.0f;
+
+   batch->quads         = 0;
+
+   if (!dispctx)
+      return;
+
+   if (batch->blend && dispctx->blend_begin)
+      dispctx->blend_begin(batch->userdata);
+   dispctx->draw(&draw, batch->userdata,
+         batch->video_width, batch->video_height);
+   if (batch->blend && dispctx->blend_end)
+      dispctx->blend_end(batch->userdata);
+
+   p_disp->draw_calls++;
+}
+
+/* Queues a quad given as a four vertex strip (BL, BR, TL, TR)
+ * in coordinates normalized to the whole framebuffer. Anything
+ * which doesn't share the texture, matrix and blend state of
+ * the pending quads sends those to the driver first. */
+static void gfx_display_batch_push(gfx_display_t *p_disp,
+      void *userdata,
+      unsigned video_width, unsigned video_height,
+      unsigned width, unsigned height,
+      const float *vertex, const float *tex_coord, const float *color,
+      uintptr_t texture, const math_matrix_4x4 *matrix, bool blend)
+{
+   /* Strip order to triangle list: (BL, BR, TL), (TL, BR, TR) */
+   static const uint8_t order[6] = { 0, 1, 2, 2, 1, 3 };
+   unsigned i;
+   gfx_display_batch_t *batch     = &p_disp->batch;
+
+   if (batch->quads)
+   {
+      if (     batch->quads == GFX_DISPLAY_BATCH_MAX_QUADS
+            || batch->texture      != texture
+            || batch->userdata     != userdata
+            || batch->blend        != blend
+            || batch->width        != width
+            || batch->height       != height
+            || batch->video_width  != video_width
+            || batch->video_height != video_height
+            || batch->has_matrix   != (matrix != NULL)
+            || (matrix && memcmp(&batch->matrix, matrix,
+                  sizeof(*matrix))))
+         gfx_display_flush(p_disp);
+   }
+
+   if (!batch->quads)
+   {
+      batch->userdata     = userdata;
+      batch->texture      = texture;
+      batch->blend        = blend;
+      batch->width        = width;
+      batch->height       = height;
+      batch->video_width  = video_width;
+      batch->video_height = video_height;
+      batch->has_matrix   = (matrix != NULL);
+      if (matrix)
+         batch->matrix    = *matrix;
+   }
+
+   for (i = 0; i < 6; i++)
+   {
+      unsigned v = batch->quads * 6 + i;
+      unsigned j = order[i];
+      batch->vertex[v * 2 + 0]    = vertex[j * 2 + 0];
+      batch->vertex[v * 2 + 1]    = vertex[j * 2 + 1];
+      batch->tex_coord[v * 2 + 0] = tex_coord[j * 2 + 0];
+      batch->tex_coord[v * 2 + 1] = tex_coord[j * 2 + 1];
+      memcpy(&batch->color[v * 4], &color[j * 4], 4 * sizeof(float));
+   }
+
+   batch->quads++;
+}
+
+/* Entry points of gfx_display_t::dispctx_batch; everything
+ * drawn or changed behind the back of the batch must
+ * see the quads queued before it on screen first */
+static void gfx_display_batch_draw(gfx_display_ctx_draw_t *draw,
+      void *data, unsigned video_width, unsigned video_height)
+{
+   gfx_display_t *p_disp = &dispgfx_st;
+   gfx_display_flush(p_disp);
+   p_disp->dispctx_impl->draw(draw, data, video_width, video_height);
+   p_disp->draw_calls++;
+}
+
+static void gfx_display_batch_draw_pipeline(gfx_display_ctx_draw_t *draw,
+      gfx_display_t *p_disp,
+      void *data, unsigned video_width, unsigned video_height)
+{
+   gfx_display_flush(p_disp);
+   p_disp->dispctx_impl->draw_pipeline(draw, p_disp, data,
+         video_width, video_height);
+}
+
+static void gfx_display_batch_blend_begin(void *data)
+{
+   gfx_display_t *p_disp = &dispgfx_st;
+   gfx_display_flush(p_disp);
+   p_disp->dispctx_impl->blend_begin(data);
+}
+
+static void gfx_display_batch_blend_end(void *data)
+{
+   gfx_display_t *p_disp = &dispgfx_st;
+   gfx_display_flush(p_disp);
+   p_disp->dispctx_impl->blend_end(data);
+}
+
+static void gfx_display_batch_scissor_begin(void *data,
+      unsigned video_width, unsigned video_height,
+      int x, int y, unsigned width, unsigned height)
+{
+   gfx_display_t *p_disp = &dispgfx_st;
+   gfx_display_flush(p_disp);
+   p_disp->dispctx_impl->scissor_begin(data, video_width, video_height,
+         x, y, width, height);
+}
+
+static void gfx_display_batch_scissor_end(void *data,
+      unsigned video_width, unsigned video_height)
+{
+   gfx_display_t *p_disp = &dispgfx_st;
+   gfx_display_flush(p_disp);
+   p_disp->dispctx_impl->scissor_end(data, video_width, video_height);
+}
+
 /* Begin scissoring operation */
 void gfx_display_scissor_begin(
       gfx_display_t *p_disp,
@@ -443,6 +599,12 @@ void gfx_display_draw_text(
       params.drop_alpha  = GFX_SHADOW_ALPHA;
    }
 
+   /* Text going to a bound raster block is drawn later on,
+    * by font_flush(); anything else is drawn right away,
+    * so it has to go on top of the quads queued so far */
+   if (!font || !font->block_bound)
+      gfx_display_flush(&dispgfx_st);
+
    if (video_st->poke && video_st->poke->set_osd_msg)
       video_st->poke->set_osd_msg(video_st->data,
             text, &params, (void*)font);
@@ -514,6 +676,45 @@ void gfx_display_draw_quad(
    if (!dispctx)
       return;
 
+   if (     dispctx->batch_quads
+         && width  > 0
+         && height > 0)
+   {
+      static const float white[16] = {
+         1.0f, 1.0f, 1.0f, 1.0f,
+         1.0f, 1.0f, 1.0f, 1.0f,
+         1.0f, 1.0f, 1.0f, 1.0f,
+         1.0f, 1.0f, 1.0f, 1.0f
+      };
+      static const float tex_coord[8] = {
+         0.0f, 1.0f,
+         1.0f, 1.0f,
+         0.0f, 0.0f,
+         1.0f, 0.0f
+      };
+      float vertex[8];
+      float x0     = x / (float)width;
+      float x1     = (x + (int)w) / (float)width;
+      float y0     = ((int)height - y - (int)h) / (float)height;
+      float y1     = ((int)height - y) / (float)height;
+
+      vertex[0]    = x0;
+      vertex[1]    = y0;
+      vertex[2]    = x1;
+      vertex[3]    = y0;
+      vertex[4]    = x0;
+      vertex[5]    = y1;
+      vertex[6]    = x1;
+      vertex[7]    = y1;
+
+      gfx_display_batch_push(p_disp, data,
+            video_width, video_height, width, height,
+            vertex, tex_coord, color ? color : white,
+            (texture != 0) ? *texture : gfx_white_texture,
+            NULL, true);
+      return;
+   }
+
    coords.vertices      = 4;
    coords.vertex        = NULL;
    coords.tex_coord     = NULL;
@@ -542,6 +743,24 @@ void gfx_display_draw_quad(
       dispctx->blend_end(data);
 }
 
+/* One of the nine sections of gfx_display_draw_texture_slice(),
+ * which are all drawn with the blend state of the caller */
+static void gfx_display_draw_slice_section(gfx_display_t *p_disp,
+      gfx_display_ctx_draw_t *draw, void *userdata,
+      unsigned video_width, unsigned video_height)
+{
+   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+
+   if (dispctx->batch_quads)
+      gfx_display_batch_push(p_disp, userdata,
+            video_width, video_height, draw->width, draw->height,
+            draw->coords->vertex, draw->coords->tex_coord,
+            draw->coords->color, draw->texture,
+            (const math_matrix_4x4*)draw->matrix_data, false);
+   else
+      dispctx->draw(draw, userdata, video_width, video_height);
+}
+
 /* Draw the texture split into 9 sections, without scaling the corners.
  * The middle sections will only scale in the X axis, and the side
  * sections will only scale in the Y axis. */
@@ -702,7 +921,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0];
    tex_coord[7] = T_TR[1];
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Top Middle section */
    vert_coord[0] = V_BL[0] + vert_woff;
@@ -723,7 +943,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0] + tex_mid_width;
    tex_coord[7] = T_TR[1];
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Top Right corner */
    vert_coord[0] = V_BL[0] + vert_woff + vert_scaled_mid_width;
@@ -744,7 +965,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0] + tex_mid_width + tex_woff;
    tex_coord[7] = T_TR[1];
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Middle Left section */
    vert_coord[0] = V_BL[0];
@@ -765,7 +987,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0];
    tex_coord[7] = T_TR[1] + tex_hoff;
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* center section */
    vert_coord[0] = V_BL[0] + vert_woff;
@@ -786,7 +1009,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0] + tex_mid_width;
    tex_coord[7] = T_TR[1] + tex_hoff;
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Middle Right section */
    vert_coord[0] = V_BL[0] + vert_woff + vert_scaled_mid_width;
@@ -807,7 +1031,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0] + tex_woff + tex_mid_width;
    tex_coord[7] = T_TR[1] + tex_hoff;
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Bottom Left corner */
    vert_coord[0] = V_BL[0];
@@ -828,7 +1053,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0];
    tex_coord[7] = T_TR[1] + tex_hoff + tex_mid_height;
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Bottom Middle section */
    vert_coord[0] = V_BL[0] + vert_woff;
@@ -849,7 +1075,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0] + tex_mid_width;
    tex_coord[7] = T_TR[1] + tex_hoff + tex_mid_height;
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 
    /* Bottom Right corner */
    vert_coord[0] = V_BL[0] + vert_woff + vert_scaled_mid_width;
@@ -870,7 +1097,8 @@ void gfx_display_draw_texture_slice(
    tex_coord[6] = T_TR[0] + tex_woff + tex_mid_width;
    tex_coord[7] = T_TR[1] + tex_hoff + tex_mid_height;
 
-   dispctx->draw(&draw, userdata, video_width, video_height);
+   gfx_display_draw_slice_section(p_disp, &draw, userdata,
+         video_width, video_height);
 }
 
 void gfx_display_rotate_z(gfx_display_t *p_disp,
@@ -1192,7 +1420,9 @@ void gfx_display_free(void)
    p_disp->framebuf_width      = 0;
    p_disp->framebuf_height     = 0;
    p_disp->framebuf_pitch      = 0;
+   p_disp->batch.quads         = 0;
    p_disp->dispctx             = NULL;
+   p_disp->dispctx_impl        = NULL;
 }
 
 void gfx_display_init(void)
@@ -1222,7 +1452,24 @@ bool gfx_display_init_first_driver(gfx_display_t *p_disp,
             && (!string_is_equal(video_driver, ident)))
          continue;
       RARCH_LOG("[Display]: Found display driver: \"%s\".\n", ident);
-      p_disp->dispctx = dispctx;
+      p_disp->dispctx_impl  = dispctx;
+      p_disp->dispctx_batch = *dispctx;
+      p_disp->batch.quads   = 0;
+      if (dispctx->draw)
+         p_disp->dispctx_batch.draw          = gfx_display_batch_draw;
+      if (dispctx->draw_pipeline)
+         p_disp->dispctx_batch.draw_pipeline = gfx_display_batch_draw_pipeline;
+      if (dispctx->blend_begin)
+         p_disp->dispctx_batch.blend_begin   = gfx_display_batch_blend_begin;
+      if (dispctx->blend_end)
+         p_disp->dispctx_batch.blend_end     = gfx_display_batch_blend_end;
+      if (dispctx->scissor_begin)
+         p_disp->dispctx_batch.scissor_begin = gfx_display_batch_scissor_begin;
+      if (dispctx->scissor_end)
+         p_disp->dispctx_batch.scissor_end   = gfx_display_batch_scissor_end;
+      if (!dispctx->draw)
+         p_disp->dispctx_batch.batch_quads   = false;
+      p_disp->dispctx       = &p_disp->dispctx_batch;
       return true;
    }
    return false;
@@ -34,6 +34,11 @@
 
 #define GFX_SHADOW_ALPHA 0.75f
 
+/* Number of quads gfx_display_draw_quad() and
+ * gfx_display_draw_texture_slice() can queue before
+ * the batch has to be flushed */
+#define GFX_DISPLAY_BATCH_MAX_QUADS 256
+
 /* Number of pixels corner-to-corner on a 1080p
  * display:
  * > sqrt((1920 * 1920) + (1080 * 1080))
@@ -146,6 +151,10 @@ typedef struct gfx_display_ctx_driver
          int x, int y, unsigned width, unsigned height);
    void (*scissor_end)(void *data, unsigned video_width,
          unsigned video_height);
+   /* Draws GFX_DISPLAY_PRIM_TRIANGLES lists of any length over
+    * the full viewport, so quads sharing a texture can be queued
+    * up and submitted together (see gfx_display_flush) */
+   bool batch_quads;
 } gfx_display_ctx_driver_t;
 
 struct gfx_display_ctx_draw
@@ -192,9 +201,36 @@ typedef struct gfx_display_ctx_powerstate
    bool charging;
 } gfx_display_ctx_powerstate_t;
 
+/* Quads queued by gfx_display_draw_quad() and
+ * gfx_display_draw_texture_slice(), as two triangles each,
+ * until something that cannot join them comes along */
+typedef struct gfx_display_batch
+{
+   float vertex[GFX_DISPLAY_BATCH_MAX_QUADS * 6 * 2];
+   float tex_coord[GFX_DISPLAY_BATCH_MAX_QUADS * 6 * 2];
+   float color[GFX_DISPLAY_BATCH_MAX_QUADS * 6 * 4];
+   math_matrix_4x4 matrix;
+   void *userdata;
+   uintptr_t texture;
+   unsigned quads;
+   unsigned video_width;
+   unsigned video_height;
+   unsigned width;
+   unsigned height;
+   bool has_matrix;
+   bool blend;
+} gfx_display_batch_t;
+
 struct gfx_display
 {
+   /* Points at dispctx_batch, a copy of the driver found by
+    * gfx_display_init_first_driver() whose draw and state
+    * callbacks flush the pending batch before calling into
+    * dispctx_impl */
    gfx_display_ctx_driver_t *dispctx;
+   gfx_display_ctx_driver_t *dispctx_impl;
+   gfx_display_ctx_driver_t dispctx_batch;
+   gfx_display_batch_t batch;
    video_coord_array_t dispca; /* ptr alignment */
 
    /* Width, height and pitch of the display framebuffer */
@@ -205,6 +241,11 @@ struct gfx_display
    /* Height of the display header */
    unsigned header_height;
 
+   /* Driver draw calls issued for the current frame,
+    * and the total of the previous one */
+   unsigned draw_calls;
+   unsigned draw_calls_last;
+
    enum menu_driver_id_type menu_driver_id;
 
    uint8_t flags;
@@ -212,6 +253,9 @@ struct gfx_display
 
 void gfx_display_free(void);
 
+/* Submits the quads queued so far in a single draw call. */
+void gfx_display_flush(gfx_display_t *p_disp);
+
 void gfx_display_init(void);
 
 void gfx_display_draw_cursor(
@@ -24,8 +24,12 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <array/rbuf.h>
+#include <array/rhmap.h>
 #include <features/features_cpu.h>
 #include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 
 #include "gfx_display.h"
@@ -33,18 +37,49 @@
 
 #include "gfx_thumbnail.h"
 
+#include "../configuration.h"
+#include "../verbosity.h"
 #include "../tasks/tasks_internal.h"
 
 #define DEFAULT_GFX_THUMBNAIL_STREAM_DELAY  83.333333f
 #define DEFAULT_GFX_THUMBNAIL_FADE_DURATION 166.66667f
 
-/* Utility structure, sent as userdata when pushing
- * an image load */
-typedef struct
+/* Limits the number of image loads in progress
+ * before prefetching is skipped, so that it can't
+ * delay the thumbnails that are actually shown */
+#define GFX_THUMBNAIL_PREFETCH_MAX_LOADING 8
+
+/* Oldest pre-scaled copies are deleted once they
+ * take more than this many bytes on disk */
+#define GFX_THUMBNAIL_PRESCALE_DIR_SIZE (128 * 1024 * 1024)
+
+struct gfx_thumbnail_prescale_file
 {
-   uint64_t list_id;
-   gfx_thumbnail_t *thumbnail;
-} gfx_thumbnail_tag_t;
+   const char *path;
+   int64_t mtime;
+   uint32_t size;
+};
+
+struct gfx_thumbnail_cache_entry
+{
+   /* Decoded image (pixels are NULL while loading) */
+   struct texture_image image;
+   gfx_thumbnail_cache_entry_t *prev; /* More recently used */
+   gfx_thumbnail_cache_entry_t *next; /* Less recently used */
+   /* Thumbnails to upload the image to once it
+    * has loaded (RBUF) */
+   gfx_thumbnail_t **waiters;
+   char *path;
+   size_t size;
+   bool loading;
+   /* When false, the image is only used by the
+    * waiting thumbnails (e.g. savestate images,
+    * which may change on disk) */
+   bool retain;
+   /* Image is (or is loading from) a pre-scaled
+    * copy, rather than the original file */
+   bool prescaled;
+};
 
 static gfx_thumbnail_state_t gfx_thumb_st = {0}; /* uint64_t alignment */
 
@@ -89,6 +124,41 @@ void gfx_thumbnail_set_fade_missing(bool fade_missing)
    p_gfx_thumb->fade_missing = fade_missing;
 }
 
+/* Sets the largest size at which the menu driver
+ * draws thumbnails, which pre-scaled copies are
+ * shrunk to fit
+ * > Size is rounded up, so that resizing a window
+ *   slightly doesn't need new copies */
+void gfx_thumbnail_set_prescale_size(unsigned width, unsigned height)
+{
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+
+   if (!width || !height)
+      width = height = 0;
+
+   p_gfx_thumb->prescale_width  = (width  + 63) & ~63;
+   p_gfx_thumb->prescale_height = (height + 63) & ~63;
+}
+
+/* Specifies whether the menu driver is showing
+ * thumbnails fullscreen, in which case original
+ * images are loaded rather than pre-scaled copies
+ * > Returns true if thumbnails that are already
+ *   loaded should be requested again */
+bool gfx_thumbnail_set_fullscreen(bool fullscreen)
+{
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+   settings_t *settings               = config_get_ptr();
+   bool reload                        =
+            fullscreen
+         && !p_gfx_thumb->fullscreen
+         && p_gfx_thumb->prescale_width
+         && settings->bools.gfx_thumbnail_prescale;
+
+   p_gfx_thumb->fullscreen = fullscreen;
+   return reload;
+}
+
 /* Callbacks */
 
 /* Fade animation callback - simply resets thumbnail
@@ -138,61 +208,194 @@ static void gfx_thumbnail_init_fade(
    }
 }
 
-/* Used to process thumbnail data following completion
- * of image load task */
-static void gfx_thumbnail_handle_upload(
-      retro_task_t *task, void *task_data, void *user_data, const char *err)
+/* Cache */
+
+static void gfx_thumbnail_cache_unlink(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      gfx_thumbnail_cache_entry_t *entry)
 {
-   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
-   struct texture_image *img          = (struct texture_image*)task_data;
-   gfx_thumbnail_tag_t *thumbnail_tag = (gfx_thumbnail_tag_t*)user_data;
-   bool fade_enabled                  = false;
+   if (entry->prev)
+      entry->prev->next       = entry->next;
+   else
+      p_gfx_thumb->cache_head = entry->next;
 
-   /* Sanity check */
-   if (!thumbnail_tag)
-      goto end;
+   if (entry->next)
+      entry->next->prev       = entry->prev;
+   else
+      p_gfx_thumb->cache_tail = entry->prev;
 
-   /* Ensure that we are operating on the correct
-    * thumbnail... */
-   if (thumbnail_tag->list_id != p_gfx_thumb->list_id)
-      goto end;
+   entry->prev = NULL;
+   entry->next = NULL;
+}
 
-   /* Only process image if we are waiting for it */
-   if (thumbnail_tag->thumbnail->status != GFX_THUMBNAIL_STATUS_PENDING)
-      goto end;
+static void gfx_thumbnail_cache_link_front(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      gfx_thumbnail_cache_entry_t *entry)
+{
+   entry->prev = NULL;
+   entry->next = p_gfx_thumb->cache_head;
+
+   if (p_gfx_thumb->cache_head)
+      p_gfx_thumb->cache_head->prev = entry;
+   else
+      p_gfx_thumb->cache_tail       = entry;
 
+   p_gfx_thumb->cache_head = entry;
+}
+
+static void gfx_thumbnail_cache_free_entry(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      gfx_thumbnail_cache_entry_t *entry)
+{
+   gfx_thumbnail_cache_unlink(p_gfx_thumb, entry);
+   (void)RHMAP_DEL_STR(p_gfx_thumb->cache_map, entry->path);
+
+   if (entry->loading)
+      p_gfx_thumb->cache_loading--;
+
+   p_gfx_thumb->cache_size -= entry->size;
+
+   image_texture_free(&entry->image);
+   RBUF_FREE(entry->waiters);
+   free(entry->path);
+   free(entry);
+}
+
+/* Frees least recently used images until the cache
+ * is no larger than 'budget' bytes */
+static void gfx_thumbnail_cache_evict(
+      gfx_thumbnail_state_t *p_gfx_thumb, size_t budget)
+{
+   gfx_thumbnail_cache_entry_t *entry = p_gfx_thumb->cache_tail;
+
+   while (entry && (p_gfx_thumb->cache_size > budget))
+   {
+      gfx_thumbnail_cache_entry_t *prev = entry->prev;
+
+      if (!entry->loading)
+      {
+         gfx_thumbnail_cache_free_entry(p_gfx_thumb, entry);
+         p_gfx_thumb->cache_stats.evictions++;
+      }
+
+      entry = prev;
+   }
+}
+
+static size_t gfx_thumbnail_cache_budget(void)
+{
+   settings_t *settings = config_get_ptr();
+   return (size_t)settings->uints.gfx_thumbnail_cache_size * 1024 * 1024;
+}
+
+static gfx_thumbnail_cache_entry_t *gfx_thumbnail_cache_get(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned gfx_thumbnail_upscale_threshold)
+{
+   /* Cached images were upscaled for a different
+    * threshold - drop them */
+   if (gfx_thumbnail_upscale_threshold != p_gfx_thumb->cache_upscale_threshold)
+   {
+      gfx_thumbnail_cache_evict(p_gfx_thumb, 0);
+      p_gfx_thumb->cache_upscale_threshold = gfx_thumbnail_upscale_threshold;
+   }
+
+   if (!p_gfx_thumb->cache_map)
+      return NULL;
+
+   return RHMAP_GET_STR(p_gfx_thumb->cache_map, path);
+}
+
+/* Uploads 'img' to 'thumbnail', or marks the
+ * thumbnail as missing if 'img' is NULL */
+static void gfx_thumbnail_upload(gfx_thumbnail_t *thumbnail,
+      struct texture_image *img)
+{
    /* Sanity check: if thumbnail already has a texture,
     * we're in some kind of weird error state - in this
     * case, the best course of action is to just reset
     * the thumbnail... */
-   if (thumbnail_tag->thumbnail->texture)
-      gfx_thumbnail_reset(thumbnail_tag->thumbnail);
+   if (thumbnail->texture)
+      gfx_thumbnail_reset(thumbnail);
 
    /* Set thumbnail 'missing' status by default
     * (saves a number of checks later) */
-   thumbnail_tag->thumbnail->status = GFX_THUMBNAIL_STATUS_MISSING;
-
-   /* If we reach this stage, thumbnail 'fade in'
-    * animations should be applied (based on current
-    * thumbnail status and global configuration) */
-   fade_enabled = true;
-
-   /* Check we have a valid image */
-   if (!img || (img->width < 1) || (img->height < 1))
-      goto end;
+   thumbnail->status = GFX_THUMBNAIL_STATUS_MISSING;
 
    /* Upload texture to GPU */
-   if (!video_driver_texture_load(
+   if (!img || !video_driver_texture_load(
             img, TEXTURE_FILTER_MIPMAP_LINEAR,
-            &thumbnail_tag->thumbnail->texture))
-      goto end;
+            &thumbnail->texture))
+      return;
 
    /* Cache dimensions */
-   thumbnail_tag->thumbnail->width  = img->width;
-   thumbnail_tag->thumbnail->height = img->height;
+   thumbnail->width  = img->width;
+   thumbnail->height = img->height;
 
    /* Update thumbnail status */
-   thumbnail_tag->thumbnail->status = GFX_THUMBNAIL_STATUS_AVAILABLE;
+   thumbnail->status = GFX_THUMBNAIL_STATUS_AVAILABLE;
+}
+
+/* Used to process thumbnail data following completion
+ * of image load task */
+static void gfx_thumbnail_handle_upload(
+      retro_task_t *task, void *task_data, void *user_data, const char *err)
+{
+   size_t i;
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+   struct texture_image *img          = (struct texture_image*)task_data;
+   char *path                         = (char*)user_data;
+   gfx_thumbnail_cache_entry_t *entry = NULL;
+   gfx_thumbnail_t **waiters          = NULL;
+
+   /* Entry will be missing if the cache has been
+    * flushed since the load was requested */
+   if (path && p_gfx_thumb->cache_map)
+      entry = RHMAP_GET_STR(p_gfx_thumb->cache_map, path);
+
+   if (!entry || !entry->loading)
+      goto end;
+
+   entry->loading  = false;
+   p_gfx_thumb->cache_loading--;
+
+   /* Check we have a valid image */
+   if (!img || !img->pixels || (img->width < 1) || (img->height < 1))
+   {
+      if (img)
+      {
+         image_texture_free(img);
+         free(img);
+         img = NULL;
+      }
+   }
+
+   /* Hand the image to every thumbnail waiting for it,
+    * and trigger their 'fade in' animations */
+   waiters        = entry->waiters;
+   entry->waiters = NULL;
+
+   for (i = 0; i < RBUF_LEN(waiters); i++)
+   {
+      gfx_thumbnail_upload(waiters[i], img);
+      gfx_thumbnail_init_fade(p_gfx_thumb, waiters[i]);
+   }
+
+   RBUF_FREE(waiters);
+
+   /* Keep the image, if required */
+   if (img && entry->retain)
+   {
+      entry->image             = *img;
+      entry->size              = img->width * img->height * sizeof(uint32_t);
+      p_gfx_thumb->cache_size += entry->size;
+      img->pixels              = NULL;
+
+      gfx_thumbnail_cache_evict(p_gfx_thumb,
+            gfx_thumbnail_cache_budget());
+   }
+   else
+      gfx_thumbnail_cache_free_entry(p_gfx_thumb, entry);
 
 end:
    /* Clean up */
@@ -202,14 +405,217 @@ end:
       free(img);
    }
 
-   if (thumbnail_tag)
+   free(path);
+}
+
+/* Gets the path of the pre-scaled copy of the image at
+ * 'path' (see 'menu_thumbnail_prescale'), and the
+ * dimensions it is shrunk to fit.
+ * > Copies are named after the image path, size and
+ *   modification time, so that a replaced image gets
+ *   a new copy (old copies are deleted by
+ *   gfx_thumbnail_prescale_trim())
+ * Returns false if pre-scaling is disabled */
+static bool gfx_thumbnail_get_prescaled_path(const char *path,
+      char *s, size_t len, unsigned *width, unsigned *height)
+{
+   char name[64];
+   char dir[DIR_MAX_LENGTH];
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+   settings_t *settings               = config_get_ptr();
+   uint64_t hash                      = UINT64_C(0xCBF29CE484222325);
+   const char *c                      = path;
+   int32_t file_size;
+   int64_t file_mtime;
+
+   if (   !settings->bools.gfx_thumbnail_prescale
+       || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   /* Copies fit the thumbnails of the current
+    * menu driver (see gfx_thumbnail_set_prescale_size()) */
+   *width  = p_gfx_thumb->prescale_width;
+   *height = p_gfx_thumb->prescale_height;
+   if (!*width || !*height)
+      return false;
+
+   if ((file_size = path_get_size(path)) <= 0)
+      return false;
+   file_mtime = path_get_mtime(path);
+
+   /* FNV-1a */
+   while (*c)
+   {
+      hash ^= (uint8_t)*c++;
+      hash *= UINT64_C(0x100000001B3);
+   }
+
+   snprintf(name, sizeof(name), "%08x%08x_%x_%x_%ux%u.png",
+         (unsigned)(hash >> 32), (unsigned)hash,
+         (unsigned)file_size, (unsigned)file_mtime,
+         *width, *height);
+   fill_pathname_join_special(dir, settings->paths.directory_cache,
+         "thumbnails", sizeof(dir));
+   fill_pathname_join_special(s, dir, name, len);
+   return true;
+}
+
+/* Starts loading the image at 'path' into a new
+ * cache entry */
+static gfx_thumbnail_cache_entry_t *gfx_thumbnail_cache_load(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned gfx_thumbnail_upscale_threshold, bool retain)
+{
+   char prescaled_path[PATH_MAX_LENGTH];
+   unsigned prescale_width            = 0;
+   unsigned prescale_height           = 0;
+   bool pushed                        = false;
+   char *tag                          = NULL;
+   gfx_thumbnail_cache_entry_t *entry = (gfx_thumbnail_cache_entry_t*)
+      calloc(1, sizeof(*entry));
+
+   if (!entry)
+      return NULL;
+
+   if (!(entry->path = strdup(path)) || !(tag = strdup(path)))
+   {
+      free(entry->path);
+      free(entry);
+      return NULL;
+   }
+
+   entry->loading = true;
+   entry->retain  = retain;
+
+   RHMAP_SET_STR(p_gfx_thumb->cache_map, entry->path, entry);
+   gfx_thumbnail_cache_link_front(p_gfx_thumb, entry);
+   p_gfx_thumb->cache_loading++;
+
+   /* Would like to cancel any existing image load tasks
+    * here, but can't see how to do it...
+    * > Load pre-scaled copy of the image, if there is
+    *   one, otherwise create it while loading
+    *   (fullscreen views show the original image) */
+   if (   retain
+       && !p_gfx_thumb->fullscreen
+       && gfx_thumbnail_get_prescaled_path(path,
+            prescaled_path, sizeof(prescaled_path),
+            &prescale_width, &prescale_height))
    {
-      /* Trigger 'fade in' animation, if required */
-      if (fade_enabled)
-         gfx_thumbnail_init_fade(p_gfx_thumb,
-               thumbnail_tag->thumbnail);
+      entry->prescaled = true;
+
+      if (path_is_valid(prescaled_path))
+         pushed = task_push_image_load(
+               prescaled_path, video_driver_supports_rgba(),
+               gfx_thumbnail_upscale_threshold,
+               gfx_thumbnail_handle_upload, tag);
+      else if ((pushed = task_push_image_load_prescaled(
+               path, prescaled_path,
+               prescale_width, prescale_height,
+               video_driver_supports_rgba(),
+               gfx_thumbnail_upscale_threshold,
+               gfx_thumbnail_handle_upload, tag)))
+         p_gfx_thumb->prescale_written = true;
+   }
+   else
+      pushed = task_push_image_load(
+            path, video_driver_supports_rgba(),
+            gfx_thumbnail_upscale_threshold,
+            gfx_thumbnail_handle_upload, tag);
 
-      free(thumbnail_tag);
+   if (!pushed)
+   {
+      free(tag);
+      gfx_thumbnail_cache_free_entry(p_gfx_thumb, entry);
+      return NULL;
+   }
+
+   return entry;
+}
+
+/* Requests the image at 'path' for 'thumbnail'
+ * - If the image is cached, it is uploaded immediately
+ *   and 'thumbnail->status' is set accordingly
+ * - Otherwise, 'thumbnail->status' is set to
+ *   GFX_THUMBNAIL_STATUS_PENDING until it has loaded
+ *   (or GFX_THUMBNAIL_STATUS_MISSING if the load
+ *   could not be started)
+ * 'retain' keeps the decoded image in the cache.
+ * Returns false if 'path' does not exist */
+static bool gfx_thumbnail_cache_request(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      gfx_thumbnail_t *thumbnail,
+      unsigned gfx_thumbnail_upscale_threshold, bool retain)
+{
+   gfx_thumbnail_cache_entry_t *entry = gfx_thumbnail_cache_get(
+         p_gfx_thumb, path, gfx_thumbnail_upscale_threshold);
+
+   thumbnail->status = GFX_THUMBNAIL_STATUS_MISSING;
+
+   /* Fullscreen views show the original image */
+   if (     entry
+         && entry->prescaled
+         && !entry->loading
+         && p_gfx_thumb->fullscreen)
+   {
+      gfx_thumbnail_cache_free_entry(p_gfx_thumb, entry);
+      entry = NULL;
+   }
+
+   if (entry)
+   {
+      p_gfx_thumb->cache_stats.hits++;
+
+      if (!entry->loading)
+      {
+         gfx_thumbnail_cache_unlink(p_gfx_thumb, entry);
+         gfx_thumbnail_cache_link_front(p_gfx_thumb, entry);
+         gfx_thumbnail_upload(thumbnail, &entry->image);
+         return true;
+      }
+
+      /* Already loading (e.g. prefetched) - wait for it */
+      entry->retain |= retain;
+   }
+   else
+   {
+      if (!path_is_valid(path))
+         return false;
+
+      p_gfx_thumb->cache_stats.misses++;
+
+      if (!(entry = gfx_thumbnail_cache_load(p_gfx_thumb, path,
+                  gfx_thumbnail_upscale_threshold, retain)))
+         return true;
+   }
+
+   RBUF_PUSH(entry->waiters, thumbnail);
+   thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+   return true;
+}
+
+/* Stops 'thumbnail' waiting for any image load */
+static void gfx_thumbnail_cache_remove_waiter(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      gfx_thumbnail_t *thumbnail)
+{
+   gfx_thumbnail_cache_entry_t *entry;
+
+   for (entry = p_gfx_thumb->cache_head; entry; entry = entry->next)
+   {
+      size_t i;
+
+      if (!entry->loading)
+         continue;
+
+      for (i = 0; i < RBUF_LEN(entry->waiters); i++)
+      {
+         if (entry->waiters[i] == thumbnail)
+         {
+            RBUF_REMOVE(entry->waiters, i);
+            return;
+         }
+      }
    }
 }
 
@@ -224,8 +630,14 @@ end:
 void gfx_thumbnail_cancel_pending_requests(void)
 {
    gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+   gfx_thumbnail_cache_entry_t *entry;
 
    p_gfx_thumb->list_id++;
+
+   /* Image loads still complete (and are cached),
+    * but no longer update any thumbnails */
+   for (entry = p_gfx_thumb->cache_head; entry; entry = entry->next)
+      RBUF_CLEAR(entry->waiters);
 }
 
 /* Requests loading of the specified thumbnail
@@ -264,30 +676,15 @@ void gfx_thumbnail_request(
          const char *thumbnail_path = NULL;
          if (gfx_thumbnail_get_path(path_data, thumbnail_id, &thumbnail_path))
          {
-            /* Load thumbnail, if required */
-            if (path_is_valid(thumbnail_path))
-            {
-               gfx_thumbnail_tag_t *thumbnail_tag =
-                  (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t));
-
-               if (!thumbnail_tag)
-                  goto end;
-
-               /* Configure user data */
-               thumbnail_tag->thumbnail = thumbnail;
-               thumbnail_tag->list_id   = p_gfx_thumb->list_id;
-
-               /* Would like to cancel any existing image load tasks
-                * here, but can't see how to do it... */
-               if (task_push_image_load(
-                        thumbnail_path, video_driver_supports_rgba(),
-                        gfx_thumbnail_upscale_threshold,
-                        gfx_thumbnail_handle_upload, thumbnail_tag))
-                  thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
-            }
+            /* Load thumbnail (or fetch it from
+             * the cache), if it exists */
+            if (gfx_thumbnail_cache_request(p_gfx_thumb,
+                     thumbnail_path, thumbnail,
+                     gfx_thumbnail_upscale_threshold, true))
+               goto end;
 #ifdef HAVE_NETWORKING
             /* Handle on demand thumbnail downloads */
-            else if (network_on_demand_thumbnails)
+            if (network_on_demand_thumbnails)
             {
                enum playlist_thumbnail_name_flags curr_flag;
                const char *system                         = NULL;
@@ -365,7 +762,6 @@ void gfx_thumbnail_request_file(
       unsigned gfx_thumbnail_upscale_threshold)
 {
    gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
-   gfx_thumbnail_tag_t *thumbnail_tag = NULL;
 
    if (!thumbnail)
       return;
@@ -376,25 +772,21 @@ void gfx_thumbnail_request_file(
    thumbnail->status = GFX_THUMBNAIL_STATUS_MISSING;
 
    /* Check if file path is valid */
-   if (   string_is_empty(file_path)
-       || !path_is_valid(file_path))
-      return;
-
-   /* Load thumbnail */
-   if (!(thumbnail_tag = (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t))))
+   if (string_is_empty(file_path))
       return;
 
-   /* Configure user data */
-   thumbnail_tag->thumbnail = thumbnail;
-   thumbnail_tag->list_id   = p_gfx_thumb->list_id;
+   /* Load thumbnail
+    * > Image is not retained in the cache, since
+    *   files such as savestate images may be
+    *   overwritten at any time */
+   gfx_thumbnail_cache_request(p_gfx_thumb,
+         file_path, thumbnail,
+         gfx_thumbnail_upscale_threshold, false);
 
-   /* Would like to cancel any existing image load tasks
-    * here, but can't see how to do it... */
-   if (task_push_image_load(
-         file_path, video_driver_supports_rgba(),
-         gfx_thumbnail_upscale_threshold,
-         gfx_thumbnail_handle_upload, thumbnail_tag))
-      thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+   /* Trigger 'fade in' animation if the image
+    * was already available */
+   if (thumbnail->status == GFX_THUMBNAIL_STATUS_AVAILABLE)
+      gfx_thumbnail_init_fade(p_gfx_thumb, thumbnail);
 }
 
 /* Resets (and free()s the current texture of) the
@@ -404,6 +796,11 @@ void gfx_thumbnail_reset(gfx_thumbnail_t *thumbnail)
    if (!thumbnail)
       return;
 
+   /* Stop waiting for any pending image load */
+   if (   (thumbnail->status == GFX_THUMBNAIL_STATUS_PENDING)
+       && gfx_thumb_st.cache_loading)
+      gfx_thumbnail_cache_remove_waiter(&gfx_thumb_st, thumbnail);
+
    /* Unload texture */
    if (thumbnail->texture)
       video_driver_texture_unload(&thumbnail->texture);
@@ -426,6 +823,259 @@ void gfx_thumbnail_reset(gfx_thumbnail_t *thumbnail)
                             | GFX_THUMB_FLAG_CORE_ASPECT);
 }
 
+/* Prefetching */
+
+/* Starts loading the image at 'path' into the
+ * cache, unless it is already there */
+static void gfx_thumbnail_cache_prefetch(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned gfx_thumbnail_upscale_threshold)
+{
+   if (   gfx_thumbnail_cache_get(p_gfx_thumb, path,
+            gfx_thumbnail_upscale_threshold)
+       || !path_is_valid(path))
+      return;
+
+   if (gfx_thumbnail_cache_load(p_gfx_thumb, path,
+            gfx_thumbnail_upscale_threshold, true))
+      p_gfx_thumb->cache_stats.prefetches++;
+}
+
+/* Loads the thumbnails of the next 'menu_thumbnail_prefetch'
+ * playlist entries into the cache, so that they can be shown
+ * straight away when scrolled to
+ * - 'first' and 'last' are the playlist indices of the
+ *   entries currently shown (the selected entry, for menu
+ *   drivers that only show its thumbnails)
+ * - Entries are prefetched in the direction of scrolling,
+ *   i.e. the direction in which 'first'/'last' have moved
+ *   since the last call. Function is a no-op if they have
+ *   not moved, so it may be called every frame
+ * NOTE: Must be called *after* gfx_thumbnail_set_system() */
+void gfx_thumbnail_prefetch(
+      gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t first, size_t last,
+      unsigned gfx_thumbnail_upscale_threshold)
+{
+   static const enum gfx_thumbnail_id thumbnail_ids[] = {
+      GFX_THUMBNAIL_RIGHT,
+      GFX_THUMBNAIL_LEFT
+   };
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+   settings_t *settings               = config_get_ptr();
+   unsigned count                     = settings->uints.gfx_thumbnail_prefetch;
+   size_t playlist_size;
+   size_t i;
+   bool forward;
+
+   if (   !path_data
+       || !playlist
+       || !count
+       || !settings->uints.gfx_thumbnail_cache_size)
+      return;
+
+   /* Determine direction of scrolling */
+   if (playlist != p_gfx_thumb->prefetch_playlist)
+      forward = true;
+   else if (   (first == p_gfx_thumb->prefetch_first)
+            && (last  == p_gfx_thumb->prefetch_last))
+      return;
+   else
+      forward = (first + last) >=
+            (p_gfx_thumb->prefetch_first + p_gfx_thumb->prefetch_last);
+
+   p_gfx_thumb->prefetch_playlist = playlist;
+   p_gfx_thumb->prefetch_first    = first;
+   p_gfx_thumb->prefetch_last     = last;
+
+   if (   !p_gfx_thumb->prefetch_path_data
+       && !(p_gfx_thumb->prefetch_path_data = gfx_thumbnail_path_init()))
+      return;
+
+   /* Inherit current system and thumbnail settings */
+   memcpy(p_gfx_thumb->prefetch_path_data, path_data,
+         sizeof(*p_gfx_thumb->prefetch_path_data));
+
+   playlist_size = playlist_get_size(playlist);
+
+   for (i = 1; i <= count; i++)
+   {
+      size_t j;
+      size_t idx;
+
+      if (forward)
+      {
+         if ((idx = last + i) >= playlist_size)
+            break;
+      }
+      else
+      {
+         if (i > first)
+            break;
+         idx = first - i;
+      }
+
+      if (p_gfx_thumb->cache_loading >= GFX_THUMBNAIL_PREFETCH_MAX_LOADING)
+         break;
+
+      if (!gfx_thumbnail_set_content_playlist(
+               p_gfx_thumb->prefetch_path_data, playlist, idx))
+         continue;
+
+      for (j = 0; j < ARRAY_SIZE(thumbnail_ids); j++)
+      {
+         const char *thumbnail_path = NULL;
+
+         if (   gfx_thumbnail_is_enabled(
+                  p_gfx_thumb->prefetch_path_data, thumbnail_ids[j])
+             && gfx_thumbnail_update_path(
+                  p_gfx_thumb->prefetch_path_data, thumbnail_ids[j])
+             && gfx_thumbnail_get_path(
+                  p_gfx_thumb->prefetch_path_data, thumbnail_ids[j],
+                  &thumbnail_path))
+            gfx_thumbnail_cache_prefetch(p_gfx_thumb, thumbnail_path,
+                  gfx_thumbnail_upscale_threshold);
+      }
+   }
+}
+
+static void gfx_thumbnail_prescale_cb(
+      retro_task_t *task, void *task_data, void *user_data, const char *err)
+{
+   struct texture_image *img = (struct texture_image*)task_data;
+
+   if (img)
+   {
+      image_texture_free(img);
+      free(img);
+   }
+}
+
+/* Creates the pre-scaled copy of the thumbnail
+ * image at 'path' in the background, if pre-scaling
+ * is enabled (e.g. after a thumbnail download) */
+void gfx_thumbnail_prescale_file(const char *path)
+{
+   char prescaled_path[PATH_MAX_LENGTH];
+   unsigned prescale_width            = 0;
+   unsigned prescale_height           = 0;
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+
+   if (   string_is_empty(path)
+       || !gfx_thumbnail_get_prescaled_path(path,
+            prescaled_path, sizeof(prescaled_path),
+            &prescale_width, &prescale_height)
+       || path_is_valid(prescaled_path))
+      return;
+
+   if (task_push_image_load_prescaled(path, prescaled_path,
+         prescale_width, prescale_height,
+         video_driver_supports_rgba(), 0,
+         gfx_thumbnail_prescale_cb, NULL))
+      p_gfx_thumb->prescale_written = true;
+}
+
+static int gfx_thumbnail_prescale_cmp(const void *a, const void *b)
+{
+   int64_t mtime_a = ((const struct gfx_thumbnail_prescale_file*)a)->mtime;
+   int64_t mtime_b = ((const struct gfx_thumbnail_prescale_file*)b)->mtime;
+   return (mtime_a > mtime_b) - (mtime_a < mtime_b);
+}
+
+/* Deletes the oldest pre-scaled copies once they take
+ * more than GFX_THUMBNAIL_PRESCALE_DIR_SIZE bytes
+ * > Copies of images that have since been replaced are
+ *   never loaded again, so they are the first to go */
+static void gfx_thumbnail_prescale_trim(void)
+{
+   size_t i;
+   char dir[DIR_MAX_LENGTH];
+   struct gfx_thumbnail_prescale_file *files = NULL;
+   struct string_list *list                  = NULL;
+   uint64_t total                            = 0;
+   settings_t *settings                      = config_get_ptr();
+
+   if (string_is_empty(settings->paths.directory_cache))
+      return;
+
+   fill_pathname_join_special(dir, settings->paths.directory_cache,
+         "thumbnails", sizeof(dir));
+   if (!(list = dir_list_new(dir, "png", false, false, false, false)))
+      return;
+
+   if (list->size && (files = (struct gfx_thumbnail_prescale_file*)
+            malloc(list->size * sizeof(*files))))
+   {
+      for (i = 0; i < list->size; i++)
+      {
+         int32_t size   = path_get_size(list->elems[i].data);
+         files[i].path  = list->elems[i].data;
+         files[i].mtime = path_get_mtime(list->elems[i].data);
+         files[i].size  = (size > 0) ? (uint32_t)size : 0;
+         total         += files[i].size;
+      }
+
+      /* Trim to 3/4 of the limit, so that this
+       * doesn't have to be repeated every time */
+      if (total > GFX_THUMBNAIL_PRESCALE_DIR_SIZE)
+      {
+         qsort(files, list->size, sizeof(*files),
+               gfx_thumbnail_prescale_cmp);
+
+         for (i = 0; (i < list->size)
+               && (total > GFX_THUMBNAIL_PRESCALE_DIR_SIZE / 4 * 3); i++)
+         {
+            if (!filestream_delete(files[i].path))
+               total -= files[i].size;
+         }
+      }
+
+      free(files);
+   }
+
+   string_list_free(list);
+}
+
+/* Frees all cached thumbnail images, and logs
+ * the cache statistics
+ * > Any pending image loads are ignored when
+ *   they complete, so this must only be called
+ *   once no thumbnails are waiting for them
+ *   (i.e. when the menu is deinitialised) */
+void gfx_thumbnail_cache_flush(void)
+{
+   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
+
+   if (p_gfx_thumb->cache_stats.hits || p_gfx_thumb->cache_stats.misses)
+      RARCH_LOG("[Thumbnails]: Cache: %u hits, %u misses, %u prefetched, %u evicted.\n",
+            p_gfx_thumb->cache_stats.hits,
+            p_gfx_thumb->cache_stats.misses,
+            p_gfx_thumb->cache_stats.prefetches,
+            p_gfx_thumb->cache_stats.evictions);
+
+   while (p_gfx_thumb->cache_head)
+      gfx_thumbnail_cache_free_entry(p_gfx_thumb, p_gfx_thumb->cache_head);
+   RHMAP_FREE(p_gfx_thumb->cache_map);
+
+   if (p_gfx_thumb->prefetch_path_data)
+      free(p_gfx_thumb->prefetch_path_data);
+   p_gfx_thumb->prefetch_path_data = NULL;
+   p_gfx_thumb->prefetch_playlist  = NULL;
+
+   /* Next menu driver sets its own thumbnail size */
+   p_gfx_thumb->prescale_width     = 0;
+   p_gfx_thumb->prescale_height    = 0;
+   p_gfx_thumb->fullscreen         = false;
+
+   if (p_gfx_thumb->prescale_written)
+   {
+      gfx_thumbnail_prescale_trim();
+      p_gfx_thumb->prescale_written = false;
+   }
+
+   memset(&p_gfx_thumb->cache_stats, 0, sizeof(p_gfx_thumb->cache_stats));
+}
+
 /* Stream processing */
 
 /* Requests loading of the specified thumbnail via
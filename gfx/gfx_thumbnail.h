@@ -99,6 +99,11 @@ typedef struct
    enum gfx_thumbnail_shadow_type type;
 } gfx_thumbnail_shadow_t;
 
+/* A decoded thumbnail image held by the thumbnail
+ * cache (or an image load that thumbnails are
+ * waiting on) */
+typedef struct gfx_thumbnail_cache_entry gfx_thumbnail_cache_entry_t;
+
 /* Structure containing all gfx_thumbnail
  * variables */
 struct gfx_thumbnail_state
@@ -115,6 +120,48 @@ struct gfx_thumbnail_state
     * at the time when the load completes */
    uint64_t list_id;
 
+   /* Decoded thumbnail images are cached (up to
+    * 'menu_thumbnail_cache_size' MB), so that thumbnails
+    * which go off-screen and come back don't have to be
+    * read and decoded again. Entries are looked up by
+    * image path (RHMAP), and also kept in a list in order
+    * of use, most recent first, for eviction */
+   gfx_thumbnail_cache_entry_t **cache_map;
+   gfx_thumbnail_cache_entry_t *cache_head;
+   gfx_thumbnail_cache_entry_t *cache_tail;
+
+   /* Used to find the thumbnails of the playlist
+    * entries to prefetch, without disturbing the
+    * menu driver's own path data */
+   gfx_thumbnail_path_data_t *prefetch_path_data;
+   playlist_t *prefetch_playlist;
+   size_t prefetch_first;
+   size_t prefetch_last;
+
+   /* Total size of the cached images, in bytes */
+   size_t cache_size;
+
+   struct
+   {
+      unsigned hits;
+      unsigned misses;
+      unsigned prefetches;
+      unsigned evictions;
+   } cache_stats;
+
+   /* Images are cached as they were loaded, i.e.
+    * already upscaled according to this threshold */
+   unsigned cache_upscale_threshold;
+
+   /* Number of image loads in progress */
+   unsigned cache_loading;
+
+   /* Largest size at which the menu driver draws
+    * thumbnails - pre-scaled copies are shrunk to
+    * fit it (see 'menu_thumbnail_prescale') */
+   unsigned prescale_width;
+   unsigned prescale_height;
+
    /* When streaming thumbnails, to minimise the processing
     * of unnecessary images (i.e. when scrolling rapidly through
     * playlists), we delay loading until an entry has been on screen
@@ -127,6 +174,14 @@ struct gfx_thumbnail_state
    /* When true, 'fade in' animation will also be
     * triggered for missing thumbnails */
    bool fade_missing;
+
+   /* When true, the menu driver is showing thumbnails
+    * fullscreen (see gfx_thumbnail_set_fullscreen()) */
+   bool fullscreen;
+
+   /* When true, pre-scaled copies may have been written
+    * since the cache directory was last trimmed */
+   bool prescale_written;
 };
 
 typedef struct gfx_thumbnail_state gfx_thumbnail_state_t;
@@ -151,6 +206,19 @@ void gfx_thumbnail_set_fade_duration(float duration);
  *   any 'thumbnail unavailable' notifications */
 void gfx_thumbnail_set_fade_missing(bool fade_missing);
 
+/* Sets the largest size at which the menu driver
+ * draws thumbnails (outside of any fullscreen view).
+ * Pre-scaled copies are shrunk to fit this size
+ * > If 'width' or 'height' is 0, no copies are made */
+void gfx_thumbnail_set_prescale_size(unsigned width, unsigned height);
+
+/* Specifies whether the menu driver is showing
+ * thumbnails fullscreen, in which case original
+ * images are loaded rather than pre-scaled copies
+ * > Returns true if thumbnails that are already
+ *   loaded should be requested again */
+bool gfx_thumbnail_set_fullscreen(bool fullscreen);
+
 /* Core interface */
 
 /* When called, prevents the handling of any pending
@@ -195,6 +263,35 @@ void gfx_thumbnail_request_file(
  * specified thumbnail */
 void gfx_thumbnail_reset(gfx_thumbnail_t *thumbnail);
 
+/* Loads the thumbnails of the next 'menu_thumbnail_prefetch'
+ * playlist entries into the cache, so that they can be shown
+ * straight away when scrolled to
+ * - 'first' and 'last' are the playlist indices of the
+ *   entries currently shown (the selected entry, for menu
+ *   drivers that only show its thumbnails)
+ * - Entries are prefetched in the direction of scrolling,
+ *   i.e. the direction in which 'first'/'last' have moved
+ *   since the last call. Function is a no-op if they have
+ *   not moved, so it may be called every frame
+ * NOTE: Must be called *after* gfx_thumbnail_set_system() */
+void gfx_thumbnail_prefetch(
+      gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t first, size_t last,
+      unsigned gfx_thumbnail_upscale_threshold);
+
+/* Creates the pre-scaled copy of the thumbnail
+ * image at 'path' in the background, if pre-scaling
+ * is enabled (e.g. after a thumbnail download) */
+void gfx_thumbnail_prescale_file(const char *path);
+
+/* Frees all cached thumbnail images, and logs
+ * the cache statistics
+ * > Any pending image loads are ignored when
+ *   they complete, so this must only be called
+ *   once no thumbnails are waiting for them
+ *   (i.e. when the menu is deinitialised) */
+void gfx_thumbnail_cache_flush(void);
+
 /* Stream processing */
 
 /* Requests loading of the specified thumbnail via
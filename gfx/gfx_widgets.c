@@ -703,6 +703,7 @@ void gfx_widgets_flush_text(
    if (!font_data || (font_data->usage_count == 0))
       return;
 
+   gfx_display_flush(disp_get_ptr());
    if (font_data->font && font_data->font->renderer && font_data->font->renderer->flush)
       font_data->font->renderer->flush(video_width, video_height, font_data->font->renderer_data);
    font_data->raster_block.carr.coords.vertices = 0;
@@ -1846,6 +1847,8 @@ void gfx_widgets_frame(void *data)
    gfx_widgets_font_unbind(&p_dispwidget->gfx_widget_fonts.bold);
    gfx_widgets_font_unbind(&p_dispwidget->gfx_widget_fonts.msg_queue);
 
+   gfx_display_flush(p_disp);
+
    if (video_st->current_video && video_st->current_video->set_viewport)
       video_st->current_video->set_viewport(
             video_st->data, video_width, video_height, false, true);
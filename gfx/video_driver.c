@@ -4142,6 +4142,7 @@ void video_driver_frame(const void *data, unsigned width,
             " - Deviation: %5.2f %%\n"
             " Frames:   %8" PRIu64"\n"
             " - Dropped:   %5u\n"
+            " Draw Calls:  %5u\n"
             "AUDIO: %s\n"
             " Saturation:  %5.2f %%\n"
             " Deviation:   %5.2f %%\n"
@@ -4171,6 +4172,7 @@ void video_driver_frame(const void *data, unsigned width,
             100.0f * stddev,
             video_st->frame_count,
             video_st->frame_drop_count,
+            ((gfx_display_t*)video_info.disp_userdata)->draw_calls_last,
             audio_state_get_ptr()->current_audio->ident,
             audio_stats.average_buffer_saturation,
             audio_stats.std_deviation_percentage,
@@ -4186,6 +4188,7 @@ void video_driver_frame(const void *data, unsigned width,
          && video_st->current_video
          && video_st->current_video->frame)
    {
+      gfx_display_t *p_disp       = (gfx_display_t*)video_info.disp_userdata;
       video_info.current_subframe = 0;
       if (video_st->current_video->frame(
                video_st->data, data, width, height,
@@ -4200,6 +4203,10 @@ void video_driver_frame(const void *data, unsigned width,
          video_st->flags |=  VIDEO_FLAG_ACTIVE;
       else
          video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+
+      /* Menu and widget draws issued through gfx_display */
+      p_disp->draw_calls_last = p_disp->draw_calls;
+      p_disp->draw_calls      = 0;
    }
 
    video_st->frame_count++;
@@ -200,6 +200,7 @@ ACHIEVEMENTS
 
 #include "../cheevos/cheevos.c"
 #include "../cheevos/cheevos_client.c"
+#include "../cheevos/cheevos_memory.c"
 #include "../cheevos/cheevos_menu.c"
 
 #include "../deps/rcheevos/src/rc_client.c"
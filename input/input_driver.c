@@ -24,6 +24,7 @@
 #include <encodings/utf.h>
 #include <clamping.h>
 #include <retro_endianness.h>
+#include <array/rbuf.h>
 
 #include "input_driver.h"
 #include "input_keymaps.h"
@@ -5761,6 +5762,154 @@ void bsv_movie_deinit_full(input_driver_state_t *input_st)
    input_st->bsv_movie_state_next_handle = NULL;
 }
 
+/* Forgets the last checkpoint, so that the next one
+ * recorded is a full one. */
+static void bsv_movie_checkpoint_invalidate(bsv_movie_t *handle)
+{
+   handle->checkpoint_pos    = -1;
+   handle->checkpoint_deltas = 0;
+}
+
+/* Drops what the checkpoints know about the part of the
+ * replay from 'end' on, after it has been cut off. */
+static void bsv_movie_checkpoint_truncate(bsv_movie_t *handle, int64_t end)
+{
+   size_t len = RBUF_LEN(handle->checkpoint_index);
+   if (handle->checkpoint_pos >= end)
+      bsv_movie_checkpoint_invalidate(handle);
+   while (len && (int64_t)handle->checkpoint_index[len - 1].pos >= end)
+      len--;
+   RBUF_RESIZE(handle->checkpoint_index, len);
+}
+
+static bool bsv_movie_checkpoint_reserve(bsv_movie_t *handle, size_t size)
+{
+   if (handle->checkpoint_state && handle->checkpoint_size == size)
+      return true;
+
+   free(handle->checkpoint_state);
+   free(handle->checkpoint_next);
+   free(handle->checkpoint_patch);
+   handle->checkpoint_state = NULL;
+   handle->checkpoint_next  = NULL;
+   handle->checkpoint_patch = NULL;
+   handle->checkpoint_size  = 0;
+   bsv_movie_checkpoint_invalidate(handle);
+
+   if (!size)
+      return false;
+
+#ifdef HAVE_REWIND
+   /* Deltas are made with the rewind codec, which
+    * needs both states from state_manager_raw_alloc. */
+   handle->checkpoint_state = (uint8_t*)state_manager_raw_alloc(size, 0);
+   handle->checkpoint_next  = (uint8_t*)state_manager_raw_alloc(size, 1);
+   handle->checkpoint_patch = (uint8_t*)malloc(
+         state_manager_raw_maxsize(size));
+
+   if (     !handle->checkpoint_state
+         || !handle->checkpoint_next
+         || !handle->checkpoint_patch)
+#else
+   handle->checkpoint_state = (uint8_t*)malloc(size);
+   handle->checkpoint_next  = (uint8_t*)malloc(size);
+
+   if (!handle->checkpoint_state || !handle->checkpoint_next)
+#endif
+   {
+      free(handle->checkpoint_state);
+      free(handle->checkpoint_next);
+      free(handle->checkpoint_patch);
+      handle->checkpoint_state = NULL;
+      handle->checkpoint_next  = NULL;
+      handle->checkpoint_patch = NULL;
+      return false;
+   }
+
+   handle->checkpoint_size  = size;
+   return true;
+}
+
+#if defined(HAVE_REWIND) && defined(MSB_FIRST)
+/* Patches are made of 16-bit words in host order,
+ * the file stores them little-endian. */
+static void bsv_movie_checkpoint_swap_patch(uint8_t *patch, size_t len)
+{
+   size_t i;
+   uint16_t *patch16 = (uint16_t*)patch;
+   for (i = 0; i < len / sizeof(uint16_t); i++)
+      patch16[i] = swap_if_big16(patch16[i]);
+}
+#endif
+
+/* Writes a checkpoint of the current state at the end of
+ * the file, as a delta to the previous one when possible.
+ * 'frame_pos' is where the frame it belongs to starts.
+ * Returns false if no checkpoint could be made. */
+static bool bsv_movie_write_checkpoint(bsv_movie_t *handle, int64_t frame_pos)
+{
+   uint8_t header[1 + 2 * sizeof(uint64_t)];
+   uint64_t size_lil;
+   uint8_t *swap;
+   retro_ctx_serialize_info_t serial_info;
+   size_t info_size = core_serialize_size();
+   int64_t pos      = intfstream_tell(handle->file);
+
+   if (!bsv_movie_checkpoint_reserve(handle, info_size))
+      return false;
+
+   serial_info.data = handle->checkpoint_next;
+   serial_info.size = info_size;
+   if (!core_serialize(&serial_info))
+      return false;
+
+#ifdef HAVE_REWIND
+   if (     handle->checkpoint_pos >= 0
+         && handle->checkpoint_deltas < REPLAY_CHECKPOINT_KEYFRAME_INTERVAL)
+   {
+      uint64_t base_lil;
+      size_t patch_size = state_manager_raw_compress(
+            handle->checkpoint_next, handle->checkpoint_state,
+            info_size, handle->checkpoint_patch);
+#ifdef MSB_FIRST
+      bsv_movie_checkpoint_swap_patch(handle->checkpoint_patch, patch_size);
+#endif
+      base_lil  = swap_if_big64((uint64_t)handle->checkpoint_pos);
+      size_lil  = swap_if_big64((uint64_t)patch_size);
+      header[0] = REPLAY_TOKEN_CHECKPOINT_DELTA;
+      memcpy(header + 1, &base_lil, sizeof(uint64_t));
+      memcpy(header + 1 + sizeof(uint64_t), &size_lil, sizeof(uint64_t));
+      intfstream_write(handle->file, header, sizeof(header));
+      intfstream_write(handle->file, handle->checkpoint_patch, patch_size);
+      handle->checkpoint_deltas++;
+   }
+   else
+#endif
+   {
+      size_lil  = swap_if_big64((uint64_t)info_size);
+      header[0] = REPLAY_TOKEN_CHECKPOINT_FRAME;
+      memcpy(header + 1, &size_lil, sizeof(uint64_t));
+      intfstream_write(handle->file, header, 1 + sizeof(uint64_t));
+      intfstream_write(handle->file, handle->checkpoint_next, info_size);
+      handle->checkpoint_deltas = 0;
+
+      /* Only full checkpoints can be seeked to */
+      {
+         struct bsv_checkpoint_entry entry;
+         entry.frame = handle->frame_counter;
+         entry.pos   = (uint64_t)frame_pos;
+         RBUF_PUSH(handle->checkpoint_index, entry);
+      }
+   }
+
+   /* The state just written is the base of the next delta */
+   swap                     = handle->checkpoint_state;
+   handle->checkpoint_state = handle->checkpoint_next;
+   handle->checkpoint_next  = swap;
+   handle->checkpoint_pos   = pos;
+   return true;
+}
+
 void bsv_movie_frame_rewind(void)
 {
    input_driver_state_t *input_st = &input_driver_st;
@@ -5830,6 +5979,9 @@ void bsv_movie_frame_rewind(void)
          bsv_movie_read_next_events(handle);
       }
    }
+
+   if (recording)
+      bsv_movie_checkpoint_truncate(handle, intfstream_tell(handle->file));
 }
 
 /* Zero out key events when playing back or recording */
@@ -5906,6 +6058,14 @@ void bsv_movie_finish_rewind(input_driver_state_t *input_st)
 void bsv_movie_read_next_events(bsv_movie_t *handle)
 {
    input_driver_state_t *input_st = input_state_get_ptr();
+   /* Don't read the checkpoint index as frames */
+   if (     handle->stream_end
+         && intfstream_tell(handle->file) >= handle->stream_end)
+   {
+      RARCH_LOG("[Replay] EOF at checkpoint index\n");
+      input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
+      return;
+   }
    if (intfstream_read(handle->file, &(handle->key_event_count), 1) == 1)
    {
       int i;
@@ -5969,8 +6129,8 @@ void bsv_movie_read_next_events(bsv_movie_t *handle)
       else if (next_frame_type == REPLAY_TOKEN_CHECKPOINT_FRAME)
       {
          uint64_t size;
-         uint8_t *st;
          retro_ctx_serialize_info_t serial_info;
+         int64_t pos = intfstream_tell(handle->file) - 1;
 
          if (intfstream_read(handle->file, &(size), sizeof(uint64_t)) != sizeof(uint64_t))
          {
@@ -5980,19 +6140,86 @@ void bsv_movie_read_next_events(bsv_movie_t *handle)
          }
 
          size = swap_if_big64(size);
-         st   = (uint8_t*)malloc(size);
-         if (intfstream_read(handle->file, st, size) != (int64_t)size)
+         if (!bsv_movie_checkpoint_reserve(handle, (size_t)size))
+         {
+            RARCH_ERR("[Replay] Failed to allocate replay checkpoint\n");
+            input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
+            return;
+         }
+
+         if (intfstream_read(handle->file, handle->checkpoint_state, size) != (int64_t)size)
          {
             RARCH_ERR("[Replay] Replay checkpoint truncated\n");
             input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
-            free(st);
+            bsv_movie_checkpoint_invalidate(handle);
             return;
          }
 
-         serial_info.data_const = st;
+         handle->checkpoint_pos = pos;
+         serial_info.data_const = handle->checkpoint_state;
          serial_info.size       = size;
          core_unserialize(&serial_info);
-         free(st);
+      }
+      else if (next_frame_type == REPLAY_TOKEN_CHECKPOINT_DELTA)
+      {
+         uint64_t base;
+         uint64_t size;
+         int64_t pos = intfstream_tell(handle->file) - 1;
+
+         if (     intfstream_read(handle->file, &(base), sizeof(uint64_t)) != sizeof(uint64_t)
+               || intfstream_read(handle->file, &(size), sizeof(uint64_t)) != sizeof(uint64_t))
+         {
+            RARCH_ERR("[Replay] Replay ran out of frames\n");
+            input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
+            return;
+         }
+
+         base = swap_if_big64(base);
+         size = swap_if_big64(size);
+
+#ifdef HAVE_REWIND
+         /* A delta can only be applied on top of the checkpoint
+          * it was made from; after seeking around in the replay
+          * that one may not be the last one read. */
+         if (     handle->checkpoint_pos >= 0
+               && (uint64_t)handle->checkpoint_pos == base
+               && size <= state_manager_raw_maxsize(handle->checkpoint_size))
+         {
+            retro_ctx_serialize_info_t serial_info;
+
+            if (intfstream_read(handle->file, handle->checkpoint_patch, size) != (int64_t)size)
+            {
+               RARCH_ERR("[Replay] Replay checkpoint truncated\n");
+               input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
+               bsv_movie_checkpoint_invalidate(handle);
+               return;
+            }
+#ifdef MSB_FIRST
+            bsv_movie_checkpoint_swap_patch(handle->checkpoint_patch, (size_t)size);
+#endif
+            if (!state_manager_raw_validate(handle->checkpoint_patch,
+                     (size_t)size, handle->checkpoint_size))
+            {
+               RARCH_ERR("[Replay] Replay checkpoint is damaged\n");
+               input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
+               bsv_movie_checkpoint_invalidate(handle);
+               return;
+            }
+            state_manager_raw_decompress(handle->checkpoint_patch, (size_t)size,
+                  handle->checkpoint_state, handle->checkpoint_size);
+
+            handle->checkpoint_pos = pos;
+            serial_info.data_const = handle->checkpoint_state;
+            serial_info.size       = handle->checkpoint_size;
+            core_unserialize(&serial_info);
+         }
+         else
+#endif
+         {
+            RARCH_WARN("[Replay] Skipping checkpoint, its base checkpoint was not read\n");
+            intfstream_seek(handle->file, (int64_t)size, SEEK_CUR);
+            bsv_movie_checkpoint_invalidate(handle);
+         }
       }
    }
 }
@@ -6022,41 +6249,44 @@ void bsv_movie_next_frame(input_driver_state_t *input_st)
 
    if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_RECORDING)
    {
-      int i;
+      /* The whole frame goes out in one write:
+       * key events, input events, then the frame token. */
+      uint8_t frame[1 + sizeof(handle->key_events) + sizeof(uint16_t)
+         + sizeof(handle->input_events) + 1];
+      size_t key_size   = handle->key_event_count * sizeof(bsv_key_data_t);
+      size_t input_size = handle->input_event_count * sizeof(bsv_input_data_t);
       uint16_t evt_count = swap_if_big16(handle->input_event_count);
-      /* write key events, frame is over */
-      intfstream_write(handle->file, &(handle->key_event_count), 1);
-      for (i = 0; i < handle->key_event_count; i++)
-         intfstream_write(handle->file, &(handle->key_events[i]), sizeof(bsv_key_data_t));
+      size_t len        = 0;
+
+      frame[len++]      = handle->key_event_count;
+      memcpy(frame + len, handle->key_events, key_size);
+      len              += key_size;
+      memcpy(frame + len, &evt_count, sizeof(uint16_t));
+      len              += sizeof(uint16_t);
+      memcpy(frame + len, handle->input_events, input_size);
+      len              += input_size;
       bsv_movie_handle_clear_key_events(handle);
-      /* write input events, frame is over */
-      intfstream_write(handle->file, &evt_count, 2);
-      for (i = 0; i < handle->input_event_count; i++)
-         intfstream_write(handle->file, &(handle->input_events[i]), sizeof(bsv_input_data_t));
       bsv_movie_handle_clear_input_events(handle);
 
       /* Maybe record checkpoint */
-      if (checkpoint_interval != 0 && handle->frame_counter > 0 && (handle->frame_counter % (checkpoint_interval*60) == 0))
+      if (     checkpoint_interval != 0
+            && handle->frame_counter > 0
+            && (handle->frame_counter % (checkpoint_interval*60) == 0))
       {
-         retro_ctx_serialize_info_t serial_info;
-         uint8_t frame_tok = REPLAY_TOKEN_CHECKPOINT_FRAME;
-         size_t info_size  = core_serialize_size();
-         uint64_t size     = swap_if_big64(info_size);
-         uint8_t *st       = (uint8_t*)malloc(info_size);
-         serial_info.data  = st;
-         serial_info.size  = info_size;
-         core_serialize(&serial_info);
-         /* "next frame is a checkpoint" */
-         intfstream_write(handle->file, (uint8_t *)(&frame_tok), sizeof(uint8_t));
-         intfstream_write(handle->file, &size, sizeof(uint64_t));
-         intfstream_write(handle->file, st, info_size);
-         free(st);
+         int64_t frame_pos = intfstream_tell(handle->file);
+         intfstream_write(handle->file, frame, len);
+         if (!bsv_movie_write_checkpoint(handle, frame_pos))
+         {
+            uint8_t frame_tok = REPLAY_TOKEN_REGULAR_FRAME;
+            RARCH_ERR("[Replay] Failed to record checkpoint\n");
+            intfstream_write(handle->file, &frame_tok, sizeof(uint8_t));
+         }
       }
       else
       {
-         uint8_t frame_tok = REPLAY_TOKEN_REGULAR_FRAME;
-         /* write "next frame is not a checkpoint" */
-         intfstream_write(handle->file, (uint8_t *)(&frame_tok), sizeof(uint8_t));
+         /* "next frame is not a checkpoint" */
+         frame[len++] = REPLAY_TOKEN_REGULAR_FRAME;
+         intfstream_write(handle->file, frame, len);
       }
    }
 
@@ -6067,6 +6297,85 @@ void bsv_movie_next_frame(input_driver_state_t *input_st)
    handle->frame_pos[handle->frame_counter & handle->frame_mask] = intfstream_tell(handle->file);
 }
 
+/* Jumps a replay being played back to 'frame'. Playback
+ * restarts from the closest full checkpoint at or before it
+ * (or from the start of the replay), and the frames from
+ * there on are run at fast-forward speed until 'frame'
+ * is reached; see runloop_check_replay_seek(). */
+bool bsv_movie_seek(input_driver_state_t *input_st, uint64_t frame)
+{
+   size_t i;
+   bsv_movie_t *handle = input_st->bsv_movie_state_handle;
+   const struct bsv_checkpoint_entry *entry = NULL;
+
+   if (     !handle
+         || !(input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_PLAYBACK))
+      return false;
+
+   /* A checkpoint is loaded while playing back the frame
+    * before the one it was recorded in. */
+   for (i = 0; i < RBUF_LEN(handle->checkpoint_index); i++)
+   {
+      const struct bsv_checkpoint_entry *e = &handle->checkpoint_index[i];
+      if (     e->frame > 0
+            && e->frame - 1 <= frame
+            && (!entry || e->frame > entry->frame))
+         entry = e;
+   }
+
+   /* Going forward, and no checkpoint to skip ahead to */
+   if (     frame >= handle->frame_counter
+         && (!entry || entry->frame - 1 <= handle->frame_counter))
+      entry = NULL;
+   else
+   {
+      /* The frame positions kept for rewinding are no
+       * longer those of the frames before this one. */
+      for (i = 0; i <= handle->frame_mask; i++)
+         handle->frame_pos[i] = handle->min_file_pos;
+
+      bsv_movie_checkpoint_invalidate(handle);
+      bsv_movie_handle_clear_key_events(handle);
+      bsv_movie_handle_clear_input_events(handle);
+
+      if (entry)
+      {
+         handle->frame_counter = entry->frame - 1;
+         intfstream_seek(handle->file, (int64_t)entry->pos, SEEK_SET);
+      }
+      else
+      {
+         /* Back to the start, as when playback began */
+         handle->frame_counter = 0;
+         intfstream_seek(handle->file, (int64_t)handle->min_file_pos, SEEK_SET);
+         if (handle->state_size)
+         {
+            retro_ctx_serialize_info_t serial_info;
+            serial_info.data_const = handle->state;
+            serial_info.size       = handle->state_size;
+            core_unserialize(&serial_info);
+         }
+         bsv_movie_read_next_events(handle);
+      }
+
+      handle->frame_pos[handle->frame_counter & handle->frame_mask] =
+         intfstream_tell(handle->file);
+      handle->first_rewind  = true;
+      handle->did_rewind    = false;
+   }
+
+   RARCH_LOG("[Replay] Seeking to frame %llu from frame %llu\n",
+         (unsigned long long)frame,
+         (unsigned long long)handle->frame_counter);
+
+   handle->seek_frame = frame;
+   if (frame > handle->frame_counter)
+      input_st->bsv_movie_state.flags |=  BSV_FLAG_MOVIE_SEEKING;
+   else
+      input_st->bsv_movie_state.flags &= ~BSV_FLAG_MOVIE_SEEKING;
+   return true;
+}
+
 size_t replay_get_serialize_size(void)
 {
    input_driver_state_t *input_st = &input_driver_st;
@@ -6166,12 +6475,21 @@ bool replay_set_serialized_data(void* buf)
                same up to handle_idx. Right? */
             intfstream_rewind(input_st->bsv_movie_state_handle->file);
             intfstream_write(input_st->bsv_movie_state_handle->file, buffer+sizeof(int32_t), loaded_len);
+            bsv_movie_checkpoint_invalidate(input_st->bsv_movie_state_handle);
+            RBUF_CLEAR(input_st->bsv_movie_state_handle->checkpoint_index);
+            /* The index at the end may have been partly overwritten */
+            if (     input_st->bsv_movie_state_handle->stream_end
+                  && loaded_len > input_st->bsv_movie_state_handle->stream_end)
+               input_st->bsv_movie_state_handle->stream_end = loaded_len;
          }
          else
          {
             intfstream_seek(input_st->bsv_movie_state_handle->file, loaded_len, SEEK_SET);
             if (recording)
+            {
                intfstream_truncate(input_st->bsv_movie_state_handle->file, loaded_len);
+               bsv_movie_checkpoint_truncate(input_st->bsv_movie_state_handle, loaded_len);
+            }
          }
       }
       else
@@ -105,6 +105,11 @@
 #define REPLAY_TOKEN_INVALID          '\0'
 #define REPLAY_TOKEN_REGULAR_FRAME    'f'
 #define REPLAY_TOKEN_CHECKPOINT_FRAME 'c'
+#define REPLAY_TOKEN_CHECKPOINT_DELTA 'd'
+
+/* Every so many checkpoints a full one is written,
+ * the others are stored as deltas to the previous one. */
+#define REPLAY_CHECKPOINT_KEYFRAME_INTERVAL 16
 
 /**
  * Takes as input analog key identifiers and converts them to corresponding
@@ -168,7 +173,10 @@ enum bsv_flags
    BSV_FLAG_MOVIE_PLAYBACK           = (1 << 2),
    BSV_FLAG_MOVIE_RECORDING          = (1 << 3),
    BSV_FLAG_MOVIE_END                = (1 << 4),
-   BSV_FLAG_MOVIE_EOF_EXIT           = (1 << 5)
+   BSV_FLAG_MOVIE_EOF_EXIT           = (1 << 5),
+   BSV_FLAG_MOVIE_SEEKING            = (1 << 6),
+   /* Fast-forward was turned on by the seek */
+   BSV_FLAG_MOVIE_SEEK_FASTFORWARD   = (1 << 7)
 };
 
 struct bsv_state
@@ -203,6 +211,14 @@ struct bsv_input_data
 };
 typedef struct bsv_input_data bsv_input_data_t;
 
+/* Where a full checkpoint starts: the file offset of the
+ * frame it is recorded in, and that frame's number. */
+struct bsv_checkpoint_entry
+{
+   uint64_t frame;
+   uint64_t pos;
+};
+
 struct bsv_movie
 {
    intfstream_t *file;
@@ -218,6 +234,24 @@ struct bsv_movie
    size_t frame_mask;
    uint64_t frame_counter;
 
+   /* The last checkpoint written or read, and where
+    * its token is in the file (-1 if it can't be used
+    * as the base of a delta checkpoint). */
+   uint8_t *checkpoint_state;
+   uint8_t *checkpoint_next;
+   uint8_t *checkpoint_patch;
+   size_t checkpoint_size;
+   int64_t checkpoint_pos;
+   unsigned checkpoint_deltas;
+
+   /* Full checkpoints in the replay (RBUF), stored as an
+    * index at the end of the file when recording stops.
+    * stream_end is where that index starts in a replay
+    * being played back, 0 if it has none. */
+   struct bsv_checkpoint_entry *checkpoint_index;
+   int64_t stream_end;
+   uint64_t seek_frame;
+
    /* Staging variables for events */
    uint8_t key_event_count;
    uint16_t input_event_count;
@@ -1034,6 +1068,7 @@ void input_overlay_check_mouse_cursor(void);
 void bsv_movie_frame_rewind(void);
 void bsv_movie_next_frame(input_driver_state_t *input_st);
 void bsv_movie_read_next_events(bsv_movie_t*handle);
+bool bsv_movie_seek(input_driver_state_t *input_st, uint64_t frame);
 void bsv_movie_finish_rewind(input_driver_state_t *input_st);
 void bsv_movie_deinit(input_driver_state_t *input_st);
 void bsv_movie_deinit_full(input_driver_state_t *input_st);
@@ -2532,6 +2532,18 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,
    "netplay_nat_traversal"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,
+   "netplay_udp_input"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_UDP_REDUNDANCY,
+   "netplay_udp_redundancy"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_SNAPSHOT_INTERVAL,
+   "netplay_snapshot_interval"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_NICKNAME,
    "netplay_nickname"
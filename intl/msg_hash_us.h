@@ -7657,6 +7657,30 @@ MSG_HASH(
    MENU_ENUM_LABEL_HELP_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
    "The range of frames of input latency that may be used by netplay to hide network latency.\nIf set, netplay will adjust the number of frames of input latency dynamically to balance CPU time, input latency and network latency. This reduces jitter and makes netplay less CPU-intensive, but at the price of unpredictable input lag."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_INPUT,
+   "Send Input over UDP"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT,
+   "Also send input over UDP when the other side supports it. A lost packet then no longer holds back the input that follows it, reducing stalls on lossy connections. The host must be reachable on UDP at its port + 1."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_REDUNDANCY,
+   "UDP Input Redundancy"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_UDP_REDUNDANCY,
+   "The number of UDP packets that repeat each input frame. Higher values tolerate more packet loss at the cost of bandwidth."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_SNAPSHOT_INTERVAL,
+   "Netplay Snapshot Interval"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_SNAPSHOT_INTERVAL,
+   "Save the core state for rollback only every this many frames, and replay input from the last saved frame instead. Higher values use less CPU with cores that are slow to save states, but make each rollback longer. 0 picks the interval automatically from measured save and replay times."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_NAT_TRAVERSAL,
    "Netplay NAT Traversal"
@@ -464,18 +464,37 @@ bool file_archive_perform_mode(const char *path, const char *valid_exts,
    handle.data          = NULL;
    handle.real_checksum = 0;
 
-   if (!userdata->transfer->backend->stream_decompress_data_to_file_init(
-            userdata->transfer->context, &handle, cdata, cmode, csize, size))
+   /* Backends that can stream write straight to the file,
+    * the others leave the whole file in handle.data */
+   if (!(handle.outfile = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
       return false;
 
-   do
+   if (!userdata->transfer->backend->stream_decompress_data_to_file_init(
+            userdata->transfer->context, &handle, cdata, cmode, csize, size))
+      ret = -1;
+   else
    {
-      ret = userdata->transfer->backend->stream_decompress_data_to_file_iterate(
-               userdata->transfer->context, &handle);
-   }while (ret == 0);
+      do
+      {
+         ret = userdata->transfer->backend->stream_decompress_data_to_file_iterate(
+                  userdata->transfer->context, &handle);
+      }while (ret == 0);
+   }
+
+   if (ret != -1 && handle.data
+         && filestream_write(handle.outfile, handle.data, size) != size)
+      ret = -1;
 
-   if (ret == -1 || !filestream_write_file(path, handle.data, size))
+   if (filestream_close(handle.outfile) != 0)
+      ret = -1;
+
+   /* Don't leave damaged content behind */
+   if (ret == -1 || handle.real_checksum != crc32)
+   {
+      filestream_delete(path);
       return false;
+   }
 
    return true;
 }
@@ -529,6 +548,15 @@ error:
 int file_archive_compressed_read(
       const char * path, void **buf,
       const char* optional_filename, int64_t *length)
+{
+   return file_archive_compressed_read_crc32(path, buf,
+         optional_filename, length, NULL);
+}
+
+int file_archive_compressed_read_crc32(
+      const char * path, void **buf,
+      const char* optional_filename, int64_t *length,
+      uint32_t *crc32)
 {
    const struct
       file_archive_file_backend *backend = NULL;
@@ -563,7 +591,7 @@ int file_archive_compressed_read(
 
    backend = file_archive_get_file_backend(str_list->elems[0].data);
    *length = backend->compressed_file_read(str_list->elems[0].data,
-         str_list->elems[1].data, buf, optional_filename);
+         str_list->elems[1].data, buf, optional_filename, crc32);
 
    string_list_free(str_list);
 
@@ -36,10 +36,21 @@
 #include <7zip/7zCrc.h>
 #include <7zip/7zFile.h>
 
+#ifdef HAVE_THREADS
+#include <7zip/Lzma2Dec.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 #define SEVENZIP_MAGIC "7z\xBC\xAF\x27\x1C"
 #define SEVENZIP_MAGIC_LEN 6
 #define SEVENZIP_LOOKTOREAD_BUF_SIZE (1 << 14)
 
+#define SEVENZIP_METHOD_LZMA2 0x21
+/* Blocks smaller than this are not worth spinning up threads for */
+#define SEVENZIP_LZMA2_MT_MIN_SIZE (4 * 1024 * 1024)
+#define SEVENZIP_LZMA2_MT_MAX_THREADS 8
+
 /* Assume W-functions do not work below Win2K and Xbox platforms */
 #if defined(_WIN32_WINNT) && _WIN32_WINNT < 0x0500 || defined(_XBOX)
 #ifndef LEGACY_WIN32
@@ -130,6 +141,268 @@ static void sevenzip_parse_file_free(void *context)
    free(sevenzip_context);
 }
 
+#ifdef HAVE_THREADS
+struct sevenzip_lzma2_job
+{
+   ISzAllocPtr alloc;
+   const uint8_t *in;
+   uint8_t *out;
+   size_t in_size;
+   size_t out_size;
+   SRes res;
+   uint8_t prop;
+   bool last;
+};
+
+static void sevenzip_lzma2_job_decode(void *data)
+{
+   CLzma2Dec state;
+   ELzmaStatus status;
+   struct sevenzip_lzma2_job *job = (struct sevenzip_lzma2_job*)data;
+   SizeT in_processed             = (SizeT)job->in_size;
+
+   Lzma2Dec_Construct(&state);
+   if ((job->res = Lzma2Dec_AllocateProbs(&state, job->prop,
+         job->alloc)) != SZ_OK)
+      return;
+
+   state.decoder.dic        = job->out;
+   state.decoder.dicBufSize = job->out_size;
+   Lzma2Dec_Init(&state);
+
+   job->res = Lzma2Dec_DecodeToDic(&state, job->out_size, job->in,
+         &in_processed, LZMA_FINISH_END, &status);
+
+   /* A job has to end exactly on a chunk boundary, and only
+    * the last one may (and must) see the end marker */
+   if (job->res == SZ_OK && (
+            in_processed         != job->in_size
+         || state.decoder.dicPos != job->out_size
+         || status               != (job->last
+            ? LZMA_STATUS_FINISHED_WITH_MARK
+            : LZMA_STATUS_NEEDS_MORE_INPUT)))
+      job->res = SZ_ERROR_DATA;
+
+   Lzma2Dec_FreeProbs(&state, job->alloc);
+}
+
+/* Decodes an LZMA2 block on several threads.
+ *
+ * LZMA2 streams are a sequence of chunks, and a chunk that
+ * resets the dictionary does not refer to anything before it.
+ * The 7-Zip encoder starts such a chunk for every block when
+ * compressing with more than one thread, so the stream can be
+ * cut there and every piece decoded straight to its place in
+ * the output. Returns false, leaving the output untouched,
+ * when the folder is not a plain LZMA2 one, when it has no
+ * split points, or on any error - the regular single-threaded
+ * path then takes over (and reports the error, if any). */
+static bool sevenzip_extract_lzma2_mt(const CSzArEx *db,
+      ILookInStream *stream, uint32_t folder_index,
+      uint32_t *block_index, Byte **buf, size_t *buf_size,
+      ISzAllocPtr alloc, ISzAllocPtr alloc_temp)
+{
+   CSzData sd;
+   CSzFolder folder;
+   struct sevenzip_lzma2_job jobs[SEVENZIP_LZMA2_MT_MAX_THREADS];
+   sthread_t *threads[SEVENZIP_LZMA2_MT_MAX_THREADS];
+   size_t in_starts[SEVENZIP_LZMA2_MT_MAX_THREADS];
+   size_t out_starts[SEVENZIP_LZMA2_MT_MAX_THREADS];
+   uint64_t pack_pos, pack_size_spec, unpack_size_spec;
+   unsigned i, num_jobs;
+   size_t pack_size, unpack_size, pos, out_pos, target;
+   unsigned num_threads = cpu_features_get_core_amount();
+   const uint8_t *data  = db->db.CodersData
+      + db->db.FoCodersOffsets[folder_index];
+   uint8_t *in          = NULL;
+   uint8_t *out         = NULL;
+   bool ret             = false;
+
+   if (num_threads < 2)
+      return false;
+   if (num_threads > SEVENZIP_LZMA2_MT_MAX_THREADS)
+      num_threads = SEVENZIP_LZMA2_MT_MAX_THREADS;
+
+   sd.Data = data;
+   sd.Size = db->db.FoCodersOffsets[folder_index + 1]
+      - db->db.FoCodersOffsets[folder_index];
+
+   if (     SzGetNextFolderItem(&folder, &sd) != SZ_OK
+         || sd.Size                  != 0
+         || folder.NumCoders         != 1
+         || folder.NumPackStreams    != 1
+         || folder.Coders[0].MethodID != SEVENZIP_METHOD_LZMA2
+         || folder.Coders[0].PropsSize != 1)
+      return false;
+
+   unpack_size_spec = SzAr_GetFolderUnpackSize(&db->db, folder_index);
+   pack_pos         = db->db.PackPositions[
+      db->db.FoStartPackStreamIndex[folder_index]];
+   pack_size_spec   = db->db.PackPositions[
+      db->db.FoStartPackStreamIndex[folder_index] + 1] - pack_pos;
+   unpack_size      = (size_t)unpack_size_spec;
+   pack_size        = (size_t)pack_size_spec;
+
+   if (     unpack_size_spec < SEVENZIP_LZMA2_MT_MIN_SIZE
+         || unpack_size     != unpack_size_spec
+         || pack_size       != pack_size_spec)
+      return false;
+
+   /* The 7z stream reader is not thread safe,
+    * so read the whole packed block in one go */
+   if (!(in = (uint8_t*)ISzAlloc_Alloc(alloc_temp, pack_size)))
+      return false;
+   if (     LookInStream_SeekTo(stream, db->dataPos + pack_pos) != SZ_OK
+         || LookInStream_Read(stream, in, pack_size)           != SZ_OK)
+      goto end;
+
+   /* Walk the chunk headers and cut the stream into
+    * jobs of about the same decompressed size */
+   num_jobs = 0;
+   pos      = 0;
+   out_pos  = 0;
+   target   = 0;
+
+   while (pos < pack_size)
+   {
+      size_t chunk_in, chunk_out;
+      uint8_t control = in[pos];
+
+      if (control == 0)
+      {
+         /* End marker, which has to be the last byte */
+         if (pos + 1 != pack_size || out_pos != unpack_size)
+            goto end;
+         break;
+      }
+
+      /* Dictionary reset, with new properties
+       * for an LZMA chunk */
+      if (control == 1 || control >= 0xE0)
+      {
+         if (out_pos >= target && num_jobs < num_threads)
+         {
+            in_starts[num_jobs]  = pos;
+            out_starts[num_jobs] = out_pos;
+            num_jobs++;
+            target = out_pos + (unpack_size - out_pos)
+               / (num_threads - num_jobs + 1);
+         }
+      }
+      else if (!num_jobs)
+         goto end;
+
+      if (control & 0x80)
+      {
+         if (pos + 5 > pack_size)
+            goto end;
+         chunk_out = ((size_t)(control & 0x1F) << 16)
+            + ((size_t)in[pos + 1] << 8) + in[pos + 2] + 1;
+         chunk_in  = ((size_t)in[pos + 3] << 8) + in[pos + 4] + 1
+            + ((control >= 0xC0) ? 6 : 5);
+      }
+      else if (control <= 2)
+      {
+         if (pos + 3 > pack_size)
+            goto end;
+         chunk_out = ((size_t)in[pos + 1] << 8) + in[pos + 2] + 1;
+         chunk_in  = chunk_out + 3;
+      }
+      else
+         goto end;
+
+      if (     chunk_in  > pack_size   - pos
+            || chunk_out > unpack_size - out_pos)
+         goto end;
+
+      pos     += chunk_in;
+      out_pos += chunk_out;
+   }
+
+   if (pos >= pack_size || num_jobs < 2)
+      goto end;
+
+   if (!(out = (uint8_t*)ISzAlloc_Alloc(alloc, unpack_size)))
+      goto end;
+
+   for (i = 0; i < num_jobs; i++)
+   {
+      bool last        = (i + 1 == num_jobs);
+
+      jobs[i].alloc    = alloc_temp;
+      jobs[i].in       = in  + in_starts[i];
+      jobs[i].out      = out + out_starts[i];
+      jobs[i].in_size  = (last ? pack_size   : in_starts[i + 1])
+         - in_starts[i];
+      jobs[i].out_size = (last ? unpack_size : out_starts[i + 1])
+         - out_starts[i];
+      jobs[i].res      = SZ_ERROR_FAIL;
+      jobs[i].prop     = data[folder.Coders[0].PropsOffset];
+      jobs[i].last     = last;
+   }
+
+   /* The first job runs on this thread, as does any
+    * job that a thread could not be created for */
+   for (i = 1; i < num_jobs; i++)
+      if (!(threads[i] = sthread_create(sevenzip_lzma2_job_decode,
+            &jobs[i])))
+         sevenzip_lzma2_job_decode(&jobs[i]);
+
+   sevenzip_lzma2_job_decode(&jobs[0]);
+
+   ret = (jobs[0].res == SZ_OK);
+   for (i = 1; i < num_jobs; i++)
+   {
+      if (threads[i])
+         sthread_join(threads[i]);
+      if (jobs[i].res != SZ_OK)
+         ret = false;
+   }
+
+   if (ret && SzBitWithVals_Check(&db->db.FolderCRCs, folder_index))
+      ret = (CrcCalc(out, unpack_size)
+            == db->db.FolderCRCs.Vals[folder_index]);
+
+   if (ret)
+   {
+      /* Hand the block over the same way
+       * SzArEx_Extract() caches it */
+      ISzAlloc_Free(alloc, *buf);
+      *buf         = out;
+      *buf_size    = unpack_size;
+      *block_index = folder_index;
+      out          = NULL;
+   }
+
+end:
+   ISzAlloc_Free(alloc, out);
+   ISzAlloc_Free(alloc_temp, in);
+   return ret;
+}
+#endif
+
+/* SzArEx_Extract(), decoding large LZMA2 blocks
+ * on several threads when the stream allows it */
+static SRes sevenzip_extract(const CSzArEx *db, ILookInStream *stream,
+      uint32_t file_index, uint32_t *block_index,
+      Byte **buf, size_t *buf_size, size_t *offset,
+      size_t *out_size, ISzAllocPtr alloc, ISzAllocPtr alloc_temp)
+{
+#ifdef HAVE_THREADS
+   uint32_t folder_index = db->FileToFolder[file_index];
+
+   /* On success the block is already in place, and
+    * SzArEx_Extract() only locates and checks the file */
+   if (     folder_index != (uint32_t)-1
+         && (!*buf || *block_index != folder_index))
+      sevenzip_extract_lzma2_mt(db, stream, folder_index,
+            block_index, buf, buf_size, alloc, alloc_temp);
+#endif
+
+   return SzArEx_Extract(db, stream, file_index, block_index,
+         buf, buf_size, offset, out_size, alloc, alloc_temp);
+}
+
 /* Extract the relative path (needle) from a 7z archive
  * (path) and allocate a buf for it to write it in.
  * If optional_outfile is set, extract to that instead
@@ -138,7 +411,7 @@ static void sevenzip_parse_file_free(void *context)
 static int64_t sevenzip_file_read(
       const char *path,
       const char *needle, void **buf,
-      const char *optional_outfile)
+      const char *optional_outfile, uint32_t *crc32)
 {
    CFileInStream archiveStream;
    CLookToRead2 lookStream;
@@ -247,7 +520,7 @@ static int64_t sevenzip_file_read(
              * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
              * */
             file_found = true;
-            res = SzArEx_Extract(&db, &lookStream.vt, i, &block_index,
+            res = sevenzip_extract(&db, &lookStream.vt, i, &block_index,
                   &output, &output_size, &offset, &outSizeProcessed,
                   &allocImp, &allocTempImp);
 
@@ -256,6 +529,13 @@ static int64_t sevenzip_file_read(
 
             outsize = (int64_t)outSizeProcessed;
 
+            /* SzArEx_Extract() has already checked
+             * the data against the stored CRC */
+            if (crc32)
+               *crc32 = SzBitWithVals_Check(&db.CRCs, i)
+                  ? db.CRCs.Vals[i]
+                  : encoding_crc32(0, output + offset, (size_t)outsize);
+
             if (optional_outfile)
             {
                const void *ptr = (const void*)(output + offset);
@@ -269,14 +549,29 @@ static int64_t sevenzip_file_read(
             }
             else
             {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc((size_t)(outsize + 1));
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf,output + offset,outsize);
+               /* Hand over the 7Zip allocated buffer (it comes
+                * from malloc()) instead of copying the file out
+                * of it. RetroArch expects a \0 at the end, and
+                * the block may hold other files as well, so
+                * move the file to the start and trim the rest */
+               uint8_t *trimmed;
+
+               if (offset)
+                  memmove(output, output + offset, (size_t)outsize);
+
+               if ((trimmed = (uint8_t*)realloc(output,
+                     (size_t)(outsize + 1))))
+                  output = trimmed;
+               else if ((size_t)outsize + 1 > output_size)
+               {
+                  res = SZ_ERROR_MEM;
+                  break;
+               }
+
+               output[outsize] = '\0';
+               *buf            = output;
+               output          = NULL;
+               block_index     = 0xFFFFFFFF;
             }
             break;
          }
@@ -332,7 +627,7 @@ static int sevenzip_stream_decompress_data_to_file_iterate(
    size_t offset           = 0;
    size_t outSizeProcessed = 0;
 
-   res = SzArEx_Extract(&sevenzip_context->db,
+   res = sevenzip_extract(&sevenzip_context->db,
          &sevenzip_context->lookStream.vt, sevenzip_context->decompress_index,
          &sevenzip_context->block_index, &sevenzip_context->output,
          &output_size, &offset, &outSizeProcessed,
@@ -342,7 +637,13 @@ static int sevenzip_stream_decompress_data_to_file_iterate(
       return 0;
 
    if (handle)
-      handle->data = sevenzip_context->output + offset;
+   {
+      handle->data          = sevenzip_context->output + offset;
+      /* SzArEx_Extract has already checked the data
+       * against the stored CRC, if there is one */
+      handle->real_checksum = sevenzip_context->db.CRCs.Vals[
+         sevenzip_context->decompress_index];
+   }
 
    return 1;
 }
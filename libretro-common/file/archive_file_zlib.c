@@ -40,6 +40,7 @@
 #endif
 
 #define _READ_CHUNK_SIZE   (128*1024)   /* Read 128KiB compressed chunks */
+#define _WRITE_CHUNK_SIZE  (512*1024)   /* Write 512KiB decompressed chunks */
 
 enum file_archive_compression_mode
 {
@@ -135,9 +136,13 @@ static bool zlib_stream_decompress_data_to_file_init(
    zip_context->csize                 = csize;
    zip_context->boffset               = 0;
    zip_context->cmode                 = cmode;
-   zip_context->decompressed_data     = (uint8_t*)malloc(size);
+   /* When streaming to a file, only a window of
+    * the decompressed data is kept in memory */
+   zip_context->decompressed_data     = (uint8_t*)malloc(
+         handle->outfile ? _WRITE_CHUNK_SIZE : size);
    zip_context->zstream               = NULL;
    zip_context->tmpbuf                = NULL;
+   handle->real_checksum              = 0;
 
    if (cmode == ZIP_MODE_DEFLATED)
    {
@@ -149,7 +154,8 @@ static bool zlib_stream_decompress_data_to_file_init(
       zip_context->zstream->avail_in  = 0;
       zip_context->zstream->total_in  = 0;
       zip_context->zstream->next_out  = zip_context->decompressed_data;
-      zip_context->zstream->avail_out = size;
+      zip_context->zstream->avail_out = handle->outfile
+         ? _WRITE_CHUNK_SIZE : size;
       zip_context->zstream->total_out = 0;
 
       zip_context->zstream->zalloc    = NULL;
@@ -170,6 +176,19 @@ error:
    return false;
 }
 
+/* Checksums (and writes out, when streaming to a
+ * file) data as it is decompressed, while it is
+ * still in the cache */
+static bool zlib_stream_decompressed_output(
+      file_archive_file_handle_t *handle, const uint8_t *data, size_t len)
+{
+   handle->real_checksum = encoding_crc32(handle->real_checksum, data, len);
+
+   if (handle->outfile && len)
+      return filestream_write(handle->outfile, data, len) == (int64_t)len;
+   return true;
+}
+
 static int zlib_stream_decompress_data_to_file_iterate(
       void *context, file_archive_file_handle_t *handle)
 {
@@ -182,13 +201,38 @@ static int zlib_stream_decompress_data_to_file_iterate(
       #ifdef HAVE_MMAP
       if (zip_context->state->archive_mmap_data)
       {
+         const uint8_t *data = zip_context->state->archive_mmap_data
+            + (size_t)zip_context->fdoffset;
+
          /* Simply copy the data to the output buffer */
-         memcpy(zip_context->decompressed_data,
-                zip_context->state->archive_mmap_data + (size_t)zip_context->fdoffset,
-                zip_context->usize);
+         if (handle->outfile)
+            return zlib_stream_decompressed_output(
+                  handle, data, zip_context->usize) ? 1 : -1;
+
+         memcpy(zip_context->decompressed_data, data, zip_context->usize);
       }
       else
       #endif
+      if (handle->outfile)
+      {
+         /* Copy the file in chunks */
+         uint32_t offset = 0;
+
+         filestream_seek(state->archive_file, zip_context->fdoffset, RETRO_VFS_SEEK_POSITION_START);
+         while (offset < zip_context->usize)
+         {
+            rd = filestream_read(state->archive_file,
+                  zip_context->decompressed_data,
+                  MIN(zip_context->usize - offset, _WRITE_CHUNK_SIZE));
+            if (rd <= 0 || !zlib_stream_decompressed_output(
+                  handle, zip_context->decompressed_data, (size_t)rd))
+               return -1;
+            offset += (uint32_t)rd;
+         }
+
+         return 1;
+      }
+      else
       {
          /* Read the entire file to memory */
          filestream_seek(state->archive_file, zip_context->fdoffset, RETRO_VFS_SEEK_POSITION_START);
@@ -198,6 +242,8 @@ static int zlib_stream_decompress_data_to_file_iterate(
             return -1;
       }
 
+      zlib_stream_decompressed_output(handle,
+            zip_context->decompressed_data, zip_context->usize);
       handle->data = zip_context->decompressed_data;
       return 1;
    }
@@ -234,8 +280,31 @@ static int zlib_stream_decompress_data_to_file_iterate(
       zip_context->zstream->next_in   = dptr;
       zip_context->zstream->avail_in  = (uInt)rd;
 
-      if (inflate(zip_context->zstream, 0) < 0)
-         return -1;
+      for (;;)
+      {
+         uint8_t *out = zip_context->zstream->next_out;
+         int zret     = inflate(zip_context->zstream, 0);
+         size_t len   = zip_context->zstream->next_out - out;
+
+         if (zret < 0 && !(zret == Z_BUF_ERROR && handle->outfile))
+            return -1;
+
+         if (!zlib_stream_decompressed_output(handle, out, len))
+            return -1;
+
+         if (!handle->outfile)
+            break;
+
+         /* Output window has been written out, reuse it */
+         zip_context->zstream->next_out  = zip_context->decompressed_data;
+         zip_context->zstream->avail_out = _WRITE_CHUNK_SIZE;
+
+         /* Stop once this chunk has been consumed and
+          * inflate has nothing left to flush */
+         if (     zret != Z_OK
+               || (!zip_context->zstream->avail_in && len < _WRITE_CHUNK_SIZE))
+            break;
+      }
 
       if (zip_context->boffset >= zip_context->csize)
       {
@@ -243,7 +312,8 @@ static int zlib_stream_decompress_data_to_file_iterate(
          free(zip_context->zstream);
          zip_context->zstream = NULL;
 
-         handle->data = zip_context->decompressed_data;
+         if (!handle->outfile)
+            handle->data = zip_context->decompressed_data;
          return 1;
       }
 
@@ -291,6 +361,7 @@ typedef struct
    char *needle;
    void **buf;
    size_t size;
+   uint32_t crc32;
    bool found;
 } decomp_state_t;
 
@@ -316,31 +387,42 @@ static int zip_file_decompressed(
    if (strstr(name, decomp_state->needle))
    {
       file_archive_file_handle_t handle = {0};
+      zip_context_t *zip_context = (zip_context_t *)userdata->transfer->context;
+      bool success               = false;
 
-      if (zip_file_decompressed_handle(userdata->transfer,
-               &handle, cdata, cmode, csize, size, crc32))
+      /* Called in case core has need_fullpath enabled -
+       * extract straight to the file instead of memory */
+      if (decomp_state->opt_file)
       {
-         if (decomp_state->opt_file != 0)
-         {
-            /* Called in case core has need_fullpath enabled. */
-            bool success = filestream_write_file(decomp_state->opt_file, handle.data, size);
+         if (!(handle.outfile = filestream_open(decomp_state->opt_file,
+               RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+            return -1;
+      }
 
-            /* Note: Do not free handle.data here - this
-             * will be done when stream is deinitialised */
-            handle.data = NULL;
+      success = zip_file_decompressed_handle(userdata->transfer,
+            &handle, cdata, cmode, csize, size, crc32);
 
-            decomp_state->size = 0;
+      if (handle.outfile && filestream_close(handle.outfile) != 0)
+         success = false;
 
-            if (!success)
-               return -1;
-         }
+      /* Don't hand out damaged content */
+      if (success && handle.real_checksum != crc32)
+         success = false;
+
+      if (!success && decomp_state->opt_file)
+         filestream_delete(decomp_state->opt_file);
+
+      if (success)
+      {
+         decomp_state->crc32 = handle.real_checksum;
+
+         if (decomp_state->opt_file != 0)
+            decomp_state->size = 0;
          else
          {
             /* Called in case core has need_fullpath disabled.
              * Will move decompressed content directly into
              * RetroArch's ROM buffer. */
-            zip_context_t *zip_context = (zip_context_t *)userdata->transfer->context;
-
             decomp_state->size = 0;
             *decomp_state->buf             = handle.data;
             decomp_state->size             = size;
@@ -349,6 +431,8 @@ static int zip_file_decompressed(
             handle.data = NULL;
          }
       }
+      else
+         return -1;
 
       decomp_state->found = true;
    }
@@ -359,7 +443,7 @@ static int zip_file_decompressed(
 static int64_t zip_file_read(
       const char *path,
       const char *needle, void **buf,
-      const char *optional_outfile)
+      const char *optional_outfile, uint32_t *crc32)
 {
    file_archive_transfer_t state            = {0};
    decomp_state_t decomp                    = {0};
@@ -395,6 +479,9 @@ static int64_t zip_file_read(
    if (!decomp.found)
       return -1;
 
+   if (crc32)
+      *crc32 = decomp.crc32;
+
    return (int64_t)decomp.size;
 }
 
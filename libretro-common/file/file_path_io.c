@@ -98,6 +98,16 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+int64_t path_get_mtime(const char *path)
+{
+   int64_t mtime = 0;
+   /* The libretro VFS interface has no modification
+    * time - only known with the built-in implementation */
+   if (path_stat_cb == retro_vfs_stat_impl)
+      retro_vfs_stat_mtime_impl(path, NULL, &mtime);
+   return mtime;
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
@@ -20,7 +20,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifdef DEBUG
+#if defined(DEBUG) || defined(RPNG_TEST)
 #include <stdio.h>
 #endif
 #include <stdint.h>
@@ -32,6 +32,7 @@
 #endif
 
 #include <boolean.h>
+#include <retro_endianness.h>
 #include <formats/image.h>
 #include <formats/rpng.h>
 #include <streams/trans_stream.h>
@@ -39,6 +40,20 @@
 
 #include "rpng_internal.h"
 
+/* Scanlines are unfiltered one pixel at a time, since each
+ * pixel depends on the one to its left, but all the bytes of
+ * a pixel are done at once. Define RPNG_NO_SIMD to compare
+ * against the plain C decoder. */
+#if !defined(RPNG_NO_SIMD)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RPNG_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+#endif
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -95,8 +110,11 @@ struct rpng_process
    uint32_t *palette;
    void *stream;
    const struct trans_stream_backend *stream_backend;
-   uint8_t *prev_scanline;
-   uint8_t *decoded_scanline;
+   /* Scanlines are unfiltered in place in inflate_buf,
+    * the first one of a pass is unfiltered against
+    * zero_scanline */
+   const uint8_t *prev_scanline;
+   uint8_t *zero_scanline;
    uint8_t *inflate_buf;
    size_t restore_buf_size;
    size_t adam7_restore_buf_size;
@@ -230,14 +248,297 @@ static bool rpng_process_ihdr(struct png_ihdr *ihdr)
 }
 #endif
 
+#if defined(RPNG_SSE2)
+static INLINE __m128i rpng_load_pixel(const uint8_t *src, unsigned bpp)
+{
+   uint8_t px[8] = {0};
+   memcpy(px, src, bpp);
+   return _mm_loadl_epi64((const __m128i*)px);
+}
+
+static INLINE void rpng_store_pixel(uint8_t *dst, __m128i px, unsigned bpp)
+{
+   uint8_t buf[8];
+   _mm_storel_epi64((__m128i*)buf, px);
+   memcpy(dst, buf, bpp);
+}
+
+static INLINE __m128i rpng_abs_epi16(__m128i x)
+{
+   __m128i neg = _mm_cmplt_epi16(x, _mm_setzero_si128());
+   return _mm_add_epi16(_mm_xor_si128(x, neg), _mm_srli_epi16(neg, 15));
+}
+
+static INLINE __m128i rpng_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static INLINE void rpng_unfilter_sub_simd(uint8_t *line,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = _mm_add_epi8(rpng_load_pixel(line + i, bpp), a);
+      rpng_store_pixel(line + i, a, bpp);
+   }
+}
+
+static INLINE void rpng_unfilter_avg_simd(uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i one = _mm_set1_epi8(1);
+   __m128i a   = _mm_setzero_si128();
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b   = rpng_load_pixel(prev + i, bpp);
+      /* _mm_avg_epu8 rounds up, PNG rounds down */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), one));
+      a           = _mm_add_epi8(rpng_load_pixel(line + i, bpp), avg);
+      rpng_store_pixel(line + i, a, bpp);
+   }
+}
+
+static INLINE void rpng_unfilter_paeth_simd(uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i zero = _mm_setzero_si128();
+   __m128i a    = zero;
+   __m128i c    = zero;
+
+   /* Widened to 16 bits, so the distances can't overflow */
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b  = _mm_unpacklo_epi8(rpng_load_pixel(prev + i, bpp), zero);
+      __m128i d  = _mm_unpacklo_epi8(rpng_load_pixel(line + i, bpp), zero);
+      __m128i pa = _mm_sub_epi16(b, c);
+      __m128i pb = _mm_sub_epi16(a, c);
+      __m128i pc = _mm_add_epi16(pa, pb);
+      __m128i smallest;
+
+      pa       = rpng_abs_epi16(pa);
+      pb       = rpng_abs_epi16(pb);
+      pc       = rpng_abs_epi16(pc);
+      smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+      /* Ties go to a, then b, then c. The sum wraps per
+       * byte, so the upper half of each lane stays zero */
+      d        = _mm_add_epi8(d,
+            rpng_select(_mm_cmpeq_epi16(smallest, pa), a,
+            rpng_select(_mm_cmpeq_epi16(smallest, pb), b, c)));
+      rpng_store_pixel(line + i, _mm_packus_epi16(d, d), bpp);
+
+      a        = d;
+      c        = b;
+   }
+}
+#elif defined(RPNG_NEON)
+static INLINE uint8x8_t rpng_load_pixel(const uint8_t *src, unsigned bpp)
+{
+   uint8_t px[8] = {0};
+   memcpy(px, src, bpp);
+   return vld1_u8(px);
+}
+
+static INLINE void rpng_store_pixel(uint8_t *dst, uint8x8_t px, unsigned bpp)
+{
+   uint8_t buf[8];
+   vst1_u8(buf, px);
+   memcpy(dst, buf, bpp);
+}
+
+static INLINE void rpng_unfilter_sub_simd(uint8_t *line,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = vadd_u8(rpng_load_pixel(line + i, bpp), a);
+      rpng_store_pixel(line + i, a, bpp);
+   }
+}
+
+static INLINE void rpng_unfilter_avg_simd(uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = vadd_u8(rpng_load_pixel(line + i, bpp),
+            vhadd_u8(a, rpng_load_pixel(prev + i, bpp)));
+      rpng_store_pixel(line + i, a, bpp);
+   }
+}
+
+static INLINE void rpng_unfilter_paeth_simd(uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t c = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      uint8x8_t b   = rpng_load_pixel(prev + i, bpp);
+      /* pa = |b - c|, pb = |a - c|, pc = |a + b - 2c| */
+      uint16x8_t pa = vabdl_u8(b, c);
+      uint16x8_t pb = vabdl_u8(a, c);
+      uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+      /* Ties go to a, then b, then c */
+      uint8x8_t use_a = vmovn_u16(vandq_u16(
+            vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+      uint8x8_t use_b = vmovn_u16(vcleq_u16(pb, pc));
+
+      a = vadd_u8(rpng_load_pixel(line + i, bpp),
+            vbsl_u8(use_a, a, vbsl_u8(use_b, b, c)));
+      rpng_store_pixel(line + i, a, bpp);
+
+      c = b;
+   }
+}
+#endif
+
+/* Reverses the Sub, Up, Average and Paeth filters
+ * in place. prev is the previous scanline, already
+ * unfiltered, or zeros for the first scanline. */
+static void rpng_unfilter_sub(uint8_t *line, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+   switch (bpp)
+   {
+      case 3:
+         rpng_unfilter_sub_simd(line, pitch, 3);
+         return;
+      case 4:
+         rpng_unfilter_sub_simd(line, pitch, 4);
+         return;
+      case 6:
+         rpng_unfilter_sub_simd(line, pitch, 6);
+         return;
+      case 8:
+         rpng_unfilter_sub_simd(line, pitch, 8);
+         return;
+   }
+#endif
+
+   for (i = bpp; i < pitch; i++)
+      line[i] += line[i - bpp];
+}
+
+static void rpng_unfilter_up(uint8_t *line,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i = 0;
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)),
+            _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(line + i, vaddq_u8(vld1q_u8(line + i), vld1q_u8(prev + i)));
+#endif
+
+   for (; i < pitch; i++)
+      line[i] += prev[i];
+}
+
+static void rpng_unfilter_avg(uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+   switch (bpp)
+   {
+      case 3:
+         rpng_unfilter_avg_simd(line, prev, pitch, 3);
+         return;
+      case 4:
+         rpng_unfilter_avg_simd(line, prev, pitch, 4);
+         return;
+      case 6:
+         rpng_unfilter_avg_simd(line, prev, pitch, 6);
+         return;
+      case 8:
+         rpng_unfilter_avg_simd(line, prev, pitch, 8);
+         return;
+   }
+#endif
+
+   for (i = 0; i < bpp; i++)
+      line[i] += prev[i] >> 1;
+   for (i = bpp; i < pitch; i++)
+      line[i] += (line[i - bpp] + prev[i]) >> 1;
+}
+
+static void rpng_unfilter_paeth(uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+   switch (bpp)
+   {
+      case 3:
+         rpng_unfilter_paeth_simd(line, prev, pitch, 3);
+         return;
+      case 4:
+         rpng_unfilter_paeth_simd(line, prev, pitch, 4);
+         return;
+      case 6:
+         rpng_unfilter_paeth_simd(line, prev, pitch, 6);
+         return;
+      case 8:
+         rpng_unfilter_paeth_simd(line, prev, pitch, 8);
+         return;
+   }
+#endif
+
+   for (i = 0; i < bpp; i++)
+      line[i] += prev[i];
+   for (i = bpp; i < pitch; i++)
+      line[i] += paeth(line[i - bpp], prev[i], prev[i - bpp]);
+}
+
 static void rpng_reverse_filter_copy_line_rgb(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   int i;
+   int i = 0;
 
    bpp /= 8;
 
-   for (i = 0; i < (int)width; i++)
+#if defined(RPNG_NEON) && RETRO_IS_LITTLE_ENDIAN
+   if (bpp == 1)
+   {
+      for (; i + 8 <= (int)width; i += 8, decoded += 24)
+      {
+         uint8x8x3_t px = vld3_u8(decoded);
+         uint8x8x4_t out;
+         out.val[0]     = px.val[2];
+         out.val[1]     = px.val[1];
+         out.val[2]     = px.val[0];
+         out.val[3]     = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(data + i), out);
+      }
+   }
+#endif
+
+   for (; i < (int)width; i++)
    {
       uint32_t r, g, b;
 
@@ -254,11 +555,38 @@ static void rpng_reverse_filter_copy_line_rgb(uint32_t *data,
 static void rpng_reverse_filter_copy_line_rgba(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   int i;
+   int i = 0;
 
    bpp /= 8;
 
-   for (i = 0; i < (int)width; i++)
+#if (defined(RPNG_SSE2) || defined(RPNG_NEON)) && RETRO_IS_LITTLE_ENDIAN
+   if (bpp == 1)
+   {
+#if defined(RPNG_SSE2)
+      /* RGBA -> BGRA, four pixels at a time */
+      __m128i ga_mask = _mm_set1_epi32((int)0xff00ff00);
+      for (; i + 4 <= (int)width; i += 4, decoded += 16)
+      {
+         __m128i px = _mm_loadu_si128((const __m128i*)decoded);
+         __m128i rb = _mm_andnot_si128(ga_mask, px);
+         _mm_storeu_si128((__m128i*)(data + i), _mm_or_si128(
+                  _mm_and_si128(ga_mask, px),
+                  _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16))));
+      }
+#elif defined(RPNG_NEON)
+      for (; i + 8 <= (int)width; i += 8, decoded += 32)
+      {
+         uint8x8x4_t px = vld4_u8(decoded);
+         uint8x8_t r    = px.val[0];
+         px.val[0]      = px.val[2];
+         px.val[2]      = r;
+         vst4_u8((uint8_t*)(data + i), px);
+      }
+#endif
+   }
+#endif
+
+   for (; i < (int)width; i++)
    {
       uint32_t r, g, b, a;
       r        = *decoded;
@@ -484,11 +812,9 @@ static void rpng_reverse_filter_deinit(struct rpng_process *pngp)
 {
    if (!pngp)
       return;
-   if (pngp->decoded_scanline)
-      free(pngp->decoded_scanline);
-   pngp->decoded_scanline = NULL;
-   if (pngp->prev_scanline)
-      free(pngp->prev_scanline);
+   if (pngp->zero_scanline)
+      free(pngp->zero_scanline);
+   pngp->zero_scanline    = NULL;
    pngp->prev_scanline    = NULL;
 
    pngp->flags           &= ~RPNG_PROCESS_FLAG_PASS_INITIALIZED;
@@ -546,11 +872,9 @@ static int rpng_reverse_filter_init(const struct png_ihdr *ihdr,
 
    pngp->restore_buf_size      = 0;
    pngp->data_restore_buf_size = 0;
-   pngp->prev_scanline         = (uint8_t*)calloc(1, pngp->pitch);
-   pngp->decoded_scanline      = (uint8_t*)calloc(1, pngp->pitch);
-
-   if (!pngp->prev_scanline || !pngp->decoded_scanline)
+   if (!(pngp->zero_scanline   = (uint8_t*)calloc(1, pngp->pitch)))
       goto error;
+   pngp->prev_scanline         = pngp->zero_scanline;
 
    pngp->h                    = 0;
    pngp->flags               |= RPNG_PROCESS_FLAG_PASS_INITIALIZED;
@@ -566,43 +890,25 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
       const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
+   uint8_t *line = pngp->inflate_buf;
 
    switch (filter)
    {
       case PNG_FILTER_NONE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
          break;
       case PNG_FILTER_SUB:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += pngp->decoded_scanline[i - pngp->bpp];
+         rpng_unfilter_sub(line, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += pngp->prev_scanline[i];
+         rpng_unfilter_up(line, pngp->prev_scanline, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] += avg;
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] += avg;
-         }
+         rpng_unfilter_avg(line, pngp->prev_scanline,
+               pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] += pngp->prev_scanline[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]);
+         rpng_unfilter_paeth(line, pngp->prev_scanline,
+               pngp->pitch, pngp->bpp);
          break;
       default:
          return IMAGE_PROCESS_ERROR_END;
@@ -611,26 +917,26 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
    switch (ihdr->color_type)
    {
       case PNG_IHDR_COLOR_GRAY:
-         rpng_reverse_filter_copy_line_bw(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         rpng_reverse_filter_copy_line_bw(data, line, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGB:
-         rpng_reverse_filter_copy_line_rgb(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         rpng_reverse_filter_copy_line_rgb(data, line, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_PLT:
          rpng_reverse_filter_copy_line_plt(
-               data, pngp->decoded_scanline, ihdr->width,
+               data, line, ihdr->width,
                ihdr->depth, pngp->palette);
          break;
       case PNG_IHDR_COLOR_GRAY_ALPHA:
-         rpng_reverse_filter_copy_line_gray_alpha(data, pngp->decoded_scanline, ihdr->width,
+         rpng_reverse_filter_copy_line_gray_alpha(data, line, ihdr->width,
                ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGBA:
-         rpng_reverse_filter_copy_line_rgba(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         rpng_reverse_filter_copy_line_rgba(data, line, ihdr->width, ihdr->depth);
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   pngp->prev_scanline = line;
 
    return IMAGE_PROCESS_NEXT;
 }
@@ -827,7 +1133,7 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng)
 
    process->flags                  = 0;
    process->prev_scanline          = NULL;
-   process->decoded_scanline       = NULL;
+   process->zero_scanline          = NULL;
    process->inflate_buf            = NULL;
 
    process->ihdr.width             = 0;
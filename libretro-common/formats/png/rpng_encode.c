@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
 #include <libretro.h>
@@ -31,6 +32,28 @@
 
 #include "rpng_internal.h"
 
+#if !defined(RPNG_NO_SIMD)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RPNG_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+#endif
+
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+#include <zlib.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+
+#define RPNG_ENCODE_THREADS
+/* Strips are deflated on their own threads */
+#define RPNG_MAX_STRIPS      8
+#define RPNG_MIN_STRIP_SIZE  (256 * 1024)
+#define RPNG_STRIP_DICT_SIZE (32 * 1024)
+#endif
+
 #undef GOTO_END_ERROR
 #define GOTO_END_ERROR() do { \
    fprintf(stderr, "[RPNG]: Error in line %d.\n", __LINE__); \
@@ -140,11 +163,41 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
    }
 }
 
+/* The filters only read the original scanlines, so
+ * unlike unfiltering they are done 16 bytes at a time */
+#if defined(RPNG_SSE2)
+/* Sum of |x| for x as int8_t: min(x, -x) as uint8_t */
+static INLINE void count_sad_16(__m128i v, __m128i *acc)
+{
+   __m128i m = _mm_min_epu8(v, _mm_sub_epi8(_mm_setzero_si128(), v));
+   *acc      = _mm_add_epi64(*acc, _mm_sad_epu8(m, _mm_setzero_si128()));
+}
+#endif
+
 static unsigned count_sad(const uint8_t *data, size_t size)
 {
-   size_t i;
+   size_t i     = 0;
    unsigned cnt = 0;
-   for (i = 0; i < size; i++)
+
+#if defined(RPNG_SSE2)
+   __m128i acc  = _mm_setzero_si128();
+   for (; i + 16 <= size; i += 16)
+      count_sad_16(_mm_loadu_si128((const __m128i*)(data + i)), &acc);
+   cnt         += (unsigned)_mm_cvtsi128_si32(acc)
+                + (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#elif defined(RPNG_NEON)
+   uint32x4_t acc = vdupq_n_u32(0);
+   for (; i + 16 <= size; i += 16)
+   {
+      int8x16_t v = vld1q_s8((const int8_t*)(data + i));
+      acc         = vpadalq_u16(acc,
+            vpaddlq_u8(vreinterpretq_u8_s8(vabsq_s8(v))));
+   }
+   cnt         += vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1)
+                + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+
+   for (; i < size; i++)
    {
       if (data[i])
          cnt += abs((int8_t)data[i]);
@@ -155,9 +208,20 @@ static unsigned count_sad(const uint8_t *data, size_t size)
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
-   width *= bpp;
-   for (i = 0; i < width; i++)
+   unsigned i = 0;
+   width     *= bpp;
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)),
+            _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= width; i += 16)
+      vst1q_u8(target + i, vsubq_u8(vld1q_u8(line + i), vld1q_u8(prev + i)));
+#endif
+
+   for (; i < width; i++)
       target[i] = line[i] - prev[i];
 
    return count_sad(target, width);
@@ -170,7 +234,19 @@ static unsigned filter_sub(uint8_t *target, const uint8_t *line,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i];
-   for (i = bpp; i < width; i++)
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)),
+            _mm_loadu_si128((const __m128i*)(line + i - bpp))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= width; i += 16)
+      vst1q_u8(target + i, vsubq_u8(vld1q_u8(line + i),
+               vld1q_u8(line + i - bpp)));
+#endif
+
+   for (; i < width; i++)
       target[i] = line[i] - line[i - bpp];
 
    return count_sad(target, width);
@@ -183,12 +259,69 @@ static unsigned filter_avg(uint8_t *target, const uint8_t *line,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= width; i += 16)
+   {
+      __m128i a   = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b   = _mm_loadu_si128((const __m128i*)(prev + i));
+      /* _mm_avg_epu8 rounds up, PNG rounds down */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)), avg));
+   }
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= width; i += 16)
+      vst1q_u8(target + i, vsubq_u8(vld1q_u8(line + i),
+            vhaddq_u8(vld1q_u8(line + i - bpp), vld1q_u8(prev + i))));
+#endif
+
+   for (; i < width; i++)
       target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
 
    return count_sad(target, width);
 }
 
+#if defined(RPNG_SSE2)
+static INLINE __m128i paeth_8(__m128i a, __m128i b, __m128i c)
+{
+   /* 16 bit lanes, so the distances can't overflow */
+   __m128i pa       = _mm_sub_epi16(b, c);
+   __m128i pb       = _mm_sub_epi16(a, c);
+   __m128i pc       = _mm_add_epi16(pa, pb);
+   __m128i neg, smallest, use_a, use_b;
+
+   neg      = _mm_cmplt_epi16(pa, _mm_setzero_si128());
+   pa       = _mm_sub_epi16(_mm_xor_si128(pa, neg), neg);
+   neg      = _mm_cmplt_epi16(pb, _mm_setzero_si128());
+   pb       = _mm_sub_epi16(_mm_xor_si128(pb, neg), neg);
+   neg      = _mm_cmplt_epi16(pc, _mm_setzero_si128());
+   pc       = _mm_sub_epi16(_mm_xor_si128(pc, neg), neg);
+   smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+   /* Ties go to a, then b, then c */
+   use_a    = _mm_cmpeq_epi16(smallest, pa);
+   use_b    = _mm_andnot_si128(use_a, _mm_cmpeq_epi16(smallest, pb));
+   return _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(use_a, a), _mm_and_si128(use_b, b)),
+         _mm_andnot_si128(_mm_or_si128(use_a, use_b), c));
+}
+#elif defined(RPNG_NEON)
+static INLINE uint8x8_t paeth_8(uint8x8_t a, uint8x8_t b, uint8x8_t c)
+{
+   /* pa = |b - c|, pb = |a - c|, pc = |a + b - 2c| */
+   uint16x8_t pa   = vabdl_u8(b, c);
+   uint16x8_t pb   = vabdl_u8(a, c);
+   uint16x8_t pc   = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+   /* Ties go to a, then b, then c */
+   uint8x8_t use_a = vmovn_u16(vandq_u16(
+         vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+   uint8x8_t use_b = vmovn_u16(vcleq_u16(pb, pc));
+   return vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+}
+#endif
+
 static unsigned filter_paeth(uint8_t *target,
       const uint8_t *line, const uint8_t *prev,
       unsigned width, unsigned bpp)
@@ -197,82 +330,104 @@ static unsigned filter_paeth(uint8_t *target,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= width; i += 16)
+   {
+      __m128i zero = _mm_setzero_si128();
+      __m128i a    = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b    = _mm_loadu_si128((const __m128i*)(prev + i));
+      __m128i c    = _mm_loadu_si128((const __m128i*)(prev + i - bpp));
+      __m128i pred = _mm_packus_epi16(
+            paeth_8(_mm_unpacklo_epi8(a, zero),
+               _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero)),
+            paeth_8(_mm_unpackhi_epi8(a, zero),
+               _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero)));
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)), pred));
+   }
+#elif defined(RPNG_NEON)
+   for (; i + 8 <= width; i += 8)
+      vst1_u8(target + i, vsub_u8(vld1_u8(line + i),
+            paeth_8(vld1_u8(line + i - bpp), vld1_u8(prev + i),
+               vld1_u8(prev + i - bpp))));
+#endif
+
+   for (; i < width; i++)
       target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
 
    return count_sad(target, width);
 }
 
-bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
-      unsigned width, unsigned height, signed pitch, unsigned bpp)
+/* Converts and filters rows [first, first + rows) of
+ * the image into target, one filter byte and a filtered
+ * scanline per row. In fast mode every row uses the Up
+ * filter, otherwise the filter that scores best. */
+static bool rpng_filter_rows(uint8_t *target, const uint8_t *data,
+      unsigned width, unsigned first, unsigned rows,
+      signed pitch, unsigned bpp, bool fast)
 {
    unsigned h;
-   struct png_ihdr ihdr = {0};
-   bool ret = true;
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
+   bool ret                = true;
+   size_t line_size        = width * bpp;
+   uint8_t *rgba_line      = (uint8_t*)malloc(line_size);
+   uint8_t *prev_encoded   = (uint8_t*)calloc(1, line_size);
    uint8_t *up_filtered    = NULL;
    uint8_t *sub_filtered   = NULL;
    uint8_t *avg_filtered   = NULL;
    uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
-   
-   if (!intf_s)
-      GOTO_END_ERROR();
-
-   stream_backend = trans_stream_get_zlib_deflate_backend();
 
-   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
-
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr_string(intf_s, &ihdr))
-      GOTO_END_ERROR();
+   if (!fast)
+   {
+      up_filtered    = (uint8_t*)malloc(line_size);
+      sub_filtered   = (uint8_t*)malloc(line_size);
+      avg_filtered   = (uint8_t*)malloc(line_size);
+      paeth_filtered = (uint8_t*)malloc(line_size);
+   }
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf      = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+   if (     !rgba_line || !prev_encoded
+         || (!fast && (!up_filtered || !sub_filtered
+               || !avg_filtered || !paeth_filtered)))
+   {
+      ret = false;
+      goto end;
+   }
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+   data += (ptrdiff_t)pitch * first;
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+   /* Rows are filtered against the row above,
+    * even when it belongs to another strip */
+   if (first > 0)
+   {
+      if (bpp == sizeof(uint32_t))
+         copy_argb_line(prev_encoded, (const uint32_t*)(data - pitch), width);
+      else
+         copy_bgr24_line(prev_encoded, data - pitch, width);
+   }
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+   for (h = 0; h < rows; h++, target += line_size, data += pitch)
    {
+      uint8_t *tmp;
+
       if (bpp == sizeof(uint32_t))
          copy_argb_line(rgba_line, (const uint32_t*)data, width);
       else
          copy_bgr24_line(rgba_line, data, width);
 
-      /* Try every filtering method, and choose the method
-       * which has most entries as zero.
-       *
-       * This is probably not very optimal, but it's very
-       * simple to implement.
-       */
+      if (fast)
+      {
+         *target++ = 2;
+         filter_up(target, rgba_line, prev_encoded, width, bpp);
+      }
+      else
       {
-         unsigned none_score  = count_sad(rgba_line, width * bpp);
+         /* Try every filtering method, and choose the method
+          * which has most entries as zero.
+          *
+          * This is probably not very optimal, but it's very
+          * simple to implement.
+          */
+         unsigned none_score  = count_sad(rgba_line, line_size);
          unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
          unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
          unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
@@ -309,22 +464,275 @@ bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
             chosen_filtered = paeth_filtered;
          }
 
-         *encode_target++ = filter;
-         memcpy(encode_target, chosen_filtered, width * bpp);
+         *target++ = filter;
+         memcpy(target, chosen_filtered, line_size);
+      }
+
+      tmp          = prev_encoded;
+      prev_encoded = rgba_line;
+      rgba_line    = tmp;
+   }
+
+end:
+   free(rgba_line);
+   free(prev_encoded);
+   free(up_filtered);
+   free(sub_filtered);
+   free(avg_filtered);
+   free(paeth_filtered);
+   return ret;
+}
+
+#ifdef RPNG_ENCODE_THREADS
+/* One horizontal strip of the image, filtered and
+ * deflated on its own thread. The strips are raw deflate
+ * streams ending on a byte boundary (sync flush), so they
+ * can simply be concatenated into one zlib stream, each
+ * in its own IDAT chunk. */
+struct rpng_strip
+{
+   const uint8_t *data;
+   uint8_t *filtered;   /* Points into the shared filter buffer */
+   uint8_t *out;        /* IDAT chunk: length, type, deflate data */
+   size_t filtered_size;
+   size_t out_size;
+   unsigned width;
+   unsigned first;
+   unsigned rows;
+   signed pitch;
+   unsigned bpp;
+   int level;
+   bool fast;
+   bool first_strip;
+   bool last_strip;
+   bool ok;
+};
+
+static void rpng_strip_deflate(void *data)
+{
+   z_stream z;
+   int zret;
+   size_t bound;
+   uint8_t *dst;
+   struct rpng_strip *strip = (struct rpng_strip*)data;
+
+   if (!rpng_filter_rows(strip->filtered, strip->data, strip->width,
+            strip->first, strip->rows, strip->pitch, strip->bpp, strip->fast))
+      return;
+
+   memset(&z, 0, sizeof(z));
+   if (deflateInit2(&z, strip->level, Z_DEFLATED, -MAX_WBITS,
+            8, Z_DEFAULT_STRATEGY) != Z_OK)
+      return;
+
+   /* Prime the window with the end of the strip above, so
+    * the strip boundaries cost next to nothing in size.
+    * That strip is being filtered on another thread, so
+    * filter the rows needed again here. */
+   if (!strip->first_strip)
+   {
+      size_t line_size   = (size_t)strip->width * strip->bpp + 1;
+      unsigned dict_rows = (unsigned)((RPNG_STRIP_DICT_SIZE
+               + line_size - 1) / line_size);
+      uint8_t *dict;
+
+      if (dict_rows > strip->first)
+         dict_rows = strip->first;
+
+      if ((dict = (uint8_t*)malloc(dict_rows * line_size)))
+      {
+         if (rpng_filter_rows(dict, strip->data, strip->width,
+                  strip->first - dict_rows, dict_rows, strip->pitch,
+                  strip->bpp, strip->fast))
+            deflateSetDictionary(&z, dict, (uInt)(dict_rows * line_size));
+         free(dict);
+      }
+   }
+
+   /* Chunk header, zlib header, sync flush marker and Adler-32 */
+   bound = deflateBound(&z, (uLong)strip->filtered_size) + 8 + 2 + 5 + 4;
+   if (!(strip->out = (uint8_t*)malloc(bound)))
+   {
+      deflateEnd(&z);
+      return;
+   }
+
+   dst = strip->out + 8;
+   if (strip->first_strip)
+   {
+      *dst++ = 0x78; /* Deflate, 32K window */
+      *dst++ = 0x9c; /* Default level, no dictionary */
+   }
+
+   z.next_in   = strip->filtered;
+   z.avail_in  = (uInt)strip->filtered_size;
+   z.next_out  = dst;
+   z.avail_out = (uInt)(bound - (dst - strip->out) - 4);
+
+   /* The output buffer is large enough to do it in one go */
+   zret = deflate(&z, strip->last_strip ? Z_FINISH : Z_SYNC_FLUSH);
+   if (strip->last_strip
+         ? zret == Z_STREAM_END
+         : (zret == Z_OK && !z.avail_in && z.avail_out))
+   {
+      strip->out_size = (size_t)(z.next_out - strip->out);
+      strip->ok       = true;
+   }
+
+   deflateEnd(&z);
+}
+
+static bool rpng_save_image_strips(intfstream_t *intf_s,
+      const uint8_t *data, uint8_t *filtered,
+      unsigned width, unsigned height, signed pitch,
+      unsigned bpp, unsigned num_strips, int level, bool fast)
+{
+   unsigned i;
+   struct rpng_strip strips[RPNG_MAX_STRIPS];
+   sthread_t *threads[RPNG_MAX_STRIPS];
+   bool ret                 = true;
+   size_t line_size         = (size_t)width * bpp + 1;
+   uLong adler              = adler32(0L, Z_NULL, 0);
+   unsigned first           = 0;
+
+   for (i = 0; i < num_strips; i++)
+   {
+      unsigned rows            = (height - first) / (num_strips - i);
+
+      strips[i].data          = data;
+      strips[i].filtered      = filtered + first * line_size;
+      strips[i].out           = NULL;
+      strips[i].filtered_size = rows * line_size;
+      strips[i].out_size      = 0;
+      strips[i].width         = width;
+      strips[i].first         = first;
+      strips[i].rows          = rows;
+      strips[i].pitch         = pitch;
+      strips[i].bpp           = bpp;
+      strips[i].level         = level;
+      strips[i].fast          = fast;
+      strips[i].first_strip   = (i == 0);
+      strips[i].last_strip    = (i == num_strips - 1);
+      strips[i].ok            = false;
+      first                  += rows;
+   }
+
+   for (i = 1; i < num_strips; i++)
+      threads[i] = sthread_create(rpng_strip_deflate, &strips[i]);
+   rpng_strip_deflate(&strips[0]);
+
+   for (i = 1; i < num_strips; i++)
+   {
+      if (threads[i])
+         sthread_join(threads[i]);
+      else
+         rpng_strip_deflate(&strips[i]);
+   }
+
+   for (i = 0; i < num_strips; i++)
+   {
+      if (!ret || !strips[i].ok)
+      {
+         ret = false;
+         continue;
+      }
+
+      adler = adler32(adler, strips[i].filtered,
+            (uInt)strips[i].filtered_size);
+
+      if (strips[i].last_strip)
+      {
+         dword_write_be(strips[i].out + strips[i].out_size, (uint32_t)adler);
+         strips[i].out_size += 4;
+      }
+
+      memcpy(strips[i].out + 4, "IDAT", 4);
+      dword_write_be(strips[i].out, (uint32_t)(strips[i].out_size - 8));
+      if (!png_write_idat_string(intf_s, strips[i].out, strips[i].out_size))
+         ret = false;
+   }
+
+   for (i = 0; i < num_strips; i++)
+      free(strips[i].out);
+
+   return ret;
+}
+#endif
+
+bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
+      unsigned width, unsigned height, signed pitch, unsigned bpp,
+      unsigned flags)
+{
+   struct png_ihdr ihdr = {0};
+   bool ret = true;
+   const struct trans_stream_backend *stream_backend = NULL;
+   size_t encode_buf_size  = 0;
+   uint8_t *encode_buf     = NULL;
+   uint8_t *deflate_buf    = NULL;
+   void *stream            = NULL;
+   uint32_t total_in       = 0;
+   uint32_t total_out      = 0;
+   bool fast               = (flags & RPNG_SAVE_FLAG_FAST) != 0;
+   int level               = fast ? 1 : 9;
+
+   if (!intf_s)
+      GOTO_END_ERROR();
+
+   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
+      GOTO_END_ERROR();
+
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr_string(intf_s, &ihdr))
+      GOTO_END_ERROR();
+
+   encode_buf_size = (width * bpp + 1) * height;
+   encode_buf      = (uint8_t*)malloc(encode_buf_size);
+   if (!encode_buf)
+      GOTO_END_ERROR();
+
+#ifdef RPNG_ENCODE_THREADS
+   if (     (flags & RPNG_SAVE_FLAG_PARALLEL)
+         && encode_buf_size >= RPNG_MIN_STRIP_SIZE * 2)
+   {
+      unsigned num_strips = cpu_features_get_core_amount();
+
+      if (num_strips > RPNG_MAX_STRIPS)
+         num_strips = RPNG_MAX_STRIPS;
+      if (num_strips > encode_buf_size / RPNG_MIN_STRIP_SIZE)
+         num_strips = (unsigned)(encode_buf_size / RPNG_MIN_STRIP_SIZE);
+      if (num_strips > height)
+         num_strips = height;
 
-         memcpy(prev_encoded, rgba_line, width * bpp);
+      if (num_strips > 1)
+      {
+         if (!rpng_save_image_strips(intf_s, data, encode_buf,
+                  width, height, pitch, bpp, num_strips, level, fast))
+            GOTO_END_ERROR();
+         if (!png_write_iend_string(intf_s))
+            GOTO_END_ERROR();
+         goto end;
       }
    }
+#endif
+
+   if (!rpng_filter_rows(encode_buf, data, width, 0, height, pitch, bpp, fast))
+      GOTO_END_ERROR();
 
    deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
    if (!deflate_buf)
       GOTO_END_ERROR();
 
-   stream = stream_backend->stream_new();
+   stream_backend = trans_stream_get_zlib_deflate_backend();
+   stream         = stream_backend->stream_new();
 
    if (!stream)
       GOTO_END_ERROR();
 
+   /* Has to be set before the stream is started */
+   stream_backend->define(stream, "level", level);
    stream_backend->set_in(
          stream,
          encode_buf,
@@ -347,12 +755,6 @@ bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
 end:
    free(encode_buf);
    free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
 
    if (stream_backend)
    {
@@ -367,6 +769,13 @@ end:
 
 bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
+{
+   return rpng_save_image_argb_flags(path, data,
+         width, height, pitch, 0);
+}
+
+bool rpng_save_image_argb_flags(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned flags)
 {
    bool ret                      = false;
    intfstream_t* intf_s          = NULL;
@@ -377,7 +786,7 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
 
    ret = rpng_save_image_stream((const uint8_t*) data, intf_s,
                                 width, height,
-                                (signed) pitch, sizeof(uint32_t));
+                                (signed) pitch, sizeof(uint32_t), flags);
    intfstream_close(intf_s);
    free(intf_s);
    return ret;
@@ -385,6 +794,13 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
+{
+   return rpng_save_image_bgr24_flags(path, data,
+         width, height, pitch, 0);
+}
+
+bool rpng_save_image_bgr24_flags(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned flags)
 {
    bool ret                      = false;
    intfstream_t* intf_s          = NULL;
@@ -393,7 +809,7 @@ bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
          RETRO_VFS_FILE_ACCESS_WRITE,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
    ret = rpng_save_image_stream(data, intf_s, width, height, 
-                                (signed) pitch, 3);
+                                (signed) pitch, 3, flags);
    intfstream_close(intf_s);
    free(intf_s);
    return ret;
@@ -402,6 +818,14 @@ bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
 
 uint8_t* rpng_save_image_bgr24_string(const uint8_t *data,
       unsigned width, unsigned height, signed pitch, uint64_t* bytes)
+{
+   return rpng_save_image_bgr24_string_flags(data,
+         width, height, pitch, bytes, 0);
+}
+
+uint8_t* rpng_save_image_bgr24_string_flags(const uint8_t *data,
+      unsigned width, unsigned height, signed pitch, uint64_t* bytes,
+      unsigned flags)
 {
    bool ret                    = false;
    uint8_t* buf                = NULL;
@@ -420,7 +844,7 @@ uint8_t* rpng_save_image_bgr24_string(const uint8_t *data,
          buf_length);
 
    ret = rpng_save_image_stream((const uint8_t*)data, 
-            intf_s, width, height, pitch, 3);
+            intf_s, width, height, pitch, 3, flags);
 
    *bytes = intfstream_get_ptr(intf_s);
    intfstream_rewind(intf_s);
@@ -54,6 +54,10 @@ enum file_archive_transfer_type
 
 typedef struct file_archive_handle
 {
+   /* If set, backends that can stream write the
+    * decompressed data here as it is produced,
+    * and data does not hold the whole file */
+   struct RFILE *outfile;
    uint8_t  *data;
    uint32_t real_checksum;
 } file_archive_file_handle_t;
@@ -130,7 +134,7 @@ struct file_archive_file_backend
 
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int64_t (*compressed_file_read)(const char *path, const char *needle, void **buf,
-         const char *optional_outfile);
+         const char *optional_outfile, uint32_t *crc32);
    const char *ident;
 };
 
@@ -187,6 +191,20 @@ int file_archive_compressed_read(
       const char* path, void **buf,
       const char* optional_filename, int64_t *length);
 
+/**
+ * file_archive_compressed_read_crc32:
+ * @crc32                        : CRC32 of the extracted file.
+ *
+ * Same as file_archive_compressed_read(), also returning
+ * the CRC32 of the extracted file. It is calculated (and
+ * checked against the archive) during extraction, so it
+ * doesn't need another pass over the data.
+ **/
+int file_archive_compressed_read_crc32(
+      const char* path, void **buf,
+      const char* optional_filename, int64_t *length,
+      uint32_t *crc32);
+
 const struct file_archive_file_backend* file_archive_get_zlib_file_backend(void);
 const struct file_archive_file_backend* file_archive_get_7z_file_backend(void);
 
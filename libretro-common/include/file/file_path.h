@@ -691,6 +691,16 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * @return modification time of @path in seconds since
+ * the epoch, or 0 if the path is invalid or its
+ * modification time is unknown.
+ */
+int64_t path_get_mtime(const char *path);
+
 bool is_path_accessible_using_standard_io(const char *path);
 
 RETRO_END_DECLS
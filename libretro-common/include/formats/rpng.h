@@ -34,6 +34,16 @@ RETRO_BEGIN_DECLS
 
 typedef struct rpng rpng_t;
 
+enum rpng_save_flags
+{
+   /* Use the Up filter on every row and a low deflate
+    * level, trading file size for speed */
+   RPNG_SAVE_FLAG_FAST     = (1 << 0),
+   /* Filter and deflate strips of large images on
+    * several threads (needs HAVE_THREADS) */
+   RPNG_SAVE_FLAG_PARALLEL = (1 << 1)
+};
+
 rpng_t *rpng_init(const char *path);
 
 bool rpng_is_valid(rpng_t *rpng);
@@ -53,11 +63,18 @@ bool rpng_start(rpng_t *rpng);
 
 bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch);
+bool rpng_save_image_argb_flags(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned flags);
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
+bool rpng_save_image_bgr24_flags(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned flags);
 
 uint8_t* rpng_save_image_bgr24_string(const uint8_t *data,
       unsigned width, unsigned height, signed pitch, uint64_t *bytes);
+uint8_t* rpng_save_image_bgr24_string_flags(const uint8_t *data,
+      unsigned width, unsigned height, signed pitch, uint64_t *bytes,
+      unsigned flags);
 
 RETRO_END_DECLS
 
@@ -0,0 +1,111 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (crc32_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <encodings/crc32.h>
+
+/* Throughput of encoding_crc32() against a plain
+ * byte-at-a-time table loop, for a range of block sizes.
+ * Usage: crc32_bench [total MB per size] */
+
+static uint32_t bytewise_table[256];
+
+static void bytewise_init(void)
+{
+   uint32_t i;
+   for (i = 0; i < 256; i++)
+   {
+      uint32_t c = i;
+      int k;
+      for (k = 0; k < 8; k++)
+         c = (c >> 1) ^ (0xedb88320 & (0 - (c & 1)));
+      bytewise_table[i] = c;
+   }
+}
+
+static uint32_t bytewise_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   crc = ~crc;
+   while (len--)
+      crc = bytewise_table[(crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
+   return ~crc;
+}
+
+static double run(uint32_t (*fn)(uint32_t, const uint8_t*, size_t),
+      const uint8_t *buf, size_t block, size_t total, uint32_t *out)
+{
+   size_t done  = 0;
+   uint32_t crc = 0;
+   clock_t t0   = clock();
+   double secs;
+
+   while (done < total)
+   {
+      crc   = fn(crc, buf, block);
+      done += block;
+   }
+
+   secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+   *out = crc;
+   return secs > 0 ? (double)total / (1024.0 * 1024.0) / secs : 0;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t sizes[] = { 16, 64, 256, 4096, 65536, 1048576 };
+   size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 64) * 1024 * 1024;
+   uint8_t *buf = (uint8_t*)malloc(sizes[5]);
+   unsigned i;
+
+   if (!buf || !total)
+      return 1;
+
+   for (i = 0; i < sizes[5]; i++)
+      buf[i] = (uint8_t)rand();
+   bytewise_init();
+
+   printf("%10s %14s %14s %8s\n", "block", "bytewise MB/s",
+         "crc32 MB/s", "speedup");
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      uint32_t ref, crc;
+      double slow = run(bytewise_crc32, buf, sizes[i], total, &ref);
+      double fast = run(encoding_crc32, buf, sizes[i], total, &crc);
+
+      if (crc != ref)
+      {
+         printf("Mismatch at block size %u\n", (unsigned)sizes[i]);
+         return 1;
+      }
+
+      printf("%10u %14.1f %14.1f %7.1fx\n", (unsigned)sizes[i],
+            slow, fast, slow > 0 ? fast / slow : 0);
+   }
+
+   free(buf);
+   return 0;
+}
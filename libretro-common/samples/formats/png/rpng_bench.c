@@ -0,0 +1,258 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rpng_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Decodes every PNG given on the command line (e.g. a
+ * directory of thumbnails) a number of times from memory,
+ * and reports the decoded megabytes per second, along with
+ * a CRC of the pixels of each image. 'make bench' builds
+ * rpng_bench_scalar as well, which has the SIMD code
+ * disabled, to compare against.
+ *
+ * With -e, the images are encoded instead, the way
+ * screenshots are (BGR24, to memory), once with each set
+ * of save flags, and each result is checked by decoding
+ * it again.
+ *
+ * Usage: rpng_bench [-e] [-n iterations] <png file>... */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <encodings/crc32.h>
+#include <formats/image.h>
+#include <formats/rpng.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+static const struct
+{
+   const char *name;
+   unsigned flags;
+} save_modes[] = {
+   { "default",       0 },
+   { "fast",          RPNG_SAVE_FLAG_FAST },
+   { "parallel",      RPNG_SAVE_FLAG_PARALLEL },
+   { "fast+parallel", RPNG_SAVE_FLAG_FAST | RPNG_SAVE_FLAG_PARALLEL },
+};
+
+static double elapsed_ms(struct timespec *start)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (now.tv_sec - start->tv_sec) * 1000.0
+      + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static uint32_t *rpng_bench_decode(void *buf, size_t len,
+      unsigned *width, unsigned *height)
+{
+   int ret;
+   uint32_t *data = NULL;
+   rpng_t *rpng   = rpng_alloc();
+
+   if (!rpng)
+      return NULL;
+
+   if (     !rpng_set_buf_ptr(rpng, buf, len)
+         || !rpng_start(rpng))
+   {
+      rpng_free(rpng);
+      return NULL;
+   }
+
+   while (rpng_iterate_image(rpng));
+
+   if (!rpng_is_valid(rpng))
+   {
+      rpng_free(rpng);
+      return NULL;
+   }
+
+   do
+   {
+      ret = rpng_process_image(rpng, (void**)&data, len, width, height);
+   } while (ret == IMAGE_PROCESS_NEXT);
+
+   rpng_free(rpng);
+
+   if (ret == IMAGE_PROCESS_ERROR || ret == IMAGE_PROCESS_ERROR_END)
+   {
+      free(data);
+      return NULL;
+   }
+
+   return data;
+}
+
+static void rpng_bench_encode(const char *path, const uint32_t *argb,
+      unsigned width, unsigned height, unsigned iterations)
+{
+   unsigned i, m;
+   size_t size  = (size_t)width * height;
+   uint8_t *bgr = (uint8_t*)malloc(size * 3);
+
+   if (!bgr)
+      return;
+
+   for (i = 0; i < size; i++)
+   {
+      bgr[i * 3 + 0] = (uint8_t)(argb[i] >>  0);
+      bgr[i * 3 + 1] = (uint8_t)(argb[i] >>  8);
+      bgr[i * 3 + 2] = (uint8_t)(argb[i] >> 16);
+   }
+
+   for (m = 0; m < sizeof(save_modes) / sizeof(save_modes[0]); m++)
+   {
+      struct timespec start;
+      double ms;
+      uint64_t bytes   = 0;
+      uint8_t *png     = NULL;
+      uint32_t *pixels = NULL;
+      unsigned w       = 0;
+      unsigned h       = 0;
+      bool same        = false;
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (i = 0; i < iterations; i++)
+      {
+         free(png);
+         png = rpng_save_image_bgr24_string_flags(bgr, width, height,
+               width * 3, &bytes, save_modes[m].flags);
+      }
+      ms = elapsed_ms(&start);
+
+      if (png && (pixels = rpng_bench_decode(png, (size_t)bytes, &w, &h))
+            && w == width && h == height)
+      {
+         same = true;
+         for (i = 0; i < size; i++)
+            if ((pixels[i] & 0xffffff) != (argb[i] & 0xffffff))
+               same = false;
+      }
+
+      printf("%s: %ux%u, %-13s %8u bytes, %.1f MB/s%s\n", path,
+            width, height, save_modes[m].name, (unsigned)bytes,
+            ms > 0.0 ? size * 3.0 * iterations
+               / (1024.0 * 1024.0) * 1000.0 / ms : 0.0,
+            same ? "" : ", MISMATCH");
+
+      free(pixels);
+      free(png);
+   }
+
+   free(bgr);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned iterations = 10;
+   unsigned files      = 0;
+   bool encode         = false;
+   double total_ms     = 0.0;
+   double total_mb     = 0.0;
+
+   for (i = 1; i < argc; i++)
+   {
+      void *buf       = NULL;
+      int64_t len     = 0;
+      uint32_t *data  = NULL;
+      unsigned width  = 0;
+      unsigned height = 0;
+      uint32_t crc;
+      double ms, mb;
+      unsigned n;
+      struct timespec start;
+
+      if (string_is_equal(argv[i], "-n") && i + 1 < argc)
+      {
+         iterations = (unsigned)strtoul(argv[++i], NULL, 10);
+         continue;
+      }
+
+      if (string_is_equal(argv[i], "-e"))
+      {
+         encode = true;
+         continue;
+      }
+
+      if (!filestream_read_file(argv[i], &buf, &len))
+      {
+         fprintf(stderr, "Failed to read %s.\n", argv[i]);
+         continue;
+      }
+
+      if (!(data = rpng_bench_decode(buf, (size_t)len, &width, &height)))
+      {
+         fprintf(stderr, "Failed to decode %s.\n", argv[i]);
+         free(buf);
+         continue;
+      }
+
+      crc = encoding_crc32(0, (const uint8_t*)data,
+            width * height * sizeof(uint32_t));
+
+      if (encode)
+      {
+         rpng_bench_encode(argv[i], data, width, height, iterations);
+         free(data);
+         free(buf);
+         files++;
+         continue;
+      }
+
+      free(data);
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (n = 0; n < iterations; n++)
+         free(rpng_bench_decode(buf, (size_t)len, &width, &height));
+      ms  = elapsed_ms(&start);
+      mb  = (double)width * height * sizeof(uint32_t)
+         * iterations / (1024.0 * 1024.0);
+
+      printf("%s: %ux%u, crc %08x, %.1f MB/s\n", argv[i],
+            width, height, crc, ms > 0.0 ? mb * 1000.0 / ms : 0.0);
+
+      total_ms += ms;
+      total_mb += mb;
+      files++;
+      free(buf);
+   }
+
+   if (!files)
+   {
+      fprintf(stderr, "Usage: %s [-e] [-n iterations] <png file>...\n", argv[0]);
+      return 1;
+   }
+
+   if (encode)
+      return 0;
+
+   printf("total: %u files, %.1f MB decoded in %.1f ms, %.1f MB/s\n",
+         files, total_mb, total_ms,
+         total_ms > 0.0 ? total_mb * 1000.0 / total_ms : 0.0);
+
+   return 0;
+}
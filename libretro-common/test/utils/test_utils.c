@@ -71,6 +71,34 @@ START_TEST (test_crc32)
 }
 END_TEST
 
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   crc = ~crc;
+   while (len--)
+   {
+      int k;
+      crc ^= *buf++;
+      for (k = 0; k < 8; k++)
+         crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+   }
+   return ~crc;
+}
+
+/* Exercise every length/alignment combination around the
+ * 8-byte and 64-byte block boundaries of the fast paths */
+START_TEST (test_crc32_blocks)
+{
+   size_t off, len, i;
+   uint8_t buf[1024 + 16];
+   for (i = 0; i < sizeof(buf); i++)
+      buf[i] = (uint8_t)(i * 131 + 7);
+   for (off = 0; off < 16; off++)
+      for (len = 0; len <= 1024; len += (len < 200) ? 1 : 29)
+         ck_assert_uint_eq(crc32_bitwise(0x12345678, buf + off, len),
+               encoding_crc32(0x12345678, buf + off, len));
+}
+END_TEST
+
 #define CRC32_BUFFER_SIZE 1048576
 #define CRC32_MAX_MB 64
 
@@ -141,6 +169,7 @@ Suite *create_suite(void)
    TCase *tc_core = tcase_create("Core");
    tcase_add_test(tc_core, test_md5);
    tcase_add_test(tc_core, test_crc32);
+   tcase_add_test(tc_core, test_crc32_blocks);
    tcase_add_test(tc_core, test_crc32_file);
    suite_add_tcase(s, tc_core);
 
@@ -852,9 +852,17 @@ const char *retro_vfs_file_get_path_impl(
 }
 
 int retro_vfs_stat_impl(const char *path, int32_t *size)
+{
+   return retro_vfs_stat_mtime_impl(path, size, NULL);
+}
+
+int retro_vfs_stat_mtime_impl(const char *path, int32_t *size,
+      int64_t *mtime)
 {
    int ret                   = RETRO_VFS_STAT_IS_VALID;
 
+   if (mtime)
+      *mtime                 = 0;
    if (!path || !*path)
       return 0;
    {
@@ -886,6 +894,8 @@ int retro_vfs_stat_impl(const char *path, int32_t *size)
 
       if (size)
          *size = (int32_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if ((stat_buf.st_mode & S_IFMT) == S_IFDIR)
          ret  |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -915,6 +925,8 @@ int retro_vfs_stat_impl(const char *path, int32_t *size)
 
       if (size)
          *size = (int32_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if (file_info & FILE_ATTRIBUTE_DIRECTORY)
          ret  |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -943,6 +955,8 @@ int retro_vfs_stat_impl(const char *path, int32_t *size)
       
       if (size)
          *size = (int32_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if (S_ISDIR(stat_buf.st_mode))
          ret |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -957,6 +971,8 @@ int retro_vfs_stat_impl(const char *path, int32_t *size)
 
       if (size)
          *size = (int32_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if (S_ISDIR(stat_buf.st_mode))
          ret |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -607,10 +607,18 @@ const char *retro_vfs_file_get_path_impl(libretro_vfs_implementation_file *strea
 }
 
 int retro_vfs_stat_impl(const char *path, int32_t *size)
+{
+   return retro_vfs_stat_mtime_impl(path, size, NULL);
+}
+
+int retro_vfs_stat_mtime_impl(const char *path, int32_t *size,
+      int64_t *mtime)
 {
    wchar_t *path_wide;
    _WIN32_FILE_ATTRIBUTE_DATA attribdata;
 
+   if (mtime)
+      *mtime = 0;
    if (!path || !*path)
       return 0;
 
@@ -632,6 +640,15 @@ int retro_vfs_stat_impl(const char *path, int32_t *size)
                    sz.LowPart = attribdata.nFileSizeLow;
                    *size = sz.QuadPart;
                }
+               if (mtime)
+               {
+                   /* FILETIME counts 100ns intervals since 1601 */
+                   ULARGE_INTEGER ft;
+                   ft.HighPart = attribdata.ftLastWriteTime.dwHighDateTime;
+                   ft.LowPart  = attribdata.ftLastWriteTime.dwLowDateTime;
+                   *mtime      = (int64_t)((ft.QuadPart
+                            - 116444736000000000ULL) / 10000000ULL);
+               }
            }
            free(path_wide);
            return (attribdata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
@@ -916,6 +916,9 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_allow_slaves,          MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_require_slaves,        MENU_ENUM_SUBLABEL_NETPLAY_REQUIRE_SLAVES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_check_frames,          MENU_ENUM_SUBLABEL_NETPLAY_CHECK_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_nat_traversal,         MENU_ENUM_SUBLABEL_NETPLAY_NAT_TRAVERSAL)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_udp_input,             MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_udp_redundancy,        MENU_ENUM_SUBLABEL_NETPLAY_UDP_REDUNDANCY)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_snapshot_interval,     MENU_ENUM_SUBLABEL_NETPLAY_SNAPSHOT_INTERVAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_stdin_cmd_enable,              MENU_ENUM_SUBLABEL_STDIN_CMD_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_mouse_enable,                  MENU_ENUM_SUBLABEL_MOUSE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_pointer_enable,                MENU_ENUM_SUBLABEL_POINTER_ENABLE)
@@ -3703,6 +3706,15 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_nat_traversal);
             break;
+         case MENU_ENUM_LABEL_NETPLAY_UDP_INPUT:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_udp_input);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_UDP_REDUNDANCY:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_udp_redundancy);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_SNAPSHOT_INTERVAL:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_snapshot_interval);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_CHECK_FRAMES:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_check_frames);
             break;
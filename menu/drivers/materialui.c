@@ -3842,6 +3842,29 @@ static void materialui_render(void *data,
          break;
    }
 
+   /* Load thumbnails of the playlist entries
+    * that are about to scroll into view */
+   if (   (materialui_render_process_entry != materialui_render_process_entry_default)
+       && (mui->last_onscreen_entry < entries_end))
+   {
+      size_t first = list->list[mui->first_onscreen_entry].entry_idx;
+      size_t last  = list->list[mui->last_onscreen_entry].entry_idx;
+
+      /* Desktop layout only shows thumbnails
+       * of the selected entry */
+      if (   (mui->list_view_type == MUI_LIST_VIEW_PLAYLIST_THUMB_DESKTOP)
+          && (selection < entries_end))
+      {
+         first = list->list[selection].entry_idx;
+         last  = first;
+      }
+
+      gfx_thumbnail_prefetch(
+            menu_st->thumbnail_path_data,
+            mui->playlist, first, last,
+            thumbnail_upscale_threshold);
+   }
+
    menu_st->entries.begin = mui->first_onscreen_entry;
 }
 
@@ -6462,6 +6485,7 @@ static void materialui_hide_fullscreen_thumbnails(
 
    /* Disable fullscreen thumbnails */
    mui->flags &= ~MUI_FLAG_SHOW_FULLSCREEN_THUMBNAILS;
+   gfx_thumbnail_set_fullscreen(false);
 }
 
 /* Enables (and triggers a fade in of) the fullscreen
@@ -6554,6 +6578,20 @@ static void materialui_show_fullscreen_thumbnails(
    /* Enable fullscreen thumbnails */
    mui->fullscreen_thumbnail_selection = selection;
    mui->flags                         |= MUI_FLAG_SHOW_FULLSCREEN_THUMBNAILS;
+
+   /* Fullscreen view shows original images, rather
+    * than the pre-scaled copies drawn in the list
+    * > Thumbnails are requested again via regular
+    *   means on the next frame */
+   if (gfx_thumbnail_set_fullscreen(true))
+   {
+      float stream_delay                = gfx_thumb_get_ptr()->stream_delay;
+
+      gfx_thumbnail_reset(primary_thumbnail);
+      gfx_thumbnail_reset(secondary_thumbnail);
+      primary_thumbnail->delay_timer    = stream_delay;
+      secondary_thumbnail->delay_timer  = stream_delay;
+   }
 }
 
 static void materialui_render_fullscreen_thumbnails(
@@ -7724,6 +7762,9 @@ static void materialui_set_thumbnail_dimensions(materialui_handle_t *mui)
          mui->thumbnail_width_max  = 0;
          break;
    }
+
+   gfx_thumbnail_set_prescale_size(
+         mui->thumbnail_width_max, mui->thumbnail_height_max);
 }
 
 /* Checks global 'Secondary Thumbnail' option - if
@@ -8908,6 +8949,10 @@ static int materialui_environ(enum menu_environ_cb type,
       case MENU_ENVIRON_DISABLE_SCREENSAVER:
          mui->flags &= ~MUI_FLAG_SHOW_SCREENSAVER;
          break;
+      case MENU_ENVIRON_IS_ANIMATING:
+         /* Touch feedback fades out as frames are drawn */
+         *(bool*)data = mui->touch_feedback_alpha > 0.0f;
+         break;
       default:
          return -1;
    }
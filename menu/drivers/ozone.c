@@ -1573,6 +1573,7 @@ static float ozone_last_framebuffer_opacity = -1.0f;
 static void ozone_cursor_animation_cb(void *userdata);
 static void ozone_selection_changed(ozone_handle_t *ozone, bool allow_animation);
 static void ozone_unload_thumbnail_textures(void *data);
+static void ozone_update_thumbnail_image(void *data);
 
 static INLINE uint8_t ozone_count_lines(const char *str)
 {
@@ -6182,6 +6183,8 @@ static void ozone_draw_thumbnail_bar(
    float scale_factor                = ozone->last_scale_factor;
    gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
 
+   gfx_thumbnail_set_prescale_size(thumbnail_width, thumbnail_height);
+
    /* Background */
    if (thumbnail_height)
    {
@@ -7123,6 +7126,7 @@ static void ozone_hide_fullscreen_thumbnails(ozone_handle_t *ozone, bool animate
 
    /* Disable fullscreen thumbnails */
    ozone->flags2 &= ~OZONE_FLAG2_SHOW_FULLSCREEN_THUMBNAILS;
+   gfx_thumbnail_set_fullscreen(false);
 }
 
 static void ozone_show_fullscreen_thumbnails(ozone_handle_t *ozone)
@@ -7210,6 +7214,12 @@ static void ozone_show_fullscreen_thumbnails(ozone_handle_t *ozone)
    /* Enable fullscreen thumbnails */
    ozone->fullscreen_thumbnail_selection = (size_t)ozone->selection;
    ozone->flags2 |=  OZONE_FLAG2_SHOW_FULLSCREEN_THUMBNAILS;
+
+   /* Fullscreen view shows original images, rather
+    * than the pre-scaled copies drawn in the sidebar */
+   if (     gfx_thumbnail_set_fullscreen(true)
+         && !(ozone->flags & OZONE_FLAG_IS_STATE_SLOT))
+      ozone_update_thumbnail_image(ozone);
 }
 
 static void ozone_draw_fullscreen_thumbnails(
@@ -10386,6 +10396,16 @@ static void ozone_render(void *data,
             break;
       }
 
+      /* Load thumbnails of the entries that are
+       * likely to be selected next
+       * > Explore list indices don't follow the
+       *   order of the playlist */
+      if (!(ozone->flags & OZONE_FLAG_IS_EXPLORE_LIST))
+         gfx_thumbnail_prefetch(
+               menu_st->thumbnail_path_data,
+               playlist, selection, selection,
+               gfx_thumbnail_upscale_threshold);
+
       if (ozone->thumbnails.left.status  != GFX_THUMBNAIL_STATUS_UNKNOWN)
          ozone->thumbnails_left_status_prev  = ozone->thumbnails.left.status;
       if (ozone->thumbnails.right.status != GFX_THUMBNAIL_STATUS_UNKNOWN)
@@ -12433,6 +12453,10 @@ static int ozone_environ_cb(enum menu_environ_cb type, void *data, void *userdat
       case MENU_ENVIRON_DISABLE_SCREENSAVER:
          ozone->flags &= ~OZONE_FLAG_SHOW_SCREENSAVER;
          break;
+      case MENU_ENVIRON_IS_ANIMATING:
+         /* The cursor wiggle is timed by the frame itself */
+         *(bool*)data = (ozone->flags2 & OZONE_FLAG2_CURSOR_WIGGLING) ? true : false;
+         break;
       default:
          return -1;
    }
@@ -7434,6 +7434,18 @@ static int rgui_environ(
          rgui->flags              &= ~RGUI_FLAG_SHOW_SCREENSAVER;
          rgui->flags              |=  RGUI_FLAG_FORCE_REDRAW;
          break;
+      case MENU_ENVIRON_IS_ANIMATING:
+         /* Particle effects only advance on frames that
+          * are drawn - any other change to the framebuffer
+          * sets GFX_DISP_FLAG_FB_DIRTY */
+         {
+            settings_t *settings   = config_get_ptr();
+            *(bool*)data           =
+                     (rgui->particle_effect != RGUI_PARTICLE_EFFECT_NONE)
+                  && (     !(rgui->flags & RGUI_FLAG_SHOW_SCREENSAVER)
+                        || settings->bools.menu_rgui_particle_effect_screensaver);
+         }
+         break;
       default:
          return -1;
    }
@@ -383,6 +383,9 @@ typedef struct xmb_handle
    unsigned categories_active_idx;
    unsigned categories_active_idx_old;
    unsigned ticker_limit;
+   unsigned last_width;
+   unsigned last_height;
+   unsigned last_thumbnail_scale_factor;
 
    float fullscreen_thumbnail_alpha;
    float x;
@@ -2742,6 +2745,15 @@ static int xmb_environ(enum menu_environ_cb type, void *data, void *userdata)
       case MENU_ENVIRON_DISABLE_SCREENSAVER:
          xmb->show_screensaver = false;
          break;
+      case MENU_ENVIRON_IS_ANIMATING:
+         /* Ribbon, snow and bokeh backgrounds move all the time */
+#ifdef HAVE_SHADERPIPELINE
+         *(bool*)data = config_get_ptr()->uints.menu_xmb_shader_pipeline
+               > XMB_SHADER_PIPELINE_WALLPAPER;
+#else
+         *(bool*)data = false;
+#endif
+         break;
       default:
          return -1;
    }
@@ -5183,6 +5195,7 @@ static void xmb_hide_fullscreen_thumbnails(
 
    /* Disable fullscreen thumbnails */
    xmb->show_fullscreen_thumbnails    = false;
+   gfx_thumbnail_set_fullscreen(false);
 }
 
 /* Enables (and triggers a fade in of) the fullscreen
@@ -5267,6 +5280,12 @@ static void xmb_show_fullscreen_thumbnails(
    /* Enable fullscreen thumbnails */
    xmb->fullscreen_thumbnail_selection = selection;
    xmb->show_fullscreen_thumbnails     = true;
+
+   /* Fullscreen view shows original images, rather
+    * than the pre-scaled copies drawn beside the list */
+   if (     gfx_thumbnail_set_fullscreen(true)
+         && string_is_empty(xmb->savestate_thumbnail_file_path))
+      xmb_refresh_thumbnail_image(xmb, 0);
 }
 
 static bool INLINE xmb_fullscreen_thumbnails_available(xmb_handle_t *xmb,
@@ -5557,6 +5576,34 @@ static bool xmb_load_dynamic_icon(const char *icon_path,
    return false;
 }
 
+/* Sets the size that pre-scaled thumbnails are shrunk
+ * to fit: thumbnails are drawn no larger than their
+ * margins (see xmb_frame()) */
+static void xmb_set_thumbnail_prescale_size(xmb_handle_t *xmb,
+      unsigned width, unsigned height)
+{
+   settings_t *settings            = config_get_ptr();
+   unsigned thumbnail_scale_factor = settings->uints.menu_xmb_thumbnail_scale_factor;
+   float pseudo_font_length        = xmb->icon_spacing_horizontal * 4 - xmb->icon_size / 4.0f;
+   float left_margin_width         = xmb->icon_size * 3.4f;
+   float right_margin_width        = (float)width - (xmb->icon_size / 6) -
+         (xmb->margins_screen_left * xmb_scale_mod[5]) -
+         xmb->icon_spacing_horizontal - pseudo_font_length;
+   float margin_height_full        = (float)height - xmb->margins_title_top - ((xmb->icon_size / 4.0f) * 2.0f);
+   float thumb_width               = MAX(left_margin_width, right_margin_width)
+         * (float)thumbnail_scale_factor / 100.0f;
+   float thumb_height              = margin_height_full
+         * (float)thumbnail_scale_factor / 100.0f;
+
+   xmb->last_width                  = width;
+   xmb->last_height                 = height;
+   xmb->last_thumbnail_scale_factor = thumbnail_scale_factor;
+
+   gfx_thumbnail_set_prescale_size(
+         thumb_width  > 0.0f ? (unsigned)thumb_width  : 0,
+         thumb_height > 0.0f ? (unsigned)thumb_height : 0);
+}
+
 static void xmb_render(void *data,
       unsigned width, unsigned height, bool is_idle)
 {
@@ -5606,6 +5653,12 @@ static void xmb_render(void *data,
       xmb_context_reset_internal(xmb, video_driver_is_threaded(), false);
    }
 
+   if (     (width  != xmb->last_width)
+         || (height != xmb->last_height)
+         || (settings->uints.menu_xmb_thumbnail_scale_factor
+               != xmb->last_thumbnail_scale_factor))
+      xmb_set_thumbnail_prescale_size(xmb, width, height);
+
    /* This must be set every frame when using a pointer,
     * otherwise touchscreen input breaks when changing
     * orientation */
@@ -5856,6 +5909,16 @@ static void xmb_render(void *data,
          default:
             break;
       }
+
+      /* Load thumbnails of the entries that are
+       * likely to be selected next
+       * > Explore list indices don't follow the
+       *   order of the playlist */
+      if (!xmb->is_explore_list)
+         gfx_thumbnail_prefetch(
+               menu_st->thumbnail_path_data,
+               playlist, selection, selection,
+               gfx_thumbnail_upscale_threshold);
    }
 
    i = menu_st->entries.begin;
@@ -7218,6 +7281,7 @@ static void xmb_frame(void *data, video_frame_info_t *video_info)
             video_width, video_height, xmb->font);
    }
 
+   gfx_display_flush(p_disp);
    if (xmb->font && xmb->font->renderer && xmb->font->renderer->flush)
       xmb->font->renderer->flush(video_width, video_height, xmb->font->renderer_data);
    if (xmb->font2 && xmb->font2->renderer && xmb->font2->renderer->flush)
@@ -7458,6 +7522,8 @@ static void xmb_layout(xmb_handle_t *xmb)
    else
       xmb_layout_psp(xmb, width);
 
+   xmb_set_thumbnail_prescale_size(xmb, width, height);
+
    for (i = 0; i < end; i++)
    {
       float ia         = xmb->items_passive_alpha;
@@ -48,7 +48,10 @@ enum menu_state_flags
     * - Does menu driver support screensaver functionality?
     * - Is screensaver currently active? */
    MENU_ST_FLAG_SCREENSAVER_SUPPORTED       = (1 << 10),
-   MENU_ST_FLAG_SCREENSAVER_ACTIVE          = (1 << 11)
+   MENU_ST_FLAG_SCREENSAVER_ACTIVE          = (1 << 11),
+   /* Nothing changed on screen this iteration, so the
+    * menu frame was neither drawn nor presented */
+   MENU_ST_FLAG_FRAME_SKIPPED               = (1 << 12)
 };
 
 enum menu_scroll_mode
@@ -90,6 +93,10 @@ enum menu_environ_cb
    MENU_ENVIRON_DISABLE_MOUSE_CURSOR,
    MENU_ENVIRON_ENABLE_SCREENSAVER,
    MENU_ENVIRON_DISABLE_SCREENSAVER,
+   /* Sets the bool pointed to by 'data' if the menu
+    * changes over time by itself, i.e. it must be redrawn
+    * even when input, animations and tasks are idle */
+   MENU_ENVIRON_IS_ANIMATING,
    MENU_ENVIRON_LAST
 };
 
@@ -8834,6 +8834,7 @@ unsigned menu_displaylist_build_list(
             unsigned user;
             bool netplay_allow_slaves    = settings->bools.netplay_allow_slaves;
             bool netplay_use_mitm_server = settings->bools.netplay_use_mitm_server;
+            bool netplay_udp_input       = settings->bools.netplay_udp_input;
             bool network_cmd_enable      = settings->bools.network_cmd_enable;
             bool network_remote_enable   = settings->bools.network_remote_enable;
 
@@ -8859,6 +8860,9 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN,   PARSE_ONLY_INT,    true},
                {MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE, PARSE_ONLY_INT,    true},
                {MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,              PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,                  PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_NETPLAY_UDP_REDUNDANCY,             PARSE_ONLY_UINT,   false},
+               {MENU_ENUM_LABEL_NETPLAY_SNAPSHOT_INTERVAL,          PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_SHARE_DIGITAL,              PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_SHARE_ANALOG,               PARSE_ONLY_UINT,   true},
             };
@@ -8876,6 +8880,10 @@ unsigned menu_displaylist_build_list(
                      if (netplay_use_mitm_server)
                         build_list[i].checked = true;
                      break;
+                  case MENU_ENUM_LABEL_NETPLAY_UDP_REDUNDANCY:
+                     if (netplay_udp_input)
+                        build_list[i].checked = true;
+                     break;
                   default:
                      break;
                }
@@ -65,6 +65,7 @@
 #endif
 
 #include "../gfx/gfx_animation.h"
+#include "../gfx/gfx_thumbnail.h"
 #include "../input/input_driver.h"
 #include "../input/input_remapping.h"
 #include "../performance_counters.h"
@@ -4504,7 +4505,115 @@ void menu_driver_frame(bool menu_is_alive, video_frame_info_t *video_info)
 {
    struct menu_state    *menu_st = &menu_driver_state;
    if (menu_is_alive && menu_st->driver_ctx->frame)
+   {
       menu_st->driver_ctx->frame(menu_st->userdata, video_info);
+      gfx_display_flush((gfx_display_t*)video_info->disp_userdata);
+   }
+}
+
+static bool menu_driver_find_any_task(retro_task_t *task, void *userdata)
+{
+   return true;
+}
+
+/**
+ * menu_driver_frame_is_damaged:
+ * @render_framebuffer       : MENU_STATE_RENDER_FRAMEBUFFER of this
+ *                             iteration (input, list refresh, running
+ *                             animations or a dirty framebuffer)
+ *
+ * Damage tracking for menu_skip_idle_frames: decides whether
+ * the menu has to be drawn and presented this iteration, or
+ * whether the frame presented last still shows what is there.
+ * Menu drivers that don't answer MENU_ENVIRON_IS_ANIMATING
+ * are always drawn.
+ *
+ * Returns: true if the menu frame has to be drawn.
+ **/
+bool menu_driver_frame_is_damaged(
+      struct menu_state *menu_st,
+      gfx_display_t *p_disp,
+      gfx_animation_t *p_anim,
+      settings_t *settings,
+      bool render_framebuffer,
+      retro_time_t current_time)
+{
+   task_finder_data_t find_data;
+   video_driver_state_t *video_st   = video_state_get_ptr();
+   runloop_state_t *runloop_st      = runloop_state_get_ptr();
+   menu_input_pointer_t *pointer    = &menu_st->input_state.pointer;
+   bool is_animating                = true;
+   bool damaged                     = render_framebuffer
+         || (p_disp->flags & GFX_DISP_FLAG_FB_DIRTY);
+
+   if (     !menu_st->driver_ctx->environ_cb
+         || (menu_st->driver_ctx->environ_cb(MENU_ENVIRON_IS_ANIMATING,
+               &is_animating, menu_st->userdata) != 0)
+         || is_animating
+         || ANIM_IS_ACTIVE(p_anim))
+      damaged                       = true;
+
+   /* Text input cursor, animated screensavers, on-screen
+    * counters and messages outside of widgets */
+   if (     (menu_st->flags & MENU_ST_FLAG_INP_DLG_KB_DISPLAY)
+         || (     (menu_st->flags & MENU_ST_FLAG_SCREENSAVER_ACTIVE)
+               && (settings->uints.menu_screensaver_animation
+                  != MENU_SCREENSAVER_BLANK))
+         || settings->bools.video_fps_show
+         || settings->bools.video_statistics_show
+         || settings->bools.video_framecount_show
+         || settings->bools.video_memory_show
+         || runloop_st->msg_queue_size > 0)
+      damaged                       = true;
+
+   /* Pointer motion, presses and kinetic scrolling */
+   if (     (pointer->type != MENU_POINTER_DISABLED)
+         && (     (pointer->x != menu_st->redraw.pointer_x)
+               || (pointer->y != menu_st->redraw.pointer_y)
+               || (pointer->flags & MENU_INP_PTR_FLG_PRESSED)
+               || (pointer->y_accel != 0.0f)))
+   {
+      menu_st->redraw.pointer_x     = pointer->x;
+      menu_st->redraw.pointer_y     = pointer->y;
+      damaged                       = true;
+   }
+
+   if (     (video_st->width  != menu_st->redraw.width)
+         || (video_st->height != menu_st->redraw.height))
+   {
+      menu_st->redraw.width         = video_st->width;
+      menu_st->redraw.height        = video_st->height;
+      damaged                       = true;
+   }
+
+   /* Thumbnail loads, downloads and the like end up
+    * on screen one way or another */
+   if (!damaged)
+   {
+      find_data.func                = menu_driver_find_any_task;
+      find_data.userdata            = NULL;
+      damaged                       = task_queue_find(&find_data);
+   }
+
+   if (damaged)
+      menu_st->redraw.frames        = MENU_REDRAW_DAMAGE_FRAMES;
+   else if ((current_time - menu_st->redraw.last_time_us)
+         >= MENU_REDRAW_INTERVAL)
+      menu_st->redraw.frames        = 1;
+
+   if (!menu_st->redraw.frames)
+      return false;
+
+   menu_st->redraw.frames--;
+   menu_st->redraw.last_time_us     = current_time;
+
+   /* Drivers without set_texture draw straight to the
+    * screen, so the frame drawn now takes care of a
+    * dirty framebuffer */
+   if (!menu_st->driver_ctx->set_texture)
+      p_disp->flags                &= ~GFX_DISP_FLAG_FB_DIRTY;
+
+   return true;
 }
 
 /* Teardown function for the menu driver. */
@@ -6724,6 +6833,8 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
                free(menu_st->thumbnail_path_data);
             menu_st->thumbnail_path_data    = NULL;
 
+            gfx_thumbnail_cache_flush();
+
             if (menu_st->driver_data->core_buf)
                free(menu_st->driver_data->core_buf);
             menu_st->driver_data->core_buf  = NULL;
@@ -61,6 +61,13 @@ RETRO_BEGIN_DECLS
 #define POWERSTATE_CHECK_INTERVAL  (30 * 1000000)
 #define DATETIME_CHECK_INTERVAL    1000000
 
+/* With menu_skip_idle_frames, the menu keeps being drawn for
+ * this many frames after the last change (so that textures
+ * uploaded after a frame and threaded video catch up), and
+ * at least once per interval (for the clock, window exposes) */
+#define MENU_REDRAW_DAMAGE_FRAMES  3
+#define MENU_REDRAW_INTERVAL       1000000
+
 #define MENU_LIST_GET(list, idx) ((list) ? ((list)->menu_stack[(idx)]) : NULL)
 
 #define MENU_LIST_GET_SELECTION(list, idx) ((list) ? ((list)->selection_buf[(idx)]) : NULL)
@@ -469,6 +476,17 @@ struct menu_state
    retro_time_t input_last_time_us;
    menu_input_t input_state;               /* retro_time_t alignment */
 
+   /* Damage tracking state of menu_driver_frame_is_damaged() */
+   struct
+   {
+      retro_time_t last_time_us;
+      unsigned frames;
+      unsigned width;
+      unsigned height;
+      int16_t pointer_x;
+      int16_t pointer_y;
+   } redraw;
+
    retro_time_t prev_start_time;
    retro_time_t noop_press_time;
    retro_time_t noop_start_time;
@@ -624,6 +642,14 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data);
 
 void menu_driver_frame(bool menu_is_alive, video_frame_info_t *video_info);
 
+bool menu_driver_frame_is_damaged(
+      struct menu_state *menu_st,
+      gfx_display_t *p_disp,
+      gfx_animation_t *p_anim,
+      settings_t *settings,
+      bool render_framebuffer,
+      retro_time_t current_time);
+
 int menu_driver_deferred_push_content_list(file_list_t *list);
 
 bool menu_driver_init(bool video_is_threaded);
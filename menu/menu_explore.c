@@ -22,6 +22,7 @@
 #include <array/rhmap.h>
 #include <formats/rjson.h>
 #include <formats/rjson_helpers.h>
+#include <streams/file_stream.h>
 #include <retro_endianness.h>
 
 #include "menu_driver.h"
@@ -108,6 +109,41 @@ typedef struct
 #endif
 } explore_entry_t;
 
+/* Database fields of a playlist entry, as found in its RDB */
+typedef struct
+{
+   const char *fields[EXPLORE_CAT_COUNT];
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+   const char *original_title;
+#endif
+   uint32_t meta_count;
+} explore_meta_t;
+
+struct explore_source
+{
+   const struct playlist_entry *source;
+   explore_meta_t *meta;
+};
+
+struct explore_rdb
+{
+   libretrodb_t *handle;
+   struct explore_source *playlist_crcs;
+   struct explore_source *playlist_names;
+   size_t count;
+   uint32_t size, mtime;
+   char systemname[NAME_MAX_LENGTH];
+   char path[PATH_MAX_LENGTH];
+};
+
+/* Explore cache - see explore_cache_read() */
+typedef struct
+{
+   explore_meta_t **crcs;
+   explore_meta_t **names;
+   uint32_t size, mtime, count;
+} explore_cache_rdb_t;
+
 struct explore_state
 {
    ex_arena arena;
@@ -449,29 +485,434 @@ static void explore_load_icons(explore_state_t *state)
    }
 }
 
+/* Placeholder for playlist entries not found in their RDB */
+static explore_meta_t explore_meta_missing;
+
+static void explore_add_entry(explore_state_t *state,
+      explore_string_t** maps[EXPLORE_CAT_COUNT],
+      const struct explore_source *src, const char *systemname,
+      explore_string_t ***split_buf)
+{
+   unsigned cat;
+   explore_entry_t *e;
+   size_t idx                 = RBUF_LEN(state->entries);
+   const explore_meta_t *meta = src->meta;
+
+   /* Not found in the RDB */
+   if (!meta || meta == &explore_meta_missing)
+      return;
+
+   RBUF_RESIZE(state->entries, idx + 1);
+   e                 = &state->entries[idx];
+   e->playlist_entry = src->source;
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+      e->by[cat]     = NULL;
+   e->split          = NULL;
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+   e->original_title = NULL;
+#endif
+
+   for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+   {
+      const char *str = meta->fields[cat];
+
+      if (cat == EXPLORE_BY_SYSTEM)
+         str = systemname;
+      else if (str && explore_by_info[cat].is_boolean)
+         str = msg_hash_to_str(*str == '1' ?
+               MENU_ENUM_LABEL_VALUE_YES : MENU_ENUM_LABEL_VALUE_NO);
+
+      explore_add_unique_string(state, maps, e, cat, str, split_buf);
+   }
+
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+   if (meta->original_title && *meta->original_title)
+   {
+      size_t len        = strlen(meta->original_title) + 1;
+      e->original_title = (char*)
+         ex_arena_alloc(&state->arena, len);
+      memcpy(e->original_title, meta->original_title, len);
+   }
+#endif
+
+   if (RBUF_LEN(*split_buf))
+   {
+      size_t len;
+
+      RBUF_PUSH(*split_buf, NULL); /* terminator */
+      len        = RBUF_SIZEOF(*split_buf);
+      e->split   = (explore_string_t **)
+         ex_arena_alloc(&state->arena, len);
+      memcpy(e->split, *split_buf, len);
+      RBUF_CLEAR(*split_buf);
+   }
+}
+
+/* Explore cache
+ *
+ * Scanning the RDBs for the fields of every playlist
+ * entry is by far the slowest part of building the
+ * explore state, so the fields are kept in a binary
+ * file in the playlist directory, grouped by RDB. An
+ * RDB is only scanned again if it has changed, or if
+ * the playlists now contain entries that were never
+ * looked up in it.
+ *
+ * Layout (integers are 32-bit little endian, strings
+ * are NUL-terminated):
+ *   magic, RDB count
+ *   per RDB:   path, size, modification time, entry count
+ *   per entry: CRC, field mask, name (only if CRC is 0),
+ *              one string per bit set in the field mask
+ * A field mask of EXPLORE_CACHE_MISSING means that the
+ * entry was not found in the RDB */
+#define EXPLORE_CACHE_MAGIC     "RAEXPL02"
+#define EXPLORE_CACHE_MAGIC_LEN 8
+#define EXPLORE_CACHE_TITLE     (1u << EXPLORE_CAT_COUNT)
+#define EXPLORE_CACHE_MISSING   0xFFFFFFFF
+
+static const char *explore_cache_strdup(ex_arena *arena, const char *str)
+{
+   size_t len;
+   char *copy;
+
+   if (!str)
+      return NULL;
+
+   len  = strlen(str) + 1;
+   copy = (char*)ex_arena_alloc(arena, len);
+   memcpy(copy, str, len);
+   return copy;
+}
+
+/* Files are identified by their size and modification
+ * time, so that an RDB rewritten in place is noticed */
+static void explore_cache_rdb_fingerprint(const char *path,
+      uint32_t *size, uint32_t *mtime)
+{
+   int32_t len = path_get_size(path);
+
+   *mtime      = (uint32_t)path_get_mtime(path);
+
+   /* Size 0 marks an RDB that can't be cached */
+   *size       = (len > 0 && *mtime) ? (uint32_t)len : 0;
+}
+
+static bool explore_cache_get_u32(const char **p, const char *end,
+      uint32_t *val)
+{
+   if (end - *p < 4)
+      return false;
+   memcpy(val, *p, 4);
+   *val = retro_le_to_cpu32(*val);
+   *p  += 4;
+   return true;
+}
+
+static const char *explore_cache_get_str(const char **p, const char *end)
+{
+   const char *str = *p;
+   const char *nul = (const char*)memchr(str, '\0', end - str);
+   if (!nul)
+      return NULL;
+   *p = nul + 1;
+   return str;
+}
+
+static void explore_cache_free(explore_cache_rdb_t *cache)
+{
+   size_t i, cap;
+
+   for (i = 0, cap = RHMAP_CAP(cache); i != cap; i++)
+   {
+      if (!RHMAP_KEY(cache, i))
+         continue;
+      RHMAP_FREE(cache[i].crcs);
+      RHMAP_FREE(cache[i].names);
+   }
+   RHMAP_FREE(cache);
+}
+
+static bool explore_cache_read_rdb(const char **p, const char *end,
+      ex_arena *arena, explore_cache_rdb_t *rdb)
+{
+   uint32_t i;
+
+   rdb->crcs  = NULL;
+   rdb->names = NULL;
+
+   if (     !explore_cache_get_u32(p, end, &rdb->size)
+         || !explore_cache_get_u32(p, end, &rdb->mtime)
+         || !explore_cache_get_u32(p, end, &rdb->count))
+      return false;
+
+   for (i = 0; i < rdb->count; i++)
+   {
+      unsigned cat;
+      uint32_t crc32, mask;
+      explore_meta_t *meta = &explore_meta_missing;
+      const char *name     = NULL;
+
+      if (     !explore_cache_get_u32(p, end, &crc32)
+            || !explore_cache_get_u32(p, end, &mask)
+            || (!crc32 && !(name = explore_cache_get_str(p, end))))
+         goto error;
+
+      if (mask != EXPLORE_CACHE_MISSING)
+      {
+         const char *title = NULL;
+
+         meta = (explore_meta_t*)
+            ex_arena_alloc(arena, sizeof(explore_meta_t));
+         memset(meta, 0, sizeof(*meta));
+
+         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+            if (     (mask & (1u << cat))
+                  && !(meta->fields[cat] = explore_cache_get_str(p, end)))
+               goto error;
+
+         if (     (mask & EXPLORE_CACHE_TITLE)
+               && !(title = explore_cache_get_str(p, end)))
+            goto error;
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+         meta->original_title = title;
+#endif
+      }
+
+      if (crc32)
+         RHMAP_SET(rdb->crcs, crc32, meta);
+      else
+         RHMAP_SET_STR(rdb->names, name, meta);
+   }
+
+   return true;
+
+error:
+   RHMAP_FREE(rdb->crcs);
+   RHMAP_FREE(rdb->names);
+   return false;
+}
+
+/* Returns the cached RDBs, strings point into @buf */
+static explore_cache_rdb_t *explore_cache_read(const char *path,
+      ex_arena *arena, void **buf)
+{
+   uint32_t i, count;
+   const char *p, *end;
+   int64_t len                = 0;
+   explore_cache_rdb_t *cache = NULL;
+
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, buf, &len))
+      return NULL;
+
+   p   = (const char*)*buf;
+   end = p + len;
+
+   if (     len < EXPLORE_CACHE_MAGIC_LEN
+         || memcmp(p, EXPLORE_CACHE_MAGIC, EXPLORE_CACHE_MAGIC_LEN))
+      goto error;
+   p  += EXPLORE_CACHE_MAGIC_LEN;
+
+   if (!explore_cache_get_u32(&p, end, &count))
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      explore_cache_rdb_t rdb;
+      const char *rdb_path = explore_cache_get_str(&p, end);
+
+      if (!rdb_path || !explore_cache_read_rdb(&p, end, arena, &rdb))
+         goto error;
+
+      RHMAP_SET_STR(cache, rdb_path, rdb);
+   }
+
+   return cache;
+
+error:
+   RARCH_WARN("[Explore]: Ignoring invalid cache file: \"%s\".\n", path);
+   explore_cache_free(cache);
+   return NULL;
+}
+
+static bool explore_cache_lookup_sources(struct explore_source *sources,
+      const explore_cache_rdb_t *rdb, bool by_name)
+{
+   size_t i, cap;
+
+   for (i = 0, cap = RHMAP_CAP(sources); i != cap; i++)
+   {
+      ptrdiff_t idx;
+
+      if (!RHMAP_KEY(sources, i))
+         continue;
+
+      if (by_name)
+      {
+         if ((idx = RHMAP_IDX_STR(rdb->names,
+               RHMAP_KEY_STR(sources, i))) == -1)
+            return false;
+         sources[i].meta = rdb->names[idx];
+      }
+      else
+      {
+         if ((idx = RHMAP_IDX(rdb->crcs,
+               RHMAP_KEY(sources, i))) == -1)
+            return false;
+         sources[i].meta = rdb->crcs[idx];
+      }
+   }
+
+   return true;
+}
+
+/* Fills in the fields of every playlist entry referencing
+ * @rdb from the cache. Returns false if the RDB has to be
+ * scanned instead */
+static bool explore_cache_lookup(explore_cache_rdb_t *cache,
+      struct explore_rdb *rdb, bool *dirty)
+{
+   size_t i, cap;
+   ptrdiff_t idx;
+   const explore_cache_rdb_t *cached = NULL;
+
+   if (!rdb->size || (idx = RHMAP_IDX_STR(cache, rdb->path)) == -1)
+      return false;
+
+   cached = &cache[idx];
+   if (     cached->size     == rdb->size
+         && cached->mtime    == rdb->mtime
+         && explore_cache_lookup_sources(rdb->playlist_crcs, cached, false)
+         && explore_cache_lookup_sources(rdb->playlist_names, cached, true))
+   {
+      /* Drop entries no longer in any playlist */
+      if (cached->count != RHMAP_LEN(rdb->playlist_crcs)
+            + RHMAP_LEN(rdb->playlist_names))
+         *dirty = true;
+      return true;
+   }
+
+   for (i = 0, cap = RHMAP_CAP(rdb->playlist_crcs); i != cap; i++)
+      rdb->playlist_crcs[i].meta  = NULL;
+   for (i = 0, cap = RHMAP_CAP(rdb->playlist_names); i != cap; i++)
+      rdb->playlist_names[i].meta = NULL;
+   return false;
+}
+
+static void explore_cache_put(char **out, const void *data, size_t len)
+{
+   char *buf   = *out;
+   size_t size = RBUF_LEN(buf);
+
+   RBUF_RESIZE(buf, size + len);
+   memcpy(buf + size, data, len);
+   *out        = buf;
+}
+
+static void explore_cache_put_u32(char **out, uint32_t val)
+{
+   val = retro_cpu_to_le32(val);
+   explore_cache_put(out, &val, sizeof(val));
+}
+
+static void explore_cache_put_meta(char **out, uint32_t crc32,
+      const char *name, const explore_meta_t *meta)
+{
+   unsigned cat;
+   uint32_t mask = 0;
+
+   explore_cache_put_u32(out, crc32);
+
+   if (!meta || meta == &explore_meta_missing)
+      mask = EXPLORE_CACHE_MISSING;
+   else
+   {
+      for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+         if (meta->fields[cat])
+            mask |= (1u << cat);
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+      if (meta->original_title)
+         mask |= EXPLORE_CACHE_TITLE;
+#endif
+   }
+
+   explore_cache_put_u32(out, mask);
+   if (!crc32)
+      explore_cache_put(out, name, strlen(name) + 1);
+
+   if (mask == EXPLORE_CACHE_MISSING)
+      return;
+
+   for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+      if (meta->fields[cat])
+         explore_cache_put(out, meta->fields[cat],
+               strlen(meta->fields[cat]) + 1);
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+   if (meta->original_title)
+      explore_cache_put(out, meta->original_title,
+            strlen(meta->original_title) + 1);
+#endif
+}
+
+static void explore_cache_write(const char *path, struct explore_rdb *rdbs)
+{
+   size_t i, j, cap;
+   char *out      = NULL;
+   uint32_t count = 0;
+
+   for (i = 0; i != RBUF_LEN(rdbs); i++)
+      if (rdbs[i].size)
+         count++;
+
+   explore_cache_put(&out, EXPLORE_CACHE_MAGIC, EXPLORE_CACHE_MAGIC_LEN);
+   explore_cache_put_u32(&out, count);
+
+   for (i = 0; i != RBUF_LEN(rdbs); i++)
+   {
+      struct explore_rdb *rdb = &rdbs[i];
+
+      if (!rdb->size)
+         continue;
+
+      explore_cache_put(&out, rdb->path, strlen(rdb->path) + 1);
+      explore_cache_put_u32(&out, rdb->size);
+      explore_cache_put_u32(&out, rdb->mtime);
+      explore_cache_put_u32(&out, (uint32_t)(
+               RHMAP_LEN(rdb->playlist_crcs)
+             + RHMAP_LEN(rdb->playlist_names)));
+
+      for (j = 0, cap = RHMAP_CAP(rdb->playlist_crcs); j != cap; j++)
+         if (RHMAP_KEY(rdb->playlist_crcs, j))
+            explore_cache_put_meta(&out,
+                  RHMAP_KEY(rdb->playlist_crcs, j), NULL,
+                  rdb->playlist_crcs[j].meta);
+      for (j = 0, cap = RHMAP_CAP(rdb->playlist_names); j != cap; j++)
+         if (RHMAP_KEY(rdb->playlist_names, j))
+            explore_cache_put_meta(&out, 0,
+                  RHMAP_KEY_STR(rdb->playlist_names, j),
+                  rdb->playlist_names[j].meta);
+   }
+
+   if (!filestream_write_file(path, out, RBUF_LEN(out)))
+      RARCH_ERR("[Explore]: Failed to write cache file: \"%s\".\n", path);
+   RBUF_FREE(out);
+}
+
 explore_state_t *menu_explore_build_list(const char *directory_playlist,
       const char *directory_database)
 {
    unsigned i;
    char tmp[PATH_MAX_LENGTH];
-   struct explore_source
-   {
-      const struct playlist_entry *source;
-      uint32_t entry_index, meta_count;
-   };
-   struct explore_rdb
-   {
-      libretrodb_t *handle;
-      struct explore_source *playlist_crcs;
-      struct explore_source *playlist_names;
-      size_t count;
-      char systemname[NAME_MAX_LENGTH];
-   }
-   *rdbs                                          = NULL;
+   ex_arena cache_arena                           = {0};
+   struct explore_rdb *rdbs                       = NULL;
    int *rdb_indices                               = NULL;
    explore_string_t **cat_maps[EXPLORE_CAT_COUNT] = {NULL};
    explore_string_t **split_buf                   = NULL;
    libretro_vfs_implementation_dir *dir           = NULL;
+   explore_cache_rdb_t *cache                     = NULL;
+   void *cache_buf                                = NULL;
+   bool cache_dirty                               = false;
 
    explore_state_t *state = (explore_state_t*)calloc(1, sizeof(*state));
 
@@ -524,7 +965,7 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       {
          int rdb_num;
          uint32_t entry_crc32;
-         struct explore_source src = { NULL, (uint32_t)-1, 0 };
+         struct explore_source src = { NULL, NULL };
          struct explore_rdb* rdb             = NULL;
          const struct playlist_entry *entry  = NULL;
          const char *db_name                 = fname;
@@ -590,6 +1031,10 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
                continue;
             }
 
+            strlcpy(newrdb.path, tmp, sizeof(newrdb.path));
+            explore_cache_rdb_fingerprint(tmp,
+                  &newrdb.size, &newrdb.mtime);
+
             RBUF_PUSH(rdbs, newrdb);
             rdb_num = (int)RBUF_LEN(rdbs);
             RHMAP_SET(rdb_indices, rdb_hash, rdb_num);
@@ -620,14 +1065,32 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          playlist_free(playlist);
    }
 
+   fill_pathname_join_special(tmp, directory_playlist,
+         FILE_PATH_EXPLORE_CACHE, sizeof(tmp));
+   cache = explore_cache_read(tmp, &cache_arena, &cache_buf);
+   if (RHMAP_LEN(cache) != RBUF_LEN(rdbs))
+      cache_dirty = true;
+
    /* Loop through all RDBs referenced in the playlists
-    * and load meta data strings */
+    * and load meta data strings, unless all of them are
+    * in the cache already */
    for (i = 0; i != RBUF_LEN(rdbs); i++)
    {
       struct rmsgpack_dom_value item;
+      libretrodb_cursor_t *cur = NULL;
       struct explore_rdb* rdb  = &rdbs[i];
-      libretrodb_cursor_t *cur = libretrodb_cursor_new();
-      bool more                =
+      bool more                = false;
+
+      if (explore_cache_lookup(cache, rdb, &cache_dirty))
+      {
+         libretrodb_close(rdb->handle);
+         libretrodb_free(rdb->handle);
+         continue;
+      }
+
+      cache_dirty = true;
+      cur         = libretrodb_cursor_new();
+      more        =
          (
           libretrodb_cursor_open(rdb->handle, cur, NULL) == 0
           && libretrodb_cursor_read_item(cur, &item) == 0);
@@ -635,8 +1098,7 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       for (; more; more = (rmsgpack_dom_value_free(&item),
                libretrodb_cursor_read_item(cur, &item) == 0))
       {
-         unsigned k, l, cat;
-         explore_entry_t* e;
+         unsigned k, cat;
          const char *fields[EXPLORE_CAT_COUNT];
          char numeric_buf[EXPLORE_CAT_COUNT][16];
          uint32_t crc32                     = 0;
@@ -715,8 +1177,7 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
                {
                   if (val->type >= RDT_STRING)
                      break;
-                  fields[cat] = msg_hash_to_str(val->val.int_ ?
-                        MENU_ENUM_LABEL_VALUE_YES : MENU_ENUM_LABEL_VALUE_NO);
+                  fields[cat] = (val->val.int_ ? "1" : "0");
                   break;
                }
                if (val->type != RDT_STRING)
@@ -738,55 +1199,22 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          }
          if (!src)
             continue;
-         if (src->entry_index != (uint32_t)-1 && src->meta_count >= meta_count)
+         if (src->meta && src->meta->meta_count >= meta_count)
             continue;
 
-         if (src->entry_index == (uint32_t)-1)
-         {
-            src->entry_index = (uint32_t)RBUF_LEN(state->entries);
-            RBUF_RESIZE(state->entries, src->entry_index + 1);
-         }
-         e = &state->entries[src->entry_index];
-         src->meta_count = meta_count;
-         e->playlist_entry = src->source;
-         for (l = 0; l < EXPLORE_CAT_COUNT; l++)
-            e->by[l]       = NULL;
-         e->split          = NULL;
-#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         e->original_title = NULL;
-#endif
-
-         fields[EXPLORE_BY_SYSTEM] = rdb->systemname;
-
+         if (!src->meta)
+            src->meta = (explore_meta_t*)
+               ex_arena_alloc(&cache_arena, sizeof(explore_meta_t));
+         src->meta->meta_count = meta_count;
          for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
-         {
-            explore_add_unique_string(state,
-                  cat_maps, e, cat,
-                  fields[cat], &split_buf);
-         }
-
+            src->meta->fields[cat] = explore_cache_strdup(
+                  &cache_arena, fields[cat]);
+         src->meta->fields[EXPLORE_BY_SYSTEM] = NULL;
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         if (original_title && *original_title)
-         {
-            size_t len        = strlen(original_title) + 1;
-            e->original_title = (char*)
-               ex_arena_alloc(&state->arena, len);
-            memcpy(e->original_title, original_title, len);
-         }
+         src->meta->original_title = explore_cache_strdup(
+               &cache_arena, original_title);
 #endif
 
-         if (RBUF_LEN(split_buf))
-         {
-            size_t len;
-
-            RBUF_PUSH(split_buf, NULL); /* terminator */
-            len        = RBUF_SIZEOF(split_buf);
-            e->split   = (explore_string_t **)
-               ex_arena_alloc(&state->arena, len);
-            memcpy(e->split, split_buf, len);
-            RBUF_CLEAR(split_buf);
-         }
-
          /* if all entries have found connections, we can leave early */
          if (--rdb->count == 0)
          {
@@ -799,9 +1227,31 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       libretrodb_cursor_free(cur);
       libretrodb_close(rdb->handle);
       libretrodb_free(rdb->handle);
+   }
+
+   if (cache_dirty)
+      explore_cache_write(tmp, rdbs);
+
+   for (i = 0; i != RBUF_LEN(rdbs); i++)
+   {
+      size_t j, cap;
+      struct explore_rdb* rdb = &rdbs[i];
+
+      for (j = 0, cap = RHMAP_CAP(rdb->playlist_crcs); j != cap; j++)
+         if (RHMAP_KEY(rdb->playlist_crcs, j))
+            explore_add_entry(state, cat_maps,
+                  &rdb->playlist_crcs[j], rdb->systemname, &split_buf);
+      for (j = 0, cap = RHMAP_CAP(rdb->playlist_names); j != cap; j++)
+         if (RHMAP_KEY(rdb->playlist_names, j))
+            explore_add_entry(state, cat_maps,
+                  &rdb->playlist_names[j], rdb->systemname, &split_buf);
+
       RHMAP_FREE(rdb->playlist_crcs);
       RHMAP_FREE(rdb->playlist_names);
    }
+   explore_cache_free(cache);
+   free(cache_buf);
+   ex_arena_free(&cache_arena);
    RBUF_FREE(split_buf);
    RHMAP_FREE(rdb_indices);
    RBUF_FREE(rdbs);
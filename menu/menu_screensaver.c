@@ -812,6 +812,7 @@ void menu_screensaver_frame(menu_screensaver_t *screensaver,
       /* Flush text and unbind font */
       if (screensaver->font_data.raster_block.carr.coords.vertices != 0)
       {
+         gfx_display_flush(p_disp);
          if (font->renderer && font->renderer->flush)
             font->renderer->flush(video_width, video_height, font->renderer_data);
          screensaver->font_data.raster_block.carr.coords.vertices = 0;
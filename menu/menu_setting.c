@@ -23092,6 +23092,55 @@ static bool setting_append_list(
                   SD_FLAG_NONE);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.netplay_udp_input,
+                  MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_INPUT,
+                  DEFAULT_NETPLAY_UDP_INPUT,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+            (*list)[list_info->index - 1].action_ok     = &setting_bool_action_left_with_refresh;
+            (*list)[list_info->index - 1].action_left   = &setting_bool_action_left_with_refresh;
+            (*list)[list_info->index - 1].action_right  = &setting_bool_action_right_with_refresh;
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_udp_redundancy,
+                  MENU_ENUM_LABEL_NETPLAY_UDP_REDUNDANCY,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_REDUNDANCY,
+                  DEFAULT_NETPLAY_UDP_REDUNDANCY,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type = ST_UI_TYPE_UINT_SPINBOX;
+            menu_settings_list_current_add_range(list, list_info, 1, 8, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_snapshot_interval,
+                  MENU_ENUM_LABEL_NETPLAY_SNAPSHOT_INTERVAL,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_SNAPSHOT_INTERVAL,
+                  DEFAULT_NETPLAY_SNAPSHOT_INTERVAL,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type = ST_UI_TYPE_UINT_SPINBOX;
+            menu_settings_list_current_add_range(list, list_info, 0, 16, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
             CONFIG_UINT(
                   list, list_info,
                   &settings->uints.netplay_share_digital,
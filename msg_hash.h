@@ -2511,6 +2511,9 @@ enum msg_hash_enums
    MENU_LABEL(NETPLAY_MAX_CONNECTIONS),
    MENU_LABEL(NETPLAY_MAX_PING),
    MENU_LABEL(NETPLAY_NAT_TRAVERSAL),
+   MENU_LABEL(NETPLAY_UDP_INPUT),
+   MENU_LABEL(NETPLAY_UDP_REDUNDANCY),
+   MENU_LABEL(NETPLAY_SNAPSHOT_INTERVAL),
    MENU_LABEL(NETPLAY_REQUEST_DEVICE_I),
    MENU_LABEL(NETPLAY_PING_SHOW),
    MENU_ENUM_LABEL_NETPLAY_REQUEST_DEVICE_1,
@@ -81,6 +81,13 @@
 
 #include "netplay_private.h"
 
+#define XXH_INLINE_ALL
+#include "../../deps/xxHash/xxhash.h"
+
+#if defined(_WIN32) && !defined(_XBOX)
+#include <wincrypt.h>
+#endif
+
 #ifdef TCP_NODELAY
 #define SET_TCP_NODELAY(fd) \
    { \
@@ -142,6 +149,9 @@
 #define MITM_ADDR_MAGIC    0x52415441 /* RATA */
 #define MITM_PING_MAGIC    0x52415450 /* RATP */
 
+/* UDP input channel magic */
+#define UDP_INPUT_MAGIC    0x52415544 /* RAUD */
+
 #if 0
 /* Activate this to enable assertions on code sections
  * that should be exclusive to one modus */
@@ -714,8 +724,92 @@ static uint32_t simple_rand_uint32(unsigned long *simple_rand_next)
    return ((part0 << 30) + (part1 << 15) + part2);
 }
 
+/**
+ * netplay_random_uint32
+ *
+ * Returns 32 bits from the system's entropy source, for secrets that
+ * must not be predictable from the time of day (unlike the salts).
+ * Falls back to simple_rand if no entropy source is available.
+ */
+static uint32_t netplay_random_uint32(netplay_t *netplay)
+{
+   uint32_t value = 0;
+#if defined(_WIN32) && !defined(_XBOX)
+   HCRYPTPROV prov;
+
+   if (CryptAcquireContext(&prov, NULL, NULL, PROV_RSA_FULL,
+         CRYPT_VERIFYCONTEXT | CRYPT_SILENT))
+   {
+      BOOL ok = CryptGenRandom(prov, sizeof(value), (BYTE*)&value);
+      CryptReleaseContext(prov, 0);
+      if (ok)
+         return value;
+   }
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+   FILE *fp = fopen("/dev/urandom", "rb");
+
+   if (fp)
+   {
+      size_t read = fread(&value, 1, sizeof(value), fp);
+      fclose(fp);
+      if (read == sizeof(value))
+         return value;
+   }
+#endif
+
+   RARCH_WARN("[Netplay] No entropy source, UDP token is predictable.\n");
+   if (netplay->simple_rand_next == 1)
+      netplay->simple_rand_next = (unsigned long)cpu_features_get_time_usec();
+   return simple_rand_uint32(&netplay->simple_rand_next);
+}
+
+/* Points *addr at the IP address of sa; IPv4-mapped
+ * IPv6 addresses yield their IPv4 address */
+static size_t netplay_udp_host_addr(const struct sockaddr_storage *sa,
+      const uint8_t **addr)
+{
+   if (sa->ss_family == AF_INET)
+   {
+      *addr = (const uint8_t*)&((const struct sockaddr_in*)sa)->sin_addr;
+      return 4;
+   }
+#ifdef HAVE_INET6
+   if (sa->ss_family == AF_INET6)
+   {
+      static const uint8_t mapped[12] =
+         { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+      *addr = (const uint8_t*)&((const struct sockaddr_in6*)sa)->sin6_addr;
+      if (!memcmp(*addr, mapped, sizeof(mapped)))
+      {
+         *addr += sizeof(mapped);
+         return 4;
+      }
+      return 16;
+   }
+#endif
+   return 0;
+}
+
+/**
+ * netplay_udp_same_host
+ *
+ * Do both addresses belong to the same host? Ports are not compared.
+ */
+static bool netplay_udp_same_host(const struct sockaddr_storage *a,
+      const struct sockaddr_storage *b)
+{
+   const uint8_t *addr_a = NULL;
+   const uint8_t *addr_b = NULL;
+   size_t len_a          = netplay_udp_host_addr(a, &addr_a);
+   size_t len_b          = netplay_udp_host_addr(b, &addr_b);
+
+   return len_a && len_a == len_b && !memcmp(addr_a, addr_b, len_a);
+}
+
 static void netplay_send_cmd_netpacket(netplay_t *netplay, size_t conn_i,
       const void* buf, size_t len, uint16_t client_id);
+static void netplay_send_keyframe(netplay_t *netplay,
+      retro_ctx_serialize_info_t *serial_info);
 static void RETRO_CALLCONV netplay_netpacket_send_cb(int flags,
       const void* buf, size_t len, uint16_t client_id);
 static void RETRO_CALLCONV netplay_netpacket_poll_receive_cb(void);
@@ -877,6 +971,8 @@ static void send_info_and_disconnect(netplay_t *netplay,
    connection->flags &= ~NETPLAY_CONN_FLAG_ACTIVE;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   free(connection->udp);
+   connection->udp = NULL;
 }
 
 static uint32_t select_protocol(uint32_t lo_protocol, uint32_t hi_protocol)
@@ -1158,6 +1254,7 @@ static void netplay_handshake_ready(netplay_t *netplay,
          slot);
 
       /* Send them the savestate */
+      connection->flags            |= NETPLAY_CONN_FLAG_NEEDS_KEYFRAME;
       netplay->force_send_savestate = true;
    }
    else
@@ -1958,6 +2055,18 @@ static bool netplay_handshake_pre_sync(netplay_t *netplay,
 
    netplay->next_ping = cpu_features_get_time_usec() + NETPLAY_PING_AFTER;
 
+   /* Ask for per-block state hashes instead of CRCs */
+   if (     netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC
+         && netplay->local_hashes)
+      netplay_send_raw_cmd(netplay, connection,
+         NETPLAY_CMD_STATE_HASH_REQUEST, NULL, 0);
+
+   /* Ask for an additional UDP input channel */
+   if (     netplay->udp_input
+         && netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC)
+      netplay_send_raw_cmd(netplay, connection,
+         NETPLAY_CMD_UDP_REQUEST, NULL, 0);
+
    /* Tell a core that uses the netpacket interface that the client is ready */
    if (networking_driver_st.core_netpacket_interface &&
          networking_driver_st.core_netpacket_interface->start)
@@ -2055,6 +2164,65 @@ static void clear_input(netplay_input_state_t istate)
    }
 }
 
+/**
+ * netplay_find_snapshot
+ * @netplay              : pointer to netplay object
+ * @ptr                  : in: the frame to start from, out: the snapshot
+ * @frame_count          : frame number matching @ptr
+ *
+ * Look back for the newest serialized frame at or before @ptr.
+ *
+ * Returns true if there is one.
+ */
+static bool netplay_find_snapshot(netplay_t *netplay, size_t *ptr,
+      uint32_t *frame_count)
+{
+   size_t i;
+   size_t tmp_ptr     = *ptr;
+   uint32_t tmp_count = *frame_count;
+
+   for (i = 0; i < netplay->buffer_size; i++)
+   {
+      struct delta_frame *delta = &netplay->buffer[tmp_ptr];
+
+      if (!delta->used || delta->frame != tmp_count)
+         return false;
+
+      if (delta->have_state)
+      {
+         *ptr         = tmp_ptr;
+         *frame_count = tmp_count;
+         return true;
+      }
+
+      tmp_ptr = PREV_PTR(tmp_ptr);
+      tmp_count--;
+   }
+
+   return false;
+}
+
+/**
+ * netplay_delta_frame_wants_state
+ *
+ * Should this frame be serialized? Apart from every snapshot_interval-th
+ * frame, that's those whose state gets checked against the server's.
+ */
+static bool netplay_delta_frame_wants_state(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   if (netplay->snapshot_interval <= 1)
+      return true;
+   if ((delta->frame % netplay->snapshot_interval) == 0)
+      return true;
+   if (netplay->check_frames && (delta->frame % netplay->check_frames) == 0)
+      return true;
+   if (delta->crc)
+      return true;
+   return netplay->remote_hashes_pending
+      && netplay->remote_hash_frame == delta->frame;
+}
+
 /**
  * netplay_delta_frame_ready
  *
@@ -2076,11 +2244,21 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
        * so we can't overwrite it! */
       if (netplay->other_frame_count <= delta->frame)
          return false;
+      /* Nor the snapshot a rewind would have to start from */
+      if (delta->have_state)
+      {
+         size_t snap_ptr       = netplay->other_ptr;
+         uint32_t snap_frame   = netplay->other_frame_count;
+         if (     netplay_find_snapshot(netplay, &snap_ptr, &snap_frame)
+               && &netplay->buffer[snap_ptr] == delta)
+            return false;
+      }
    }
 
-   delta->used  = true;
-   delta->frame = frame;
-   delta->crc   = 0;
+   delta->used       = true;
+   delta->frame      = frame;
+   delta->crc        = 0;
+   delta->have_state = false;
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
@@ -2110,6 +2288,77 @@ static uint32_t netplay_delta_frame_crc(netplay_t *netplay,
          netplay->state_size);
 }
 
+/**
+ * netplay_state_hash_blocks
+ *
+ * Get the number of blocks savestates are hashed in, and their size.
+ */
+static uint32_t netplay_state_hash_blocks(netplay_t *netplay,
+      size_t *block_size)
+{
+   size_t size = NETPLAY_STATE_HASH_BLOCK_SIZE;
+
+   while (netplay->state_size > size * NETPLAY_STATE_HASH_MAX_BLOCKS)
+      size <<= 1;
+
+   *block_size = size;
+   return (uint32_t)((netplay->state_size + size - 1) / size);
+}
+
+/**
+ * netplay_delta_frame_hashes
+ *
+ * Hash the serialization of this frame block by block.
+ *
+ * Returns the number of hashes written to @hashes.
+ */
+static uint32_t netplay_delta_frame_hashes(netplay_t *netplay,
+      struct delta_frame *delta, uint64_t *hashes)
+{
+   size_t block_size;
+   uint32_t i;
+   const uint8_t *state = (const uint8_t*)delta->state;
+   uint32_t count       = netplay_state_hash_blocks(netplay, &block_size);
+
+   for (i = 0; i < count; i++)
+   {
+      size_t offset = i * block_size;
+      size_t len    = netplay->state_size - offset;
+
+      if (len > block_size)
+         len = block_size;
+
+      hashes[i] = XXH3_64bits(state + offset, len);
+   }
+
+   return count;
+}
+
+/**
+ * netplay_find_delta_frame
+ *
+ * Look for a frame that's still in the buffer.
+ */
+static bool netplay_find_delta_frame(netplay_t *netplay, uint32_t frame,
+      size_t *ptr)
+{
+   size_t tmp_ptr = netplay->run_ptr;
+
+   do
+   {
+      if (     netplay->buffer[tmp_ptr].used
+            && netplay->buffer[tmp_ptr].frame == frame)
+      {
+         *ptr = tmp_ptr;
+         return true;
+      }
+
+      tmp_ptr = PREV_PTR(tmp_ptr);
+   } while (tmp_ptr != netplay->run_ptr);
+
+   return false;
+}
+
 /*
  * Free an input state list
  */
@@ -2652,6 +2901,7 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    for (i = 0; i < netplay->connections_size; i++)
    {
       if (     (netplay->connections[i].flags & NETPLAY_CONN_FLAG_ACTIVE)
+            && !(netplay->connections[i].flags & NETPLAY_CONN_FLAG_STATE_HASHES)
             && (netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED))
          success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
             NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
@@ -2659,6 +2909,159 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    return success;
 }
 
+/**
+ * netplay_cmd_state_hash
+ *
+ * Send the per-block state hashes of a frame to all clients that
+ * asked for them.
+ */
+static bool netplay_cmd_state_hash(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   size_t i, block_size;
+   uint32_t j, count;
+   uint32_t header[4];
+   uint32_t *words = (uint32_t*)netplay->local_hashes;
+   bool success    = true;
+   NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+   count = netplay_delta_frame_hashes(netplay, delta, netplay->local_hashes);
+   netplay_state_hash_blocks(netplay, &block_size);
+
+   /* Each hash becomes two big-endian words in place */
+   for (j = 0; j < count; j++)
+   {
+      uint64_t hash    = netplay->local_hashes[j];
+      words[j * 2]     = htonl((uint32_t)(hash >> 32));
+      words[j * 2 + 1] = htonl((uint32_t)hash);
+   }
+
+   header[0] = htonl(NETPLAY_CMD_STATE_HASH);
+   header[1] = htonl(2 * sizeof(uint32_t) + count * sizeof(uint64_t));
+   header[2] = htonl(delta->frame);
+   header[3] = htonl((uint32_t)block_size);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (  (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
+          ||  !(connection->flags & NETPLAY_CONN_FLAG_STATE_HASHES)
+          ||  (connection->mode  < NETPLAY_CONNECTION_CONNECTED))
+         continue;
+
+      success = netplay_send(&connection->send_packet_buffer,
+            connection->fd, header, sizeof(header))
+         && netplay_send(&connection->send_packet_buffer,
+            connection->fd, words, count * sizeof(uint64_t))
+         && success;
+   }
+
+   return success;
+}
+
+/**
+ * netplay_cmd_request_blocks
+ *
+ * Ask the server for the blocks of a frame's state that failed to match.
+ */
+static bool netplay_cmd_request_blocks(netplay_t *netplay, uint32_t frame,
+      const uint32_t *bitmap, uint32_t words)
+{
+   uint32_t payload[1 + NETPLAY_STATE_HASH_MAX_BLOCKS / 32];
+   uint32_t i;
+
+   if (     (netplay->connections_size == 0)
+       || (!(netplay->connections[0].flags & NETPLAY_CONN_FLAG_ACTIVE))
+       ||   (netplay->connections[0].mode  < NETPLAY_CONNECTION_CONNECTED))
+      return false;
+   if (netplay->savestate_request_outstanding)
+      return true;
+   netplay->savestate_request_outstanding = true;
+
+   payload[0] = htonl(frame);
+   for (i = 0; i < words; i++)
+      payload[1 + i] = htonl(bitmap[i]);
+
+   return netplay_send_raw_cmd(netplay, &netplay->connections[0],
+      NETPLAY_CMD_REQUEST_BLOCKS, payload, (1 + words) * sizeof(uint32_t));
+}
+
+/**
+ * netplay_send_state_blocks
+ * @netplay              : pointer to netplay object
+ * @connection           : the client that asked for them
+ * @delta                : the frame to send blocks of
+ * @bitmap               : the blocks to send
+ *
+ * Send the requested blocks of a frame's state, compressed as one piece.
+ */
+static bool netplay_send_state_blocks(netplay_t *netplay,
+      struct netplay_connection *connection, struct delta_frame *delta,
+      const uint32_t *bitmap)
+{
+   uint32_t header[5];
+   uint32_t wire_bitmap[NETPLAY_STATE_HASH_MAX_BLOCKS / 32];
+   uint32_t i, count, words, rd, wn;
+   size_t block_size;
+   size_t gathered                       = 0;
+   const uint8_t *state                  = (const uint8_t*)delta->state;
+   struct compression_transcoder *ctrans = NULL;
+
+   count = netplay_state_hash_blocks(netplay, &block_size);
+   words = (count + 31) / 32;
+
+   for (i = 0; i < count; i++)
+   {
+      size_t offset, len;
+
+      if (!(bitmap[i / 32] & (1U << (i % 32))))
+         continue;
+
+      offset = i * block_size;
+      len    = netplay->state_size - offset;
+      if (len > block_size)
+         len = block_size;
+
+      memcpy(netplay->block_buffer + gathered, state + offset, len);
+      gathered += len;
+      netplay->state_blocks_resent++;
+   }
+
+   for (i = 0; i < words; i++)
+      wire_bitmap[i] = htonl(bitmap[i]);
+
+   switch (connection->compression_supported)
+   {
+      case NETPLAY_COMPRESSION_ZLIB:
+         ctrans = &netplay->compress_zlib;
+         break;
+      default:
+         ctrans = &netplay->compress_nil;
+         break;
+   }
+
+   ctrans->compression_backend->set_in(ctrans->compression_stream,
+      netplay->block_buffer, (uint32_t)gathered);
+   ctrans->compression_backend->set_out(ctrans->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   if (!ctrans->compression_backend->trans(ctrans->compression_stream,
+         true, &rd, &wn, NULL))
+      return false;
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_BLOCKS);
+   header[1] = htonl(3 * sizeof(uint32_t) + words * sizeof(uint32_t) + wn);
+   header[2] = htonl(delta->frame);
+   header[3] = htonl((uint32_t)netplay->state_size);
+   header[4] = htonl((uint32_t)block_size);
+
+   return netplay_send(&connection->send_packet_buffer, connection->fd,
+            header, sizeof(header))
+      && netplay_send(&connection->send_packet_buffer, connection->fd,
+            wire_bitmap, words * sizeof(uint32_t))
+      && netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->zbuffer, wn);
+}
+
 /**
  * netplay_cmd_request_savestate
  *
@@ -3164,21 +3567,126 @@ static bool netplay_resolve_input(netplay_t *netplay,
    return ret;
 }
 
+/**
+ * netplay_check_state_hashes
+ *
+ * Compare a frame's state against the server's per-block hashes,
+ * and ask for only the blocks that differ.
+ */
+static void netplay_check_state_hashes(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   uint32_t bitmap[NETPLAY_STATE_HASH_MAX_BLOCKS / 32];
+   size_t block_size;
+   uint32_t i, count;
+   uint32_t differing = 0;
+   uint32_t runs      = 0;
+
+   netplay->remote_hashes_pending = false;
+
+   if (!delta->have_state)
+      return;
+
+   count = netplay_delta_frame_hashes(netplay, delta, netplay->local_hashes);
+   netplay_state_hash_blocks(netplay, &block_size);
+
+   memset(bitmap, 0, sizeof(bitmap));
+   for (i = 0; i < count; i++)
+   {
+      if (netplay->local_hashes[i] != netplay->remote_hashes[i])
+      {
+         bitmap[i / 32] |= 1U << (i % 32);
+         differing++;
+      }
+   }
+
+   if (!differing)
+   {
+      netplay->crc_validity_checked = true;
+      return;
+   }
+
+   /* If the very first check frame is wrong,
+      they probably just don't work. */
+   if (!netplay->crc_validity_checked)
+   {
+      netplay->crcs_valid = false;
+      return;
+   }
+
+   RARCH_WARN("[Netplay] State desync at frame %u: %u of %u blocks differ.\n",
+      delta->frame, differing, count);
+
+   /* Log the diverged regions, to help tell what part of the core's
+    * state isn't deterministic */
+   for (i = 0; i < count && runs < 8; i++)
+   {
+      uint32_t first = i;
+
+      if (!(bitmap[i / 32] & (1U << (i % 32))))
+         continue;
+
+      while (i + 1 < count && (bitmap[(i + 1) / 32] & (1U << ((i + 1) % 32))))
+         i++;
+
+      RARCH_LOG("[Netplay] Diverged: 0x%08lX-0x%08lX.\n",
+         (unsigned long)(first * block_size),
+         (unsigned long)(MIN((i + 1) * block_size, netplay->state_size) - 1));
+      runs++;
+   }
+
+   if (netplay->check_frames)
+      netplay_cmd_request_blocks(netplay, delta->frame, bitmap,
+         (count + 31) / 32);
+}
+
 static void netplay_handle_frame_hash(netplay_t *netplay,
       struct delta_frame *delta)
 {
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+   /* We can't check a frame we didn't serialize */
+   if (netplay->state_size && !delta->have_state)
+      return;
+
    if (netplay->is_server)
    {
       if (netplay->check_frames && (delta->frame % netplay->check_frames) == 0)
       {
-         delta->crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
-         netplay_cmd_crc(netplay, delta);
+         size_t i;
+         bool want_crc    = false;
+         bool want_hashes = false;
+
+         for (i = 0; i < netplay->connections_size; i++)
+         {
+            struct netplay_connection *connection = &netplay->connections[i];
+            if (  (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
+                ||  (connection->mode  < NETPLAY_CONNECTION_CONNECTED))
+               continue;
+            if (connection->flags & NETPLAY_CONN_FLAG_STATE_HASHES)
+               want_hashes = true;
+            else
+               want_crc    = true;
+         }
+
+         /* Only hash the state the ways our clients need it */
+         if (want_crc)
+         {
+            delta->crc = netplay->state_size ?
+               netplay_delta_frame_crc(netplay, delta) : 0;
+            netplay_cmd_crc(netplay, delta);
+         }
+         if (want_hashes && netplay->local_hashes)
+            netplay_cmd_state_hash(netplay, delta);
       }
    }
    else
    {
+      if (     netplay->crcs_valid
+            && netplay->remote_hashes_pending
+            && netplay->remote_hash_frame == delta->frame)
+         netplay_check_state_hashes(netplay, delta);
+
       if (netplay->crcs_valid && delta->crc)
       {
          /* We have a remote CRC, so check it. */
@@ -3637,6 +4145,21 @@ static struct netplay_connection *allocate_connection(netplay_t *netplay)
    return connection;
 }
 
+/**
+ * netplay_keyframe_is_local
+ * @netplay              : pointer to netplay object
+ *
+ * Can the frame we're about to run be sent as is to just the peers that
+ * want it? Only if our input isn't ahead of it and everyone's input up to
+ * it has arrived. Otherwise loading it skips us ahead or drops late input,
+ * and every peer has to load it along with us.
+ */
+static bool netplay_keyframe_is_local(netplay_t *netplay)
+{
+   return netplay->run_ptr == netplay->self_ptr
+      && netplay->unread_frame_count >= netplay->run_frame_count;
+}
+
 /**
  * netplay_sync_pre_frame
  * @netplay              : pointer to netplay object
@@ -3651,37 +4174,72 @@ static bool netplay_sync_pre_frame(netplay_t *netplay)
        netplay->run_frame_count > 0 && netplay_delta_frame_ready(netplay,
             &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
    {
+      struct delta_frame *delta = &netplay->buffer[netplay->run_ptr];
+
       /* Don't serialize until it's safe. */
-      if (!(netplay->quirks & NETPLAY_QUIRK_INITIALIZATION))
+      if (netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
+         delta->have_state = false;
+      /* Rewinds replay from the previous snapshot instead */
+      else if (!netplay->force_send_savestate
+            && !netplay_delta_frame_wants_state(netplay, delta))
+         delta->have_state = false;
+      else
       {
          retro_ctx_serialize_info_t serial_info = {0};
+         retro_time_t start                     = cpu_features_get_time_usec();
 
-         serial_info.data = netplay->buffer[netplay->run_ptr].state;
+         serial_info.data = delta->state;
          serial_info.size = netplay->state_size;
          memset(serial_info.data, 0, serial_info.size);
-         if (core_serialize_special(&serial_info))
+         delta->have_state = core_serialize_special(&serial_info);
+
+         netplay->serialize_time_sum += cpu_features_get_time_usec() - start;
+         netplay->serialize_count++;
+
+         if (delta->have_state)
          {
             if (netplay->force_send_savestate && !netplay->stall &&
                   !netplay->remote_paused)
             {
-               /* Bring our running frame and input frames into
-                * parity so we don't send old info. */
-               if (netplay->run_ptr != netplay->self_ptr)
+               if (netplay_keyframe_is_local(netplay))
                {
-                  memcpy(netplay->buffer[netplay->self_ptr].state,
-                     netplay->buffer[netplay->run_ptr].state,
-                     netplay->state_size);
-                  netplay->run_ptr         = netplay->self_ptr;
-                  netplay->run_frame_count = netplay->self_frame_count;
+                  /* Only those waiting for it need to load it. */
+                  serial_info.data_const = delta->state;
+                  netplay_send_keyframe(netplay, &serial_info);
+
+                  netplay->keyframes_targeted++;
+                  netplay->force_send_savestate = false;
                }
+               /* Give late input a few frames to arrive first. */
+               else if (netplay->run_ptr == netplay->self_ptr &&
+                     ++netplay->keyframe_wait < NETPLAY_KEYFRAME_MAX_WAIT)
+                  ;
+               else
+               {
+                  /* Bring our running frame and input frames into
+                   * parity so we don't send old info. */
+                  if (netplay->run_ptr != netplay->self_ptr)
+                  {
+                     memcpy(netplay->buffer[netplay->self_ptr].state,
+                        netplay->buffer[netplay->run_ptr].state,
+                        netplay->state_size);
+                     netplay->buffer[netplay->self_ptr].have_state = true;
+                     netplay->run_ptr         = netplay->self_ptr;
+                     netplay->run_frame_count = netplay->self_frame_count;
+                  }
 
-               /* Send this along to the other side. */
-               serial_info.data_const =
-                  netplay->buffer[netplay->run_ptr].state;
+                  /* Send this along to the other side. */
+                  serial_info.data_const =
+                     netplay->buffer[netplay->run_ptr].state;
 
-               netplay_load_savestate(netplay, &serial_info, false);
+                  netplay_load_savestate(netplay, &serial_info, false);
 
-               netplay->force_send_savestate = false;
+                  netplay->keyframes_broadcast++;
+                  netplay->force_send_savestate = false;
+               }
+
+               if (!netplay->force_send_savestate)
+                  netplay->keyframe_wait = 0;
             }
          }
          else
@@ -3761,14 +4319,54 @@ process:
 }
 
 /**
- * netplay_sync_input_post_frame
- * @netplay              : pointer to netplay object
- * @stalled              : true if we're currently stalled
+ * netplay_tune_snapshot_interval
  *
- * Post-frame for Netplay synchronization.
- * We check if we have new input and replay from recorded input.
+ * Pick the snapshot interval with the least expected time spent per frame:
+ * serializing one frame in every N, against replaying (N - 1) / 2 more
+ * frames on average in every rewind.
  */
-static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
+static void netplay_tune_snapshot_interval(netplay_t *netplay)
+{
+   uint32_t n;
+   double serialize, replay, rewind_rate;
+   uint32_t best    = 1;
+   double best_cost = 0;
+
+   if (!netplay->serialize_count || !netplay->replay_count)
+      return;
+
+   serialize   = (double)netplay->serialize_time_sum / netplay->serialize_count;
+   replay      = (double)netplay->replay_time_sum    / netplay->replay_count;
+   rewind_rate = (double)netplay->rewinds / netplay->run_frame_count;
+
+   for (n = 1; n <= NETPLAY_MAX_SNAPSHOT_INTERVAL; n++)
+   {
+      double cost = serialize / n + rewind_rate * replay * (n - 1) / 2;
+      if (n == 1 || cost < best_cost)
+      {
+         best      = n;
+         best_cost = cost;
+      }
+   }
+
+   if (best != netplay->snapshot_interval)
+   {
+      RARCH_LOG("[Netplay] Snapshot interval %u -> %u (serialize %.0fus, "
+         "replay %.0fus per frame, %.3f rewinds per frame).\n",
+         netplay->snapshot_interval, best, serialize, replay, rewind_rate);
+      netplay->snapshot_interval = best;
+   }
+}
+
+/**
+ * netplay_sync_input_post_frame
+ * @netplay              : pointer to netplay object
+ * @stalled              : true if we're currently stalled
+ *
+ * Post-frame for Netplay synchronization.
+ * We check if we have new input and replay from recorded input.
+ */
+static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 {
    uint32_t lo_frame_count, hi_frame_count;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
@@ -3778,6 +4376,10 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
    {
       netplay->run_ptr = NEXT_PTR(netplay->run_ptr);
       netplay->run_frame_count++;
+
+      if (     netplay->snapshot_auto
+            && (netplay->run_frame_count % NETPLAY_SNAPSHOT_TUNE_FRAMES) == 0)
+         netplay_tune_snapshot_interval(netplay);
    }
 
    /* We've finished an input frame even if we're stalling */
@@ -3861,9 +4463,20 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      size_t snap_ptr             = netplay->replay_ptr;
+      uint32_t rewind_frame_count = netplay->replay_frame_count;
 
       /* Replay frames. */
       netplay->is_replay = true;
+      netplay->rewinds++;
+
+      /* Not every frame is serialized. Start from the nearest snapshot
+       * and catch up to the rewind point with input we already had. */
+      if (netplay_find_snapshot(netplay, &netplay->replay_ptr,
+            &netplay->replay_frame_count))
+         snap_ptr = netplay->replay_ptr;
+      else
+         RARCH_ERR("[Netplay] No snapshot to rewind to: Prepare for desync!\n");
 
       /* If we have a keyboard device, we replay the previous frame's input
        * just to assert that the keydown/keyup events work if the core
@@ -3895,7 +4508,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 
       while (netplay->replay_frame_count < netplay->run_frame_count)
       {
-         retro_time_t start, tm;
+         retro_time_t start, mid, tm;
          struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
 
          serial_info.data_const  = NULL;
@@ -3904,12 +4517,27 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 
          start                   = cpu_features_get_time_usec();
 
-         /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         core_serialize_special(&serial_info);
+         /* Frames before the rewind point are unchanged */
+         if (netplay->replay_frame_count >= rewind_frame_count)
+         {
+            /* Remember the current state */
+            if (     netplay->replay_ptr == snap_ptr
+                  || netplay_delta_frame_wants_state(netplay, ptr))
+            {
+               memset(serial_info.data, 0, serial_info.size);
+               ptr->have_state = core_serialize_special(&serial_info);
+               netplay->serialize_time_sum +=
+                  cpu_features_get_time_usec() - start;
+               netplay->serialize_count++;
+            }
+            else
+               ptr->have_state = false;
 
-         if (netplay->replay_frame_count < netplay->unread_frame_count)
-            netplay_handle_frame_hash(netplay, ptr);
+            if (netplay->replay_frame_count < netplay->unread_frame_count)
+               netplay_handle_frame_hash(netplay, ptr);
+         }
+
+         mid = cpu_features_get_time_usec();
 
          /* Re-simulate this frame's input */
          netplay_resolve_input(netplay, netplay->replay_ptr, true);
@@ -3921,6 +4549,8 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 #ifdef HAVE_THREADS
          autosave_unlock();
 #endif
+         netplay->replay_time_sum += cpu_features_get_time_usec() - mid;
+         netplay->replay_count++;
          netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
          netplay->replay_frame_count++;
 
@@ -4300,6 +4930,212 @@ static void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
+/**
+ * netplay_udp_init_socket
+ *
+ * Open the socket used by the UDP input channel.
+ * Servers listen on their TCP port + 1,
+ * clients send from an ephemeral port.
+ *
+ * Returns the socket or -1 on failure.
+ */
+static int netplay_udp_init_socket(bool is_server, int family, uint16_t port)
+{
+   struct addrinfo *addr = NULL;
+   int fd                = socket_init((void**)&addr, port, NULL,
+      SOCKET_TYPE_DATAGRAM, family);
+
+   if (fd >= 0 && addr)
+   {
+#if defined(HAVE_INET6) && defined(IPV6_V6ONLY)
+      if (addr->ai_family == AF_INET6)
+      {
+         int on = 0;
+
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY,
+            (const char*)&on, sizeof(on));
+      }
+#endif
+
+      if ((!is_server || socket_bind(fd, addr)) && socket_nonblock(fd))
+      {
+         SET_FD_CLOEXEC(fd)
+         freeaddrinfo_retro(addr);
+         return fd;
+      }
+   }
+
+   if (fd >= 0)
+      socket_close(fd);
+   if (addr)
+      freeaddrinfo_retro(addr);
+
+   return -1;
+}
+
+/**
+ * netplay_udp_acked
+ *
+ * Has the peer acknowledged receiving the datagram with this sequence number?
+ */
+static bool netplay_udp_acked(uint32_t ack, uint32_t ack_bits, uint32_t seq)
+{
+   if (seq == ack)
+      return true;
+   if (seq > ack || ack - seq > 32)
+      return false;
+   return (ack_bits & (1U << (ack - seq - 1))) != 0;
+}
+
+/**
+ * netplay_udp_handle_ack
+ *
+ * Drop every pending entry the peer has confirmed receiving.
+ */
+static void netplay_udp_handle_ack(struct netplay_udp_channel *udp,
+      uint32_t ack, uint32_t ack_bits)
+{
+   size_t i, j;
+
+   for (i = j = 0; i < udp->pending_count; i++)
+   {
+      struct netplay_udp_entry *entry = &udp->pending[i];
+      bool delivered                  = false;
+
+      if (entry->sends)
+      {
+         uint32_t seq;
+
+         for (seq = entry->first_seq; seq <= entry->last_seq; seq++)
+         {
+            if (netplay_udp_acked(ack, ack_bits, seq))
+            {
+               delivered = true;
+               break;
+            }
+         }
+      }
+
+      if (!delivered)
+      {
+         if (i != j)
+            udp->pending[j] = *entry;
+         j++;
+      }
+   }
+
+   udp->pending_count = j;
+}
+
+/**
+ * netplay_udp_queue
+ *
+ * Queue an input message for delivery over the UDP input channel.
+ * If the queue is full, the oldest entry is dropped;
+ * it is still delivered over TCP.
+ */
+static void netplay_udp_queue(struct netplay_connection *connection,
+      const uint32_t *msg, size_t size)
+{
+   struct netplay_udp_entry *entry;
+   struct netplay_udp_channel *udp = connection->udp;
+
+   if (!udp || !udp->has_addr || size > NETPLAY_UDP_ENTRY_WORDS)
+      return;
+
+   if (udp->pending_count >= NETPLAY_UDP_MAX_ENTRIES)
+   {
+      memmove(&udp->pending[0], &udp->pending[1],
+         (NETPLAY_UDP_MAX_ENTRIES - 1) * sizeof(udp->pending[0]));
+      udp->pending_count--;
+   }
+
+   entry        = &udp->pending[udp->pending_count++];
+   entry->sends = 0;
+   entry->size  = (uint32_t)size;
+   memcpy(entry->data, msg, size * sizeof(uint32_t));
+
+   udp->dirty   = true;
+}
+
+/**
+ * netplay_udp_flush
+ *
+ * Send a datagram carrying every pending input message along with
+ * our acknowledgements, if there is anything worth sending.
+ * Each message is repeated in up to udp_redundancy datagrams.
+ */
+static void netplay_udp_flush(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   size_t i, j;
+   uint32_t seq;
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+   size_t bufused                  = NETPLAY_UDP_HEADER_WORDS;
+   struct netplay_udp_channel *udp = connection->udp;
+
+   if (!udp || !udp->has_addr || !udp->dirty || netplay->udp_fd < 0)
+      return;
+
+   seq       = udp->send_seq++;
+   buffer[0] = htonl(UDP_INPUT_MAGIC);
+   buffer[1] = htonl(udp->token);
+   buffer[2] = htonl(seq);
+   buffer[3] = htonl(udp->recv_seq);
+   buffer[4] = htonl(udp->has_recv ? udp->recv_bits : 0);
+
+   for (i = 0; i < udp->pending_count; i++)
+   {
+      struct netplay_udp_entry *entry = &udp->pending[i];
+
+      memcpy(buffer + bufused, entry->data, entry->size * sizeof(uint32_t));
+      bufused += entry->size;
+
+      if (!entry->sends++)
+         entry->first_seq = seq;
+      entry->last_seq     = seq;
+   }
+
+   /* Unacknowledged datagrams are not retried; TCP has a copy. */
+   if (sendto(netplay->udp_fd, (const char*)buffer,
+         bufused * sizeof(uint32_t), 0,
+         (struct sockaddr*)&udp->addr, udp->addr_len) > 0)
+      netplay->udp_datagrams_sent++;
+
+   /* Forget entries that have been repeated often enough */
+   for (i = j = 0; i < udp->pending_count; i++)
+   {
+      if (udp->pending[i].sends >= netplay->udp_redundancy)
+         continue;
+      if (i != j)
+         udp->pending[j] = udp->pending[i];
+      j++;
+   }
+   udp->pending_count = j;
+
+   udp->dirty         = false;
+}
+
+/**
+ * netplay_udp_flush_all
+ *
+ * Flush the UDP input channel of every connection.
+ */
+static void netplay_udp_flush_all(netplay_t *netplay)
+{
+   size_t i;
+
+   if (netplay->udp_fd < 0)
+      return;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+         netplay_udp_flush(netplay, connection);
+   }
+}
+
 /* Send the specified input data */
 static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
       struct netplay_connection *only, struct netplay_connection *except,
@@ -4347,6 +5183,7 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
          netplay_hangup(netplay, only);
          return false;
       }
+      netplay_udp_queue(only, buffer, bufused);
    }
    else
    {
@@ -4363,6 +5200,8 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
             if (!netplay_send(&connection->send_packet_buffer, connection->fd,
                   buffer, bufused * sizeof(uint32_t)))
                netplay_hangup(netplay, connection);
+            else
+               netplay_udp_queue(connection, buffer, bufused);
          }
       }
    }
@@ -4429,6 +5268,9 @@ bool netplay_send_cur_input(netplay_t *netplay,
    if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
          false))
       return false;
+
+   netplay_udp_flush(netplay, connection);
+
    return true;
 }
 
@@ -5938,6 +6780,11 @@ static bool netplay_get_cmd(netplay_t *netplay,
                /* We've already replayed up to this frame, so we can check it
                 * directly */
                uint32_t local_crc = 0;
+
+               /* Unless it wasn't serialized */
+               if (netplay->state_size && !netplay->buffer[tmp_ptr].have_state)
+                  break;
+
                if (netplay->state_size)
                   local_crc       = netplay_delta_frame_crc(
                         netplay, &netplay->buffer[tmp_ptr]);
@@ -5957,6 +6804,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
          NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
          /* Delay until next frame so we don't send the savestate after the
           * input */
+         connection->flags            |= NETPLAY_CONN_FLAG_NEEDS_KEYFRAME;
          netplay->force_send_savestate = true;
          break;
 
@@ -6070,6 +6918,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
             ctrans->decompression_backend->trans(
                ctrans->decompression_stream,
                true, &rd, &wn, NULL);
+            netplay->buffer[load_ptr].have_state = true;
 
             /* Force a rewind to the relevant frame. */
             netplay->force_rewind = true;
@@ -6214,6 +7063,280 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_STATE_HASH_REQUEST:
+         NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+         if (!netplay->is_server)
+         {
+            RARCH_ERR("[Netplay] NETPLAY_CMD_STATE_HASH_REQUEST from a server.\n");
+            return netplay_cmd_nak(netplay, connection);
+         }
+
+         if (cmd_size)
+         {
+            RARCH_ERR("[Netplay] Unexpected payload in NETPLAY_CMD_STATE_HASH_REQUEST.\n");
+            return netplay_cmd_nak(netplay, connection);
+         }
+
+         connection->flags |= NETPLAY_CONN_FLAG_STATE_HASHES;
+         break;
+
+      case NETPLAY_CMD_STATE_HASH:
+         {
+            uint32_t buffer[2];
+            uint32_t i, count;
+            size_t block_size;
+            size_t tmp_ptr;
+            uint32_t *words = (uint32_t*)netplay->remote_hashes;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_STATE_HASH from a client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            count = netplay_state_hash_blocks(netplay, &block_size);
+            if (     !netplay->local_hashes
+                  || cmd_size != sizeof(buffer) + count * sizeof(uint64_t))
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_STATE_HASH received unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(buffer, sizeof(buffer))
+               return false;
+            RECV(words, count * sizeof(uint64_t))
+               return false;
+
+            buffer[0] = ntohl(buffer[0]);
+            buffer[1] = ntohl(buffer[1]);
+
+            if (buffer[1] != block_size)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_STATE_HASH with an unexpected block size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            for (i = 0; i < count; i++)
+               netplay->remote_hashes[i] =
+                     ((uint64_t)ntohl(words[i * 2]) << 32)
+                  |  (uint64_t)ntohl(words[i * 2 + 1]);
+
+            netplay->remote_hash_frame     = buffer[0];
+            netplay->have_remote_hashes    = true;
+            netplay->remote_hashes_pending = false;
+
+            /* Oh well, we got rid of it! */
+            if (!netplay_find_delta_frame(netplay, buffer[0], &tmp_ptr))
+               break;
+
+            /* We've already replayed up to this frame, so we can check it
+             * directly, or else we'll check it when we catch up */
+            if (buffer[0] <= netplay->other_frame_count)
+            {
+               if (netplay->crcs_valid)
+                  netplay_check_state_hashes(netplay,
+                     &netplay->buffer[tmp_ptr]);
+            }
+            else
+               netplay->remote_hashes_pending = true;
+
+            break;
+         }
+
+      case NETPLAY_CMD_REQUEST_BLOCKS:
+         {
+            uint32_t buffer[1 + NETPLAY_STATE_HASH_MAX_BLOCKS / 32];
+            uint32_t i, words;
+            size_t block_size;
+            size_t tmp_ptr;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (!netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_REQUEST_BLOCKS from a server.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            words = (netplay_state_hash_blocks(netplay, &block_size) + 31) / 32;
+            if (     !netplay->local_hashes
+                  || cmd_size != (1 + words) * sizeof(uint32_t))
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_REQUEST_BLOCKS received unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(buffer, cmd_size)
+               return false;
+
+            for (i = 0; i < 1 + words; i++)
+               buffer[i] = ntohl(buffer[i]);
+
+            /* Don't send it if we're expected to be desynced. */
+            if (netplay->desync)
+               break;
+
+            /* Too old to patch; fall back to a whole savestate */
+            if (     !netplay_find_delta_frame(netplay, buffer[0], &tmp_ptr)
+                  || !netplay->buffer[tmp_ptr].have_state
+                  || buffer[0] >= netplay->other_frame_count)
+            {
+               connection->flags            |= NETPLAY_CONN_FLAG_NEEDS_KEYFRAME;
+               netplay->force_send_savestate = true;
+               break;
+            }
+
+            if (!netplay_send_state_blocks(netplay, connection,
+                  &netplay->buffer[tmp_ptr], &buffer[1]))
+               return false;
+            break;
+         }
+
+      case NETPLAY_CMD_LOAD_BLOCKS:
+         {
+            uint32_t buffer[3];
+            uint32_t bitmap[NETPLAY_STATE_HASH_MAX_BLOCKS / 32];
+            uint32_t i, count, words, rd, wn;
+            size_t block_size;
+            size_t tmp_ptr;
+            size_t expected                       = 0;
+            size_t gathered                       = 0;
+            uint32_t blocks_raw                   = 0;
+            struct compression_transcoder *ctrans = NULL;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_LOAD_BLOCKS from client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            count = netplay_state_hash_blocks(netplay, &block_size);
+            words = (count + 31) / 32;
+            if (     !netplay->local_hashes
+                  || cmd_size < sizeof(buffer) + words * sizeof(uint32_t))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_LOAD_BLOCKS.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+            blocks_raw = cmd_size - (sizeof(buffer) + words * sizeof(uint32_t));
+
+            RECV(buffer, sizeof(buffer))
+               return false;
+            RECV(bitmap, words * sizeof(uint32_t))
+               return false;
+
+            for (i = 0; i < 3; i++)
+               buffer[i] = ntohl(buffer[i]);
+            for (i = 0; i < words; i++)
+               bitmap[i] = ntohl(bitmap[i]);
+
+            if (     buffer[1] != netplay->state_size
+                  || buffer[2] != block_size
+                  || blocks_raw > netplay->zbuffer_size)
+            {
+               RARCH_ERR("[Netplay] Netplay block load with an unexpected save state size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(netplay->zbuffer, blocks_raw)
+               return false;
+
+            netplay->savestate_request_outstanding = false;
+
+            /* We must still have the frame, with all of the input since */
+            if (     !netplay_find_delta_frame(netplay, buffer[0], &tmp_ptr)
+                  || !netplay->buffer[tmp_ptr].have_state
+                  || buffer[0] > netplay->other_frame_count)
+            {
+               netplay_cmd_request_savestate(netplay);
+               break;
+            }
+
+            for (i = 0; i < count; i++)
+            {
+               size_t len;
+
+               if (!(bitmap[i / 32] & (1U << (i % 32))))
+                  continue;
+
+               len = netplay->state_size - i * block_size;
+               expected += (len > block_size) ? block_size : len;
+            }
+
+            switch (connection->compression_supported)
+            {
+               case NETPLAY_COMPRESSION_ZLIB:
+                  ctrans = &netplay->compress_zlib;
+                  break;
+               default:
+                  ctrans = &netplay->compress_nil;
+                  break;
+            }
+
+            ctrans->decompression_backend->set_in(
+               ctrans->decompression_stream,
+               netplay->zbuffer, blocks_raw);
+            ctrans->decompression_backend->set_out(
+               ctrans->decompression_stream,
+               netplay->block_buffer, (uint32_t)expected);
+            ctrans->decompression_backend->trans(
+               ctrans->decompression_stream,
+               true, &rd, &wn, NULL);
+
+            if (wn != expected)
+            {
+               netplay_cmd_request_savestate(netplay);
+               break;
+            }
+
+            for (i = 0; i < count; i++)
+            {
+               size_t offset, len;
+
+               if (!(bitmap[i / 32] & (1U << (i % 32))))
+                  continue;
+
+               offset = i * block_size;
+               len    = netplay->state_size - offset;
+               if (len > block_size)
+                  len = block_size;
+
+               memcpy((uint8_t*)netplay->buffer[tmp_ptr].state + offset,
+                  netplay->block_buffer + gathered, len);
+               gathered += len;
+            }
+
+            /* Make sure the patched state is now right */
+            if (     netplay->have_remote_hashes
+                  && netplay->remote_hash_frame == buffer[0])
+            {
+               netplay_delta_frame_hashes(netplay,
+                  &netplay->buffer[tmp_ptr], netplay->local_hashes);
+
+               for (i = 0; i < count; i++)
+                  if (netplay->local_hashes[i] != netplay->remote_hashes[i])
+                     break;
+
+               if (i < count)
+               {
+                  RARCH_WARN("[Netplay] State still differs after patching, requesting a savestate.\n");
+                  netplay_cmd_request_savestate(netplay);
+                  break;
+               }
+            }
+
+            RARCH_LOG("[Netplay] Resynchronized %lu bytes of state at frame %u.\n",
+               (unsigned long)expected, buffer[0]);
+
+            /* Rewind to the patched frame and replay from there */
+            netplay->other_ptr         = tmp_ptr;
+            netplay->other_frame_count = buffer[0];
+            netplay->force_rewind      = true;
+            break;
+         }
+
       case NETPLAY_CMD_PAUSE:
          {
             char msg[512], nick[NETPLAY_NICK_LEN];
@@ -6371,6 +7494,127 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP_REQUEST:
+         {
+            uint32_t token;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (!netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_REQUEST from a server.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size)
+            {
+               RARCH_ERR("[Netplay] Unexpected payload in NETPLAY_CMD_UDP_REQUEST.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            /* Not hosting a UDP input channel; the client keeps using TCP. */
+            if (netplay->udp_fd < 0)
+               break;
+
+            if (!connection->udp)
+            {
+               socklen_t peer_len = sizeof(struct sockaddr_storage);
+               struct netplay_udp_channel *udp =
+                  (struct netplay_udp_channel*)calloc(1, sizeof(*udp));
+               if (!udp)
+                  break;
+
+               /* Datagrams are only taken from the host
+                * this TCP connection comes from */
+               if (getpeername(connection->fd,
+                     (struct sockaddr*)&udp->peer, &peer_len) < 0)
+               {
+                  free(udp);
+                  break;
+               }
+
+               udp->token      = netplay_random_uint32(netplay);
+               connection->udp = udp;
+            }
+
+            token = htonl(connection->udp->token);
+            if (!netplay_send_raw_cmd(netplay, connection,
+                  NETPLAY_CMD_UDP_TOKEN, &token, sizeof(token)))
+               return false;
+            break;
+         }
+
+      case NETPLAY_CMD_UDP_TOKEN:
+         {
+            uint32_t token;
+            struct sockaddr_storage peer;
+            socklen_t peer_len = sizeof(peer);
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_TOKEN from a client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(token))
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_TOKEN with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&token, sizeof(token))
+               return false;
+            token = ntohl(token);
+
+            if (!netplay->udp_input || connection->udp)
+               break;
+
+            /* The server's UDP port is its TCP port + 1 */
+            memset(&peer, 0, sizeof(peer));
+            if (getpeername(connection->fd, (struct sockaddr*)&peer,
+                  &peer_len) < 0)
+               break;
+            if (peer.ss_family == AF_INET)
+            {
+               struct sockaddr_in *sin = (struct sockaddr_in*)&peer;
+               sin->sin_port = htons(ntohs(sin->sin_port) + 1);
+            }
+#ifdef HAVE_INET6
+            else if (peer.ss_family == AF_INET6)
+            {
+               struct sockaddr_in6 *sin6 = (struct sockaddr_in6*)&peer;
+               sin6->sin6_port = htons(ntohs(sin6->sin6_port) + 1);
+            }
+#endif
+            else
+               break;
+
+            if (netplay->udp_fd < 0)
+               netplay->udp_fd = netplay_udp_init_socket(false,
+                  peer.ss_family, 0);
+            if (netplay->udp_fd < 0)
+            {
+               RARCH_WARN("[Netplay] Failed to open the UDP input socket.\n");
+               break;
+            }
+
+            connection->udp = (struct netplay_udp_channel*)
+               calloc(1, sizeof(*connection->udp));
+            if (!connection->udp)
+               break;
+
+            memcpy(&connection->udp->addr, &peer, peer_len);
+            memcpy(&connection->udp->peer, &peer, peer_len);
+            connection->udp->addr_len = peer_len;
+            connection->udp->token    = token;
+            connection->udp->has_addr = true;
+            /* Say hello, so that the server learns our address */
+            connection->udp->dirty    = true;
+
+            RARCH_LOG("[Netplay] Sending input over UDP as well.\n");
+            break;
+         }
+
       case NETPLAY_CMD_PLAYER_CHAT:
          {
             char nickname[NETPLAY_NICK_LEN];
@@ -6526,6 +7770,196 @@ shrt:
 
 #undef RECV
 
+/**
+ * netplay_udp_handle_input
+ *
+ * Apply one input message received over the UDP input channel.
+ * Unlike the TCP path, nothing here is fatal: anything we can't use
+ * right now is dropped, since the TCP copy will arrive eventually.
+ */
+static void netplay_udp_handle_input(netplay_t *netplay,
+      struct netplay_connection *connection,
+      const uint32_t *payload, uint32_t words)
+{
+   uint32_t frame_num, client_num, input_size, devices, device;
+   struct delta_frame *dframe;
+
+   /* Slaves have no frame ordering to check against */
+   if (connection->mode != NETPLAY_CONNECTION_PLAYING || words < 2)
+      return;
+
+   frame_num  = ntohl(payload[0]);
+   client_num = ntohl(payload[1]) & 0xFFFF;
+
+   if (netplay->is_server)
+      client_num = (uint32_t)(connection - netplay->connections + 1);
+
+   if (     client_num >= MAX_CLIENTS
+         || !(netplay->connected_players & (1 << client_num)))
+      return;
+
+   devices    = netplay->client_devices[client_num];
+   input_size = netplay_expected_input_size(netplay, devices);
+   if (words != 2 + input_size)
+      return;
+
+   /* Only the next expected frame is any use to us: older frames were
+    * already delivered, newer ones have to wait for their predecessors. */
+   if (frame_num != netplay->read_frame_count[client_num])
+      return;
+
+   dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+   if (!netplay_delta_frame_ready(netplay, dframe, frame_num))
+      return;
+
+   payload += 2;
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      uint32_t dsize, di;
+      if (!(devices & (1 << device)))
+         continue;
+
+      dsize  = netplay_expected_input_size(netplay, 1 << device);
+      istate = netplay_input_state_for(&dframe->real_input[device],
+            client_num, dsize, false, false);
+      if (!istate)
+         return;
+
+      for (di = 0; di < dsize; di++)
+         istate->data[di] = ntohl(payload[di]);
+      payload += dsize;
+   }
+   dframe->have_real[client_num] = true;
+
+   netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+   netplay->read_frame_count[client_num]++;
+   netplay->udp_inputs_applied++;
+
+   if (netplay->is_server)
+   {
+      /* Forward it on if it's past data */
+      if (dframe->frame <= netplay->self_frame_count)
+         send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+   }
+   else if (client_num == 0)
+   {
+      netplay->server_ptr         = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
+}
+
+/**
+ * netplay_udp_poll
+ *
+ * Read every pending datagram from the UDP input channel.
+ */
+static void netplay_udp_poll(netplay_t *netplay)
+{
+   if (netplay->udp_fd < 0)
+      return;
+
+   for (;;)
+   {
+      size_t i;
+      uint32_t token, seq, pos, words;
+      uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+      struct sockaddr_storage their_addr;
+      struct netplay_udp_channel *udp       = NULL;
+      struct netplay_connection *connection = NULL;
+      socklen_t addr_size                   = sizeof(their_addr);
+      ssize_t ret                           = recvfrom(netplay->udp_fd,
+         (char*)buffer, sizeof(buffer), 0,
+         (struct sockaddr*)&their_addr, &addr_size);
+
+      if (ret < 0)
+         break;
+
+      if (     ret < (ssize_t)(NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t))
+            || ret % sizeof(uint32_t)
+            || ntohl(buffer[0]) != UDP_INPUT_MAGIC)
+         continue;
+
+      /* Find out whose datagram this is */
+      token = ntohl(buffer[1]);
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         connection = &netplay->connections[i];
+         if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+               && connection->udp
+               && connection->udp->token == token)
+         {
+            udp = connection->udp;
+            break;
+         }
+      }
+      /* The token alone could be guessed or sniffed; the datagram
+       * must also come from the host at the other end of the TCP
+       * connection, or it could redirect the peer's input */
+      if (!udp || !netplay_udp_same_host(&their_addr, &udp->peer))
+         continue;
+
+      netplay->udp_datagrams_recvd++;
+
+      /* Servers learn the client's port from its datagrams */
+      if (netplay->is_server)
+      {
+         memcpy(&udp->addr, &their_addr, addr_size);
+         udp->addr_len = addr_size;
+         udp->has_addr = true;
+      }
+
+      netplay_udp_handle_ack(udp, ntohl(buffer[3]), ntohl(buffer[4]));
+
+      seq = ntohl(buffer[2]);
+      if (!udp->has_recv || seq > udp->recv_seq)
+      {
+         uint32_t diff  = udp->has_recv ? seq - udp->recv_seq : 0;
+
+         if (!udp->has_recv || diff > 32)
+            udp->recv_bits = 0;
+         else if (diff == 32)
+            udp->recv_bits = 1U << 31;
+         else
+            udp->recv_bits = (udp->recv_bits << diff) | (1U << (diff - 1));
+         udp->recv_seq  = seq;
+         udp->has_recv  = true;
+      }
+      else if (seq < udp->recv_seq && udp->recv_seq - seq <= 32)
+         udp->recv_bits |= 1U << (udp->recv_seq - seq - 1);
+      else
+         /* Duplicate */
+         continue;
+
+      words = (uint32_t)(ret / sizeof(uint32_t));
+      pos   = NETPLAY_UDP_HEADER_WORDS;
+
+      /* Datagrams without input don't need to be acknowledged */
+      if (pos < words)
+         udp->dirty = true;
+
+      while (pos + 2 <= words)
+      {
+         uint32_t cmd      = ntohl(buffer[pos]);
+         uint32_t cmd_size = ntohl(buffer[pos + 1]);
+         uint32_t cmd_words;
+
+         if (     cmd != NETPLAY_CMD_INPUT
+               || cmd_size % sizeof(uint32_t))
+            break;
+
+         cmd_words = cmd_size / sizeof(uint32_t);
+         if (cmd_words > words - pos - 2)
+            break;
+
+         netplay_udp_handle_input(netplay, connection,
+            buffer + pos + 2, cmd_words);
+
+         pos += 2 + cmd_words;
+      }
+   }
+}
+
 /**
  * netplay_poll_net_input
  *
@@ -6537,6 +7971,9 @@ static void netplay_poll_net_input(netplay_t *netplay)
    bool had_input;
    struct netplay_connection *connection;
 
+   /* Anything that made it over UDP first saves us waiting on TCP. */
+   netplay_udp_poll(netplay);
+
    do
    {
       had_input = false;
@@ -6985,7 +8422,8 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
 
 static bool netplay_init_serialization(netplay_t *netplay)
 {
-   size_t i;
+   size_t i, block_size;
+   uint32_t blocks;
 
    if (netplay->state_size)
       return true;
@@ -7010,6 +8448,33 @@ static bool netplay_init_serialization(netplay_t *netplay)
          return false;
    }
 
+   if (netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC)
+   {
+      /* Ours first, then the remote ones */
+      netplay->local_hashes  = (uint64_t*)calloc(
+         2 * NETPLAY_STATE_HASH_MAX_BLOCKS, sizeof(uint64_t));
+      netplay->remote_hashes = netplay->local_hashes
+         + NETPLAY_STATE_HASH_MAX_BLOCKS;
+      netplay->block_buffer  = (uint8_t*)malloc(netplay->state_size);
+      if (!netplay->local_hashes || !netplay->block_buffer)
+      {
+         free(netplay->local_hashes);
+         free(netplay->block_buffer);
+         netplay->local_hashes  = NULL;
+         netplay->remote_hashes = NULL;
+         netplay->block_buffer  = NULL;
+         return false;
+      }
+
+      /* Large states get larger blocks, so a desync
+       * resends more data per differing block */
+      blocks = netplay_state_hash_blocks(netplay, &block_size);
+      if (block_size > NETPLAY_STATE_HASH_BLOCK_SIZE)
+         RARCH_LOG("[Netplay] Savestate of %u bytes is hashed in %u blocks of %u bytes.\n",
+               (unsigned)netplay->state_size, (unsigned)blocks,
+               (unsigned)block_size);
+   }
+
    netplay->zbuffer_size    = netplay->state_size * 2;
    netplay->zbuffer         = (uint8_t*)calloc(1, netplay->zbuffer_size);
    if (!netplay->zbuffer)
@@ -7123,6 +8588,36 @@ static void netplay_free(netplay_t *netplay)
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+   {
+      RARCH_LOG("[Netplay] UDP input: %u datagrams sent, %u received, "
+         "%u frames of input arrived ahead of TCP.\n",
+         netplay->udp_datagrams_sent, netplay->udp_datagrams_recvd,
+         netplay->udp_inputs_applied);
+      socket_close(netplay->udp_fd);
+   }
+
+   if (netplay->stall_frames)
+      RARCH_LOG("[Netplay] Stalled for %u frames.\n", netplay->stall_frames);
+
+   if (netplay->rewinds)
+      RARCH_LOG("[Netplay] %u rewinds; serializing took %lluus in %u frames, "
+         "replaying %lluus in %u frames (snapshot interval %u).\n",
+         netplay->rewinds,
+         (unsigned long long)netplay->serialize_time_sum,
+         netplay->serialize_count,
+         (unsigned long long)netplay->replay_time_sum,
+         netplay->replay_count, netplay->snapshot_interval);
+
+   if (netplay->state_blocks_resent)
+      RARCH_LOG("[Netplay] Resent %u state blocks to resynchronize.\n",
+         netplay->state_blocks_resent);
+
+   if (netplay->keyframes_targeted || netplay->keyframes_broadcast)
+      RARCH_LOG("[Netplay] Sent %u savestates to single peers, "
+         "%u to every peer.\n",
+         netplay->keyframes_targeted, netplay->keyframes_broadcast);
+
    if (netplay->mitm_handler)
    {
       for (i = 0; i < ARRAY_SIZE(netplay->mitm_handler->pending); i++)
@@ -7147,6 +8642,8 @@ static void netplay_free(netplay_t *netplay)
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
       }
+
+      free(connection->udp);
    }
 
    free(netplay->connections);
@@ -7161,6 +8658,8 @@ static void netplay_free(netplay_t *netplay)
    }
 
    free(netplay->zbuffer);
+   free(netplay->local_hashes);
+   free(netplay->block_buffer);
 
    if (netplay->compress_nil.compression_stream)
       netplay->compress_nil.compression_backend->stream_free(
@@ -7213,6 +8712,7 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
    netplay->modus            = modus;
    netplay->crcs_valid       = true;
    netplay->listen_fd        = -1;
+   netplay->udp_fd           = -1;
    netplay->next_announce    = -1;
    netplay->next_ping        = -1;
    netplay->simple_rand_next = 1;
@@ -7302,10 +8802,48 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
       /* Clients get device info from the server. */
    }
 
+   if (modus == NETPLAY_MODUS_INPUT_FRAME_SYNC)
+   {
+      settings_t *settings    = config_get_ptr();
+      netplay->udp_input      = settings->bools.netplay_udp_input;
+      netplay->udp_redundancy = settings->uints.netplay_udp_redundancy;
+      if (netplay->udp_redundancy < 1)
+         netplay->udp_redundancy = 1;
+      else if (netplay->udp_redundancy > NETPLAY_UDP_MAX_REDUNDANCY)
+         netplay->udp_redundancy = NETPLAY_UDP_MAX_REDUNDANCY;
+
+      /* 0 starts out serializing every frame and adapts */
+      netplay->snapshot_interval = settings->uints.netplay_snapshot_interval;
+      netplay->snapshot_auto     = !netplay->snapshot_interval;
+      if (netplay->snapshot_interval < 1)
+         netplay->snapshot_interval = 1;
+      else if (netplay->snapshot_interval > NETPLAY_MAX_SNAPSHOT_INTERVAL)
+         netplay->snapshot_interval = NETPLAY_MAX_SNAPSHOT_INTERVAL;
+   }
+
    if (!init_tcp_socket(netplay, server, mitm, port) ||
          !netplay_init_buffers(netplay))
       goto failure;
 
+   /* Datagrams can't be tunneled through a relay server */
+   if (netplay->is_server && netplay->udp_input && !netplay->mitm_handler)
+   {
+      netplay->udp_fd = netplay_udp_init_socket(true,
+#ifdef HAVE_INET6
+         AF_INET6,
+#else
+         AF_INET,
+#endif
+         port + 1);
+#ifdef HAVE_INET6
+      if (netplay->udp_fd < 0)
+         netplay->udp_fd = netplay_udp_init_socket(true, AF_INET, port + 1);
+#endif
+      if (netplay->udp_fd < 0)
+         RARCH_WARN("[Netplay] Failed to bind UDP port %hu for input, "
+            "using TCP only.\n", (unsigned short)(port + 1));
+   }
+
    return netplay;
 
 failure:
@@ -7320,17 +8858,33 @@ failure:
  * @serial_info          : the savestate being loaded
  * @cx                   : compression type
  * @z                    : compression backend to use
+ * @only_flags           : if nonzero, only send to peers with these flags
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. The state is compressed once, however many peers receive it.
  */
 static void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
-   struct compression_transcoder *z)
+   struct compression_transcoder *z, uint8_t only_flags)
 {
    uint32_t header[4];
    uint32_t rd, wn;
    size_t i;
+   size_t peers = 0;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+            && (connection->compression_supported == cx)
+            && (!only_flags || (connection->flags & only_flags)))
+         peers++;
+   }
+
+   /* Nobody to compress it for */
+   if (!peers)
+      return;
 
    /* Compress it */
    z->compression_backend->set_in(z->compression_stream,
@@ -7357,9 +8911,12 @@ static void netplay_send_savestate(netplay_t *netplay,
       struct netplay_connection *connection = &netplay->connections[i];
       if (  (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
           ||  (connection->mode  < NETPLAY_CONNECTION_CONNECTED)
-          ||  (connection->compression_supported != cx))
+          ||  (connection->compression_supported != cx)
+          ||  (only_flags && !(connection->flags & only_flags)))
          continue;
 
+      connection->flags &= ~NETPLAY_CONN_FLAG_NEEDS_KEYFRAME;
+
       if (   !netplay_send(&connection->send_packet_buffer,
                connection->fd, header,
                sizeof(header))
@@ -7370,6 +8927,32 @@ static void netplay_send_savestate(netplay_t *netplay,
    }
 }
 
+/**
+ * netplay_send_keyframe
+ * @netplay              : pointer to netplay object
+ * @serial_info          : our current state
+ *
+ * Send our current state only to the peers waiting for one, i.e. those
+ * that just joined or asked for it. Everyone else is already in sync, so
+ * the cost of a join doesn't scale with the number of spectators.
+ *
+ * Only valid when nothing would be discarded by loading the state, see
+ * netplay_keyframe_is_local.
+ */
+static void netplay_send_keyframe(netplay_t *netplay,
+      retro_ctx_serialize_info_t *serial_info)
+{
+   if (netplay->desync)
+      return;
+
+   if (netplay->compress_nil.compression_backend)
+      netplay_send_savestate(netplay, serial_info, 0,
+         &netplay->compress_nil, NETPLAY_CONN_FLAG_NEEDS_KEYFRAME);
+   if (netplay->compress_zlib.compression_backend)
+      netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
+         &netplay->compress_zlib, NETPLAY_CONN_FLAG_NEEDS_KEYFRAME);
+}
+
 /**
  * netplay_frontend_paused
  * @netplay              : pointer to netplay object
@@ -7533,10 +9116,14 @@ void netplay_load_savestate(netplay_t *netplay,
             return;
          tmp_serial_info.data_const = tmp_serial_info.data;
          serial_info                = &tmp_serial_info;
+         netplay->buffer[netplay->run_ptr].have_state = true;
       }
       else if (serial_info->size <= netplay->state_size)
+      {
          memcpy(netplay->buffer[netplay->run_ptr].state,
             serial_info->data_const, serial_info->size);
+         netplay->buffer[netplay->run_ptr].have_state = true;
+      }
    }
 
    /* Don't send it if we're expected to be desynced. */
@@ -7545,10 +9132,10 @@ void netplay_load_savestate(netplay_t *netplay,
       /* Send this to every peer. */
       if (netplay->compress_nil.compression_backend)
          netplay_send_savestate(netplay, serial_info, 0,
-            &netplay->compress_nil);
+            &netplay->compress_nil, 0);
       if (netplay->compress_zlib.compression_backend)
          netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
-            &netplay->compress_zlib);
+            &netplay->compress_zlib, 0);
    }
 }
 
@@ -8658,6 +10245,8 @@ static bool netplay_pre_frame(netplay_t *netplay)
       /* We may have received data even if we're stalled,
        * so run post-frame sync. */
       netplay_sync_input_post_frame(netplay, true);
+      netplay_udp_flush_all(netplay);
+      netplay->stall_frames++;
       return false;
    }
 
@@ -8693,6 +10282,8 @@ static void netplay_post_frame(netplay_t *netplay)
          netplay_hangup(netplay, connection);
    }
 
+   netplay_udp_flush_all(netplay);
+
    /* If we're disconnected, deinitialize */
    if (     (!(netplay->is_server))
          && (!(netplay->connections[0].flags & NETPLAY_CONN_FLAG_ACTIVE)))
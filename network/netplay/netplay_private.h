@@ -62,6 +62,33 @@
 #define NETPLAY_MAX_REQ_STALL_TIME      60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
+/* Input frames waiting for UDP delivery to a single peer,
+ * and the largest single input message (in words) */
+#define NETPLAY_UDP_MAX_ENTRIES     16
+#define NETPLAY_UDP_ENTRY_WORDS     16
+#define NETPLAY_UDP_MAX_REDUNDANCY  8
+/* magic, token, seq, ack and ack bitmap */
+#define NETPLAY_UDP_HEADER_WORDS    5
+#define NETPLAY_UDP_MAX_WORDS       (NETPLAY_UDP_HEADER_WORDS + \
+      NETPLAY_UDP_MAX_ENTRIES * NETPLAY_UDP_ENTRY_WORDS)
+
+/* Savestates are hashed in blocks of at least this size,
+ * doubled until there are no more than MAX_BLOCKS of them
+ * (logged when the state is set up). The whole state is
+ * hashed at each check frame: cores serialize it in full
+ * every frame, so there are no dirty blocks to go by. */
+#define NETPLAY_STATE_HASH_BLOCK_SIZE 0x10000
+#define NETPLAY_STATE_HASH_MAX_BLOCKS 1024
+
+/* Largest gap between serialized frames, and how often
+ * (in frames) an automatic snapshot interval is reconsidered */
+#define NETPLAY_MAX_SNAPSHOT_INTERVAL 16
+#define NETPLAY_SNAPSHOT_TUNE_FRAMES  600
+
+/* How many frames a savestate for a single peer may wait for
+ * all input to arrive before it is sent to every peer instead */
+#define NETPLAY_KEYFRAME_MAX_WAIT 15
+
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
 
@@ -165,6 +192,19 @@ enum netplay_cmd
    /* Send a network packet from the raw packet core interface */
    NETPLAY_CMD_NETPACKET      = 0x0048,
 
+   /* Ask the server for per-block state hashes
+    * instead of CRCs (client only) */
+   NETPLAY_CMD_STATE_HASH_REQUEST = 0x0049,
+
+   /* Send the per-block hashes of a frame's state */
+   NETPLAY_CMD_STATE_HASH     = 0x004A,
+
+   /* Request the state blocks that failed to match (client only) */
+   NETPLAY_CMD_REQUEST_BLOCKS = 0x004B,
+
+   /* Send state blocks for the client to patch in */
+   NETPLAY_CMD_LOAD_BLOCKS    = 0x004C,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -176,6 +216,13 @@ enum netplay_cmd
       each one individually */
    NETPLAY_CMD_CFG_ACK        = 0x0062,
 
+   /* Ask the server for a token to send input over UDP (client only) */
+   NETPLAY_CMD_UDP_REQUEST    = 0x0063,
+
+   /* Grant a UDP input channel token (server only).
+    * The server listens for UDP on its TCP port + 1. */
+   NETPLAY_CMD_UDP_TOKEN      = 0x0064,
+
    /* Chat commands */
 
    /* Sends a player chat message.
@@ -328,6 +375,10 @@ struct delta_frame
    /* Have we read local input? */
    bool have_local;
 
+   /* Does state hold this frame's serialization?
+    * Only every snapshot_interval-th frame is serialized. */
+   bool have_state;
+
    /* Have we read the real (remote) input? */
    bool have_real[MAX_CLIENTS];
 
@@ -364,7 +415,64 @@ enum netplay_connection_flags
    /* Is this connection allowed to play (server only)? */
    NETPLAY_CONN_FLAG_CAN_PLAY       = (1 << 2),
    /* Did we request a ping response? */
-   NETPLAY_CONN_FLAG_PING_REQUESTED = (1 << 3)
+   NETPLAY_CONN_FLAG_PING_REQUESTED = (1 << 3),
+   /* Does this client want per-block state hashes (server only)? */
+   NETPLAY_CONN_FLAG_STATE_HASHES   = (1 << 4),
+   /* Is this connection waiting for a savestate (server only)? */
+   NETPLAY_CONN_FLAG_NEEDS_KEYFRAME = (1 << 5)
+};
+
+/* An input frame queued for redundant UDP delivery.
+ * The data is a complete NETPLAY_CMD_INPUT message
+ * in network byte order. */
+struct netplay_udp_entry
+{
+   /* First and last datagram this entry was sent in */
+   uint32_t first_seq;
+   uint32_t last_seq;
+   /* How many datagrams carried this entry so far? */
+   uint32_t sends;
+   /* Size of the message in words */
+   uint32_t size;
+   uint32_t data[NETPLAY_UDP_ENTRY_WORDS];
+};
+
+/* Optional unreliable input channel alongside the TCP connection.
+ * Input is always sent over TCP as well; whichever copy arrives first
+ * is used, so a lost TCP segment no longer holds back later frames. */
+struct netplay_udp_channel
+{
+   struct netplay_udp_entry pending[NETPLAY_UDP_MAX_ENTRIES];
+
+   /* Where to send datagrams for this peer */
+   struct sockaddr_storage addr;
+   socklen_t addr_len;
+
+   /* Address of the peer's TCP connection; datagrams
+    * from any other host are dropped */
+   struct sockaddr_storage peer;
+
+   size_t pending_count;
+
+   /* Shared secret identifying this peer's datagrams */
+   uint32_t token;
+
+   /* Sequence number of the next datagram we send */
+   uint32_t send_seq;
+
+   /* Highest sequence number received, and a bitmap of the
+    * 32 datagrams preceding it (bit 0 = recv_seq - 1) */
+   uint32_t recv_seq;
+   uint32_t recv_bits;
+
+   /* Do we know the peer's address yet? */
+   bool has_addr;
+
+   /* Have we received anything from the peer yet? */
+   bool has_recv;
+
+   /* Is there something (new entries or an ack) worth sending? */
+   bool dirty;
 };
 
 /* Each connection gets a connection struct */
@@ -380,6 +488,9 @@ struct netplay_connection
    struct socket_buffer send_packet_buffer;
    struct socket_buffer recv_packet_buffer;
 
+   /* UDP input channel, if negotiated */
+   struct netplay_udp_channel *udp;
+
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
@@ -488,6 +599,11 @@ struct netplay
    retro_time_t frame_run_time_sum;
    retro_time_t frame_run_time_avg;
 
+   /* Time spent serializing, and running frames again
+    * in rewinds, to choose a snapshot interval */
+   retro_time_t serialize_time_sum;
+   retro_time_t replay_time_sum;
+
    /* When did we start falling behind? */
    retro_time_t catch_up_time;
    /* How long have we been stalled? */
@@ -522,6 +638,14 @@ struct netplay
    /* A buffer into which to compress frames for transfer */
    uint8_t *zbuffer;
 
+   /* Per-block state hashes: ours, and the last ones
+    * the server sent, NETPLAY_STATE_HASH_MAX_BLOCKS each */
+   uint64_t *local_hashes;
+   uint64_t *remote_hashes;
+
+   /* Differing state blocks, gathered for transfer */
+   uint8_t *block_buffer;
+
    size_t connections_size;
    size_t buffer_size;
    size_t zbuffer_size;
@@ -608,6 +732,34 @@ struct netplay
    /* TCP connection for listening (server only) */
    int listen_fd;
 
+   /* UDP socket for the input channel, or -1 */
+   int udp_fd;
+
+   /* How many datagrams should carry each input frame? */
+   uint32_t udp_redundancy;
+
+   /* Serialize every this many frames, and replay from the
+    * nearest snapshot on rewind; picked as we go if automatic */
+   uint32_t snapshot_interval;
+   uint32_t serialize_count;
+   uint32_t replay_count;
+   uint32_t rewinds;
+
+   /* Statistics, logged when netplay ends */
+   uint32_t stall_frames;
+   uint32_t udp_datagrams_sent;
+   uint32_t udp_datagrams_recvd;
+   uint32_t udp_inputs_applied;
+   uint32_t state_blocks_resent;
+   uint32_t keyframes_targeted;
+   uint32_t keyframes_broadcast;
+
+   /* Frames the pending savestate has waited for input */
+   uint32_t keyframe_wait;
+
+   /* The frame the remote state hashes are for */
+   uint32_t remote_hash_frame;
+
    int frame_run_time_ptr;
 
    /* Latency frames; positive to hide network latency,
@@ -656,6 +808,13 @@ struct netplay
    /* Are they valid? */
    bool crcs_valid;
 
+   /* Is snapshot_interval picked as we go? */
+   bool snapshot_auto;
+
+   /* Do we have remote state hashes, and are they yet to be checked? */
+   bool have_remote_hashes;
+   bool remote_hashes_pending;
+
    /* Netplay pausing */
    bool local_paused;
    bool remote_paused;
@@ -674,7 +833,8 @@ struct netplay
    /* Force a reset */
    bool force_reset;
 
-   /* Force our state to be sent to all connections */
+   /* Force our state to be sent to the connections
+    * flagged with NETPLAY_CONN_FLAG_NEEDS_KEYFRAME */
    bool force_send_savestate;
 
    /* Have we requested a savestate as a sync point? */
@@ -682,6 +842,9 @@ struct netplay
 
    /* Host settings */
    bool allow_pausing;
+
+   /* Should input also be sent over UDP? */
+   bool udp_input;
 };
 
 void video_frame_net(const void *data,
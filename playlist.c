@@ -25,11 +25,13 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <streams/interface_stream.h>
+#include <streams/file_stream.h>
 #include <file/file_path.h>
 #include <file/archive_file.h>
 #include <lists/string_list.h>
 #include <formats/rjson.h>
 #include <array/rbuf.h>
+#include <array/rhmap.h>
 
 #include "playlist.h"
 #include "verbosity.h"
@@ -44,6 +46,11 @@
 #define PLAYLIST_ENTRIES 6
 #endif
 
+#define PLAYLIST_JOURNAL_EXT ".journal"
+/* Journal is folded back into the playlist file
+ * once larger than half the file plus this */
+#define PLAYLIST_JOURNAL_SLACK (16 * 1024)
+
 #define WINDOWS_PATH_DELIMITER '\\'
 #define POSIX_PATH_DELIMITER '/'
 
@@ -66,7 +73,8 @@ enum content_playlist_flags
    CNT_PLAYLIST_FLG_MOD        = (1 << 0),
    CNT_PLAYLIST_FLG_OLD_FMT    = (1 << 1),
    CNT_PLAYLIST_FLG_COMPRESSED = (1 << 2),
-   CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3)
+   CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3),
+   CNT_PLAYLIST_FLG_INDEXED    = (1 << 4)
 };
 
 struct content_playlist
@@ -77,6 +85,22 @@ struct content_playlist
 
    struct playlist_entry *entries;
 
+   /* Number of entries with each 'real' path, and
+    * inside each archive (see playlist_path_index_find()) */
+   uint32_t *path_index;
+   uint32_t *archive_index;
+
+   /* Strings of entries read from file
+    * (see playlist_pool_strdup()) */
+   char *strings;
+   char **strings_interned;
+   size_t strings_size;
+   size_t strings_used;
+
+   /* Operations not yet appended to the
+    * journal (see playlist_journal_add()) */
+   char *journal;
+
    playlist_manual_scan_record_t scan_record; /* ptr alignment */
    playlist_config_t config;                  /* size_t alignment */
 
@@ -94,7 +118,8 @@ enum json_ctx_flags
    JSON_CTX_FLG_IN_ITEMS             = (1 << 0),
    JSON_CTX_FLG_IN_SUBSYSTEM_CONTENT = (1 << 1),
    JSON_CTX_FLG_CAPACITY_EXCEEDED    = (1 << 2),
-   JSON_CTX_FLG_OOM                  = (1 << 3)
+   JSON_CTX_FLG_OOM                  = (1 << 3),
+   JSON_CTX_FLG_INTERN               = (1 << 4)
 };
 
 typedef struct
@@ -492,6 +517,178 @@ static bool playlist_path_matches_entry(playlist_path_id_t *path_id,
    return false;
 }
 
+enum playlist_path_index_result
+{
+   PLAYLIST_PATH_INDEX_NO_MATCH = 0,
+   PLAYLIST_PATH_INDEX_MATCH,
+   PLAYLIST_PATH_INDEX_UNKNOWN
+};
+
+static uint32_t playlist_path_index_key(const char *path,
+      char *s, size_t len, const char **key)
+{
+#ifdef _WIN32
+   /* Handle case-insensitive operating systems*/
+   strlcpy(s, path, len);
+   string_to_lower(s);
+   *key = s;
+#else
+   *key = path;
+#endif
+   return playlist_path_hash(*key);
+}
+
+static bool playlist_path_index_has(uint32_t *index, const char *path)
+{
+   char tmp[PATH_MAX_LENGTH];
+   const char *key;
+   uint32_t hash = playlist_path_index_key(path, tmp, sizeof(tmp), &key);
+   return RHMAP_HAS_FULL(index, hash, key);
+}
+
+static bool playlist_path_index_adjust(uint32_t **index,
+      const char *path, bool add)
+{
+   char tmp[PATH_MAX_LENGTH];
+   const char *key;
+   uint32_t *map = *index;
+   uint32_t hash = playlist_path_index_key(path, tmp, sizeof(tmp), &key);
+   ptrdiff_t idx = RHMAP_IDX_FULL(map, hash, key);
+   bool ret      = true;
+
+   if (add)
+   {
+      if (idx >= 0)
+         map[idx]++;
+      else if (RHMAP_TRYFIT(map, RHMAP_LEN(map) + 1))
+         RHMAP_SET_FULL(map, hash, key, 1);
+      else
+         ret = false; /* out of memory */
+   }
+   else if (idx >= 0 && --map[idx] == 0)
+      (void)RHMAP_DEL_FULL(map, hash, key);
+
+   *index = map;
+   return ret;
+}
+
+static bool playlist_path_index_entry(playlist_t *playlist,
+      struct playlist_entry *entry, bool add)
+{
+   if (!entry->path_id)
+   {
+      if (!(entry->path_id = playlist_path_id_init(entry->path)))
+         return false;
+   }
+
+   if (string_is_empty(entry->path_id->real_path))
+      return true;
+
+   if (!playlist_path_index_adjust(&playlist->path_index,
+         entry->path_id->real_path, add))
+      return false;
+
+   if (     entry->path_id->is_in_archive
+         && !string_is_empty(entry->path_id->archive_path))
+      return playlist_path_index_adjust(&playlist->archive_index,
+            entry->path_id->archive_path, add);
+
+   return true;
+}
+
+static void playlist_path_index_free(playlist_t *playlist)
+{
+   RHMAP_FREE(playlist->path_index);
+   RHMAP_FREE(playlist->archive_index);
+   playlist->flags &= ~CNT_PLAYLIST_FLG_INDEXED;
+}
+
+/* Keep the path index (if built) in step with
+ * an entry being added to or removed from the
+ * playlist, or having its path changed */
+static void playlist_path_index_add(playlist_t *playlist,
+      struct playlist_entry *entry)
+{
+   if (     (playlist->flags & CNT_PLAYLIST_FLG_INDEXED)
+         && !playlist_path_index_entry(playlist, entry, true))
+      playlist_path_index_free(playlist);
+}
+
+static void playlist_path_index_remove(playlist_t *playlist,
+      struct playlist_entry *entry)
+{
+   if (playlist->flags & CNT_PLAYLIST_FLG_INDEXED)
+      playlist_path_index_entry(playlist, entry, false);
+}
+
+/**
+ * playlist_path_index_find:
+ * @playlist          : Playlist handle
+ * @path_id           : Path identity to search for
+ *
+ * Looks up whether any entry matches 'path_id', as
+ * playlist_path_matches_entry() would decide, without
+ * walking the playlist. The index is built on first
+ * use, which initialises the path ID cache of every
+ * entry (as the first search always did).
+ *
+ * Returns PLAYLIST_PATH_INDEX_UNKNOWN if the index
+ * can't tell, in which case entries must be compared
+ * one by one.
+ **/
+static enum playlist_path_index_result playlist_path_index_find(
+      playlist_t *playlist, const playlist_path_id_t *path_id)
+{
+   size_t i, len;
+
+   if (string_is_empty(path_id->real_path))
+      return PLAYLIST_PATH_INDEX_UNKNOWN;
+
+   if (!(playlist->flags & CNT_PLAYLIST_FLG_INDEXED))
+   {
+      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+      {
+         if (!playlist_path_index_entry(playlist,
+               &playlist->entries[i], true))
+         {
+            playlist_path_index_free(playlist);
+            return PLAYLIST_PATH_INDEX_UNKNOWN;
+         }
+      }
+
+      playlist->flags |= CNT_PLAYLIST_FLG_INDEXED;
+   }
+
+   if (playlist_path_index_has(playlist->path_index, path_id->real_path))
+      return PLAYLIST_PATH_INDEX_MATCH;
+
+#ifdef RARCH_INTERNAL
+   if (!playlist->config.fuzzy_archive_match)
+      return PLAYLIST_PATH_INDEX_NO_MATCH;
+#endif
+
+   if (string_is_empty(path_id->archive_path))
+      return PLAYLIST_PATH_INDEX_NO_MATCH;
+
+   /* An archive matches any entry inside it... */
+   if (path_id->is_archive && !path_id->is_in_archive)
+   {
+      if (playlist_path_index_has(playlist->archive_index,
+            path_id->archive_path))
+         return PLAYLIST_PATH_INDEX_MATCH;
+   }
+   /* ...and a file inside an archive matches the archive */
+   else if (path_id->is_in_archive)
+   {
+      if (     playlist_path_index_has(playlist->path_index,
+                  path_id->archive_path)
+            && path_is_compressed_file(path_id->archive_path))
+         return PLAYLIST_PATH_INDEX_MATCH;
+   }
+
+   return PLAYLIST_PATH_INDEX_NO_MATCH;
+}
+
 /**
  * playlist_core_path_equal:
  * @real_core_path  : 'Real' search path, generated by path_resolve_realpath()
@@ -571,33 +768,447 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+/* When a playlist is read, entry strings are copied
+ * into a single block instead of being allocated one
+ * by one, and core paths/names, database names and
+ * subsystems (which tend to be the same for every
+ * entry) are only stored once. Strings set after
+ * that are allocated as usual - entry strings must
+ * therefore be released with playlist_free_string() */
+
+static bool playlist_string_is_pooled(const playlist_t *playlist,
+      const char *s)
+{
+   return (uintptr_t)s - (uintptr_t)playlist->strings
+         < playlist->strings_used;
+}
+
+static void playlist_free_string(const playlist_t *playlist, char *s)
+{
+   if (s && !playlist_string_is_pooled(playlist, s))
+      free(s);
+}
+
+static char *playlist_pool_strdup(playlist_t *playlist,
+      const char *s, bool intern)
+{
+   char *copy;
+   size_t len;
+
+   if (intern)
+   {
+      ptrdiff_t idx = RHMAP_IDX_STR(playlist->strings_interned, s);
+      if (idx >= 0)
+         return playlist->strings_interned[idx];
+   }
+
+   /* Pool is sized to the file, so this only
+    * happens if decoding made a string longer */
+   len = strlen(s) + 1;
+   if (len > playlist->strings_size - playlist->strings_used)
+      return strdup(s);
+
+   copy                    = playlist->strings + playlist->strings_used;
+   memcpy(copy, s, len);
+   playlist->strings_used += len;
+
+   if (intern && RHMAP_TRYFIT(playlist->strings_interned,
+         RHMAP_LEN(playlist->strings_interned) + 1))
+      RHMAP_SET_STR(playlist->strings_interned, s, copy);
+
+   return copy;
+}
+
+static void playlist_pool_rebase(const playlist_t *playlist,
+      char **s, char *strings)
+{
+   if (*s && playlist_string_is_pooled(playlist, *s))
+      *s = strings + (*s - playlist->strings);
+}
+
+/* Releases the unused part of the pool once
+ * the playlist has been read */
+static void playlist_pool_finalize(playlist_t *playlist)
+{
+   size_t i, len;
+   char *strings;
+
+   RHMAP_FREE(playlist->strings_interned);
+
+   if (playlist->strings_used == playlist->strings_size)
+      return;
+
+   if (!playlist->strings_used)
+   {
+      free(playlist->strings);
+      playlist->strings      = NULL;
+      playlist->strings_size = 0;
+      return;
+   }
+
+   if (!(strings = (char*)malloc(playlist->strings_used)))
+      return;
+
+   memcpy(strings, playlist->strings, playlist->strings_used);
+
+   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+   {
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      playlist_pool_rebase(playlist, &entry->path,            strings);
+      playlist_pool_rebase(playlist, &entry->label,           strings);
+      playlist_pool_rebase(playlist, &entry->core_path,       strings);
+      playlist_pool_rebase(playlist, &entry->core_name,       strings);
+      playlist_pool_rebase(playlist, &entry->db_name,         strings);
+      playlist_pool_rebase(playlist, &entry->crc32,           strings);
+      playlist_pool_rebase(playlist, &entry->subsystem_ident, strings);
+      playlist_pool_rebase(playlist, &entry->subsystem_name,  strings);
+   }
+
+   free(playlist->strings);
+   playlist->strings      = strings;
+   playlist->strings_size = playlist->strings_used;
+}
+
+static void playlist_pool_free(playlist_t *playlist)
+{
+   RHMAP_FREE(playlist->strings_interned);
+   free(playlist->strings);
+   playlist->strings      = NULL;
+   playlist->strings_size = 0;
+   playlist->strings_used = 0;
+}
+
+static void playlist_write_entry(rjsonwriter_t *writer,
+      const struct playlist_entry *entry)
+{
+   rjsonwriter_add_spaces(writer, 4);
+   rjsonwriter_raw(writer, "{", 1);
+
+   rjsonwriter_raw(writer, "\n", 1);
+   rjsonwriter_add_spaces(writer, 6);
+   rjsonwriter_add_string(writer, "path");
+   rjsonwriter_raw(writer, ":", 1);
+   rjsonwriter_raw(writer, " ", 1);
+   rjsonwriter_add_string(writer, entry->path);
+   rjsonwriter_raw(writer, ",", 1);
+
+   if (entry->entry_slot)
+   {
+      rjsonwriter_raw(writer, "\n", 1);
+      rjsonwriter_add_spaces(writer, 6);
+      rjsonwriter_add_string(writer, "entry_slot");
+      rjsonwriter_raw(writer, ":", 1);
+      rjsonwriter_raw(writer, " ", 1);
+      rjsonwriter_rawf(writer, "%d", (int)entry->entry_slot);
+      rjsonwriter_raw(writer, ",", 1);
+   }
+
+   rjsonwriter_raw(writer, "\n", 1);
+   rjsonwriter_add_spaces(writer, 6);
+   rjsonwriter_add_string(writer, "label");
+   rjsonwriter_raw(writer, ":", 1);
+   rjsonwriter_raw(writer, " ", 1);
+   rjsonwriter_add_string(writer, entry->label);
+   rjsonwriter_raw(writer, ",", 1);
+
+   rjsonwriter_raw(writer, "\n", 1);
+   rjsonwriter_add_spaces(writer, 6);
+   rjsonwriter_add_string(writer, "core_path");
+   rjsonwriter_raw(writer, ":", 1);
+   rjsonwriter_raw(writer, " ", 1);
+   rjsonwriter_add_string(writer, entry->core_path);
+   rjsonwriter_raw(writer, ",", 1);
+
+   rjsonwriter_raw(writer, "\n", 1);
+   rjsonwriter_add_spaces(writer, 6);
+   rjsonwriter_add_string(writer, "core_name");
+   rjsonwriter_raw(writer, ":", 1);
+   rjsonwriter_raw(writer, " ", 1);
+   rjsonwriter_add_string(writer, entry->core_name);
+   rjsonwriter_raw(writer, ",", 1);
+
+   rjsonwriter_raw(writer, "\n", 1);
+   rjsonwriter_add_spaces(writer, 6);
+   rjsonwriter_add_string(writer, "crc32");
+   rjsonwriter_raw(writer, ":", 1);
+   rjsonwriter_raw(writer, " ", 1);
+   rjsonwriter_add_string(writer, entry->crc32);
+   rjsonwriter_raw(writer, ",", 1);
+
+   rjsonwriter_raw(writer, "\n", 1);
+   rjsonwriter_add_spaces(writer, 6);
+   rjsonwriter_add_string(writer, "db_name");
+   rjsonwriter_raw(writer, ":", 1);
+   rjsonwriter_raw(writer, " ", 1);
+   rjsonwriter_add_string(writer, entry->db_name);
+
+   if (!string_is_empty(entry->subsystem_ident))
+   {
+      rjsonwriter_raw(writer, ",", 1);
+      rjsonwriter_raw(writer, "\n", 1);
+      rjsonwriter_add_spaces(writer, 6);
+      rjsonwriter_add_string(writer, "subsystem_ident");
+      rjsonwriter_raw(writer, ":", 1);
+      rjsonwriter_raw(writer, " ", 1);
+      rjsonwriter_add_string(writer, entry->subsystem_ident);
+   }
+
+   if (!string_is_empty(entry->subsystem_name))
+   {
+      rjsonwriter_raw(writer, ",", 1);
+      rjsonwriter_raw(writer, "\n", 1);
+      rjsonwriter_add_spaces(writer, 6);
+      rjsonwriter_add_string(writer, "subsystem_name");
+      rjsonwriter_raw(writer, ":", 1);
+      rjsonwriter_raw(writer, " ", 1);
+      rjsonwriter_add_string(writer, entry->subsystem_name);
+   }
+
+   if (  entry->subsystem_roms &&
+         entry->subsystem_roms->size > 0)
+   {
+      unsigned j;
+
+      rjsonwriter_raw(writer, ",", 1);
+      rjsonwriter_raw(writer, "\n", 1);
+      rjsonwriter_add_spaces(writer, 6);
+      rjsonwriter_add_string(writer, "subsystem_roms");
+      rjsonwriter_raw(writer, ":", 1);
+      rjsonwriter_raw(writer, " ", 1);
+      rjsonwriter_raw(writer, "[", 1);
+      rjsonwriter_raw(writer, "\n", 1);
+
+      for (j = 0; j < entry->subsystem_roms->size; j++)
+      {
+         const struct string_list *roms = entry->subsystem_roms;
+         rjsonwriter_add_spaces(writer, 8);
+         rjsonwriter_add_string(writer,
+               !string_is_empty(roms->elems[j].data)
+               ? roms->elems[j].data
+               : "");
+
+         if (j < entry->subsystem_roms->size - 1)
+         {
+            rjsonwriter_raw(writer, ",", 1);
+            rjsonwriter_raw(writer, "\n", 1);
+         }
+      }
+
+      rjsonwriter_raw(writer, "\n", 1);
+      rjsonwriter_add_spaces(writer, 6);
+      rjsonwriter_raw(writer, "]", 1);
+   }
+
+   rjsonwriter_raw(writer, "\n", 1);
+
+   rjsonwriter_add_spaces(writer, 4);
+   rjsonwriter_raw(writer, "}", 1);
+}
+
+/* Journal
+ * Changes to an otherwise unmodified playlist (pushing,
+ * updating and deleting entries) are appended to a
+ * journal next to the playlist file rather than
+ * rewriting the whole file. Each line holds one
+ * operation:
+ *   insert 0 <entry> : add entry at the top
+ *   move <n>         : move entry n to the top
+ *   delete <n>       : remove entry n
+ *   set <n> <entry>  : replace entry n
+ * where <entry> is {"items":[...]} holding the entry
+ * as written to the playlist file. The first line
+ * records the size and modification time of the
+ * playlist file the journal applies to. The journal
+ * is replayed when the playlist is read, and folded
+ * back into the file once it has grown too large */
+
+static void playlist_journal_get_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   size_t _len = strlcpy(s, playlist->config.path, len);
+   strlcpy(s + _len, PLAYLIST_JOURNAL_EXT, len - _len);
+}
+
+/* Fingerprints the playlist file a journal applies
+ * to, so a journal is never replayed over a file
+ * that was rewritten without it. Returns 'false'
+ * if the file's size or modification time is unknown */
+static bool playlist_journal_get_base(const char *path,
+      char *s, size_t len)
+{
+   int32_t size  = path_get_size(path);
+   int64_t mtime = path_get_mtime(path);
+
+   if (size <= 0 || mtime <= 0)
+      return false;
+
+   snprintf(s, len, "lpl %u %u\n", (unsigned)size, (unsigned)mtime);
+   return true;
+}
+
+/* Changes can be journaled if the playlist file
+ * is otherwise up to date */
+static bool playlist_journal_enabled(const playlist_t *playlist)
+{
+   return     !(playlist->flags & CNT_PLAYLIST_FLG_MOD)
+         && !string_is_empty(playlist->config.path)
+         && (((playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)    > 0) == playlist->config.old_format)
+#if defined(HAVE_ZLIB)
+         && (((playlist->flags & CNT_PLAYLIST_FLG_COMPRESSED) > 0) == playlist->config.compress)
+#endif
+         ;
+}
+
+static bool playlist_journal_add(playlist_t *playlist,
+      const char *op, size_t idx, const struct playlist_entry *entry)
+{
+   char prefix[32];
+   size_t i;
+   rjsonwriter_t *writer = NULL;
+   char *json            = NULL;
+   int json_len          = 0;
+   size_t len            = RBUF_LEN(playlist->journal);
+   size_t _len           = snprintf(prefix, sizeof(prefix),
+         "%s %u", op, (unsigned)idx);
+
+   if (entry)
+   {
+      if (!(writer = rjsonwriter_open_memory()))
+         return false;
+
+      rjsonwriter_raw(writer, "{", 1);
+      rjsonwriter_add_string(writer, "items");
+      rjsonwriter_raw(writer, ":", 1);
+      rjsonwriter_raw(writer, "[", 1);
+      playlist_write_entry(writer, entry);
+      rjsonwriter_raw(writer, "]", 1);
+      rjsonwriter_raw(writer, "}", 1);
+
+      if (!(json = rjsonwriter_get_memory_buffer(writer, &json_len)))
+      {
+         rjsonwriter_free(writer);
+         return false;
+      }
+
+      /* Strings are escaped, so any newline is
+       * formatting - keep each operation on one line */
+      for (i = 0; i < (size_t)json_len; i++)
+         if (json[i] == '\n')
+            json[i] = ' ';
+   }
+
+   if (!RBUF_TRYFIT(playlist->journal, len + _len + json_len + 2))
+   {
+      if (writer)
+         rjsonwriter_free(writer);
+      return false; /* out of memory */
+   }
+
+   RBUF_RESIZE(playlist->journal, len + _len);
+   memcpy(playlist->journal + len, prefix, _len);
+   if (json)
+   {
+      RBUF_PUSH(playlist->journal, ' ');
+      len = RBUF_LEN(playlist->journal);
+      RBUF_RESIZE(playlist->journal, len + json_len);
+      memcpy(playlist->journal + len, json, json_len);
+      rjsonwriter_free(writer);
+   }
+   RBUF_PUSH(playlist->journal, '\n');
+
+   return true;
+}
+
+/* Appends pending operations to the journal. Returns
+ * 'false' if the playlist file must be rewritten instead */
+static bool playlist_journal_write(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   char base[64];
+   RFILE *file;
+   int32_t journal_size;
+   size_t len        = RBUF_LEN(playlist->journal);
+   int32_t base_size = path_get_size(playlist->config.path);
+
+   if (base_size <= 0)
+      return false;
+
+   playlist_journal_get_path(playlist, journal_path, sizeof(journal_path));
+   if ((journal_size = path_get_size(journal_path)) < 0)
+      journal_size = 0;
+
+   /* Replaying a large journal costs more than
+    * reading the playlist file it applies to */
+   if ((size_t)journal_size + len
+         > (size_t)base_size / 2 + PLAYLIST_JOURNAL_SLACK)
+      return false;
+
+   if (journal_size > 0)
+   {
+      if (!(file = filestream_open(journal_path,
+            RETRO_VFS_FILE_ACCESS_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         return false;
+      filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END);
+   }
+   else
+   {
+      if (     !playlist_journal_get_base(playlist->config.path,
+                  base, sizeof(base))
+            || !(file = filestream_open(journal_path,
+                  RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         return false;
+      filestream_printf(file, "%s", base);
+   }
+
+   if (filestream_write(file, playlist->journal, len) != (int64_t)len)
+   {
+      filestream_close(file);
+      return false;
+   }
+
+   filestream_close(file);
+   RBUF_CLEAR(playlist->journal);
+
+   RARCH_LOG("[Playlist]: Written to playlist journal: \"%s\".\n", journal_path);
+   return true;
+}
+
+/* Discards the journal once the playlist file
+ * has been rewritten */
+static void playlist_journal_reset(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+
+   RBUF_FREE(playlist->journal);
+
+   playlist_journal_get_path(playlist, journal_path, sizeof(journal_path));
+   if (path_is_valid(journal_path))
+      filestream_delete(journal_path);
+}
+
 /**
  * playlist_free_entry:
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(const playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
-   if (entry->path)
-      free(entry->path);
-   if (entry->label)
-      free(entry->label);
-   if (entry->core_path)
-      free(entry->core_path);
-   if (entry->core_name)
-      free(entry->core_name);
-   if (entry->db_name)
-      free(entry->db_name);
-   if (entry->crc32)
-      free(entry->crc32);
-   if (entry->subsystem_ident)
-      free(entry->subsystem_ident);
-   if (entry->subsystem_name)
-      free(entry->subsystem_name);
+   playlist_free_string(playlist, entry->path);
+   playlist_free_string(playlist, entry->label);
+   playlist_free_string(playlist, entry->core_path);
+   playlist_free_string(playlist, entry->core_name);
+   playlist_free_string(playlist, entry->db_name);
+   playlist_free_string(playlist, entry->crc32);
+   playlist_free_string(playlist, entry->subsystem_ident);
+   playlist_free_string(playlist, entry->subsystem_name);
    if (entry->runtime_str)
       free(entry->runtime_str);
    if (entry->last_played_str)
@@ -643,6 +1254,7 @@ void playlist_delete_index(playlist_t *playlist,
       size_t idx)
 {
    size_t len;
+   bool journal;
    struct playlist_entry *entry_to_delete;
 
    if (!playlist)
@@ -652,10 +1264,15 @@ void playlist_delete_index(playlist_t *playlist,
    if (idx >= len)
       return;
 
+   journal = playlist_journal_enabled(playlist);
+
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
-      playlist_free_entry(entry_to_delete);
+   {
+      playlist_path_index_remove(playlist, entry_to_delete);
+      playlist_free_entry(playlist, entry_to_delete);
+   }
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -663,7 +1280,8 @@ void playlist_delete_index(playlist_t *playlist,
 
    RBUF_RESIZE(playlist->entries, len - 1);
 
-   playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+   if (!journal || !playlist_journal_add(playlist, "delete", idx, NULL))
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
 }
 
 /**
@@ -686,6 +1304,13 @@ void playlist_delete_by_path(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(search_path)))
       return;
 
+   if (playlist_path_index_find(playlist, path_id)
+         == PLAYLIST_PATH_INDEX_NO_MATCH)
+   {
+      playlist_path_id_free(path_id);
+      return;
+   }
+
    while (i < RBUF_LEN(playlist->entries))
    {
       if (!playlist_path_matches_entry(path_id,
@@ -718,7 +1343,13 @@ void playlist_get_index_by_path(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(search_path)))
       return;
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+   if (playlist_path_index_find(playlist, path_id)
+         == PLAYLIST_PATH_INDEX_NO_MATCH)
+      len = 0;
+   else
+      len = RBUF_LEN(playlist->entries);
+
+   for (i = 0; i < len; i++)
    {
       if (!playlist_path_matches_entry(path_id,
             &playlist->entries[i], &playlist->config))
@@ -743,6 +1374,18 @@ bool playlist_entry_exists(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(path)))
       return false;
 
+   switch (playlist_path_index_find(playlist, path_id))
+   {
+      case PLAYLIST_PATH_INDEX_MATCH:
+         playlist_path_id_free(path_id);
+         return true;
+      case PLAYLIST_PATH_INDEX_NO_MATCH:
+         playlist_path_id_free(path_id);
+         return false;
+      default:
+         break;
+   }
+
    for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
    {
       if (playlist_path_matches_entry(path_id,
@@ -760,17 +1403,20 @@ bool playlist_entry_exists(playlist_t *playlist,
 void playlist_update(playlist_t *playlist, size_t idx,
       const struct playlist_entry *update_entry)
 {
+   bool journal;
    struct playlist_entry *entry = NULL;
 
    if (!playlist || idx >= RBUF_LEN(playlist->entries))
       return;
 
    entry            = &playlist->entries[idx];
+   journal          = playlist_journal_enabled(playlist);
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
-      if (entry->path)
-         free(entry->path);
+      playlist_path_index_remove(playlist, entry);
+
+      playlist_free_string(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
 
       if (entry->path_id)
@@ -779,48 +1425,50 @@ void playlist_update(playlist_t *playlist, size_t idx,
          entry->path_id  = NULL;
       }
 
+      playlist_path_index_add(playlist, entry);
+
       playlist->flags |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->label && (update_entry->label != entry->label))
    {
-      if (entry->label)
-         free(entry->label);
+      playlist_free_string(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
-      if (entry->core_path)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path   = strdup(update_entry->core_path);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
-      if (entry->core_name)
-         free(entry->core_name);
+      playlist_free_string(playlist, entry->core_name);
       entry->core_name   = strdup(update_entry->core_name);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
-      if (entry->db_name)
-         free(entry->db_name);
+      playlist_free_string(playlist, entry->db_name);
       entry->db_name     = strdup(update_entry->db_name);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
-      if (entry->crc32)
-         free(entry->crc32);
+      playlist_free_string(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
+
+   if (     journal
+         && (playlist->flags & CNT_PLAYLIST_FLG_MOD)
+         && playlist_journal_add(playlist, "set", idx, entry))
+      playlist->flags   &= ~CNT_PLAYLIST_FLG_MOD;
 }
 
 void playlist_update_runtime(playlist_t *playlist, size_t idx,
@@ -836,8 +1484,9 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
-      if (entry->path)
-         free(entry->path);
+      playlist_path_index_remove(playlist, entry);
+
+      playlist_free_string(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
 
       if (entry->path_id)
@@ -846,14 +1495,15 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
          entry->path_id  = NULL;
       }
 
+      playlist_path_index_add(playlist, entry);
+
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
-      if (entry->core_path)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path      = strdup(update_entry->core_path);
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
@@ -983,7 +1633,13 @@ bool playlist_push_runtime(playlist_t *playlist,
    }
 
    len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+
+   /* Skip the search for a duplicate entry if
+    * none can have the same content path */
+   i   = (playlist_path_index_find(playlist, path_id)
+         == PLAYLIST_PATH_INDEX_NO_MATCH) ? len : 0;
+
+   for (; i < len; i++)
    {
       struct playlist_entry tmp;
       bool equal_path  = (string_is_empty(path_id->real_path)
@@ -1020,7 +1676,8 @@ bool playlist_push_runtime(playlist_t *playlist,
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
-      playlist_free_entry(last_entry);
+      playlist_path_index_remove(playlist, last_entry);
+      playlist_free_entry(playlist, last_entry);
       len--;
    }
    else
@@ -1043,6 +1700,7 @@ bool playlist_push_runtime(playlist_t *playlist,
          playlist->entries[0].path            = strdup(path_id->real_path);
       playlist->entries[0].path_id            = path_id;
       path_id                                 = NULL;
+      playlist_path_index_add(playlist, &playlist->entries[0]);
 
       if (!string_is_empty(real_core_path))
          playlist->entries[0].core_path       = strdup(real_core_path);
@@ -1305,10 +1963,13 @@ bool playlist_push(playlist_t *playlist,
    playlist_path_id_t *path_id = NULL;
    const char *core_name       = entry->core_name;
    bool entry_updated          = false;
+   bool journal                = false;
 
    if (!playlist || !entry)
       goto error;
 
+   journal                     = playlist_journal_enabled(playlist);
+
    if (string_is_empty(entry->core_path))
    {
       RARCH_ERR("Cannot push NULL or empty core path into the playlist.\n");
@@ -1348,7 +2009,13 @@ bool playlist_push(playlist_t *playlist,
    }
 
    len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+
+   /* Skip the search for a duplicate entry if
+    * none can have the same content path */
+   i   = (playlist_path_index_find(playlist, path_id)
+         == PLAYLIST_PATH_INDEX_NO_MATCH) ? len : 0;
+
+   for (; i < len; i++)
    {
       struct playlist_entry tmp;
       bool equal_path  = (string_is_empty(path_id->real_path)
@@ -1458,7 +2125,11 @@ bool playlist_push(playlist_t *playlist,
       if (i == 0)
       {
          if (entry_updated)
+         {
+            journal = journal && playlist_journal_add(playlist,
+                  "set", 0, &playlist->entries[0]);
             goto success;
+         }
 
          goto error;
       }
@@ -1469,6 +2140,11 @@ bool playlist_push(playlist_t *playlist,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
 
+      journal = journal
+            && playlist_journal_add(playlist, "move", i, NULL)
+            && (!entry_updated || playlist_journal_add(playlist,
+                  "set", 0, &playlist->entries[0]));
+
       goto success;
    }
 
@@ -1478,8 +2154,12 @@ bool playlist_push(playlist_t *playlist,
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
-      playlist_free_entry(last_entry);
+      playlist_path_index_remove(playlist, last_entry);
+      playlist_free_entry(playlist, last_entry);
       len--;
+
+      journal = journal && playlist_journal_add(playlist,
+            "delete", len, NULL);
    }
    else
    {
@@ -1521,6 +2201,7 @@ bool playlist_push(playlist_t *playlist,
          playlist->entries[0].path            = strdup(path_id->real_path);
       playlist->entries[0].path_id            = path_id;
       path_id                                 = NULL;
+      playlist_path_index_add(playlist, &playlist->entries[0]);
 
       playlist->entries[0].entry_slot         = entry->entry_slot;
 
@@ -1548,12 +2229,16 @@ bool playlist_push(playlist_t *playlist,
          for (i = 0; i < entry->subsystem_roms->size; i++)
             string_list_append(playlist->entries[0].subsystem_roms, entry->subsystem_roms->elems[i].data, attributes);
       }
+
+      journal = journal && playlist_journal_add(playlist,
+            "insert", 0, &playlist->entries[0]);
    }
 
 success:
    if (path_id)
       playlist_path_id_free(path_id);
-   playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
+   if (!journal)
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
    return true;
 
 error:
@@ -1568,7 +2253,9 @@ void playlist_write_runtime_file(playlist_t *playlist)
    intfstream_t *file  = NULL;
    rjsonwriter_t* writer;
 
-   if (!playlist || !(playlist->flags & CNT_PLAYLIST_FLG_MOD))
+   if (     !playlist
+         || !(   (playlist->flags & CNT_PLAYLIST_FLG_MOD)
+              || RBUF_LEN(playlist->journal)))
       return;
 
    if (!(file = intfstream_open_file(playlist->config.path,
@@ -1714,6 +2401,7 @@ void playlist_write_runtime_file(playlist_t *playlist)
                                | CNT_PLAYLIST_FLG_COMPRESSED);
 
    RARCH_LOG("[Playlist]: Written to playlist file: \"%s\".\n", playlist->config.path);
+   playlist_journal_reset(playlist);
 end:
    intfstream_close(file);
    free(file);
@@ -1735,13 +2423,24 @@ void playlist_write_file(playlist_t *playlist)
    bool pl_compressed   = ((playlist->flags & CNT_PLAYLIST_FLG_COMPRESSED) > 0);
    bool pl_old_fmt      = ((playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)    > 0);
 
-   if (   !playlist
-       || !((playlist->flags & CNT_PLAYLIST_FLG_MOD) ||
+   if (!playlist)
+      return;
+
+   if (!((playlist->flags & CNT_PLAYLIST_FLG_MOD) ||
 #if defined(HAVE_ZLIB)
         (pl_compressed != playlist->config.compress) ||
 #endif
         (pl_old_fmt    != playlist->config.old_format)))
-      return;
+   {
+      /* Only journaled changes (if any) - append them,
+       * unless the journal has grown large enough to
+       * be folded back into the playlist file */
+      if (     !RBUF_LEN(playlist->journal)
+            || playlist_journal_write(playlist))
+         return;
+
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+   }
 
 #if defined(HAVE_ZLIB)
    if (playlist->config.compress)
@@ -1967,128 +2666,7 @@ void playlist_write_file(playlist_t *playlist)
 
       for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
       {
-         rjsonwriter_add_spaces(writer, 4);
-         rjsonwriter_raw(writer, "{", 1);
-
-         rjsonwriter_raw(writer, "\n", 1);
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "path");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_add_string(writer, playlist->entries[i].path);
-         rjsonwriter_raw(writer, ",", 1);
-
-         if (playlist->entries[i].entry_slot)
-         {
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 6);
-            rjsonwriter_add_string(writer, "entry_slot");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_rawf(writer, "%d", (int)playlist->entries[i].entry_slot);
-            rjsonwriter_raw(writer, ",", 1);
-         }
-
-         rjsonwriter_raw(writer, "\n", 1);
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "label");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_add_string(writer, playlist->entries[i].label);
-         rjsonwriter_raw(writer, ",", 1);
-
-         rjsonwriter_raw(writer, "\n", 1);
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "core_path");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_add_string(writer, playlist->entries[i].core_path);
-         rjsonwriter_raw(writer, ",", 1);
-
-         rjsonwriter_raw(writer, "\n", 1);
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "core_name");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_add_string(writer, playlist->entries[i].core_name);
-         rjsonwriter_raw(writer, ",", 1);
-
-         rjsonwriter_raw(writer, "\n", 1);
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "crc32");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_add_string(writer, playlist->entries[i].crc32);
-         rjsonwriter_raw(writer, ",", 1);
-
-         rjsonwriter_raw(writer, "\n", 1);
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "db_name");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_add_string(writer, playlist->entries[i].db_name);
-
-         if (!string_is_empty(playlist->entries[i].subsystem_ident))
-         {
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 6);
-            rjsonwriter_add_string(writer, "subsystem_ident");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_add_string(writer, playlist->entries[i].subsystem_ident);
-         }
-
-         if (!string_is_empty(playlist->entries[i].subsystem_name))
-         {
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 6);
-            rjsonwriter_add_string(writer, "subsystem_name");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_add_string(writer, playlist->entries[i].subsystem_name);
-         }
-
-         if (  playlist->entries[i].subsystem_roms &&
-               playlist->entries[i].subsystem_roms->size > 0)
-         {
-            unsigned j;
-
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 6);
-            rjsonwriter_add_string(writer, "subsystem_roms");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_raw(writer, "[", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-
-            for (j = 0; j < playlist->entries[i].subsystem_roms->size; j++)
-            {
-               const struct string_list *roms = playlist->entries[i].subsystem_roms;
-               rjsonwriter_add_spaces(writer, 8);
-               rjsonwriter_add_string(writer,
-                     !string_is_empty(roms->elems[j].data)
-                     ? roms->elems[j].data
-                     : "");
-
-               if (j < playlist->entries[i].subsystem_roms->size - 1)
-               {
-                  rjsonwriter_raw(writer, ",", 1);
-                  rjsonwriter_raw(writer, "\n", 1);
-               }
-            }
-
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 6);
-            rjsonwriter_raw(writer, "]", 1);
-         }
-
-         rjsonwriter_raw(writer, "\n", 1);
-
-         rjsonwriter_add_spaces(writer, 4);
-         rjsonwriter_raw(writer, "}", 1);
+         playlist_write_entry(writer, &playlist->entries[i]);
 
          if (i < len - 1)
             rjsonwriter_raw(writer, ",", 1);
@@ -2121,6 +2699,9 @@ void playlist_write_file(playlist_t *playlist)
 end:
    intfstream_close(file);
    free(file);
+
+   if (!(playlist->flags & CNT_PLAYLIST_FLG_MOD))
+      playlist_journal_reset(playlist);
 }
 
 /**
@@ -2167,12 +2748,16 @@ void playlist_free(playlist_t *playlist)
          struct playlist_entry *entry = &playlist->entries[i];
 
          if (entry)
-            playlist_free_entry(entry);
+            playlist_free_entry(playlist, entry);
       }
 
       RBUF_FREE(playlist->entries);
    }
 
+   playlist_path_index_free(playlist);
+   playlist_pool_free(playlist);
+   RBUF_FREE(playlist->journal);
+
    free(playlist);
 }
 
@@ -2193,9 +2778,17 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
    RBUF_CLEAR(playlist->entries);
+   playlist_path_index_free(playlist);
+   playlist_pool_free(playlist);
+
+   /* Later changes can't be journaled against
+    * the entries in the playlist file */
+   RBUF_FREE(playlist->journal);
+   if (len)
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
 }
 
 /**
@@ -2345,9 +2938,11 @@ static bool JSONStringHandler(void *context, const char *pValue, size_t length)
                && length
                && !string_is_empty(pValue))
          {
-            if (*pCtx->current_string_val)
-                free(*pCtx->current_string_val);
-             *pCtx->current_string_val = strdup(pValue);
+            playlist_free_string(pCtx->playlist,
+                  *pCtx->current_string_val);
+            *pCtx->current_string_val = playlist_pool_strdup(
+                  pCtx->playlist, pValue,
+                  pCtx->flags & JSON_CTX_FLG_INTERN);
          }
       }
    }
@@ -2447,7 +3042,8 @@ static bool JSONObjectMemberHandler(void *context, const char *pValue, size_t le
          {
             pCtx->current_string_val     = NULL;
             pCtx->current_entry_uint_val = NULL;
-            pCtx->flags                 &= ~(JSON_CTX_FLG_IN_SUBSYSTEM_CONTENT);
+            pCtx->flags                 &= ~(JSON_CTX_FLG_IN_SUBSYSTEM_CONTENT
+                                           | JSON_CTX_FLG_INTERN);
             switch (pValue[0])
             {
                case 'c':
@@ -2503,6 +3099,14 @@ static bool JSONObjectMemberHandler(void *context, const char *pValue, size_t le
                         pCtx->flags |= (JSON_CTX_FLG_IN_SUBSYSTEM_CONTENT);
                      break;
             }
+
+            /* Values shared by most entries are only stored once */
+            if (     (pCtx->current_string_val == &pCtx->current_entry->core_name)
+                  || (pCtx->current_string_val == &pCtx->current_entry->core_path)
+                  || (pCtx->current_string_val == &pCtx->current_entry->db_name)
+                  || (pCtx->current_string_val == &pCtx->current_entry->subsystem_ident)
+                  || (pCtx->current_string_val == &pCtx->current_entry->subsystem_name))
+               pCtx->flags |= JSON_CTX_FLG_INTERN;
          }
       }
    }
@@ -2593,6 +3197,7 @@ static bool playlist_read_file(playlist_t *playlist)
 {
    unsigned i;
    int test_char;
+   int64_t size;
    bool res             = true;
 #if defined(HAVE_ZLIB)
       /* Always use RZIP interface when reading playlists
@@ -2636,6 +3241,14 @@ static bool playlist_read_file(playlist_t *playlist)
    /* Reset file to start */
    intfstream_rewind(file);
 
+   /* Entry strings can't take up more space than
+    * the file itself */
+   if ((size = intfstream_get_size(file)) > 0)
+   {
+      if ((playlist->strings = (char*)malloc((size_t)size)))
+         playlist->strings_size = (size_t)size;
+   }
+
    if (!(playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT))
    {
       rjson_t* parser;
@@ -2733,27 +3346,33 @@ static bool playlist_read_file(playlist_t *playlist)
 
             /* path */
             if (!string_is_empty(line_buf[0]))
-               entry->path      = strdup(line_buf[0]);
+               entry->path      = playlist_pool_strdup(playlist,
+                     line_buf[0], false);
 
             /* label */
             if (!string_is_empty(line_buf[1]))
-               entry->label     = strdup(line_buf[1]);
+               entry->label     = playlist_pool_strdup(playlist,
+                     line_buf[1], false);
 
             /* core_path */
             if (!string_is_empty(line_buf[2]))
-               entry->core_path = strdup(line_buf[2]);
+               entry->core_path = playlist_pool_strdup(playlist,
+                     line_buf[2], true);
 
             /* core_name */
             if (!string_is_empty(line_buf[3]))
-               entry->core_name = strdup(line_buf[3]);
+               entry->core_name = playlist_pool_strdup(playlist,
+                     line_buf[3], true);
 
             /* crc32 */
             if (!string_is_empty(line_buf[4]))
-               entry->crc32     = strdup(line_buf[4]);
+               entry->crc32     = playlist_pool_strdup(playlist,
+                     line_buf[4], false);
 
             /* db_name */
             if (!string_is_empty(line_buf[5]))
-               entry->db_name   = strdup(line_buf[5]);
+               entry->db_name   = playlist_pool_strdup(playlist,
+                     line_buf[5], true);
          }
          /* If fewer than 'PLAYLIST_ENTRIES' lines were
           * read, then this is metadata */
@@ -2877,11 +3496,184 @@ static bool playlist_read_file(playlist_t *playlist)
    }
 
 end:
+   playlist_pool_finalize(playlist);
    intfstream_close(file);
    free(file);
    return res;
 }
 
+static bool playlist_journal_read_entry(const char *json,
+      struct playlist_entry *entry)
+{
+   rjson_t *parser;
+   playlist_t scratch;
+   JSONContext context = {0};
+   bool ret            = false;
+
+   memset(&scratch, 0, sizeof(scratch));
+   scratch.config.capacity = 1;
+   context.playlist        = &scratch;
+
+   if (!(parser = rjson_open_string(json, strlen(json))))
+      return false;
+
+   rjson_set_options(parser,
+           RJSON_OPTION_ALLOW_UNESCAPED_CONTROL_CHARACTERS
+         | RJSON_OPTION_REPLACE_INVALID_ENCODING);
+
+   ret = (rjson_parse(parser, &context,
+            JSONObjectMemberHandler,
+            JSONStringHandler,
+            JSONNumberHandler,
+            JSONStartObjectHandler,
+            JSONEndObjectHandler,
+            JSONStartArrayHandler,
+            JSONEndArrayHandler,
+            JSONBoolHandler,
+            NULL) == RJSON_DONE)
+         && (RBUF_LEN(scratch.entries) == 1);
+   rjson_free(parser);
+
+   if (scratch.entries)
+   {
+      /* The first entry is cleared as soon as
+       * it is started, even if left incomplete */
+      if (ret)
+         *entry = scratch.entries[0];
+      else
+         playlist_free_entry(&scratch, &scratch.entries[0]);
+      RBUF_FREE(scratch.entries);
+   }
+
+   return ret;
+}
+
+static bool playlist_journal_apply(playlist_t *playlist, char *line)
+{
+   struct playlist_entry entry;
+   char *json;
+   size_t idx;
+   size_t len = RBUF_LEN(playlist->entries);
+   char *arg  = strchr(line, ' ');
+
+   if (!arg)
+      return false;
+
+   *arg++ = '\0';
+   idx    = (size_t)strtoul(arg, &json, 10);
+
+   if (string_is_equal(line, "move"))
+   {
+      if (idx >= len)
+         return false;
+
+      entry = playlist->entries[idx];
+      memmove(playlist->entries + 1, playlist->entries,
+            idx * sizeof(struct playlist_entry));
+      playlist->entries[0] = entry;
+      return true;
+   }
+
+   if (string_is_equal(line, "delete"))
+   {
+      if (idx >= len)
+         return false;
+
+      playlist_free_entry(playlist, &playlist->entries[idx]);
+      RBUF_REMOVE(playlist->entries, idx);
+      return true;
+   }
+
+   if (     (*json != ' ')
+         || !playlist_journal_read_entry(json + 1, &entry))
+      return false;
+
+   if (string_is_equal(line, "insert") && RBUF_TRYFIT(playlist->entries, len + 1))
+   {
+      RBUF_RESIZE(playlist->entries, len + 1);
+      memmove(playlist->entries + 1, playlist->entries,
+            len * sizeof(struct playlist_entry));
+      playlist->entries[0] = entry;
+      return true;
+   }
+
+   if (string_is_equal(line, "set") && idx < len)
+   {
+      playlist_free_entry(playlist, &playlist->entries[idx]);
+      playlist->entries[idx] = entry;
+      return true;
+   }
+
+   playlist_free_entry(playlist, &entry);
+   return false;
+}
+
+/* Applies the journal (see playlist_journal_add())
+ * to a freshly read playlist */
+static void playlist_journal_replay(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   char base[64];
+   char *line, *next;
+   size_t i, len;
+   void *buf      = NULL;
+   int64_t size   = 0;
+   unsigned count = 0;
+
+   if (string_is_empty(playlist->config.path))
+      return;
+
+   playlist_journal_get_path(playlist, journal_path, sizeof(journal_path));
+   if (     !path_is_valid(journal_path)
+         || !filestream_read_file(journal_path, &buf, &size))
+      return;
+
+   /* Journal is useless if the playlist file was
+    * rewritten without it (e.g. by an older build) */
+   line = (char*)buf;
+   if (     !playlist_journal_get_base(playlist->config.path,
+               base, sizeof(base))
+         || strncmp(line, base, strlen(base)))
+   {
+      RARCH_WARN("[Playlist]: Discarding outdated playlist journal: \"%s\".\n",
+            journal_path);
+      free(buf);
+      filestream_delete(journal_path);
+      return;
+   }
+
+   for (line += strlen(base); *line; line = next + 1, count++)
+   {
+      /* Last line is incomplete if writing it was
+       * interrupted - everything before it still
+       * applies, and the next write will fold the
+       * journal into the playlist file */
+      if (     !(next = strchr(line, '\n'))
+            || (*next = '\0', !playlist_journal_apply(playlist, line)))
+      {
+         RARCH_WARN("[Playlist]: Ignoring damaged playlist journal entry: \"%s\".\n",
+               journal_path);
+         playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+         break;
+      }
+   }
+
+   free(buf);
+
+   /* Capacity may have been reduced since */
+   if ((len = RBUF_LEN(playlist->entries)) > playlist->config.capacity)
+   {
+      for (i = playlist->config.capacity; i < len; i++)
+         playlist_free_entry(playlist, &playlist->entries[i]);
+      RBUF_RESIZE(playlist->entries, playlist->config.capacity);
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+   }
+
+   if (count)
+      RARCH_LOG("[Playlist]: Replayed %u changes from playlist journal: \"%s\".\n",
+            count, journal_path);
+}
+
 void playlist_free_cached(void)
 {
    if (playlist_cached && !(playlist_cached->flags & CNT_PLAYLIST_FLG_CACHED_EXT))
@@ -2939,6 +3731,13 @@ playlist_t *playlist_init(const playlist_config_t *config)
    playlist->default_core_path              = NULL;
    playlist->base_content_directory         = NULL;
    playlist->entries                        = NULL;
+   playlist->path_index                     = NULL;
+   playlist->archive_index                  = NULL;
+   playlist->strings                        = NULL;
+   playlist->strings_interned               = NULL;
+   playlist->strings_size                   = 0;
+   playlist->strings_used                   = 0;
+   playlist->journal                        = NULL;
    playlist->label_display_mode             = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode           = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode            = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -2960,6 +3759,8 @@ playlist_t *playlist_init(const playlist_config_t *config)
    if (!playlist_read_file(playlist))
       goto error;
 
+   playlist_journal_replay(playlist);
+
    /* Try auto-fixing paths if enabled, and playlist
     * base content directory is different */
    if (config->autofix_paths &&
@@ -2985,7 +3786,7 @@ playlist_t *playlist_init(const playlist_config_t *config)
                   playlist->base_content_directory, playlist->config.base_content_directory,
                   sizeof(tmp_entry_path));
 
-            free(entry->path);
+            playlist_free_string(playlist, entry->path);
             entry->path = strdup(tmp_entry_path);
 
             /* Fix subsystem roms paths*/
@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <compat/msvc.h>
 #include <compat/strl.h>
@@ -30,6 +31,7 @@
 #include <file/config_file.h>
 #include <audio/audio_resampler.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
 #include <audio/conversion/float_to_s16.h>
 #include <audio/conversion/s16_to_float.h>
 
@@ -74,13 +76,89 @@ extern "C" {
 #endif
 #define HAVE_CH_LAYOUT (LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 28, 100))
 
+#define MAX_FRAMES 32
+#define MAX_SCALE_WORKERS 4
+/* Converted frames each scale worker may have waiting
+ * for the encoder. */
+#define SCALE_QUEUE_SIZE 4
+/* Encoded packets waiting to be written out. */
+#define MUX_QUEUE_SIZE 64
+
+/* Bounded single-producer, single-consumer queue between
+ * two stages of the pipeline. Pushing to a full queue
+ * blocks, which is how a slow stage holds back the ones
+ * feeding it; how often and how long that happens is
+ * counted. */
+struct ff_queue_item
+{
+   void *data;
+   retro_time_t time;
+};
+
+struct ff_queue
+{
+   slock_t *lock;
+   scond_t *cond;
+   struct ff_queue_item *items;
+   unsigned size;
+   unsigned head;
+   unsigned count;
+   bool closed;
+
+   unsigned pushed;
+   /* Pushes that found the queue full. */
+   unsigned full;
+   retro_time_t full_time;
+   unsigned peak;
+};
+
+/* A frame handed from the runloop to the scale workers.
+ * The pixels are copied once into buf, which is aligned
+ * and has an aligned pitch so it can be fed to the scaler
+ * as is. Dupe frames carry no pixels at all. */
+struct ff_video_slot
+{
+   struct record_video_data attr;
+   uint8_t *buf;
+   retro_time_t enqueue_time;
+   bool done;
+};
+
+struct ff_scale_worker
+{
+   struct ffmpeg *handle;
+   sthread_t *thread;
+   /* Converted frames, in order. NULL for dupe frames. */
+   struct ff_queue out;
+   struct scaler_ctx scaler;
+   struct SwsContext *sws;
+   unsigned index;
+};
+
+struct ff_video_stats
+{
+   unsigned frames;
+   unsigned dupes;
+   /* Time spent in ffmpeg_push_video(), including waiting
+    * for a free slot. */
+   retro_time_t enqueue_total;
+   retro_time_t enqueue_max;
+   /* Time from a frame being queued until it is scaled
+    * and encoded. */
+   retro_time_t encode_total;
+   retro_time_t encode_max;
+};
+
 struct ff_video_info
 {
    AVCodecContext *codec;
    const AVCodec *encoder;
 
-   AVFrame *conv_frame;
-   uint8_t *conv_frame_buf;
+   /* Converted frames are allocated from the pool, and
+    * the encoder keeps the last one to repeat for dupes. */
+   AVBufferPool *frame_pool;
+   int frame_size;
+   AVFrame *last_frame;
    int64_t frame_cnt;
 
    uint8_t *outbuf;
@@ -99,8 +177,8 @@ struct ff_video_info
 
    AVFormatContext *format;
 
+   /* Template for the scale workers' own scalers. */
    struct scaler_ctx scaler;
-   struct SwsContext *sws;
    bool use_sws;
 };
 
@@ -190,10 +268,33 @@ typedef struct ffmpeg
    slock_t *cond_lock;
    slock_t *lock;
    fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
    sthread_t *thread;
 
+   /* Video goes runloop -> slots -> scale workers ->
+    * encoder thread (along with audio) -> mux thread. */
+
+   /* Ring of video frames. Slots between slot_read and
+    * slot_write belong to the scale workers, the rest to
+    * the runloop. Both counters and the done flags are
+    * only changed under lock, and slot_cond is broadcast
+    * whenever they change. */
+   struct ff_video_slot slots[MAX_FRAMES];
+   size_t slot_pitch;
+   unsigned slot_read;
+   unsigned slot_write;
+   scond_t *slot_cond;
+   bool video_closed;
+
+   /* Frame n is scaled by worker n % scale_workers. */
+   struct ff_scale_worker workers[MAX_SCALE_WORKERS];
+   unsigned scale_workers;
+   unsigned video_next;
+
+   struct ff_queue mux_queue;
+   sthread_t *mux_thread;
+
+   struct ff_video_stats stats;
+
    volatile bool alive;
    volatile bool can_sleep;
 } ffmpeg_t;
@@ -385,7 +486,6 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle, const char *audio_resampler)
 
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
-   size_t size;
    struct ff_config_param *params  = &handle->config;
    struct ff_video_info *video     = &handle->video;
    struct record_params *param     = &handle->params;
@@ -507,20 +607,12 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    video->frame_drop_ratio = params->frame_drop_ratio;
 
-   size = av_image_get_buffer_size(video->pix_fmt, param->out_width,
-         param->out_height, 1);
-   video->conv_frame_buf   = (uint8_t*)av_malloc(size);
-   video->conv_frame       = av_frame_alloc();
+   video->frame_size       = av_image_get_buffer_size(video->pix_fmt,
+         param->out_width, param->out_height, 1);
+   video->frame_pool       = av_buffer_pool_init(video->frame_size,
+         av_buffer_alloc);
 
-   AVFrame* frame = video->conv_frame;
-   av_image_fill_arrays(frame->data, frame->linesize, video->conv_frame_buf,
-         video->pix_fmt, param->out_width, param->out_height, 1);
-
-   video->conv_frame->width  = param->out_width;
-   video->conv_frame->height = param->out_height;
-   video->conv_frame->format = video->pix_fmt;
-
-   return true;
+   return video->frame_pool != NULL;
 }
 
 static bool ffmpeg_init_config_common(struct ff_config_param *params,
@@ -877,67 +969,292 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
    return avformat_write_header(handle->muxer.ctx, NULL) >= 0;
 }
 
-#define MAX_FRAMES 32
-
 static void ffmpeg_thread(void *data);
+static void ffmpeg_scale_thread(void *data);
+static void ffmpeg_mux_thread(void *data);
+
+static bool ff_queue_init(struct ff_queue *queue, unsigned size)
+{
+   queue->items = (struct ff_queue_item*)calloc(size, sizeof(*queue->items));
+   queue->lock  = slock_new();
+   queue->cond  = scond_new();
+   queue->size  = size;
+
+   return queue->items && queue->lock && queue->cond;
+}
+
+static void ff_queue_free(struct ff_queue *queue,
+      void (*free_item)(void *data))
+{
+   for (; queue->count; queue->count--)
+   {
+      free_item(queue->items[queue->head].data);
+      queue->head = (queue->head + 1) % queue->size;
+   }
+
+   free(queue->items);
+   if (queue->lock)
+      slock_free(queue->lock);
+   if (queue->cond)
+      scond_free(queue->cond);
+
+   memset(queue, 0, sizeof(*queue));
+}
+
+/* Blocks while the queue is full. Fails only once the
+ * queue has been closed, in which case the caller keeps
+ * ownership of data. */
+static bool ff_queue_push(struct ff_queue *queue,
+      void *data, retro_time_t time)
+{
+   struct ff_queue_item *item;
+
+   slock_lock(queue->lock);
+
+   if (queue->count == queue->size && !queue->closed)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+
+      queue->full++;
+      while (queue->count == queue->size && !queue->closed)
+         scond_wait(queue->cond, queue->lock);
+      queue->full_time += cpu_features_get_time_usec() - start;
+   }
+
+   if (queue->closed)
+   {
+      slock_unlock(queue->lock);
+      return false;
+   }
+
+   item       = &queue->items[(queue->head + queue->count) % queue->size];
+   item->data = data;
+   item->time = time;
+
+   queue->pushed++;
+   if (++queue->count > queue->peak)
+      queue->peak = queue->count;
+
+   slock_unlock(queue->lock);
+   scond_signal(queue->cond);
+
+   return true;
+}
+
+/* Returns false if the queue is empty, or with block set,
+ * once it is empty and closed. */
+static bool ff_queue_pop(struct ff_queue *queue,
+      void **data, retro_time_t *time, bool block)
+{
+   slock_lock(queue->lock);
+
+   while (block && !queue->count && !queue->closed)
+      scond_wait(queue->cond, queue->lock);
+
+   if (!queue->count)
+   {
+      slock_unlock(queue->lock);
+      return false;
+   }
+
+   *data = queue->items[queue->head].data;
+   if (time)
+      *time = queue->items[queue->head].time;
+
+   queue->head = (queue->head + 1) % queue->size;
+   queue->count--;
+
+   slock_unlock(queue->lock);
+   scond_signal(queue->cond);
+
+   return true;
+}
+
+static void ff_queue_close(struct ff_queue *queue)
+{
+   slock_lock(queue->lock);
+   queue->closed = true;
+   slock_unlock(queue->lock);
+   scond_signal(queue->cond);
+}
+
+static void ff_queue_log(const char *name, const struct ff_queue *queue)
+{
+   if (queue->pushed)
+      RARCH_LOG("[FFmpeg]: %s queue: %u pushed, peak %u of %u, "
+            "full %u times for %.2f ms.\n",
+            name, queue->pushed, queue->peak, queue->size,
+            queue->full, queue->full_time / 1000.0);
+}
+
+static void ffmpeg_free_frame_item(void *data)
+{
+   AVFrame *frame = (AVFrame*)data;
+   av_frame_free(&frame);
+}
+
+static void ffmpeg_free_packet_item(void *data)
+{
+   AVPacket *pkt = (AVPacket*)data;
+   av_packet_free(&pkt);
+}
 
 static bool init_thread(ffmpeg_t *handle)
 {
+   unsigned i;
+   unsigned cores     = cpu_features_get_core_amount();
+
+   handle->slot_pitch = FFALIGN(handle->params.fb_width *
+         handle->video.pix_size, 64);
+
+   /* For some reason, FFmpeg has a tendency to crash
+    * if we don't overallocate a bit. swscale may read one
+    * row past the frame plus the SIMD padding. */
+   for (i = 0; i < MAX_FRAMES; i++)
+      if (!(handle->slots[i].buf = (uint8_t*)av_mallocz(
+                  handle->slot_pitch * (handle->params.fb_height + 1)
+                  + AV_INPUT_BUFFER_PADDING_SIZE)))
+         return false;
+
    handle->lock       = slock_new();
    handle->cond_lock  = slock_new();
    handle->cond       = scond_new();
+   handle->slot_cond  = scond_new();
    handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo  = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
+
+   /* Leave a core each to the runloop and the encoder. */
+   handle->scale_workers = cores > 2
+      ? MIN(cores - 2, MAX_SCALE_WORKERS) : 1;
+
+   if (!ff_queue_init(&handle->mux_queue, MUX_QUEUE_SIZE))
+      return false;
+
+   for (i = 0; i < handle->scale_workers; i++)
+   {
+      struct ff_scale_worker *worker = &handle->workers[i];
+
+      worker->handle = handle;
+      worker->index  = i;
+      worker->scaler = handle->video.scaler;
+
+      if (!ff_queue_init(&worker->out, SCALE_QUEUE_SIZE))
+         return false;
+   }
+
+   if (!(handle->mux_thread = sthread_create(ffmpeg_mux_thread, handle)))
+      return false;
+
+   for (i = 0; i < handle->scale_workers; i++)
+      if (!(handle->workers[i].thread = sthread_create(
+                  ffmpeg_scale_thread, &handle->workers[i])))
+         return false;
 
    handle->alive     = true;
    handle->can_sleep = true;
    handle->thread    = sthread_create(ffmpeg_thread, handle);
 
-   return true;
+   return handle->thread != NULL;
 }
 
+/* Stops the scale workers and the encoder thread. Frames
+ * already handed over are scaled first; whatever the
+ * encoder thread did not get to is left in the workers'
+ * queues for ffmpeg_flush_buffers(). */
 static void deinit_thread(ffmpeg_t *handle)
 {
+   unsigned i;
+
+   if (handle->lock)
+   {
+      slock_lock(handle->lock);
+      handle->video_closed = true;
+      slock_unlock(handle->lock);
+      scond_broadcast(handle->slot_cond);
+   }
+
+   for (i = 0; i < handle->scale_workers; i++)
+   {
+      if (handle->workers[i].thread)
+         sthread_join(handle->workers[i].thread);
+      handle->workers[i].thread = NULL;
+   }
+
    if (!handle->thread)
       return;
 
    slock_lock(handle->cond_lock);
+   /* Also under lock, for ffmpeg_push_video() waiting
+    * for a free slot. */
+   slock_lock(handle->lock);
    handle->alive = false;
+   slock_unlock(handle->lock);
    handle->can_sleep = false;
    slock_unlock(handle->cond_lock);
 
    scond_signal(handle->cond);
-   sthread_join(handle->thread);
+   scond_broadcast(handle->slot_cond);
 
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
+   sthread_join(handle->thread);
 
    handle->thread = NULL;
 }
 
+static void deinit_mux_thread(ffmpeg_t *handle)
+{
+   if (!handle->mux_thread)
+      return;
+
+   ff_queue_close(&handle->mux_queue);
+   sthread_join(handle->mux_thread);
+
+   handle->mux_thread = NULL;
+}
+
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
+   unsigned i;
+
    if (handle->audio_fifo)
    {
       fifo_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
 
-   if (handle->attr_fifo)
+   for (i = 0; i < MAX_FRAMES; i++)
    {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
+      av_free(handle->slots[i].buf);
+      handle->slots[i].buf = NULL;
    }
 
-   if (handle->video_fifo)
+   for (i = 0; i < MAX_SCALE_WORKERS; i++)
    {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
+      struct ff_scale_worker *worker = &handle->workers[i];
+
+      ff_queue_free(&worker->out, ffmpeg_free_frame_item);
+      scaler_ctx_gen_reset(&worker->scaler);
+
+      if (worker->sws)
+         sws_freeContext(worker->sws);
+      worker->sws = NULL;
    }
+
+   ff_queue_free(&handle->mux_queue, ffmpeg_free_packet_item);
+   av_frame_free(&handle->video.last_frame);
+
+   if (handle->lock)
+      slock_free(handle->lock);
+   if (handle->cond_lock)
+      slock_free(handle->cond_lock);
+   if (handle->cond)
+      scond_free(handle->cond);
+   if (handle->slot_cond)
+      scond_free(handle->slot_cond);
+
+   handle->lock      = NULL;
+   handle->cond_lock = NULL;
+   handle->cond      = NULL;
+   handle->slot_cond = NULL;
 }
 
 static void ffmpeg_free(void *data)
@@ -947,6 +1264,7 @@ static void ffmpeg_free(void *data)
       return;
 
    deinit_thread(handle);
+   deinit_mux_thread(handle);
    deinit_thread_buf(handle);
 
    if (handle->audio.codec)
@@ -963,13 +1281,7 @@ static void ffmpeg_free(void *data)
       av_free(handle->video.codec);
    }
 
-   av_frame_free(&handle->video.conv_frame);
-   av_free(handle->video.conv_frame_buf);
-
-   scaler_ctx_gen_reset(&handle->video.scaler);
-
-   if (handle->video.sws)
-      sws_freeContext(handle->video.sws);
+   av_buffer_pool_uninit(&handle->video.frame_pool);
 
    if (handle->config.conf)
       config_file_free(handle->config.conf);
@@ -1064,10 +1376,10 @@ static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
    unsigned y;
-   struct record_video_data attr_data;
+   struct ff_video_slot *slot;
+   retro_time_t start, now;
    bool drop_frame  = false;
    ffmpeg_t *handle = (ffmpeg_t*)data;
-   int       offset = 0;
 
    if (!handle || !vid)
       return false;
@@ -1080,53 +1392,67 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
+   if (!handle->alive)
+      return false;
 
-      slock_lock(handle->lock);
-      avail = (unsigned)FIFO_WRITE_AVAIL(handle->attr_fifo);
-      slock_unlock(handle->lock);
+   start = cpu_features_get_time_usec();
 
-      if (!handle->alive)
-         return false;
+   slock_lock(handle->lock);
+   while (     handle->slot_write - handle->slot_read >= MAX_FRAMES
+         && handle->alive)
+      scond_wait(handle->slot_cond, handle->lock);
+   slock_unlock(handle->lock);
 
-      if (avail >= sizeof(*vid))
-         break;
+   /* Recording was stopped while waiting for a free slot */
+   if (!handle->alive)
+      return false;
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
+   /* The slot is ours until slot_write moves past it,
+    * so it can be filled without holding the lock. */
+   slot       = &handle->slots[handle->slot_write % MAX_FRAMES];
+   slot->attr = *vid;
 
-      slock_unlock(handle->cond_lock);
+   if (slot->attr.is_dupe)
+   {
+      slot->attr.width  = slot->attr.height = 0;
+      slot->attr.pitch  = 0;
+      slot->attr.data   = NULL;
+      handle->stats.dupes++;
    }
-
-   slock_lock(handle->lock);
-
-   /* Tightly pack our frame to conserve memory.
-    * libretro tends to use a very large pitch.
-    */
-   attr_data = *vid;
-
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
    else
-      attr_data.pitch = (int)(attr_data.width * handle->video.pix_size);
-
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   {
+      size_t len         = vid->width * handle->video.pix_size;
+      const uint8_t *src = (const uint8_t*)vid->data;
+      uint8_t *dst       = slot->buf;
+
+      slot->attr.pitch   = (int)handle->slot_pitch;
+      slot->attr.data    = slot->buf;
+
+      /* Pitch is negative for bottom-up frames (e.g. GPU
+       * readback), so step the source pointer row by row
+       * rather than multiplying it with an unsigned row */
+      if (vid->pitch == (int)handle->slot_pitch)
+         memcpy(dst, src, handle->slot_pitch * vid->height);
+      else
+         for (y = 0; y < vid->height; y++, src += vid->pitch)
+         {
+            memcpy(dst, src, len);
+            dst += handle->slot_pitch;
+         }
+   }
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   now                = cpu_features_get_time_usec();
+   slot->enqueue_time = now;
 
+   slock_lock(handle->lock);
+   handle->slot_write++;
    slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   scond_broadcast(handle->slot_cond);
+
+   handle->stats.frames++;
+   handle->stats.enqueue_total += now - start;
+   if (now - start > handle->stats.enqueue_max)
+      handle->stats.enqueue_max = now - start;
 
    return true;
 }
@@ -1179,6 +1505,48 @@ static bool ffmpeg_push_audio(void *data,
    return true;
 }
 
+/* Hands an encoded packet over to the mux thread. */
+static bool ffmpeg_mux_packet(ffmpeg_t *handle, AVPacket *pkt)
+{
+   AVPacket *out = av_packet_alloc();
+
+   if (!out)
+      return false;
+
+   av_packet_move_ref(out, pkt);
+
+   if (!ff_queue_push(&handle->mux_queue, out, cpu_features_get_time_usec()))
+   {
+      av_packet_free(&out);
+      return false;
+   }
+
+   return true;
+}
+
+static void ffmpeg_mux_thread(void *data)
+{
+   void *item;
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   while (ff_queue_pop(&handle->mux_queue, &item, NULL, true))
+   {
+      AVPacket *pkt = (AVPacket*)item;
+      int ret       = av_interleaved_write_frame(handle->muxer.ctx, pkt);
+
+      if (ret < 0)
+      {
+#ifdef __cplusplus
+         RARCH_ERR("[FFmpeg]: Cannot write packet to output file. Error code: %d.\n", ret);
+#else
+         RARCH_ERR("[FFmpeg]: Cannot write packet to output file. Error code: %s.\n", av_err2str(ret));
+#endif
+      }
+
+      av_packet_free(&pkt);
+   }
+}
+
 static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
 {
    AVPacket *pkt;
@@ -1224,24 +1592,15 @@ static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
 
       pkt->stream_index = handle->muxer.vstream->index;
 
-      ret = av_interleaved_write_frame(handle->muxer.ctx, pkt);
-      if (ret < 0)
-      {
-#ifdef __cplusplus
-         RARCH_ERR("[FFmpeg]: Cannot write video packet to output file. Error code: %d.\n", ret);
-#else
-         RARCH_ERR("[FFmpeg]: Cannot write video packet to output file. Error code: %s.\n", av_err2str(ret));
-#endif
+      if (!ffmpeg_mux_packet(handle, pkt))
          return false;
-      }
-
-      av_packet_unref(pkt);
    }
    return true;
 }
 
 static void ffmpeg_scale_input(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+      struct ff_scale_worker *worker,
+      const struct record_video_data *vid, AVFrame *frame)
 {
    /* Attempt to preserve more information if we scale down. */
    bool shrunk = handle->params.out_width < vid->width
@@ -1251,42 +1610,166 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
    {
       int linesize      = vid->pitch;
 
-      handle->video.sws = sws_getCachedContext(handle->video.sws,
+      worker->sws = sws_getCachedContext(worker->sws,
             vid->width, vid->height, handle->video.in_pix_fmt,
             handle->params.out_width, handle->params.out_height,
             handle->video.pix_fmt,
             shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
 
-      sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
-            &linesize, 0, vid->height, handle->video.conv_frame->data,
-            handle->video.conv_frame->linesize);
+      sws_scale(worker->sws, (const uint8_t* const*)&vid->data,
+            &linesize, 0, vid->height, frame->data,
+            frame->linesize);
    }
    else
       video_frame_record_scale(
-            &handle->video.scaler,
-            handle->video.conv_frame->data[0],
+            &worker->scaler,
+            frame->data[0],
             vid->data,
             handle->params.out_width,
             handle->params.out_height,
-            handle->video.conv_frame->linesize[0],
+            frame->linesize[0],
             vid->width,
             vid->height,
             vid->pitch,
             shrunk);
 }
 
+static AVFrame *ffmpeg_alloc_frame(ffmpeg_t *handle)
+{
+   AVFrame *frame = av_frame_alloc();
+
+   if (!frame)
+      return NULL;
+
+   if (!(frame->buf[0] = av_buffer_pool_get(handle->video.frame_pool)))
+   {
+      av_frame_free(&frame);
+      return NULL;
+   }
+
+   av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data,
+         handle->video.pix_fmt, handle->params.out_width,
+         handle->params.out_height, 1);
+
+   frame->width  = handle->params.out_width;
+   frame->height = handle->params.out_height;
+   frame->format = handle->video.pix_fmt;
+
+   return frame;
+}
+
+static void ffmpeg_scale_thread(void *data)
+{
+   struct ff_scale_worker *worker = (struct ff_scale_worker*)data;
+   ffmpeg_t *handle               = worker->handle;
+   unsigned seq                   = worker->index;
+
+   for (;;)
+   {
+      struct ff_video_slot *slot;
+      retro_time_t enqueue_time;
+      AVFrame *frame = NULL;
+      bool queued;
+
+      slock_lock(handle->lock);
+      while (!(queued = (int)(handle->slot_write - seq) > 0)
+            && !handle->video_closed)
+         scond_wait(handle->slot_cond, handle->lock);
+      slock_unlock(handle->lock);
+
+      if (!queued)
+         break;
+
+      slot         = &handle->slots[seq % MAX_FRAMES];
+      enqueue_time = slot->enqueue_time;
+
+      /* If there is no frame to scale into, this one is
+       * recorded as a dupe. */
+      if (!slot->attr.is_dupe && (frame = ffmpeg_alloc_frame(handle)))
+         ffmpeg_scale_input(handle, worker, &slot->attr, frame);
+
+      /* Slots are given back in order, so this one may
+       * have to wait for the other workers to catch up. */
+      slock_lock(handle->lock);
+      slot->done = true;
+      while (     handle->slot_read != handle->slot_write
+            && handle->slots[handle->slot_read % MAX_FRAMES].done)
+         handle->slots[handle->slot_read++ % MAX_FRAMES].done = false;
+      slock_unlock(handle->lock);
+      scond_broadcast(handle->slot_cond);
+
+      if (!ff_queue_push(&worker->out, frame, enqueue_time))
+         av_frame_free(&frame);
+
+      /* Wake up the encoder thread. It looks for a frame
+       * again under cond_lock before going to sleep, so
+       * signalling under it too means the wakeup can't
+       * fall in between. */
+      slock_lock(handle->cond_lock);
+      scond_signal(handle->cond);
+      slock_unlock(handle->cond_lock);
+
+      seq += handle->scale_workers;
+   }
+}
+
+/* Encodes the next converted frame. A NULL frame repeats
+ * the previous one. */
 static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+      AVFrame *frame, retro_time_t enqueue_time)
 {
-   if (!vid->is_dupe)
-      ffmpeg_scale_input(handle, vid);
+   bool ret = true;
+   retro_time_t elapsed;
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+   if (frame)
+   {
+      av_frame_free(&handle->video.last_frame);
+      handle->video.last_frame = frame;
+   }
 
-   if (!encode_video(handle, handle->video.conv_frame))
-      return false;
+   if (handle->video.last_frame)
+   {
+      handle->video.last_frame->pts = handle->video.frame_cnt;
+      ret = encode_video(handle, handle->video.last_frame);
+   }
 
    handle->video.frame_cnt++;
+
+   elapsed = cpu_features_get_time_usec() - enqueue_time;
+   handle->stats.encode_total += elapsed;
+   if (elapsed > handle->stats.encode_max)
+      handle->stats.encode_max = elapsed;
+
+   return ret;
+}
+
+/* Whether the next converted frame is ready to be encoded. */
+static bool ffmpeg_video_queued(ffmpeg_t *handle)
+{
+   bool queued;
+   struct ff_queue *queue = &handle->workers[
+      handle->video_next % handle->scale_workers].out;
+
+   slock_lock(queue->lock);
+   queued = queue->count > 0;
+   slock_unlock(queue->lock);
+
+   return queued;
+}
+
+/* Takes the next frame from whichever worker scaled it. */
+static bool ffmpeg_pop_video(ffmpeg_t *handle,
+      AVFrame **frame, retro_time_t *enqueue_time)
+{
+   void *data;
+
+   if (!ff_queue_pop(&handle->workers[
+            handle->video_next % handle->scale_workers].out,
+            &data, enqueue_time, false))
+      return false;
+
+   *frame = (AVFrame*)data;
+   handle->video_next++;
    return true;
 }
 
@@ -1425,19 +1908,11 @@ static bool encode_audio(ffmpeg_t *handle, bool dry)
 
       pkt->stream_index = handle->muxer.astream->index;
 
-      ret = av_interleaved_write_frame(handle->muxer.ctx, pkt);
-      if (ret < 0)
+      if (!ffmpeg_mux_packet(handle, pkt))
       {
          av_frame_free(&frame);
-#ifdef __cplusplus
-         RARCH_ERR("[FFmpeg]: Cannot write video packet to output file. Error code: %d.\n", ret);
-#else
-         RARCH_ERR("[FFmpeg]: Cannot write video packet to output file. Error code: %s.\n", av_err2str(ret));
-#endif
          return false;
       }
-
-      av_packet_unref(pkt);
    }
 
    av_frame_free(&frame);
@@ -1585,8 +2060,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    void *audio_buf       = NULL;
    bool did_work         = false;
-   void *video_buf       = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ?
       (handle->audio.codec->frame_size *
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1598,7 +2071,8 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
    do
    {
-      struct record_video_data attr_buf;
+      AVFrame *frame = NULL;
+      retro_time_t enqueue_time;
 
       did_work = false;
 
@@ -1617,13 +2091,9 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (FIFO_READ_AVAIL(handle->attr_fifo) >= sizeof(attr_buf))
+      if (ffmpeg_pop_video(handle, &frame, &enqueue_time))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+         ffmpeg_push_video_thread(handle, frame, enqueue_time);
 
          did_work = true;
       }
@@ -1636,7 +2106,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1651,12 +2120,33 @@ static bool ffmpeg_finalize(void *data)
    /* Flush out data still in buffers (internal, and FFmpeg internal). */
    ffmpeg_flush_buffers(handle);
 
+   /* Wait for the last packets to be written. */
+   deinit_mux_thread(handle);
+
+   if (handle->stats.frames)
+   {
+      unsigned i;
+
+      RARCH_LOG("[FFmpeg]: %u frames queued (%u dupes). "
+            "Enqueue: %.2f ms avg, %.2f ms max. "
+            "Queued to encoded: %.2f ms avg, %.2f ms max.\n",
+            handle->stats.frames, handle->stats.dupes,
+            handle->stats.enqueue_total / 1000.0 / handle->stats.frames,
+            handle->stats.enqueue_max / 1000.0,
+            handle->stats.encode_total / 1000.0 / handle->stats.frames,
+            handle->stats.encode_max / 1000.0);
+
+      for (i = 0; i < handle->scale_workers; i++)
+         ff_queue_log("Scaled frame", &handle->workers[i].out);
+      ff_queue_log("Packet", &handle->mux_queue);
+   }
+
    deinit_thread_buf(handle);
 
    /* Write final data. */
    av_write_trailer(handle->muxer.ctx);
 
-   avio_close(ctx->pb);
+   avio_close(handle->muxer.ctx->pb);
 
    return true;
 }
@@ -1664,25 +2154,18 @@ static bool ffmpeg_finalize(void *data)
 static void ffmpeg_thread(void *data)
 {
    ffmpeg_t *ff          = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf       = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
    size_t audio_buf_size = ff->config.audio_enable ?
       (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
    void *audio_buf       = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
 
    while (ff->alive)
    {
-      struct record_video_data attr_buf;
-
-      bool avail_video = false;
+      AVFrame *frame = NULL;
+      retro_time_t enqueue_time;
+      bool avail_video = ffmpeg_pop_video(ff, &frame, &enqueue_time);
       bool avail_audio = false;
 
       slock_lock(ff->lock);
-      if (FIFO_READ_AVAIL(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
-
       if (ff->config.audio_enable)
          if (FIFO_READ_AVAIL(ff->audio_fifo) >= audio_buf_size)
             avail_audio = true;
@@ -1693,9 +2176,14 @@ static void ffmpeg_thread(void *data)
          slock_lock(ff->cond_lock);
          if (ff->can_sleep)
          {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
+            /* A scale worker may have queued a frame since
+             * it was looked for above */
+            if (!ffmpeg_video_queued(ff))
+            {
+               ff->can_sleep = false;
+               scond_wait(ff->cond, ff->cond_lock);
+               ff->can_sleep = true;
+            }
          }
          else
             scond_signal(ff->cond);
@@ -1703,18 +2191,8 @@ static void ffmpeg_thread(void *data)
          slock_unlock(ff->cond_lock);
       }
 
-      if (avail_video && video_buf)
-      {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
-      }
+      if (avail_video)
+         ffmpeg_push_video_thread(ff, frame, enqueue_time);
 
       if (avail_audio && audio_buf)
       {
@@ -1732,7 +2210,6 @@ static void ffmpeg_thread(void *data)
       }
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -6043,12 +6043,24 @@ static enum runloop_state_enum runloop_check_state(
                         (runloop_st->flags & RUNLOOP_FLAG_IDLE) ? true : false);
             }
 
+            menu_st->flags           &= ~MENU_ST_FLAG_FRAME_SKIPPED;
+
             if (      (menu_st->flags & MENU_ST_FLAG_ALIVE)
                   && !(runloop_st->flags & RUNLOOP_FLAG_IDLE))
                if (display_menu_libretro(runloop_st, input_st,
                         settings->floats.slowmotion_ratio,
                         libretro_running, current_time))
-                  video_driver_cached_frame();
+               {
+                  if (     !settings->bools.menu_skip_idle_frames
+                        || menu_driver_frame_is_damaged(menu_st, p_disp,
+                           anim_get_ptr(), settings,
+                           BIT64_GET(menu->state,
+                              MENU_STATE_RENDER_FRAMEBUFFER),
+                           current_time))
+                     video_driver_cached_frame();
+                  else
+                     menu_st->flags  |=  MENU_ST_FLAG_FRAME_SKIPPED;
+               }
 
             if (menu->driver_ctx->set_texture)
                menu->driver_ctx->set_texture(menu->userdata);
@@ -6829,6 +6841,47 @@ static enum runloop_state_enum runloop_check_state(
 }
 
 
+#ifdef HAVE_BSV_MOVIE
+/* Runs the replay at fast-forward speed while a seek
+ * (see bsv_movie_seek()) hasn't reached its frame yet. */
+static void runloop_check_replay_seek(runloop_state_t *runloop_st,
+      input_driver_state_t *input_st)
+{
+   bsv_movie_t *handle = input_st->bsv_movie_state_handle;
+
+   if (     (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_SEEKING)
+         && !(input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_END)
+         && handle
+         && handle->frame_counter < handle->seek_frame)
+   {
+      if (!(input_st->flags & INP_FLAG_NONBLOCKING))
+      {
+         input_st->flags                 |= INP_FLAG_NONBLOCKING;
+         runloop_st->flags               |= RUNLOOP_FLAG_FASTMOTION;
+         input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_SEEK_FASTFORWARD;
+         command_event(CMD_EVENT_SET_FRAME_LIMIT, NULL);
+         driver_set_nonblock_state();
+      }
+      return;
+   }
+
+   input_st->bsv_movie_state.flags &= ~BSV_FLAG_MOVIE_SEEKING;
+
+   /* Only turn fast-forward off if the seek turned it on */
+   if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_SEEK_FASTFORWARD)
+   {
+      input_st->bsv_movie_state.flags &= ~BSV_FLAG_MOVIE_SEEK_FASTFORWARD;
+      if (input_st->flags & INP_FLAG_NONBLOCKING)
+      {
+         input_st->flags                     &= ~INP_FLAG_NONBLOCKING;
+         runloop_st->flags                   &= ~RUNLOOP_FLAG_FASTMOTION;
+         runloop_st->fastforward_after_frames = 1;
+         driver_set_nonblock_state();
+      }
+   }
+}
+#endif
+
 
 /**
  * runloop_iterate:
@@ -6995,6 +7048,17 @@ int runloop_iterate(void)
             rcheevos_idle();
 #endif
 #ifdef HAVE_MENU
+         /* Nothing was presented, so there is no vsync to block
+          * on either; wait for the next frame to poll input */
+         if (menu_state_get_ptr()->flags & MENU_ST_FLAG_FRAME_SKIPPED)
+         {
+            retro_sleep((unsigned)(1000.0f /
+                  ((video_st->video_refresh_rate_original)
+                     ? video_st->video_refresh_rate_original
+                     : settings->floats.video_refresh_rate)));
+            return 1;
+         }
+
          /* Rely on vsync throttling unless VRR is enabled and menu throttle is disabled. */
          if (vrr_runloop_enable && !settings->bools.menu_throttle_framerate)
             return 0;
@@ -7172,6 +7236,9 @@ int runloop_iterate(void)
 
 #ifdef HAVE_BSV_MOVIE
    bsv_movie_finish_rewind(input_st);
+   if (input_st->bsv_movie_state.flags & (BSV_FLAG_MOVIE_SEEKING
+            | BSV_FLAG_MOVIE_SEEK_FASTFORWARD))
+      runloop_check_replay_seek(runloop_st, input_st);
    if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_END)
    {
       movie_stop_playback(input_st);
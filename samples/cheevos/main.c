@@ -0,0 +1,296 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (main.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Replays an achievement set (the game data JSON returned
+ * by the server for the patch request) against a memory
+ * dump of the core's system RAM (and optionally save RAM),
+ * mapped the way rcheevos maps it for the set's console.
+ * Every achievement and leaderboard is evaluated for a
+ * number of frames, once reading memory by walking the
+ * regions (rc_libretro_memory_read) and once through the
+ * page table, and the read rate of each is reported. The
+ * values read are checksummed, and must match.
+ *
+ * Usage: cheevos_bench [-n frames] <game data json>
+ *           <system ram dump> [save ram dump] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libretro.h>
+
+#include "../../deps/rcheevos/include/rc_api_runtime.h"
+#include "../../deps/rcheevos/include/rc_runtime.h"
+#include "../../cheevos/cheevos_memory.h"
+
+typedef struct bench_memory
+{
+   rc_libretro_memory_regions_t regions;
+   rcheevos_memory_pages_t pages;
+   uint64_t reads;
+   uint32_t checksum;
+} bench_memory_t;
+
+/* Only used by the m3u hash sets (rhash isn't built here) */
+void* rc_file_open(const char* path) { return NULL; }
+void rc_file_seek(void* file_handle, int64_t offset, int origin) { }
+int64_t rc_file_tell(void* file_handle) { return 0; }
+size_t rc_file_read(void* file_handle, void* buffer, int requested_bytes) { return 0; }
+void rc_file_close(void* file_handle) { }
+int rc_path_compare_extension(const char* path, const char* ext) { return 0; }
+int rc_hash_error(const char* message) { return 0; }
+
+static rc_libretro_core_memory_info_t core_memory[2];
+static bench_memory_t bench;
+
+static double elapsed_ms(clock_t start)
+{
+   return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static void *read_file(const char *path, size_t *len)
+{
+   long size;
+   char *data = NULL;
+   FILE *fp   = fopen(path, "rb");
+
+   if (!fp)
+      return NULL;
+
+   if (     fseek(fp, 0, SEEK_END) == 0
+         && (size = ftell(fp)) >= 0
+         && fseek(fp, 0, SEEK_SET) == 0
+         && (data = (char*)malloc((size_t)size + 1)))
+   {
+      if (fread(data, 1, (size_t)size, fp) == (size_t)size)
+      {
+         data[size] = '\0';
+         *len       = (size_t)size;
+      }
+      else
+      {
+         free(data);
+         data = NULL;
+      }
+   }
+
+   fclose(fp);
+   return data;
+}
+
+static void get_core_memory_info(uint32_t id,
+      rc_libretro_core_memory_info_t *info)
+{
+   switch (id)
+   {
+      case RETRO_MEMORY_SYSTEM_RAM:
+         *info = core_memory[0];
+         break;
+      case RETRO_MEMORY_SAVE_RAM:
+         *info = core_memory[1];
+         break;
+      default:
+         info->data = NULL;
+         info->size = 0;
+         break;
+   }
+}
+
+/* Same as rc_client_peek */
+static uint32_t peek_value(uint8_t *buffer, uint32_t num_read,
+      uint32_t num_bytes)
+{
+   uint32_t value = 0;
+
+   if (num_read != num_bytes)
+      return 0;
+
+   switch (num_bytes)
+   {
+      case 4:
+         value |= buffer[3] << 24;
+         /* fall-through */
+      case 3:
+         value |= buffer[2] << 16;
+         /* fall-through */
+      case 2:
+         value |= buffer[1] << 8;
+         /* fall-through */
+      case 1:
+         value |= buffer[0];
+         break;
+   }
+
+   bench.reads++;
+   bench.checksum = (bench.checksum ^ value) * 16777619u;
+   return value;
+}
+
+static uint32_t peek_regions(uint32_t address, uint32_t num_bytes, void *ud)
+{
+   uint8_t buffer[4];
+   if (num_bytes > sizeof(buffer))
+      return 0;
+   return peek_value(buffer, rc_libretro_memory_read(&bench.regions,
+            address, buffer, num_bytes), num_bytes);
+}
+
+static uint32_t peek_pages(uint32_t address, uint32_t num_bytes, void *ud)
+{
+   uint8_t buffer[4];
+   if (num_bytes > sizeof(buffer))
+      return 0;
+   return peek_value(buffer, rcheevos_memory_pages_read(&bench.pages,
+            &bench.regions, address, buffer, num_bytes), num_bytes);
+}
+
+static void event_handler(const rc_runtime_event_t *runtime_event) { }
+
+static void run(const char *name,
+      const rc_api_fetch_game_data_response_t *game_data,
+      rc_runtime_peek_t peek, unsigned frames)
+{
+   uint32_t i;
+   clock_t start;
+   double ms;
+   rc_runtime_t runtime;
+   unsigned active = 0;
+
+   rc_runtime_init(&runtime);
+
+   for (i = 0; i < game_data->num_achievements; i++)
+      if (rc_runtime_activate_achievement(&runtime,
+               game_data->achievements[i].id,
+               game_data->achievements[i].definition, NULL, 0) == RC_OK)
+         active++;
+
+   for (i = 0; i < game_data->num_leaderboards; i++)
+      if (rc_runtime_activate_lboard(&runtime,
+               game_data->leaderboards[i].id,
+               game_data->leaderboards[i].definition, NULL, 0) == RC_OK)
+         active++;
+
+   bench.reads    = 0;
+   bench.checksum = 2166136261u;
+
+   start = clock();
+   for (i = 0; i < frames; i++)
+      rc_runtime_do_frame(&runtime, event_handler, peek, NULL, NULL);
+   ms = elapsed_ms(start);
+
+   printf("%-8s %u triggers, %u frames, %.3f ms/frame, "
+         "%.1f Mreads/s, checksum %08x\n",
+         name, active, frames, ms / frames,
+         ms > 0.0 ? bench.reads / ms / 1000.0 : 0.0,
+         (unsigned)bench.checksum);
+
+   rc_runtime_destroy(&runtime);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   size_t len;
+   rc_api_fetch_game_data_response_t game_data;
+   char *json        = NULL;
+   const char *files[3];
+   unsigned num_files = 0;
+   unsigned frames    = 1000;
+   uint32_t checksum;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         frames = (unsigned)strtoul(argv[++i], NULL, 10);
+      else if (num_files < 3)
+         files[num_files++] = argv[i];
+   }
+
+   if (num_files < 2 || !frames)
+   {
+      fprintf(stderr, "Usage: %s [-n frames] <game data json> "
+            "<system ram dump> [save ram dump]\n", argv[0]);
+      return 1;
+   }
+
+   if (!(json = (char*)read_file(files[0], &len)))
+   {
+      fprintf(stderr, "Failed to read %s.\n", files[0]);
+      return 1;
+   }
+
+   if (rc_api_process_fetch_game_data_response(&game_data, json) != RC_OK)
+   {
+      fprintf(stderr, "Failed to parse %s.\n", files[0]);
+      return 1;
+   }
+
+   for (i = 1; i < (int)num_files; i++)
+   {
+      if (!(core_memory[i - 1].data = (uint8_t*)read_file(files[i], &len)))
+      {
+         fprintf(stderr, "Failed to read %s.\n", files[i]);
+         return 1;
+      }
+      core_memory[i - 1].size = len;
+   }
+
+   if (!rc_libretro_memory_init(&bench.regions, NULL,
+            get_core_memory_info, game_data.console_id))
+   {
+      fprintf(stderr, "No memory mapped for console %u.\n",
+            (unsigned)game_data.console_id);
+      return 1;
+   }
+
+   if (!rcheevos_memory_pages_init(&bench.pages, &bench.regions))
+   {
+      fprintf(stderr, "Failed to allocate page table.\n");
+      return 1;
+   }
+
+   printf("%s: console %u, %u regions, %u bytes, %u pages of %u bytes\n",
+         game_data.title ? game_data.title : files[0],
+         (unsigned)game_data.console_id, (unsigned)bench.regions.count,
+         (unsigned)bench.regions.total_size, (unsigned)bench.pages.count,
+         (unsigned)bench.pages.mask + 1);
+
+   run("regions:", &game_data, peek_regions, frames);
+   checksum = bench.checksum;
+   run("pages:", &game_data, peek_pages, frames);
+
+   if (checksum != bench.checksum)
+   {
+      fprintf(stderr, "Checksum mismatch.\n");
+      return 1;
+   }
+
+   rcheevos_memory_pages_free(&bench.pages);
+   rc_api_destroy_fetch_game_data_response(&game_data);
+   free(core_memory[0].data);
+   free(core_memory[1].data);
+   free(json);
+
+   return 0;
+}
@@ -0,0 +1,162 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (main.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Builds a large playlist the way a content scan
+ * does (push every file not already in it), then
+ * looks up every entry, every parent archive and as
+ * many paths that are not in the playlist. Finally
+ * saves it, and times reading it back and freeing it.
+ * Lookups don't depend on the playlist size; pushes
+ * still do, since new entries go to the top.
+ *
+ * Usage: playlist_bench [entries] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <retro_miscellaneous.h>
+
+#include "../../core_info.h"
+#include "../../playlist.h"
+
+#define ARCHIVE_PATH "/roms/set%u/game%06u.zip"
+#define ENTRY_PATH   ARCHIVE_PATH "#game%06u.bin"
+#define MISSING_PATH "/roms/set%u/missing%06u.bin"
+
+/* No cores are installed here */
+bool core_info_find(const char *core_path, core_info_t **core_info)
+{
+   return false;
+}
+
+bool core_info_core_file_id_is_equal(const char *core_path_a,
+      const char *core_path_b)
+{
+   return false;
+}
+
+static double elapsed_ms(clock_t start)
+{
+   return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+   char path[PATH_MAX_LENGTH];
+   char label[NAME_MAX_LENGTH];
+   char crc32[32];
+   playlist_config_t config;
+   playlist_t *playlist  = NULL;
+   unsigned num_entries  = 100000;
+   unsigned found        = 0;
+   unsigned i;
+   clock_t start;
+
+   if (argc > 1)
+      num_entries = (unsigned)strtoul(argv[1], NULL, 10);
+
+   memset(&config, 0, sizeof(config));
+   config.capacity            = num_entries;
+   config.fuzzy_archive_match = true;
+   playlist_config_set_path(&config, "playlist_bench.lpl");
+   remove(config.path);
+
+   if (!(playlist = playlist_init(&config)))
+   {
+      fprintf(stderr, "Failed to create playlist.\n");
+      return 1;
+   }
+
+   start = clock();
+   for (i = 0; i < num_entries; i++)
+   {
+      struct playlist_entry entry = {0};
+
+      snprintf(path, sizeof(path), ENTRY_PATH, i % 64, i, i);
+      if (playlist_entry_exists(playlist, path))
+         continue;
+
+      snprintf(label, sizeof(label), "Game %06u", i);
+      snprintf(crc32, sizeof(crc32), "%08X|crc", i * 2654435761u);
+      entry.path      = path;
+      entry.label     = label;
+      entry.crc32     = crc32;
+      entry.core_path = "DETECT";
+      entry.core_name = "DETECT";
+      entry.db_name   = "Bench.lpl";
+
+      playlist_push(playlist, &entry);
+   }
+   printf("push:     %u entries in %.1f ms\n",
+         (unsigned)playlist_size(playlist), elapsed_ms(start));
+
+   start = clock();
+   for (i = 0; i < num_entries; i++)
+   {
+      snprintf(path, sizeof(path), ENTRY_PATH, i % 64, i, i);
+      found += playlist_entry_exists(playlist, path);
+   }
+   printf("hits:     %u/%u found in %.1f ms\n",
+         found, num_entries, elapsed_ms(start));
+
+   found = 0;
+   start = clock();
+   for (i = 0; i < num_entries; i++)
+   {
+      snprintf(path, sizeof(path), ARCHIVE_PATH, i % 64, i);
+      found += playlist_entry_exists(playlist, path);
+   }
+   printf("archives: %u/%u found in %.1f ms\n",
+         found, num_entries, elapsed_ms(start));
+
+   found = 0;
+   start = clock();
+   for (i = 0; i < num_entries; i++)
+   {
+      snprintf(path, sizeof(path), MISSING_PATH, i % 64, i);
+      found += playlist_entry_exists(playlist, path);
+   }
+   printf("misses:   %u/%u found in %.1f ms\n",
+         found, num_entries, elapsed_ms(start));
+
+   playlist_write_file(playlist);
+   playlist_free(playlist);
+
+   start = clock();
+   if (!(playlist = playlist_init(&config)))
+   {
+      fprintf(stderr, "Failed to read playlist.\n");
+      return 1;
+   }
+   printf("load:     %u entries in %.1f ms\n",
+         (unsigned)playlist_size(playlist), elapsed_ms(start));
+
+   start = clock();
+   playlist_free(playlist);
+   printf("free:     %.1f ms\n", elapsed_ms(start));
+
+   remove(config.path);
+
+   return 0;
+}
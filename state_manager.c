@@ -187,7 +187,7 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
 
 /* Returns the maximum compressed size of a savestate.
  * It is very likely to compress to far less. */
-static size_t state_manager_raw_maxsize(size_t uncomp)
+size_t state_manager_raw_maxsize(size_t uncomp)
 {
    /* bytes covered by a compressed block */
    const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
@@ -203,7 +203,7 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
  * See state_manager_raw_compress for information about this.
  * When you're done with it, send it to free().
  */
-static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
+void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
    size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
    uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
@@ -235,7 +235,7 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
  * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
  * Returns the number of bytes actually written to 'patch'.
  */
-static size_t state_manager_raw_compress(const void *src,
+size_t state_manager_raw_compress(const void *src,
       const void *dst, size_t len, void *patch)
 {
    const uint16_t  *old16 = (const uint16_t*)src;
@@ -301,7 +301,7 @@ static size_t state_manager_raw_compress(const void *src,
  * If the given arguments do not match a previous call to
  * state_manager_raw_compress(), anything at all can happen.
  */
-static void state_manager_raw_decompress(const void *patch,
+void state_manager_raw_decompress(const void *patch,
       size_t patchlen, void *data, size_t datalen)
 {
    uint16_t         *out16 = (uint16_t*)data;
@@ -340,6 +340,63 @@ static void state_manager_raw_decompress(const void *patch,
    }
 }
 
+/*
+ * Checks that 'patch' could have been returned by
+ * state_manager_raw_compress() for 'datalen' bytes of data:
+ * it has to end within 'patchlen' bytes, and must not reach
+ * past the end of the data. Patches that don't come from this
+ * process (e.g. replay checkpoints) must be checked before
+ * they are passed to state_manager_raw_decompress().
+ */
+bool state_manager_raw_validate(const void *patch,
+      size_t patchlen, size_t datalen)
+{
+   const uint16_t *patch16 = (const uint16_t*)patch;
+   size_t left16           = patchlen / sizeof(uint16_t);
+   size_t num16s           = (datalen + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+   size_t pos16            = 0;
+
+   while (left16)
+   {
+      uint16_t numchanged  = *(patch16++);
+      left16--;
+
+      if (numchanged)
+      {
+         if (left16 < (size_t)numchanged + 1)
+            return false;
+
+         pos16       += *patch16++;
+         if (pos16 > num16s || numchanged > num16s - pos16)
+            return false;
+
+         patch16     += numchanged;
+         pos16       += numchanged;
+         left16      -= (size_t)numchanged + 1;
+      }
+      else
+      {
+         uint32_t numunchanged;
+
+         if (left16 < 2)
+            return false;
+
+         numunchanged = patch16[0] | ((uint32_t)patch16[1] << 16);
+         if (!numunchanged)
+            return true;
+         if (numunchanged > num16s - pos16)
+            return false;
+
+         patch16     += 2;
+         pos16       += numunchanged;
+         left16      -= 2;
+      }
+   }
+
+   return false;
+}
+
 /* The start offsets point to 'nextstart' of any given compressed frame.
  * Each uint16 is stored native endian; anything that claims any other
  * endianness refers to the endianness of this specific item.
@@ -73,6 +73,21 @@ struct state_manager_rewind_state
    uint8_t flags;
 };
 
+/* The delta codec used for the rewind buffer. Replay
+ * checkpoints use it as well; see state_manager.c. */
+size_t state_manager_raw_maxsize(size_t uncomp);
+
+void *state_manager_raw_alloc(size_t len, uint16_t uniq);
+
+size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch);
+
+void state_manager_raw_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen);
+
+bool state_manager_raw_validate(const void *patch,
+      size_t patchlen, size_t datalen);
+
 bool state_manager_frame_is_reversed(void);
 
 void state_manager_event_deinit(
@@ -45,6 +45,13 @@
 #include "../config.h"
 #endif
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <memmap.h>
+#endif
+
 #include <boolean.h>
 
 #include <encodings/crc32.h>
@@ -268,6 +275,21 @@ bool content_file_override_set(
    return true;
 }
 
+static void content_file_info_free_data(
+      content_file_info_t *file_info)
+{
+#ifdef HAVE_MMAP
+   if (file_info->data_mapped)
+      munmap(file_info->data, file_info->data_size);
+   else
+#endif
+      free(file_info->data);
+
+   file_info->data        = NULL;
+   file_info->data_size   = 0;
+   file_info->data_mapped = false;
+}
+
 /* Frees any content data that is not flagged
  * as 'persistent'. Should be called after
  * content_file_load() */
@@ -285,12 +307,7 @@ static void content_file_list_free_transient_data(
 
       if (file_info->data &&
           !file_info->persistent_data)
-      {
-         free((void*)file_info->data);
-
-         file_info->data      = NULL;
-         file_info->data_size = 0;
-      }
+         content_file_info_free_data(file_info);
    }
 }
 
@@ -343,10 +360,7 @@ static void content_file_list_free_entry(
    }
 
    if (file_info->data)
-   {
-      free((void*)file_info->data);
-      file_info->data = NULL;
-   }
+      content_file_info_free_data(file_info);
    file_info->data_size       = 0;
 
    file_info->file_in_archive = false;
@@ -474,6 +488,7 @@ static bool content_file_list_set_info(
       const char *path,
       void *data,
       size_t data_size,
+      bool data_mapped,
       bool persistent_data,
       size_t idx)
 {
@@ -521,6 +536,7 @@ static bool content_file_list_set_info(
 
    file_info->data            = data;
    file_info->data_size       = data_size;
+   file_info->data_mapped     = data_mapped;
    file_info->persistent_data = persistent_data;
 
    /* Assign paths
@@ -658,11 +674,87 @@ static bool content_file_list_set_info(
 #define CONTENT_FILE_ATTR_GET_REQUIRED(attr)      ((attr.i & 4) != 0)
 #define CONTENT_FILE_ATTR_GET_PERSISTENT(attr)    ((attr.i & 8) != 0)
 
+#ifdef HAVE_MMAP
+/* Smaller content is simply read into memory */
+#define CONTENT_FILE_MAP_MIN_SIZE (4 * 1024 * 1024)
+
+/**
+ * content_file_map:
+ * @content_path : path of the content file.
+ * @size         : size of the mapped content file.
+ *
+ * Maps a large content file into memory, so that only
+ * the parts a core actually accesses are ever read.
+ * The mapping is private: should a core write to its
+ * content buffer, it gets its own copy of the page
+ * instead of modifying the file.
+ *
+ * Only plain files on the local file system can be
+ * mapped: anything else (e.g. a cdrom:// path) fails
+ * to open here, and is read through filestream instead.
+ *
+ * Returns: mapped content, or NULL if the file should
+ * be read into memory instead.
+ **/
+static void *content_file_map(const char *content_path, int64_t *size)
+{
+   struct stat st;
+   int fd;
+   void *data = NULL;
+
+   if ((fd = open(content_path, O_RDONLY)) == -1)
+      return NULL;
+
+   /* filestream_read_file() NUL-terminates the buffer,
+    * and some cores rely on that. A mapping only reads
+    * as NUL past the end of the file if the file doesn't
+    * end on a page boundary */
+   if (     fstat(fd, &st) == 0
+         && S_ISREG(st.st_mode)
+         && st.st_size >= CONTENT_FILE_MAP_MIN_SIZE
+         && (uint64_t)st.st_size <= (uint64_t)((size_t)-1)
+         && (st.st_size % sysconf(_SC_PAGESIZE)) != 0)
+   {
+      if ((data = mmap(NULL, (size_t)st.st_size,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+         data  = NULL;
+      else
+         *size = (int64_t)st.st_size;
+   }
+
+   close(fd);
+   return data;
+}
+
+/* Patches are applied to a copy of the content,
+ * so patched content can't be mapped */
+static bool content_file_has_patch(
+      content_information_ctx_t *content_ctx)
+{
+#ifdef HAVE_PATCH
+   if (content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED)
+      return false;
+
+   return (!string_is_empty(content_ctx->name_ips)
+               && path_is_valid(content_ctx->name_ips))
+       || (!string_is_empty(content_ctx->name_bps)
+               && path_is_valid(content_ctx->name_bps))
+       || (!string_is_empty(content_ctx->name_ups)
+               && path_is_valid(content_ctx->name_ups))
+       || (!string_is_empty(content_ctx->name_xdelta)
+               && path_is_valid(content_ctx->name_xdelta));
+#else
+   return false;
+#endif
+}
+#endif
+
 /**
  * content_file_load_into_memory:
  * @content_path : path of the content file.
  * @data         : buffer into which the content file will be read.
  * @data_size    : size of the resultant content buffer.
+ * @data_mapped  : set if @data is a mapping of the content file.
  *
  * Reads the content file into memory. Also performs soft patching
  * (see patch_content function) if soft patching has not been
@@ -678,13 +770,16 @@ static bool content_file_load_into_memory(
       size_t idx,
       enum rarch_content_type first_content_type,
       uint8_t **data,
-      size_t *data_size)
+      size_t *data_size,
+      bool *data_mapped)
 {
    uint8_t *content_data = NULL;
    int64_t content_size  = 0;
+   uint32_t content_crc  = 0;
 
    *data                 = NULL;
    *data_size            = 0;
+   *data_mapped          = false;
 
    RARCH_LOG("[Content]: %s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), content_path);
@@ -693,15 +788,28 @@ static bool content_file_load_into_memory(
 #ifdef HAVE_COMPRESSION
    if (content_compressed)
    {
-      if (!file_archive_compressed_read(content_path,
-            (void**)&content_data, NULL, &content_size))
+      if (!file_archive_compressed_read_crc32(content_path,
+            (void**)&content_data, NULL, &content_size, &content_crc))
          return false;
    }
    else
+#endif
+   {
+#ifdef HAVE_MMAP
+      if (     idx != 0
+            || first_content_type != RARCH_CONTENT_NONE
+            || !content_file_has_patch(content_ctx))
+         content_data = (uint8_t*)content_file_map(
+               content_path, &content_size);
+
+      if (content_data)
+         *data_mapped = true;
+      else
 #endif
       if (!filestream_read_file(content_path,
             (void**)&content_data, &content_size))
          return false;
+   }
 
    if (content_size < 0)
       return false;
@@ -718,7 +826,8 @@ static bool content_file_load_into_memory(
 
 #ifdef HAVE_PATCH
          /* Attempt to apply a patch. */
-         if (!(content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED))
+         if (     !(content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED)
+               && !*data_mapped)
             has_patch = patch_content(
                   content_ctx->flags & CONTENT_INFO_FLAG_IS_IPS_PREF,
                   content_ctx->flags & CONTENT_INFO_FLAG_IS_BPS_PREF,
@@ -740,8 +849,10 @@ static bool content_file_load_into_memory(
           * actually needed */
          if (content_compressed || has_patch)
          {
-            p_content->rom_crc = encoding_crc32(0, content_data,
-                  (size_t)content_size);
+            /* Extraction has calculated the CRC already */
+            p_content->rom_crc = has_patch
+               ? encoding_crc32(0, content_data, (size_t)content_size)
+               : content_crc;
             RARCH_LOG("[Content]: CRC32: 0x%x.\n",
                   (unsigned)p_content->rom_crc);
          }
@@ -953,6 +1064,7 @@ static bool content_file_load(
       const char *content_path = NULL;
       uint8_t *content_data    = NULL;
       size_t content_size      = 0;
+      bool content_mapped      = false;
       const char *valid_exts   = special
             ? special->roms[i].valid_extensions
             : content_ctx->valid_extensions;
@@ -991,7 +1103,7 @@ static bool content_file_load(
             if (!content_file_load_into_memory(
                   content_ctx, p_content, content_path,
                   content_compressed, i, first_content_type,
-                  &content_data, &content_size))
+                  &content_data, &content_size, &content_mapped))
             {
                char msg[128];
                snprintf(msg, sizeof(msg), "%s \"%s\"\n",
@@ -1113,12 +1225,19 @@ static bool content_file_load(
       /* Add current entry to content file list */
       if (!content_file_list_set_info(
             p_content->content_list,
-            content_path, content_data, content_size,
+            content_path, content_data, content_size, content_mapped,
             CONTENT_FILE_ATTR_GET_PERSISTENT(content->elems[i].attr), i))
       {
          RARCH_LOG("[Content]: Failed to process content file: \"%s\".\n", content_path);
          if (content_data)
-            free((void*)content_data);
+         {
+#ifdef HAVE_MMAP
+            if (content_mapped)
+               munmap(content_data, content_size);
+            else
+#endif
+               free((void*)content_data);
+         }
          *error_enum = MSG_FAILED_TO_LOAD_CONTENT;
          return false;
       }
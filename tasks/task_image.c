@@ -18,8 +18,13 @@
 #include <string.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
+#ifdef HAVE_RPNG
+#include <formats/rpng.h>
+#endif
 #include <compat/strl.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 #include <features/features_cpu.h>
@@ -50,10 +55,13 @@ struct nbio_image_handle
    void *handle;
    transfer_cb_t  cb;
    struct texture_image ti; /* ptr alignment */
+   char *prescale_path;
    size_t size;
    int processing_final_state;
    unsigned frame_duration;
    unsigned upscale_threshold;
+   unsigned prescale_width;
+   unsigned prescale_height;
    enum image_type_enum type;
    enum image_status_enum status;
    uint8_t flags;
@@ -168,8 +176,12 @@ static void task_image_cleanup(nbio_handle_t *nbio)
    {
       image_transfer_free(image->handle, image->type);
 
-      image->handle  = NULL;
-      image->cb      = NULL;
+      if (image->prescale_path)
+         free(image->prescale_path);
+
+      image->handle        = NULL;
+      image->cb            = NULL;
+      image->prescale_path = NULL;
    }
    if (!string_is_empty(nbio->path))
       free(nbio->path);
@@ -277,6 +289,156 @@ static bool upscale_image(
    return true;
 }
 
+/* Shrinks an image to fit within (max_width x max_height),
+ * preserving its aspect ratio. Each output pixel is the
+ * average of the source pixels it covers.
+ * Returns false if the image already fits */
+static bool downscale_image(
+      unsigned max_width, unsigned max_height,
+      struct texture_image *image_src,
+      struct texture_image *image_dst)
+{
+   unsigned y_dst;
+
+   /* Sanity check */
+   if (!image_src || !image_dst || (max_width < 1) || (max_height < 1))
+      return false;
+
+   if (!image_src->pixels || (image_src->width < 1) || (image_src->height < 1))
+      return false;
+
+   if ((image_src->width <= max_width) && (image_src->height <= max_height))
+      return false;
+
+   /* Get output dimensions */
+   if ((uint64_t)image_src->width * max_height > (uint64_t)image_src->height * max_width)
+   {
+      image_dst->width  = max_width;
+      image_dst->height = (unsigned)((uint64_t)image_src->height * max_width / image_src->width);
+   }
+   else
+   {
+      image_dst->height = max_height;
+      image_dst->width  = (unsigned)((uint64_t)image_src->width * max_height / image_src->height);
+   }
+
+   if (image_dst->width < 1)
+      image_dst->width  = 1;
+   if (image_dst->height < 1)
+      image_dst->height = 1;
+
+   /* Allocate pixel buffer */
+   if (!(image_dst->pixels = (uint32_t*)malloc(image_dst->width * image_dst->height * sizeof(uint32_t))))
+      return false;
+
+   for (y_dst = 0; y_dst < image_dst->height; y_dst++)
+   {
+      unsigned x_dst;
+      unsigned y0 = (unsigned)((uint64_t)y_dst       * image_src->height / image_dst->height);
+      unsigned y1 = (unsigned)((uint64_t)(y_dst + 1) * image_src->height / image_dst->height);
+
+      for (x_dst = 0; x_dst < image_dst->width; x_dst++)
+      {
+         unsigned x, y, count;
+         uint32_t a  = 0;
+         uint32_t r  = 0;
+         uint32_t g  = 0;
+         uint32_t b  = 0;
+         unsigned x0 = (unsigned)((uint64_t)x_dst       * image_src->width / image_dst->width);
+         unsigned x1 = (unsigned)((uint64_t)(x_dst + 1) * image_src->width / image_dst->width);
+
+         for (y = y0; y < y1; y++)
+         {
+            const uint32_t *src = image_src->pixels + (y * image_src->width);
+            for (x = x0; x < x1; x++)
+            {
+               a += (src[x] >> 24) & 0xFF;
+               r += (src[x] >> 16) & 0xFF;
+               g += (src[x] >>  8) & 0xFF;
+               b += (src[x]      ) & 0xFF;
+            }
+         }
+
+         count = (x1 - x0) * (y1 - y0);
+         image_dst->pixels[(y_dst * image_dst->width) + x_dst] =
+                 ((a / count) << 24)
+               | ((r / count) << 16)
+               | ((g / count) <<  8)
+               |  (b / count);
+      }
+   }
+
+   return true;
+}
+
+/* Shrinks the loaded image to fit the prescale dimensions,
+ * and saves the result to the prescale path (via a temporary
+ * file, so that a partially written image is never loaded) */
+static void task_image_prescale(struct nbio_image_handle *image)
+{
+   struct texture_image img_resampled = {
+      NULL,
+      0,
+      0,
+      false
+   };
+
+   if (!downscale_image(image->prescale_width, image->prescale_height,
+            &image->ti, &img_resampled))
+      return;
+
+   free(image->ti.pixels);
+   image->ti.width  = img_resampled.width;
+   image->ti.height = img_resampled.height;
+   image->ti.pixels = img_resampled.pixels;
+
+#ifdef HAVE_RPNG
+   {
+      size_t i;
+      bool saved                  = false;
+      char tmp_path[PATH_MAX_LENGTH];
+      char dir[DIR_MAX_LENGTH];
+      size_t num_pixels           = image->ti.width * image->ti.height;
+      uint32_t *argb              = image->ti.pixels;
+
+      /* rpng saves ARGB pixels */
+      if (image->ti.supports_rgba)
+      {
+         if (!(argb = (uint32_t*)malloc(num_pixels * sizeof(uint32_t))))
+            return;
+         for (i = 0; i < num_pixels; i++)
+         {
+            uint32_t col = image->ti.pixels[i];
+            argb[i]      = (col & 0xFF00FF00)
+                         | ((col & 0x000000FF) << 16)
+                         | ((col & 0x00FF0000) >> 16);
+         }
+      }
+
+      fill_pathname_basedir(dir, image->prescale_path, sizeof(dir));
+      if (!path_is_directory(dir))
+         path_mkdir(dir);
+
+      strlcpy(tmp_path, image->prescale_path, sizeof(tmp_path));
+      strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+      /* Copies are small, and quick to decode at any
+       * compression level - favour saving them quickly */
+      if (rpng_save_image_argb_flags(tmp_path, argb,
+               image->ti.width, image->ti.height,
+               image->ti.width * sizeof(uint32_t),
+               RPNG_SAVE_FLAG_FAST))
+         saved = (filestream_rename(tmp_path, image->prescale_path) == 0);
+
+      if (!saved)
+         filestream_delete(tmp_path);
+
+      if (argb != image->ti.pixels)
+         free(argb);
+   }
+#endif
+}
+
 bool task_image_load_handler(retro_task_t *task)
 {
    uint8_t flg;
@@ -341,6 +503,10 @@ bool task_image_load_handler(retro_task_t *task)
 
       if (img)
       {
+         /* Shrink and save image, if required */
+         if (image->prescale_path)
+            task_image_prescale(image);
+
          /* Upscale image, if required */
          if (image->upscale_threshold > 0)
          {
@@ -392,6 +558,16 @@ bool task_image_load_handler(retro_task_t *task)
 bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_prescaled(fullpath, NULL, 0, 0,
+         supports_rgba, upscale_threshold, cb, user_data);
+}
+
+bool task_push_image_load_prescaled(const char *fullpath,
+      const char *prescale_path,
+      unsigned prescale_width, unsigned prescale_height,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
    struct nbio_image_handle   *image = NULL;
@@ -433,6 +609,10 @@ bool task_push_image_load(const char *fullpath,
    image->frame_duration             = 0;
    image->size                       = 0;
    image->upscale_threshold          = upscale_threshold;
+   image->prescale_path              = string_is_empty(prescale_path)
+         ? NULL : strdup(prescale_path);
+   image->prescale_width             = prescale_width;
+   image->prescale_height            = prescale_height;
    image->handle                     = NULL;
 
    image->ti.width                   = 0;
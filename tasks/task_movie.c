@@ -25,6 +25,7 @@
 #include <file/file_path.h>
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
+#include <array/rbuf.h>
 
 #ifdef _WIN32
 #include <direct.h>
@@ -52,14 +53,80 @@
 #define IDENTIFIER_INDEX   4
 #define HEADER_LEN         6
 
-#define REPLAY_FORMAT_VERSION 1
+#define REPLAY_FORMAT_VERSION 3
 #define REPLAY_MAGIC       0x42535632
 
+/* Recorded replays end with an index of their full checkpoints:
+ * (frame, offset) pairs, then the number of pairs, the offset
+ * of the index and this magic number, all little-endian. */
+#define REPLAY_INDEX_MAGIC 0x42535649
+#define REPLAY_INDEX_TRAILER_LEN (2 * sizeof(uint64_t) + sizeof(uint32_t))
+
 /* Forward declaration */
 bool content_load_state_in_progress(void* data);
 
 /* Private functions */
 
+static void bsv_movie_read_index(bsv_movie_t *handle)
+{
+   size_t i;
+   uint64_t count;
+   uint64_t start;
+   uint32_t magic;
+   uint8_t trailer[REPLAY_INDEX_TRAILER_LEN];
+   int64_t size = intfstream_get_size(handle->file);
+
+   if (size < (int64_t)(handle->min_file_pos + REPLAY_INDEX_TRAILER_LEN))
+      return;
+
+   intfstream_seek(handle->file, size - REPLAY_INDEX_TRAILER_LEN, SEEK_SET);
+   if (intfstream_read(handle->file, trailer, sizeof(trailer)) != sizeof(trailer))
+      return;
+
+   memcpy(&count, trailer, sizeof(uint64_t));
+   memcpy(&start, trailer + sizeof(uint64_t), sizeof(uint64_t));
+   memcpy(&magic, trailer + 2 * sizeof(uint64_t), sizeof(uint32_t));
+   count = swap_if_big64(count);
+   start = swap_if_big64(start);
+   magic = swap_if_big32(magic);
+
+   /* Replays from before the index, or cut short */
+   if (magic != REPLAY_INDEX_MAGIC)
+      return;
+
+   if (     start < handle->min_file_pos
+         || start + count * sizeof(struct bsv_checkpoint_entry)
+            + REPLAY_INDEX_TRAILER_LEN != (uint64_t)size)
+   {
+      RARCH_WARN("[Replay] Ignoring invalid checkpoint index\n");
+      return;
+   }
+
+   if (count)
+   {
+      size_t len = (size_t)count * sizeof(struct bsv_checkpoint_entry);
+
+      if (!RBUF_TRYFIT(handle->checkpoint_index, (size_t)count))
+         return;
+      RBUF_RESIZE(handle->checkpoint_index, (size_t)count);
+
+      intfstream_seek(handle->file, (int64_t)start, SEEK_SET);
+      if (intfstream_read(handle->file, handle->checkpoint_index, len) != (int64_t)len)
+      {
+         RBUF_CLEAR(handle->checkpoint_index);
+         return;
+      }
+
+      for (i = 0; i < (size_t)count; i++)
+      {
+         handle->checkpoint_index[i].frame = swap_if_big64(handle->checkpoint_index[i].frame);
+         handle->checkpoint_index[i].pos   = swap_if_big64(handle->checkpoint_index[i].pos);
+      }
+   }
+
+   handle->stream_end = (int64_t)start;
+}
+
 static bool bsv_movie_init_playback(
       bsv_movie_t *handle, const char *path)
 {
@@ -138,6 +205,8 @@ static bool bsv_movie_init_playback(
    }
 
    handle->min_file_pos = sizeof(header) + state_size;
+   bsv_movie_read_index(handle);
+   intfstream_seek(handle->file, (int64_t)handle->min_file_pos, SEEK_SET);
    bsv_movie_read_next_events(handle);
 
    return true;
@@ -205,13 +274,43 @@ static bool bsv_movie_init_record(
    return true;
 }
 
+static void bsv_movie_write_index(bsv_movie_t *handle)
+{
+   size_t i;
+   uint8_t trailer[REPLAY_INDEX_TRAILER_LEN];
+   size_t count   = RBUF_LEN(handle->checkpoint_index);
+   uint64_t start = swap_if_big64((uint64_t)intfstream_tell(handle->file));
+   uint64_t len   = swap_if_big64((uint64_t)count);
+   uint32_t magic = swap_if_big32(REPLAY_INDEX_MAGIC);
+
+   for (i = 0; i < count; i++)
+   {
+      struct bsv_checkpoint_entry entry;
+      entry.frame = swap_if_big64(handle->checkpoint_index[i].frame);
+      entry.pos   = swap_if_big64(handle->checkpoint_index[i].pos);
+      intfstream_write(handle->file, &entry, sizeof(entry));
+   }
+
+   memcpy(trailer, &len, sizeof(uint64_t));
+   memcpy(trailer + sizeof(uint64_t), &start, sizeof(uint64_t));
+   memcpy(trailer + 2 * sizeof(uint64_t), &magic, sizeof(uint32_t));
+   intfstream_write(handle->file, trailer, sizeof(trailer));
+}
+
 void bsv_movie_free(bsv_movie_t *handle)
 {
+   if (handle->file && !handle->playback)
+      bsv_movie_write_index(handle);
+
    intfstream_close(handle->file);
    free(handle->file);
 
    free(handle->state);
    free(handle->frame_pos);
+   free(handle->checkpoint_state);
+   free(handle->checkpoint_next);
+   free(handle->checkpoint_patch);
+   RBUF_FREE(handle->checkpoint_index);
    free(handle);
 }
 
@@ -223,6 +322,8 @@ static bsv_movie_t *bsv_movie_init_internal(const char *path, enum rarch_movie_t
    if (!handle)
       return NULL;
 
+   handle->checkpoint_pos  = -1;
+
    if (type == RARCH_MOVIE_PLAYBACK)
    {
       if (!bsv_movie_init_playback(handle, path))
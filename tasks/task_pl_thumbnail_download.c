@@ -35,6 +35,7 @@
 #include "../verbosity.h"
 
 #ifdef RARCH_INTERNAL
+#include "../gfx/gfx_thumbnail.h"
 #include "../gfx/gfx_thumbnail_path.h"
 #ifdef HAVE_MENU
 #include "../menu/menu_cbs.h"
@@ -270,6 +271,9 @@ void cb_http_task_download_pl_thumbnail(
       goto finish;
    }
 
+   /* Create pre-scaled copy, if enabled */
+   gfx_thumbnail_prescale_file(transf->path);
+
 finish:
 
    if (!string_is_empty(err))
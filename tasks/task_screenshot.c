@@ -110,12 +110,14 @@ static bool screenshot_dump_direct(screenshot_task_state_t *state)
 
    scaler_ctx_gen_reset(&state->scaler);
 
-   ret = rpng_save_image_bgr24(
+   /* Large frames are deflated on several threads */
+   ret = rpng_save_image_bgr24_flags(
          state->filename,
          state->out_buffer,
          state->width,
          state->height,
-         state->width * 3
+         state->width * 3,
+         RPNG_SAVE_FLAG_PARALLEL
          );
 
    free(state->out_buffer);
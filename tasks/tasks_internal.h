@@ -183,6 +183,16 @@ bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
 
+/* Same as task_push_image_load(), but an image larger
+ * than (prescale_width x prescale_height) is shrunk to
+ * fit, and the result is also saved as a PNG to
+ * 'prescale_path', to be loaded instead next time */
+bool task_push_image_load_prescaled(const char *fullpath,
+      const char *prescale_path,
+      unsigned prescale_width, unsigned prescale_height,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *userdata);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -0,0 +1,389 @@
+/*
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Lossy localhost relay for netplay testing. See README. */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#define MAX_QUEUED 4096
+#define CHUNK_SIZE 4096
+
+struct packet
+{
+   int64_t release;
+   size_t len;
+   unsigned char data[CHUNK_SIZE];
+};
+
+/* TCP chunks are released strictly in order,
+ * datagrams whenever their own delay expires */
+struct queue
+{
+   struct packet *packets[MAX_QUEUED];
+   size_t count;
+};
+
+static unsigned loss_percent = 0;
+static unsigned jitter_ms    = 0;
+static unsigned rto_ms       = 200;
+
+static unsigned long tcp_chunks, tcp_held, udp_datagrams, udp_dropped;
+
+static volatile sig_atomic_t quit = 0;
+
+static int64_t now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool roll_loss(void)
+{
+   return loss_percent && (unsigned)(rand() % 100) < loss_percent;
+}
+
+static unsigned roll_jitter(void)
+{
+   return jitter_ms ? (unsigned)(rand() % (jitter_ms + 1)) : 0;
+}
+
+static void on_signal(int sig)
+{
+   (void)sig;
+   quit = 1;
+}
+
+static bool push(struct queue *q, const void *data, size_t len,
+      int64_t release)
+{
+   struct packet *pkt;
+
+   if (q->count >= MAX_QUEUED)
+      return false;
+   if (!(pkt = (struct packet*)malloc(sizeof(*pkt))))
+      return false;
+
+   memcpy(pkt->data, data, len);
+   pkt->len               = len;
+   pkt->release           = release;
+   q->packets[q->count++] = pkt;
+   return true;
+}
+
+static void pop(struct queue *q, size_t i)
+{
+   free(q->packets[i]);
+   memmove(&q->packets[i], &q->packets[i + 1],
+      (q->count - i - 1) * sizeof(q->packets[0]));
+   q->count--;
+}
+
+/* Queue a chunk of TCP stream, never letting it overtake earlier chunks */
+static void push_tcp(struct queue *q, const void *data, size_t len)
+{
+   int64_t release = now_ms() + roll_jitter();
+
+   tcp_chunks++;
+   if (roll_loss())
+   {
+      release += rto_ms;
+      tcp_held++;
+   }
+
+   if (q->count && q->packets[q->count - 1]->release > release)
+      release = q->packets[q->count - 1]->release;
+
+   push(q, data, len, release);
+}
+
+static bool flush_tcp(struct queue *q, int fd, int64_t now)
+{
+   while (q->count && q->packets[0]->release <= now)
+   {
+      struct packet *pkt = q->packets[0];
+      size_t sent        = 0;
+
+      while (sent < pkt->len)
+      {
+         ssize_t ret = send(fd, pkt->data + sent, pkt->len - sent, 0);
+         if (ret <= 0)
+            return false;
+         sent += ret;
+      }
+
+      pop(q, 0);
+   }
+
+   return true;
+}
+
+static void flush_udp(struct queue *q, int fd,
+      const struct sockaddr_in *to, int64_t now)
+{
+   size_t i = 0;
+
+   while (i < q->count)
+   {
+      struct packet *pkt = q->packets[i];
+
+      if (pkt->release > now)
+      {
+         i++;
+         continue;
+      }
+
+      sendto(fd, pkt->data, pkt->len, 0,
+         (const struct sockaddr*)to, sizeof(*to));
+      pop(q, i);
+   }
+}
+
+static int64_t next_release(const struct queue *q, int64_t next)
+{
+   size_t i;
+
+   for (i = 0; i < q->count; i++)
+      if (next < 0 || q->packets[i]->release < next)
+         next = q->packets[i]->release;
+
+   return next;
+}
+
+static int open_socket(int type, uint16_t port, bool do_bind)
+{
+   struct sockaddr_in addr;
+   int on = 1;
+   int fd = socket(AF_INET, type, 0);
+
+   if (fd < 0)
+      return -1;
+
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+   if (type == SOCK_STREAM)
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+   if (do_bind)
+   {
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family      = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port        = htons(port);
+
+      if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+      {
+         close(fd);
+         return -1;
+      }
+   }
+
+   return fd;
+}
+
+static void usage(const char *argv0)
+{
+   fprintf(stderr,
+      "Usage: %s [-l listen port] [-p host port] [-L loss %%] [-j jitter ms]\n"
+      "       [-r retransmission timeout ms] [-s seed]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   int listen_fd, client_fd, host_fd, udp_client_fd, udp_host_fd;
+   struct sockaddr_in host_addr, host_udp_addr, client_udp_addr;
+   struct queue to_host       = {0};
+   struct queue to_client     = {0};
+   struct queue udp_to_host   = {0};
+   struct queue udp_to_client = {0};
+   bool have_client_udp       = false;
+   uint16_t listen_port       = 55437;
+   uint16_t host_port         = 55435;
+   unsigned seed              = (unsigned)time(NULL);
+
+   while ((opt = getopt(argc, argv, "l:p:L:j:r:s:h")) != -1)
+   {
+      switch (opt)
+      {
+         case 'l':
+            listen_port  = (uint16_t)atoi(optarg);
+            break;
+         case 'p':
+            host_port    = (uint16_t)atoi(optarg);
+            break;
+         case 'L':
+            loss_percent = (unsigned)atoi(optarg);
+            break;
+         case 'j':
+            jitter_ms    = (unsigned)atoi(optarg);
+            break;
+         case 'r':
+            rto_ms       = (unsigned)atoi(optarg);
+            break;
+         case 's':
+            seed         = (unsigned)atoi(optarg);
+            break;
+         default:
+            usage(argv[0]);
+            return 1;
+      }
+   }
+
+   srand(seed);
+   signal(SIGINT, on_signal);
+   signal(SIGTERM, on_signal);
+   signal(SIGPIPE, SIG_IGN);
+
+   memset(&host_addr, 0, sizeof(host_addr));
+   host_addr.sin_family      = AF_INET;
+   host_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   host_addr.sin_port        = htons(host_port);
+   host_udp_addr             = host_addr;
+   host_udp_addr.sin_port    = htons(host_port + 1);
+
+   listen_fd     = open_socket(SOCK_STREAM, listen_port, true);
+   udp_client_fd = open_socket(SOCK_DGRAM, listen_port + 1, true);
+   udp_host_fd   = open_socket(SOCK_DGRAM, 0, false);
+   if (listen_fd < 0 || udp_client_fd < 0 || udp_host_fd < 0
+         || listen(listen_fd, 1) < 0)
+   {
+      perror("netplay-proxy");
+      return 1;
+   }
+
+   fprintf(stderr, "Relaying 127.0.0.1:%u -> 127.0.0.1:%u "
+         "(loss %u%%, jitter %ums, rto %ums, seed %u)\n",
+         listen_port, host_port, loss_percent, jitter_ms, rto_ms, seed);
+
+   if ((client_fd = accept(listen_fd, NULL, NULL)) < 0)
+   {
+      perror("accept");
+      return 1;
+   }
+
+   host_fd = open_socket(SOCK_STREAM, 0, false);
+   if (host_fd < 0 || connect(host_fd,
+         (struct sockaddr*)&host_addr, sizeof(host_addr)) < 0)
+   {
+      perror("connect");
+      return 1;
+   }
+
+   while (!quit)
+   {
+      unsigned char buf[CHUNK_SIZE];
+      struct pollfd fds[4];
+      int64_t now, next = -1;
+      int timeout, i;
+
+      fds[0].fd = client_fd;
+      fds[1].fd = host_fd;
+      fds[2].fd = udp_client_fd;
+      fds[3].fd = udp_host_fd;
+      for (i = 0; i < 4; i++)
+      {
+         fds[i].events  = POLLIN;
+         fds[i].revents = 0;
+      }
+
+      next = next_release(&to_host, next);
+      next = next_release(&to_client, next);
+      next = next_release(&udp_to_host, next);
+      next = next_release(&udp_to_client, next);
+      now  = now_ms();
+      timeout = next < 0 ? 100 : (next > now ? (int)(next - now) : 0);
+
+      if (poll(fds, 4, timeout) < 0 && errno != EINTR)
+         break;
+
+      if (fds[0].revents & (POLLIN | POLLHUP))
+      {
+         ssize_t ret = recv(client_fd, buf, sizeof(buf), 0);
+         if (ret <= 0)
+            break;
+         push_tcp(&to_host, buf, ret);
+      }
+
+      if (fds[1].revents & (POLLIN | POLLHUP))
+      {
+         ssize_t ret = recv(host_fd, buf, sizeof(buf), 0);
+         if (ret <= 0)
+            break;
+         push_tcp(&to_client, buf, ret);
+      }
+
+      if (fds[2].revents & POLLIN)
+      {
+         socklen_t len = sizeof(client_udp_addr);
+         ssize_t ret   = recvfrom(udp_client_fd, buf, sizeof(buf), 0,
+            (struct sockaddr*)&client_udp_addr, &len);
+         if (ret > 0)
+         {
+            have_client_udp = true;
+            udp_datagrams++;
+            if (roll_loss())
+               udp_dropped++;
+            else
+               push(&udp_to_host, buf, ret, now_ms() + roll_jitter());
+         }
+      }
+
+      if (fds[3].revents & POLLIN)
+      {
+         ssize_t ret = recv(udp_host_fd, buf, sizeof(buf), 0);
+         if (ret > 0 && have_client_udp)
+         {
+            udp_datagrams++;
+            if (roll_loss())
+               udp_dropped++;
+            else
+               push(&udp_to_client, buf, ret, now_ms() + roll_jitter());
+         }
+      }
+
+      now = now_ms();
+      if (     !flush_tcp(&to_host, host_fd, now)
+            || !flush_tcp(&to_client, client_fd, now))
+         break;
+      flush_udp(&udp_to_host, udp_host_fd, &host_udp_addr, now);
+      if (have_client_udp)
+         flush_udp(&udp_to_client, udp_client_fd, &client_udp_addr, now);
+   }
+
+   fprintf(stderr, "TCP: %lu chunks, %lu held back for retransmission\n"
+         "UDP: %lu datagrams, %lu dropped\n",
+         tcp_chunks, tcp_held, udp_datagrams, udp_dropped);
+
+   close(client_fd);
+   close(host_fd);
+   close(listen_fd);
+   close(udp_client_fd);
+   close(udp_host_fd);
+
+   return 0;
+}
@@ -0,0 +1,1107 @@
+/*
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Headless netplay spectator relay. See README. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "../../version.all"
+#include "../../network/netplay/netplay_protocol.h"
+
+/* Wire values, see network/netplay/README */
+#define NETPLAY_MAGIC            0x52414E50 /* RANP */
+#define FULL_MAGIC               0x46554C4C /* FULL */
+#define POKE_MAGIC               0x504F4B45 /* POKE */
+#define BANNED_MAGIC             0x44454E59 /* DENY */
+
+#define CMD_DISCONNECT           0x0002
+#define CMD_INPUT                0x0003
+#define CMD_NICK                 0x0020
+#define CMD_PASSWORD             0x0021
+#define CMD_INFO                 0x0022
+#define CMD_SYNC                 0x0023
+#define CMD_PLAY                 0x0025
+#define CMD_MODE                 0x0026
+#define CMD_MODE_REFUSED         0x0027
+#define CMD_REQUEST_SAVESTATE    0x0041
+#define CMD_LOAD_SAVESTATE       0x0042
+#define CMD_PAUSE                0x0043
+#define CMD_RESUME               0x0044
+#define CMD_STALL                0x0045
+#define CMD_STATE_HASH           0x004A
+#define CMD_LOAD_BLOCKS          0x004C
+#define CMD_CFG_ACK              0x0062
+#define CMD_UDP_TOKEN            0x0064
+#define CMD_PING_REQUEST         0x1100
+#define CMD_PING_RESPONSE        0x1101
+#define CMD_SETTING_ALLOW_PAUSING        0x2000
+#define CMD_SETTING_INPUT_LATENCY_FRAMES 0x2001
+
+#define SYNC_BIT_PAUSED          (1U<<31)
+#define MODE_BIT_YOU             (1U<<31)
+#define MODE_BIT_PLAYING         (1U<<30)
+#define MODE_REFUSED_UNPRIVILEGED 1
+
+#define COMPRESSION_ZLIB         (1<<0)
+
+#define NICK_LEN                 32
+#define MAX_INPUT_DEVICES        16
+#define MAX_CLIENTS              32
+
+#define HEADER_SIZE              (6*sizeof(uint32_t))
+#define INFO_PAYLOAD_SIZE        (sizeof(uint32_t) + 2*NICK_LEN)
+#define MODE_PAYLOAD_SIZE        (3*sizeof(uint32_t) + MAX_INPUT_DEVICES + NICK_LEN)
+#define SYNC_FIXED_SIZE          (2*sizeof(uint32_t) \
+      + MAX_INPUT_DEVICES*sizeof(uint32_t) \
+      + MAX_INPUT_DEVICES \
+      + MAX_INPUT_DEVICES*sizeof(uint32_t) \
+      + NICK_LEN)
+
+/* Largest command we accept, and how far behind a spectator may fall */
+#define MAX_COMMAND_SIZE         (64*1024*1024)
+#define MAX_PENDING_OUTPUT       (32*1024*1024)
+
+/* Commands since the cached savestate beyond which we ask for a fresher one,
+ * and beyond which the cache is dropped until it arrives */
+#define LOG_REFRESH_SIZE         (4*1024*1024)
+#define LOG_MAX_SIZE             (32*1024*1024)
+
+/* How long an unanswered savestate request is given */
+#define KEYFRAME_TIMEOUT_MS      10000
+
+struct buf
+{
+   unsigned char *data;
+   size_t len;
+   size_t cap;
+};
+
+enum peer_state
+{
+   PEER_HEADER = 0,
+   PEER_NICK,
+   PEER_INFO,
+   PEER_WAITING,
+   PEER_LIVE
+};
+
+struct peer
+{
+   struct buf in;
+   struct buf out;
+   enum peer_state state;
+   int fd;
+   char nick[NICK_LEN];
+};
+
+enum upstream_state
+{
+   UP_HEADER = 0,
+   UP_NICK,
+   UP_INFO,
+   UP_SYNC,
+   UP_LIVE
+};
+
+/* What a spectator has to be told in SYNC to pick up the stream */
+struct stream_state
+{
+   uint32_t frame;
+   uint32_t config_devices[MAX_INPUT_DEVICES];
+   uint32_t device_clients[MAX_INPUT_DEVICES];
+   uint8_t  share_modes[MAX_INPUT_DEVICES];
+   /* Latest setting commands, complete */
+   unsigned char allow_pausing[3*sizeof(uint32_t)];
+   unsigned char latency_frames[4*sizeof(uint32_t)];
+   bool have_allow_pausing;
+   bool have_latency_frames;
+   bool paused;
+};
+
+struct upstream
+{
+   struct buf in;
+   struct buf out;
+   struct buf sram;
+   /* The host's NICK and INFO commands, served to every spectator */
+   unsigned char nick_cmd[2*sizeof(uint32_t) + NICK_LEN];
+   unsigned char info_cmd[2*sizeof(uint32_t) + INFO_PAYLOAD_SIZE];
+   enum upstream_state state;
+   int fd;
+   uint32_t platform;
+   uint32_t compression;
+   uint32_t protocol;
+   uint32_t impl;
+   uint32_t client_num;
+};
+
+static struct upstream up;
+static struct peer *peers;
+static size_t max_peers = 64;
+
+/* The stream as it is now, and as it was at the cached savestate */
+static struct stream_state cur;
+static struct stream_state key;
+
+/* The cached savestate, as a complete LOAD_SAVESTATE command, and
+ * every command the host sent after it */
+static struct buf keyframe;
+static struct buf stream_log;
+static bool have_keyframe = false;
+
+static bool keyframe_requested = false;
+static int64_t keyframe_requested_at;
+static int64_t keyframe_at;
+static unsigned keyframe_interval_ms = 30000;
+
+static char relay_nick[NICK_LEN] = "Relay";
+
+static unsigned long keyframes_received, spectators_served;
+static unsigned long long bytes_in, bytes_out;
+
+static volatile sig_atomic_t quit = 0;
+
+static int64_t now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void on_signal(int sig)
+{
+   (void)sig;
+   quit = 1;
+}
+
+static bool buf_append(struct buf *b, const void *data, size_t len)
+{
+   if (b->len + len > b->cap)
+   {
+      size_t cap = b->cap ? b->cap : 4096;
+      unsigned char *data_new;
+
+      while (cap < b->len + len)
+         cap *= 2;
+      if (!(data_new = (unsigned char*)realloc(b->data, cap)))
+         return false;
+      b->data = data_new;
+      b->cap  = cap;
+   }
+
+   memcpy(b->data + b->len, data, len);
+   b->len += len;
+   return true;
+}
+
+static void buf_consume(struct buf *b, size_t len)
+{
+   memmove(b->data, b->data + len, b->len - len);
+   b->len -= len;
+}
+
+static void buf_free(struct buf *b)
+{
+   free(b->data);
+   memset(b, 0, sizeof(*b));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+   uint32_t v;
+   memcpy(&v, p, sizeof(v));
+   return ntohl(v);
+}
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+   v = htonl(v);
+   memcpy(p, &v, sizeof(v));
+}
+
+static bool send_cmd(struct buf *out, uint32_t cmd,
+      const void *payload, uint32_t size)
+{
+   unsigned char hdr[2*sizeof(uint32_t)];
+
+   put_u32(hdr, cmd);
+   put_u32(hdr + sizeof(uint32_t), size);
+   return buf_append(out, hdr, sizeof(hdr))
+      && (!size || buf_append(out, payload, size));
+}
+
+/* Same as netplay_platform_magic and netplay_impl_magic */
+static uint32_t platform_magic(void)
+{
+   return ((1 == htonl(1)) << 30)
+      |(sizeof(size_t) << 15)
+      |(sizeof(long));
+}
+
+static uint32_t impl_magic(void)
+{
+   size_t i;
+   uint32_t res    = 0;
+   const char *ver = PACKAGE_VERSION;
+   size_t len      = strlen(ver);
+
+   for (i = 0; i < len; i++)
+      res ^= ver[i] << (i & 0xf);
+
+   res ^= NETPLAY_PROTOCOL_VERSION << (i & 0xf);
+
+   return res;
+}
+
+static int open_listen(uint16_t port)
+{
+   struct sockaddr_in addr;
+   int on = 1;
+   int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+   if (fd < 0)
+      return -1;
+
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   addr.sin_port        = htons(port);
+
+   if (     bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+         || listen(fd, 16) < 0)
+   {
+      close(fd);
+      return -1;
+   }
+
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+   return fd;
+}
+
+static int open_upstream(const char *host, uint16_t port)
+{
+   char service[8];
+   struct addrinfo hints, *res, *ai;
+   int on = 1;
+   int fd = -1;
+
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family   = AF_UNSPEC;
+   hints.ai_socktype = SOCK_STREAM;
+   snprintf(service, sizeof(service), "%u", (unsigned)port);
+
+   if (getaddrinfo(host, service, &hints, &res))
+      return -1;
+
+   for (ai = res; ai; ai = ai->ai_next)
+   {
+      if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0)
+         continue;
+      if (!connect(fd, ai->ai_addr, ai->ai_addrlen))
+         break;
+      close(fd);
+      fd = -1;
+   }
+   freeaddrinfo(res);
+
+   if (fd >= 0)
+   {
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+   }
+
+   return fd;
+}
+
+static void peer_close(struct peer *peer, const char *why)
+{
+   if (why)
+      fprintf(stderr, "Spectator \"%s\" dropped: %s\n",
+            peer->nick[0] ? peer->nick : "?", why);
+   close(peer->fd);
+   buf_free(&peer->in);
+   buf_free(&peer->out);
+   memset(peer, 0, sizeof(*peer));
+   peer->fd = -1;
+}
+
+/* Queue output for a spectator, dropping it if it can't keep up */
+static void peer_send(struct peer *peer, const void *data, size_t len)
+{
+   if (peer->out.len + len > MAX_PENDING_OUTPUT)
+      peer_close(peer, "too far behind");
+   else if (!buf_append(&peer->out, data, len))
+      peer_close(peer, "out of memory");
+}
+
+static void request_keyframe(void)
+{
+   int64_t now = now_ms();
+
+   if (     keyframe_requested
+         && now - keyframe_requested_at < KEYFRAME_TIMEOUT_MS)
+      return;
+
+   send_cmd(&up.out, CMD_REQUEST_SAVESTATE, NULL, 0);
+   keyframe_requested    = true;
+   keyframe_requested_at = now;
+}
+
+/* Start a spectator on the cached savestate: SYNC as of that frame,
+ * the savestate itself, then everything since */
+static void peer_promote(struct peer *peer)
+{
+   size_t i;
+   unsigned char *sync, *p;
+   uint32_t size = (uint32_t)(SYNC_FIXED_SIZE + up.sram.len);
+
+   if (!(sync = (unsigned char*)malloc(size)))
+   {
+      peer_close(peer, "out of memory");
+      return;
+   }
+
+   p = sync;
+   put_u32(p, key.frame);
+   p += sizeof(uint32_t);
+   put_u32(p, up.client_num | (key.paused ? SYNC_BIT_PAUSED : 0));
+   p += sizeof(uint32_t);
+   for (i = 0; i < MAX_INPUT_DEVICES; i++, p += sizeof(uint32_t))
+      put_u32(p, key.config_devices[i]);
+   memcpy(p, key.share_modes, MAX_INPUT_DEVICES);
+   p += MAX_INPUT_DEVICES;
+   for (i = 0; i < MAX_INPUT_DEVICES; i++, p += sizeof(uint32_t))
+      put_u32(p, key.device_clients[i]);
+   memcpy(p, peer->nick, NICK_LEN);
+   p += NICK_LEN;
+   if (up.sram.len)
+      memcpy(p, up.sram.data, up.sram.len);
+
+   if (!send_cmd(&peer->out, CMD_SYNC, sync, size))
+   {
+      free(sync);
+      peer_close(peer, "out of memory");
+      return;
+   }
+   free(sync);
+
+   if (up.protocol >= 6)
+   {
+      if (key.have_allow_pausing)
+         peer_send(peer, key.allow_pausing, sizeof(key.allow_pausing));
+      if (peer->fd >= 0 && key.have_latency_frames)
+         peer_send(peer, key.latency_frames, sizeof(key.latency_frames));
+   }
+
+   if (peer->fd >= 0)
+      peer_send(peer, keyframe.data, keyframe.len);
+   if (peer->fd >= 0 && stream_log.len)
+      peer_send(peer, stream_log.data, stream_log.len);
+
+   if (peer->fd >= 0)
+   {
+      peer->state = PEER_LIVE;
+      spectators_served++;
+      fprintf(stderr, "Spectator \"%s\" joined at frame %u\n",
+            peer->nick, (unsigned)key.frame);
+   }
+}
+
+/* Pass a host command on to every spectator, and remember it for later ones */
+static void broadcast(const unsigned char *cmd, size_t len)
+{
+   size_t i;
+
+   for (i = 0; i < max_peers; i++)
+      if (peers[i].fd >= 0 && peers[i].state == PEER_LIVE)
+         peer_send(&peers[i], cmd, len);
+
+   if (!buf_append(&stream_log, cmd, len))
+      stream_log.len = LOG_MAX_SIZE;
+
+   if (stream_log.len >= LOG_MAX_SIZE)
+   {
+      /* New spectators will have to wait for the next one */
+      have_keyframe   = false;
+      stream_log.len  = 0;
+      request_keyframe();
+   }
+   else if (stream_log.len >= LOG_REFRESH_SIZE)
+      request_keyframe();
+}
+
+static void new_keyframe(const unsigned char *cmd, size_t len)
+{
+   size_t i, pos;
+   struct buf carried = {0};
+   uint32_t frame     = get_u32(cmd + 2*sizeof(uint32_t));
+
+   /* Those already watching load it too, it's in order for them */
+   for (i = 0; i < max_peers; i++)
+      if (peers[i].fd >= 0 && peers[i].state == PEER_LIVE)
+         peer_send(&peers[i], cmd, len);
+
+   /* Players' input is forwarded as it arrives, so some of it may be for
+    * frames at or after this one already; spectators starting here need it */
+   for (pos = 0; pos + 2*sizeof(uint32_t) <= stream_log.len; )
+   {
+      const unsigned char *c = stream_log.data + pos;
+      size_t clen            = 2*sizeof(uint32_t) + get_u32(c + sizeof(uint32_t));
+
+      if (     get_u32(c) == CMD_INPUT
+            && clen >= 3*sizeof(uint32_t)
+            && get_u32(c + 2*sizeof(uint32_t)) >= frame)
+         buf_append(&carried, c, clen);
+      pos += clen;
+   }
+
+   buf_free(&stream_log);
+   stream_log = carried;
+
+   keyframe.len = 0;
+   if (!buf_append(&keyframe, cmd, len))
+   {
+      have_keyframe = false;
+      return;
+   }
+
+   key                = cur;
+   key.frame          = frame;
+   have_keyframe      = true;
+   keyframe_requested = false;
+   keyframe_at        = now_ms();
+   keyframes_received++;
+
+   for (i = 0; i < max_peers; i++)
+      if (peers[i].fd >= 0 && peers[i].state == PEER_WAITING)
+         peer_promote(&peers[i]);
+}
+
+static void track_mode(const unsigned char *payload)
+{
+   size_t i;
+   uint32_t mode       = get_u32(payload + sizeof(uint32_t));
+   uint32_t devices    = get_u32(payload + 2*sizeof(uint32_t));
+   uint32_t client_num = mode & 0xFFFF;
+
+   if (client_num >= MAX_CLIENTS)
+      return;
+
+   memcpy(cur.share_modes, payload + 3*sizeof(uint32_t), MAX_INPUT_DEVICES);
+
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+   {
+      if (mode & MODE_BIT_PLAYING)
+      {
+         if (devices & (1 << i))
+            cur.device_clients[i] |= (1U << client_num);
+      }
+      else
+         cur.device_clients[i] &= ~(1U << client_num);
+   }
+}
+
+/* A command from the host once connected */
+static bool upstream_command(const unsigned char *cmd, size_t len)
+{
+   uint32_t type          = get_u32(cmd);
+   uint32_t size          = (uint32_t)(len - 2*sizeof(uint32_t));
+   const unsigned char *p = cmd + 2*sizeof(uint32_t);
+
+   switch (type)
+   {
+      case CMD_DISCONNECT:
+         fprintf(stderr, "Host disconnected\n");
+         return false;
+
+      case CMD_PING_REQUEST:
+         send_cmd(&up.out, CMD_PING_RESPONSE, NULL, 0);
+         break;
+
+      /* Meant for us alone */
+      case CMD_PING_RESPONSE:
+      case CMD_MODE_REFUSED:
+      case CMD_STALL:
+      case CMD_STATE_HASH:
+      case CMD_LOAD_BLOCKS:
+      case CMD_CFG_ACK:
+      case CMD_UDP_TOKEN:
+         break;
+
+      case CMD_MODE:
+         if (size != MODE_PAYLOAD_SIZE)
+            return false;
+         if (get_u32(p + sizeof(uint32_t)) & MODE_BIT_YOU)
+            break;
+         track_mode(p);
+         broadcast(cmd, len);
+         break;
+
+      case CMD_LOAD_SAVESTATE:
+         if (size < 2*sizeof(uint32_t))
+            return false;
+         new_keyframe(cmd, len);
+         break;
+
+      case CMD_PAUSE:
+      case CMD_RESUME:
+         cur.paused = (type == CMD_PAUSE);
+         broadcast(cmd, len);
+         break;
+
+      case CMD_SETTING_ALLOW_PAUSING:
+         if (len == sizeof(cur.allow_pausing))
+         {
+            memcpy(cur.allow_pausing, cmd, len);
+            cur.have_allow_pausing = true;
+         }
+         broadcast(cmd, len);
+         break;
+
+      case CMD_SETTING_INPUT_LATENCY_FRAMES:
+         if (len == sizeof(cur.latency_frames))
+         {
+            memcpy(cur.latency_frames, cmd, len);
+            cur.have_latency_frames = true;
+         }
+         broadcast(cmd, len);
+         break;
+
+      default:
+         broadcast(cmd, len);
+         break;
+   }
+
+   return true;
+}
+
+/* Our side of the client handshake, then the command stream */
+static bool upstream_process(void)
+{
+   for (;;)
+   {
+      size_t len;
+
+      if (up.state == UP_HEADER)
+      {
+         uint32_t magic;
+
+         if (up.in.len < HEADER_SIZE)
+            return true;
+
+         magic = get_u32(up.in.data);
+         if (magic == FULL_MAGIC || magic == BANNED_MAGIC)
+         {
+            fprintf(stderr, "Host refused the connection (%s)\n",
+                  magic == FULL_MAGIC ? "full" : "banned");
+            return false;
+         }
+         if (magic != NETPLAY_MAGIC)
+         {
+            fprintf(stderr, "Not a RetroArch netplay host\n");
+            return false;
+         }
+         if (get_u32(up.in.data + 3*sizeof(uint32_t)))
+         {
+            fprintf(stderr, "Host wants a password, which isn't supported\n");
+            return false;
+         }
+
+         up.platform    = get_u32(up.in.data + 1*sizeof(uint32_t));
+         up.compression = get_u32(up.in.data + 2*sizeof(uint32_t))
+            & COMPRESSION_ZLIB;
+         up.protocol    = get_u32(up.in.data + 4*sizeof(uint32_t));
+         up.impl        = get_u32(up.in.data + 5*sizeof(uint32_t));
+         buf_consume(&up.in, HEADER_SIZE);
+
+         if (     up.protocol < LOW_NETPLAY_PROTOCOL_VERSION
+               || up.protocol > HIGH_NETPLAY_PROTOCOL_VERSION)
+         {
+            fprintf(stderr, "Host speaks netplay protocol %u\n",
+                  (unsigned)up.protocol);
+            return false;
+         }
+
+         send_cmd(&up.out, CMD_NICK, relay_nick, NICK_LEN);
+         up.state = UP_NICK;
+         continue;
+      }
+
+      if (up.in.len < 2*sizeof(uint32_t))
+         return true;
+      len = 2*sizeof(uint32_t) + get_u32(up.in.data + sizeof(uint32_t));
+      if (len > MAX_COMMAND_SIZE)
+      {
+         fprintf(stderr, "Host sent an oversized command\n");
+         return false;
+      }
+      if (up.in.len < len)
+         return true;
+
+      switch (up.state)
+      {
+         case UP_NICK:
+            if (     get_u32(up.in.data) != CMD_NICK
+                  || len != sizeof(up.nick_cmd))
+               return false;
+            memcpy(up.nick_cmd, up.in.data, len);
+            up.state = UP_INFO;
+            break;
+
+         case UP_INFO:
+            if (     get_u32(up.in.data) != CMD_INFO
+                  || len != sizeof(up.info_cmd))
+            {
+               fprintf(stderr, "Host has no content loaded\n");
+               return false;
+            }
+            /* Claim to be running whatever the host is */
+            memcpy(up.info_cmd, up.in.data, len);
+            buf_append(&up.out, up.info_cmd, len);
+            up.state = UP_SYNC;
+            break;
+
+         case UP_SYNC:
+            {
+               size_t i;
+               const unsigned char *p = up.in.data + 2*sizeof(uint32_t);
+
+               if (     get_u32(up.in.data) != CMD_SYNC
+                     || len < 2*sizeof(uint32_t) + SYNC_FIXED_SIZE)
+                  return false;
+
+               cur.frame     = get_u32(p);
+               up.client_num = get_u32(p + sizeof(uint32_t));
+               cur.paused    = !!(up.client_num & SYNC_BIT_PAUSED);
+               up.client_num &= ~SYNC_BIT_PAUSED;
+               p += 2*sizeof(uint32_t);
+               for (i = 0; i < MAX_INPUT_DEVICES; i++, p += sizeof(uint32_t))
+                  cur.config_devices[i] = get_u32(p);
+               memcpy(cur.share_modes, p, MAX_INPUT_DEVICES);
+               p += MAX_INPUT_DEVICES;
+               for (i = 0; i < MAX_INPUT_DEVICES; i++, p += sizeof(uint32_t))
+                  cur.device_clients[i] = get_u32(p);
+               p += NICK_LEN;
+
+               up.sram.len = 0;
+               buf_append(&up.sram, p,
+                     len - 2*sizeof(uint32_t) - SYNC_FIXED_SIZE);
+
+               fprintf(stderr, "Relaying \"%.*s\" from frame %u\n",
+                     NICK_LEN, (const char*)up.nick_cmd + 2*sizeof(uint32_t),
+                     (unsigned)cur.frame);
+
+               /* The host sends us a savestate now that we're in */
+               keyframe_requested    = true;
+               keyframe_requested_at = now_ms();
+               up.state              = UP_LIVE;
+            }
+            break;
+
+         case UP_LIVE:
+            if (!upstream_command(up.in.data, len))
+               return false;
+            break;
+
+         default:
+            return false;
+      }
+
+      buf_consume(&up.in, len);
+   }
+}
+
+/* The server side of the handshake, as far as spectators need it */
+static void peer_process(struct peer *peer)
+{
+   while (peer->fd >= 0)
+   {
+      size_t len;
+      uint32_t type;
+
+      if (peer->state == PEER_HEADER)
+      {
+         unsigned char hdr[HEADER_SIZE];
+         uint32_t magic, compression;
+
+         if (peer->in.len < sizeof(uint32_t))
+            return;
+
+         magic = get_u32(peer->in.data);
+         if (magic != NETPLAY_MAGIC && magic != POKE_MAGIC)
+         {
+            peer_close(peer, "not netplay");
+            return;
+         }
+
+         put_u32(hdr,                      NETPLAY_MAGIC);
+         put_u32(hdr + 1*sizeof(uint32_t), up.platform);
+         put_u32(hdr + 2*sizeof(uint32_t), up.compression);
+         put_u32(hdr + 3*sizeof(uint32_t), 0);
+         put_u32(hdr + 4*sizeof(uint32_t), up.protocol);
+         put_u32(hdr + 5*sizeof(uint32_t), up.impl);
+
+         if (magic == POKE_MAGIC)
+         {
+            send(peer->fd, hdr, sizeof(hdr), MSG_NOSIGNAL);
+            peer_close(peer, NULL);
+            return;
+         }
+
+         if (peer->in.len < HEADER_SIZE)
+            return;
+
+         /* The savestates we pass on are compressed the host's way */
+         compression = get_u32(peer->in.data + 2*sizeof(uint32_t));
+         if ((compression & up.compression) != up.compression)
+         {
+            peer_close(peer, "no zlib support");
+            return;
+         }
+
+         buf_consume(&peer->in, HEADER_SIZE);
+         peer_send(peer, hdr, sizeof(hdr));
+         peer->state = PEER_NICK;
+         continue;
+      }
+
+      if (peer->in.len < 2*sizeof(uint32_t))
+         return;
+      type = get_u32(peer->in.data);
+      len  = 2*sizeof(uint32_t) + get_u32(peer->in.data + sizeof(uint32_t));
+      if (len > 64*1024)
+      {
+         peer_close(peer, "oversized command");
+         return;
+      }
+      if (peer->in.len < len)
+         return;
+
+      switch (peer->state)
+      {
+         case PEER_NICK:
+            if (type != CMD_NICK || len != 2*sizeof(uint32_t) + NICK_LEN)
+            {
+               peer_close(peer, "no nickname");
+               return;
+            }
+            memcpy(peer->nick, peer->in.data + 2*sizeof(uint32_t), NICK_LEN);
+            peer->nick[NICK_LEN - 1] = '\0';
+            peer_send(peer, up.nick_cmd, sizeof(up.nick_cmd));
+            if (peer->fd >= 0)
+               peer_send(peer, up.info_cmd, sizeof(up.info_cmd));
+            peer->state = PEER_INFO;
+            break;
+
+         case PEER_INFO:
+            {
+               char name[NICK_LEN + 1] = {0}, host_name[NICK_LEN + 1] = {0};
+
+               if (type != CMD_INFO || len != sizeof(up.info_cmd))
+               {
+                  peer_close(peer, "no content loaded");
+                  return;
+               }
+
+               memcpy(name, peer->in.data + 3*sizeof(uint32_t), NICK_LEN);
+               memcpy(host_name, up.info_cmd + 3*sizeof(uint32_t), NICK_LEN);
+               if (strcasecmp(name, host_name))
+               {
+                  peer_close(peer, "different core");
+                  return;
+               }
+
+               if (have_keyframe)
+                  peer_promote(peer);
+               else
+               {
+                  peer->state = PEER_WAITING;
+                  request_keyframe();
+               }
+            }
+            break;
+
+         default:
+            switch (type)
+            {
+               case CMD_DISCONNECT:
+                  peer_close(peer, NULL);
+                  return;
+               case CMD_PING_REQUEST:
+                  send_cmd(&peer->out, CMD_PING_RESPONSE, NULL, 0);
+                  break;
+               case CMD_PLAY:
+                  {
+                     unsigned char reason[sizeof(uint32_t)];
+                     put_u32(reason, MODE_REFUSED_UNPRIVILEGED);
+                     send_cmd(&peer->out, CMD_MODE_REFUSED,
+                           reason, sizeof(reason));
+                  }
+                  break;
+               case CMD_REQUEST_SAVESTATE:
+                  /* It comes to everyone, which does no harm */
+                  request_keyframe();
+                  break;
+               default:
+                  /* Spectators have nothing to say to the host */
+                  break;
+            }
+            break;
+      }
+
+      if (peer->fd >= 0)
+         buf_consume(&peer->in, len);
+   }
+}
+
+static bool flush_out(int fd, struct buf *out)
+{
+   while (out->len)
+   {
+      ssize_t ret = send(fd, out->data, out->len, MSG_NOSIGNAL);
+      if (ret < 0)
+         return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+      bytes_out += ret;
+      buf_consume(out, ret);
+   }
+
+   return true;
+}
+
+static bool read_in(int fd, struct buf *in)
+{
+   unsigned char chunk[65536];
+   ssize_t ret = recv(fd, chunk, sizeof(chunk), 0);
+
+   if (ret == 0)
+      return false;
+   if (ret < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+   bytes_in += ret;
+   return buf_append(in, chunk, ret);
+}
+
+static void usage(const char *argv0)
+{
+   fprintf(stderr,
+      "Usage: %s -H host [-p host port] [-l listen port] [-m max spectators]\n"
+      "       [-k keyframe interval s] [-n nickname]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   int listen_fd;
+   size_t i;
+   struct pollfd *fds;
+   const char *host     = NULL;
+   uint16_t host_port   = 55435;
+   uint16_t listen_port = 55436;
+   unsigned char hdr[HEADER_SIZE];
+
+   while ((opt = getopt(argc, argv, "H:p:l:m:k:n:h")) != -1)
+   {
+      switch (opt)
+      {
+         case 'H':
+            host                 = optarg;
+            break;
+         case 'p':
+            host_port            = (uint16_t)atoi(optarg);
+            break;
+         case 'l':
+            listen_port          = (uint16_t)atoi(optarg);
+            break;
+         case 'm':
+            max_peers            = (size_t)atoi(optarg);
+            break;
+         case 'k':
+            keyframe_interval_ms = (unsigned)atoi(optarg) * 1000;
+            break;
+         case 'n':
+            strncpy(relay_nick, optarg, sizeof(relay_nick) - 1);
+            break;
+         default:
+            usage(argv[0]);
+            return 1;
+      }
+   }
+
+   if (!host || !max_peers)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   signal(SIGINT, on_signal);
+   signal(SIGTERM, on_signal);
+   signal(SIGPIPE, SIG_IGN);
+
+   peers = (struct peer*)calloc(max_peers, sizeof(*peers));
+   fds   = (struct pollfd*)calloc(max_peers + 2, sizeof(*fds));
+   if (!peers || !fds)
+      return 1;
+   for (i = 0; i < max_peers; i++)
+      peers[i].fd = -1;
+
+   if ((listen_fd = open_listen(listen_port)) < 0)
+   {
+      perror("netplay-relay");
+      return 1;
+   }
+
+   if ((up.fd = open_upstream(host, host_port)) < 0)
+   {
+      fprintf(stderr, "Couldn't connect to %s:%u\n", host,
+            (unsigned)host_port);
+      return 1;
+   }
+
+   /* Introduce ourselves as a client */
+   put_u32(hdr,                      NETPLAY_MAGIC);
+   put_u32(hdr + 1*sizeof(uint32_t), platform_magic());
+   put_u32(hdr + 2*sizeof(uint32_t), COMPRESSION_ZLIB);
+   put_u32(hdr + 3*sizeof(uint32_t), HIGH_NETPLAY_PROTOCOL_VERSION);
+   put_u32(hdr + 4*sizeof(uint32_t), LOW_NETPLAY_PROTOCOL_VERSION);
+   put_u32(hdr + 5*sizeof(uint32_t), impl_magic());
+   buf_append(&up.out, hdr, sizeof(hdr));
+
+   fprintf(stderr, "Relaying %s:%u to spectators on port %u\n",
+         host, (unsigned)host_port, (unsigned)listen_port);
+
+   while (!quit)
+   {
+      size_t nfds = 0;
+      int64_t now;
+
+      fds[nfds].fd       = up.fd;
+      fds[nfds].events   = POLLIN | (up.out.len ? POLLOUT : 0);
+      fds[nfds++].revents = 0;
+
+      /* Nobody can join until we know what to tell them */
+      fds[nfds].fd       = up.state == UP_LIVE ? listen_fd : -1;
+      fds[nfds].events   = POLLIN;
+      fds[nfds++].revents = 0;
+
+      for (i = 0; i < max_peers; i++)
+      {
+         fds[nfds].fd      = peers[i].fd;
+         fds[nfds].events  = POLLIN | (peers[i].out.len ? POLLOUT : 0);
+         fds[nfds++].revents = 0;
+      }
+
+      if (poll(fds, nfds, 1000) < 0 && errno != EINTR)
+         break;
+
+      if (fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+      {
+         if (!read_in(up.fd, &up.in))
+         {
+            fprintf(stderr, "Lost the host\n");
+            break;
+         }
+         if (!upstream_process())
+            break;
+      }
+
+      if (fds[1].revents & POLLIN)
+      {
+         int fd = accept(listen_fd, NULL, NULL);
+
+         if (fd >= 0)
+         {
+            for (i = 0; i < max_peers; i++)
+               if (peers[i].fd < 0)
+                  break;
+
+            if (i == max_peers)
+            {
+               unsigned char full[sizeof(uint32_t)];
+               put_u32(full, FULL_MAGIC);
+               send(fd, full, sizeof(full), MSG_NOSIGNAL);
+               close(fd);
+            }
+            else
+            {
+               int on = 1;
+               setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+               fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+               peers[i].fd    = fd;
+               peers[i].state = PEER_HEADER;
+            }
+         }
+      }
+
+      for (i = 0; i < max_peers; i++)
+      {
+         struct peer *peer = &peers[i];
+
+         if (peer->fd < 0 || !(fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+
+         if (!read_in(peer->fd, &peer->in))
+            peer_close(peer, peer->state == PEER_LIVE ? NULL : "hung up");
+         else
+            peer_process(peer);
+      }
+
+      /* Keep the cache fresh so joining doesn't replay minutes of input */
+      now = now_ms();
+      if (     up.state == UP_LIVE
+            && have_keyframe
+            && keyframe_interval_ms
+            && now - keyframe_at >= keyframe_interval_ms)
+         request_keyframe();
+
+      if (!flush_out(up.fd, &up.out))
+      {
+         fprintf(stderr, "Lost the host\n");
+         break;
+      }
+      for (i = 0; i < max_peers; i++)
+         if (peers[i].fd >= 0 && !flush_out(peers[i].fd, &peers[i].out))
+            peer_close(&peers[i], "send failed");
+   }
+
+   fprintf(stderr, "%lu savestates cached, %lu spectators served; "
+         "%llu bytes in, %llu bytes out\n",
+         keyframes_received, spectators_served, bytes_in, bytes_out);
+
+   for (i = 0; i < max_peers; i++)
+      if (peers[i].fd >= 0)
+         peer_close(&peers[i], NULL);
+   close(up.fd);
+   close(listen_fd);
+
+   return 0;
+}